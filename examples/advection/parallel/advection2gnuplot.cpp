@@ -39,6 +39,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "string"
 #include "tuple"
 #include "unordered_map"
+#include "utility"
 #include "vector"
 
 #include "dccrg_cartesian_geometry.hpp"
@@ -46,6 +47,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "dccrg_topology.hpp"
 
 #include "advection_variables.hpp"
+#include "read_cells.hpp"
 
 using namespace std;
 using namespace advection;
@@ -137,62 +139,28 @@ int main(int argc, char* argv[])
 		);
 
 		// read cell data
+		vector<uint64_t> file_offsets;
+		file_offsets.reserve(cells_offsets.size());
+		for (const auto& item: cells_offsets) {
+			file_offsets.push_back(item.second);
+		}
+
+		Cell::set_transfer_all(true, Density(), Velocity());
+		vector<Cell> cells;
+		if (not gensimcell::read_cells(file, file_offsets, cells)) {
+			cerr << "Process " << rank
+				<< " couldn't read cell data from file " << argv_string
+				<< endl;
+			MPI_File_close(&file);
+			continue;
+		}
+
 		unordered_map<
 			uint64_t,
 			Cell
 		> simulation_data;
-		Cell::set_transfer_all(true, Density(), Velocity());
-
-		for (const auto& item: cells_offsets) {
-			const uint64_t
-				cell_id = item.first,
-				file_address = item.second;
-
-			simulation_data[cell_id];
-
-			/*
-			dccrg writes cell data without padding so store the
-			non-padded version of the cell's datatype into file_datatype
-			*/
-			void* memory_address = NULL;
-			int memory_count = -1;
-			MPI_Datatype
-				memory_datatype = MPI_DATATYPE_NULL,
-				file_datatype = MPI_DATATYPE_NULL;
-
-			tie(
-				memory_address,
-				memory_count,
-				memory_datatype
-			) = simulation_data.at(cell_id).get_mpi_datatype();
-
-			int sizeof_memory_datatype;
-			MPI_Type_size(memory_datatype, &sizeof_memory_datatype);
-			MPI_Type_contiguous(sizeof_memory_datatype, MPI_BYTE, &file_datatype);
-
-			// interpret data from the file using the non-padded type
-			MPI_Type_commit(&file_datatype);
-			MPI_File_set_view(
-				file,
-				file_address,
-				MPI_BYTE,
-				file_datatype,
-				const_cast<char*>("native"),
-				MPI_INFO_NULL
-			);
-
-			MPI_Type_commit(&memory_datatype);
-			MPI_File_read_at(
-				file,
-				0,
-				memory_address,
-				memory_count,
-				memory_datatype,
-				MPI_STATUS_IGNORE
-			);
-
-			MPI_Type_free(&memory_datatype);
-			MPI_Type_free(&file_datatype);
+		for (size_t i = 0; i < cells_offsets.size(); i++) {
+			simulation_data[cells_offsets[i].first] = std::move(cells[i]);
 		}
 
 		MPI_File_close(&file);
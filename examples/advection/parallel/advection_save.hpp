@@ -35,6 +35,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cstdlib"
 #include "iomanip"
+#include "iostream"
 #include "mpi.h"
 #include "sstream"
 #include "string"
@@ -44,6 +45,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "dccrg_cartesian_geometry.hpp"
 
 #include "gensimcell.hpp"
+#include "schema.hpp"
 
 //! see ../serial.cpp for the basics
 
@@ -56,6 +58,10 @@ The variables Density_T and Velocity_T are used to refer
 to the particular data to be saved.
 Assumes that the transfer of all variables
 had been disabled before this function was called. 
+
+Also saves the gensimcell::Schema of cell data into a
+file with the same name and .schema appended so the data
+can be decoded without the Cell_T type.
 */
 template<
 	class Cell_T,
@@ -79,11 +85,16 @@ template<
 	char dummy;
 	std::tuple<void*, int, MPI_Datatype> header{(void*) &dummy, 0, MPI_BYTE};
 
-	grid.save_grid_data(
-		"advection_" + time_string.str() + ".dc",
-		0,
-		header
-	);
+	const std::string file_name("advection_" + time_string.str() + ".dc");
+
+	grid.save_grid_data(file_name, 0, header);
+
+	if (grid.get_rank() == 0) {
+		const auto schema = gensimcell::Schema::create(Cell_T());
+		if (not schema.write(file_name + ".schema")) {
+			std::cerr << "Couldn't write schema of " << file_name << std::endl;
+		}
+	}
 
 	Cell_T::set_transfer_all(false, Density_T(), Velocity_T());
 }
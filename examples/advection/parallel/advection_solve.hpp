@@ -41,6 +41,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "dccrg_cartesian_geometry.hpp"
 
 #include "gensimcell.hpp"
+#include "kernel_access.hpp"
+#include "parallel_for.hpp"
 
 //! see ../serial.cpp for the basics
 
@@ -48,24 +50,31 @@ namespace advection {
 
 /*!
 Calculates the flux of advected density into (+) and
-out of (-) each given cell in given grid over given time.
+out of (-) one cell over given time.
 
-Returns the longest allowed time step for given cells
-and their neighbors.
+Returns the longest allowed time step for the cell
+and its neighbors.
 */
 template<
 	class Cell_T,
 	class Density_T,
 	class Density_Flux_T,
 	class Velocity_T
-> double solve(
-	const double dt,
-	const std::vector<uint64_t>& cell_ids,
-	dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& grid
-) {
-	double max_time_step = std::numeric_limits<double>::max();
-
-	for (auto cell_id: cell_ids) {
+> struct Solve_Kernel :
+	gensimcell::Reads<Density_T, Velocity_T>,
+	gensimcell::Writes<Density_Flux_T>
+{
+	double dt;
+
+	explicit Solve_Kernel(const double given_dt) :
+		dt(given_dt)
+	{}
+
+	double operator()(
+		const uint64_t cell_id,
+		dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& grid
+	) const {
+		double max_time_step = std::numeric_limits<double>::max();
 
 		/*
 		Unoptimized version that only changes the data of the current
@@ -88,8 +97,8 @@ template<
 		const auto length = grid.geometry.get_length(cell_id);
 
 		// advection out of current cell in x and y directions
-		flux -= fabs(n * v[0] * dt / length[0]);
-		flux -= fabs(n * v[1] * dt / length[1]);
+		flux -= fabs(n * v[0] * this->dt / length[0]);
+		flux -= fabs(n * v[1] * this->dt / length[1]);
 
 		// check time step
 		max_time_step =
@@ -128,7 +137,7 @@ template<
 
 			const auto neigh_length = grid.geometry.get_length(neighbor_id);
 
-			flux += fabs(neigh_n * neigh_v[dim] * dt / neigh_length[dim]);
+			flux += fabs(neigh_n * neigh_v[dim] * this->dt / neigh_length[dim]);
 
 			max_time_step
 				= std::min(
@@ -136,24 +145,52 @@ template<
 					fabs(neigh_length[dim] / neigh_v[dim])
 				);
 		}
-	}
 
-	return max_time_step;
-}
+		return max_time_step;
+	}
+};
 
 
 /*!
-Applies the density fluxes in given cells.
+Calculates the flux of advected density into (+) and
+out of (-) each given cell in given grid over given time.
+
+Returns the longest allowed time step for given cells
+and their neighbors. Cells are processed in parallel by
+gensimcell's default thread pool.
 */
 template<
 	class Cell_T,
 	class Density_T,
-	class Density_Flux_T
-> void apply_solution(
+	class Density_Flux_T,
+	class Velocity_T
+> double solve(
+	const double dt,
 	const std::vector<uint64_t>& cell_ids,
 	dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& grid
 ) {
-	for (auto cell_id: cell_ids) {
+	return gensimcell::parallel_min_cells(
+		cell_ids,
+		grid,
+		Solve_Kernel<Cell_T, Density_T, Density_Flux_T, Velocity_T>(dt)
+	);
+}
+
+
+/*!
+Applies the density flux of one cell.
+*/
+template<
+	class Cell_T,
+	class Density_T,
+	class Density_Flux_T
+> struct Apply_Kernel :
+	gensimcell::Writes<Density_T, Density_Flux_T>
+{
+	void operator()(
+		const uint64_t cell_id,
+		dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& grid
+	) const {
 		Cell_T* data = grid[cell_id];
 		if (data == NULL) {
 			std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
@@ -162,6 +199,25 @@ template<
 		(*data)[Density_T()] += (*data)[Density_Flux_T()];
 		(*data)[Density_Flux_T()] = 0;
 	}
+};
+
+
+/*!
+Applies the density fluxes in given cells.
+*/
+template<
+	class Cell_T,
+	class Density_T,
+	class Density_Flux_T
+> void apply_solution(
+	const std::vector<uint64_t>& cell_ids,
+	dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& grid
+) {
+	gensimcell::parallel_for_cells(
+		cell_ids,
+		grid,
+		Apply_Kernel<Cell_T, Density_T, Density_Flux_T>()
+	);
 }
 
 
@@ -42,6 +42,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "dccrg.hpp"
 #include "dccrg_cartesian_geometry.hpp"
 #include "gensimcell.hpp"
+#include "reduction.hpp"
 
 #include "advection_initialize.hpp"
 #include "advection_save.hpp"
@@ -56,13 +57,21 @@ int main(int argc, char* argv[])
 	/*
 	Set up MPI
 	*/
-	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
-		std::cerr << "Coudln't initialize MPI." << std::endl;
+	// cells are solved by threads but only main thread calls MPI
+	int provided = MPI_THREAD_SINGLE;
+	if (
+		MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided) != MPI_SUCCESS
+		or provided < MPI_THREAD_FUNNELED
+	) {
+		std::cerr << "Couldn't initialize MPI with MPI_THREAD_FUNNELED." << std::endl;
 		abort();
 	}
 
 	MPI_Comm comm = MPI_COMM_WORLD;
 
+	// share hardware threads of each node between its processes
+	gensimcell::set_default_nr_threads(gensimcell::get_nr_threads_per_process(comm));
+
 	int rank = 0, comm_size = 0;
 	MPI_Comm_rank(comm, &rank);
 	MPI_Comm_size(comm, &comm_size);
@@ -133,13 +142,17 @@ int main(int argc, char* argv[])
 
 	double advection_next_save = 0;
 
+	// reduced while the solution is applied
+	gensimcell::Async_Reduction<double> time_step_reduction(
+		comm,
+		gensimcell::Reduction::min
+	);
+
 	double
 		simulation_time = 0,
 		time_step = 0;
 	while (simulation_time <= M_PI) {
 
-		double next_time_step = std::numeric_limits<double>::max();
-
 		/*
 		Save simulation to disk
 		*/
@@ -176,29 +189,33 @@ int main(int argc, char* argv[])
 		);
 		grid.start_remote_neighbor_copy_updates();
 
-		next_time_step
-			= std::min(
-				next_time_step,
-				advection::solve<
-					Cell,
-					advection::Density,
-					advection::Density_Flux,
-					advection::Velocity
-				>(time_step, inner_cells, grid)
-			);
+		time_step_reduction.add(
+			advection::solve<
+				Cell,
+				advection::Density,
+				advection::Density_Flux,
+				advection::Velocity
+			>(time_step, inner_cells, grid)
+		);
 
 		grid.wait_remote_neighbor_copy_update_receives();
 
-		next_time_step
-			= std::min(
-				next_time_step,
-				advection::solve<
-					Cell,
-					advection::Density,
-					advection::Density_Flux,
-					advection::Velocity
-				>(time_step, outer_cells, grid)
-			);
+		time_step_reduction.add(
+			advection::solve<
+				Cell,
+				advection::Density,
+				advection::Density_Flux,
+				advection::Velocity
+			>(time_step, outer_cells, grid)
+		);
+
+		// overlap the time step reduction with rest of the step
+		if (not time_step_reduction.start()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< ": Couldn't start time step reduction."
+				<< std::endl;
+			abort();
+		}
 
 		/*
 		Apply solution
@@ -224,9 +241,14 @@ int main(int argc, char* argv[])
 
 		simulation_time += time_step;
 
-		MPI_Allreduce(&next_time_step, &time_step, 1, MPI_DOUBLE, MPI_MIN, comm);
+		if (not time_step_reduction.wait()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< ": Couldn't reduce time step."
+				<< std::endl;
+			abort();
+		}
 		const double CFL = 0.5;
-		time_step *= CFL;
+		time_step = CFL * time_step_reduction.get_result();
 	}
 
 	MPI_Finalize();
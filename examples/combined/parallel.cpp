@@ -42,6 +42,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "dccrg.hpp"
 #include "dccrg_cartesian_geometry.hpp"
 #include "gensimcell.hpp"
+#include "fused_kernel.hpp"
+#include "parallel_for.hpp"
+#include "reduction.hpp"
 
 #include "gol_initialize.hpp"
 #include "gol_save.hpp"
@@ -62,16 +65,58 @@ int main(int argc, char* argv[])
 	// the cell type used by this program
 	using Cell = combined::Cell;
 
+	// kernels of each model that are fused into one pass over cells
+	using GoL_Solve_Kernel = gol::Solve_Kernel<
+		Cell,
+		gol::Is_Alive,
+		gol::Live_Neighbors
+	>;
+	using GoL_Apply_Kernel = gol::Apply_Kernel<
+		Cell,
+		gol::Is_Alive,
+		gol::Live_Neighbors
+	>;
+	using Advection_Solve_Kernel = advection::Solve_Kernel<
+		Cell,
+		advection::Density,
+		advection::Density_Flux,
+		advection::Velocity
+	>;
+	using Advection_Apply_Kernel = advection::Apply_Kernel<
+		Cell,
+		advection::Density,
+		advection::Density_Flux
+	>;
+	using Incorporate_Kernel = particle::Incorporate_Kernel<
+		Cell,
+		particle::Number_Of_Internal_Particles,
+		particle::Internal_Particles,
+		particle::External_Particles
+	>;
+	using Remove_Kernel = particle::Remove_Kernel<
+		Cell,
+		particle::Number_Of_External_Particles,
+		particle::External_Particles
+	>;
+
 	/*
 	Set up MPI
 	*/
-	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
-		std::cerr << "Coudln't initialize MPI." << std::endl;
+	// cells are solved by threads but only main thread calls MPI
+	int provided = MPI_THREAD_SINGLE;
+	if (
+		MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided) != MPI_SUCCESS
+		or provided < MPI_THREAD_FUNNELED
+	) {
+		std::cerr << "Couldn't initialize MPI with MPI_THREAD_FUNNELED." << std::endl;
 		abort();
 	}
 
 	MPI_Comm comm = MPI_COMM_WORLD;
 
+	// share hardware threads of each node between its processes
+	gensimcell::set_default_nr_threads(gensimcell::get_nr_threads_per_process(comm));
+
 	int rank = 0, comm_size = 0;
 	MPI_Comm_rank(comm, &rank);
 	MPI_Comm_size(comm, &comm_size);
@@ -160,13 +205,17 @@ int main(int argc, char* argv[])
 	double advection_next_save = 0;
 	double particle_next_save = 0;
 
+	// reduced while the solution is applied
+	gensimcell::Async_Reduction<double> time_step_reduction(
+		comm,
+		gensimcell::Reduction::min
+	);
+
 	double
 		simulation_time = 0,
 		time_step = 0;
 	while (simulation_time <= M_PI) {
 
-		double next_time_step = std::numeric_limits<double>::max();
-
 		/*
 		Save simulations
 		*/
@@ -228,34 +277,30 @@ int main(int argc, char* argv[])
 		Solve
 		*/
 
-		next_time_step
-			= std::min(
-				next_time_step,
-				particle::solve<
-					Cell,
-					particle::Number_Of_Internal_Particles,
-					particle::Number_Of_External_Particles,
-					particle::Velocity,
-					particle::Internal_Particles,
-					particle::External_Particles
-				>(time_step, outer_cells, grid)
-			);
+		time_step_reduction.add(
+			particle::solve<
+				Cell,
+				particle::Number_Of_Internal_Particles,
+				particle::Number_Of_External_Particles,
+				particle::Velocity,
+				particle::Internal_Particles,
+				particle::External_Particles
+			>(time_step, outer_cells, grid)
+		);
 
 		Cell::set_transfer_all(true, particle::Number_Of_External_Particles());
 		grid.start_remote_neighbor_copy_updates();
 
-		next_time_step
-			= std::min(
-				next_time_step,
-				particle::solve<
-					Cell,
-					particle::Number_Of_Internal_Particles,
-					particle::Number_Of_External_Particles,
-					particle::Velocity,
-					particle::Internal_Particles,
-					particle::External_Particles
-				>(time_step, inner_cells, grid)
-			);
+		time_step_reduction.add(
+			particle::solve<
+				Cell,
+				particle::Number_Of_Internal_Particles,
+				particle::Number_Of_External_Particles,
+				particle::Velocity,
+				particle::Internal_Particles,
+				particle::External_Particles
+			>(time_step, inner_cells, grid)
+		);
 
 
 		grid.wait_remote_neighbor_copy_update_receives();
@@ -283,101 +328,74 @@ int main(int argc, char* argv[])
 		grid.start_remote_neighbor_copy_updates();
 
 
-		gol::solve<
-			Cell,
-			gol::Is_Alive,
-			gol::Live_Neighbors
-		>(inner_cells, grid);
-
-		next_time_step
-			= std::min(
-				next_time_step,
-				advection::solve<
-					Cell,
-					advection::Density,
-					advection::Density_Flux,
-					advection::Velocity
-				>(time_step, inner_cells, grid)
-			);
-
-		particle::incorporate_external_particles<
-			Cell,
-			particle::Number_Of_Internal_Particles,
-			particle::Internal_Particles,
-			particle::External_Particles
-		>(inner_cells, grid);
+		/*
+		Solve game of life and advection and incorporate
+		particles from neighbors in one pass over cells
+		*/
+		time_step_reduction.add_cells(
+			inner_cells,
+			grid,
+			gensimcell::fuse(
+				Incorporate_Kernel(),
+				GoL_Solve_Kernel(),
+				Advection_Solve_Kernel(time_step)
+			)
+		);
 
 		grid.wait_remote_neighbor_copy_update_receives();
 
 
-		gol::solve<
-			Cell,
-			gol::Is_Alive,
-			gol::Live_Neighbors
-		>(outer_cells, grid);
-
-		next_time_step
-			= std::min(
-				next_time_step,
-				advection::solve<
-					Cell,
-					advection::Density,
-					advection::Density_Flux,
-					advection::Velocity
-				>(time_step, outer_cells, grid)
-			);
-
-		gol::apply_solution<
-			Cell,
-			gol::Is_Alive,
-			gol::Live_Neighbors
-		>(inner_cells, grid);
-
-		advection::apply_solution<
-			Cell,
-			advection::Density,
-			advection::Density_Flux
-		>(inner_cells, grid);
+		time_step_reduction.add_cells(
+			outer_cells,
+			grid,
+			gensimcell::fuse(
+				Incorporate_Kernel(),
+				GoL_Solve_Kernel(),
+				Advection_Solve_Kernel(time_step)
+			)
+		);
 
-		particle::incorporate_external_particles<
-			Cell,
-			particle::Number_Of_Internal_Particles,
-			particle::Internal_Particles,
-			particle::External_Particles
-		>(outer_cells, grid);
+		// overlap the time step reduction with rest of the step
+		if (not time_step_reduction.start()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< ": Couldn't start time step reduction."
+				<< std::endl;
+			abort();
+		}
 
-		particle::remove_external_particles<
-			Cell,
-			particle::Number_Of_External_Particles,
-			particle::External_Particles
-		>(inner_cells, grid);
+		gensimcell::parallel_for_cells(
+			inner_cells,
+			grid,
+			gensimcell::fuse(
+				GoL_Apply_Kernel(),
+				Advection_Apply_Kernel(),
+				Remove_Kernel()
+			)
+		);
 
 		grid.wait_remote_neighbor_copy_update_sends();
 
 
-		gol::apply_solution<
-			Cell,
-			gol::Is_Alive,
-			gol::Live_Neighbors
-		>(outer_cells, grid);
-
-		advection::apply_solution<
-			Cell,
-			advection::Density,
-			advection::Density_Flux
-		>(outer_cells, grid);
-
-		particle::remove_external_particles<
-			Cell,
-			particle::Number_Of_External_Particles,
-			particle::External_Particles
-		>(outer_cells, grid);
+		gensimcell::parallel_for_cells(
+			outer_cells,
+			grid,
+			gensimcell::fuse(
+				GoL_Apply_Kernel(),
+				Advection_Apply_Kernel(),
+				Remove_Kernel()
+			)
+		);
 
 		simulation_time += time_step;
 
-		MPI_Allreduce(&next_time_step, &time_step, 1, MPI_DOUBLE, MPI_MIN, comm);
+		if (not time_step_reduction.wait()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< ": Couldn't reduce time step."
+				<< std::endl;
+			abort();
+		}
 		const double CFL = 0.5;
-		time_step *= CFL;
+		time_step = CFL * time_step_reduction.get_result();
 	}
 
 	MPI_Finalize();
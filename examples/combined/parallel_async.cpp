@@ -1,5 +1,6 @@
 /*
-Same as parallel.cpp but takes advantage of additional threads via std::async.
+Same as parallel.cpp but takes advantage of additional threads by
+running the solvers as tasks of a gensimcell::Task_Graph.
 
 Copyright 2013, 2014, 2015, 2016 Ilja Honkonen
 All rights reserved.
@@ -36,13 +37,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "boost/lexical_cast.hpp"
 #include "cmath"
 #include "cstdlib"
-#include "future"
 #include "iostream"
 #include "mpi.h"
 
 #include "dccrg.hpp"
 #include "dccrg_cartesian_geometry.hpp"
 #include "gensimcell.hpp"
+#include "task_graph.hpp"
 
 #include "gol_initialize.hpp"
 #include "gol_save.hpp"
@@ -66,13 +67,21 @@ int main(int argc, char* argv[])
 	/*
 	Set up MPI
 	*/
-	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
-		std::cerr << "Coudln't initialize MPI." << std::endl;
+	// cells are solved by threads but only main thread calls MPI
+	int provided = MPI_THREAD_SINGLE;
+	if (
+		MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided) != MPI_SUCCESS
+		or provided < MPI_THREAD_FUNNELED
+	) {
+		std::cerr << "Couldn't initialize MPI with MPI_THREAD_FUNNELED." << std::endl;
 		abort();
 	}
 
 	MPI_Comm comm = MPI_COMM_WORLD;
 
+	// share hardware threads of each node between its processes
+	gensimcell::set_default_nr_threads(gensimcell::get_nr_threads_per_process(comm));
+
 	int rank = 0, comm_size = 0;
 	MPI_Comm_rank(comm, &rank);
 	MPI_Comm_size(comm, &comm_size);
@@ -164,107 +173,287 @@ int main(int argc, char* argv[])
 		simulation_time = 0,
 		time_step = 0;
 
+	// cells whose time step is solved by each task
+	double
+		particle_outer_time_step = 0,
+		particle_inner_time_step = 0,
+		advection_inner_time_step = 0,
+		advection_outer_time_step = 0;
+
+	using gensimcell::Cell_Set;
+	using gensimcell::reads;
+	using gensimcell::writes;
+
 	/*
-	Function templates are not suitable for std::async so make lambdas
+	Tasks of one time step in serial order, the graph runs
+	them in parallel when the variables and cells they read
+	and write allow it and overlaps exchanges with solving
 	*/
+	gensimcell::Task_Graph graph;
 
-	// game of life
-	auto gol_inner_solve = [&](){
-		return gol::solve<
-			Cell,
-			gol::Is_Alive,
-			gol::Live_Neighbors
-		>(inner_cells, grid);
-	};
-	auto gol_outer_solve = [&](){
-		return gol::solve<
-			Cell,
-			gol::Is_Alive,
-			gol::Live_Neighbors
-		>(outer_cells, grid);
-	};
-	auto gol_inner_apply = [&](){
-		return gol::apply_solution<
-			Cell,
-			gol::Is_Alive,
-			gol::Live_Neighbors
-		>(inner_cells, grid);
-	};
-	auto gol_outer_apply = [&](){
-		return gol::apply_solution<
-			Cell,
-			gol::Is_Alive,
-			gol::Live_Neighbors
-		>(outer_cells, grid);
-	};
-
-	// advection
-	auto advection_inner_solve = [&](){
-		return advection::solve<
-			Cell,
-			advection::Density,
-			advection::Density_Flux,
-			advection::Velocity
-		>(time_step, inner_cells, grid);
-	};
-	auto advection_outer_solve = [&](){
-		return advection::solve<
-			Cell,
-			advection::Density,
-			advection::Density_Flux,
-			advection::Velocity
-		>(time_step, outer_cells, grid);
-	};
-	auto advection_inner_apply = [&](){
-		return advection::apply_solution<
-			Cell,
-			advection::Density,
-			advection::Density_Flux
-		>(inner_cells, grid);
-	};
-	auto advection_outer_apply = [&](){
-		return advection::apply_solution<
-			Cell,
-			advection::Density,
-			advection::Density_Flux
-		>(outer_cells, grid);
-	};
-
-	// particle propagation
-	auto particle_incorporate_inner = [&](){
-		return particle::incorporate_external_particles<
-			Cell,
+	// particles leaving outer cells are needed by neighbors first
+	graph.add_task(
+		reads<
+			particle::Velocity,
+			particle::Internal_Particles,
+			particle::External_Particles
+		>(Cell_Set::outer)
+		+ writes<
 			particle::Number_Of_Internal_Particles,
+			particle::Number_Of_External_Particles,
+			particle::Internal_Particles,
+			particle::External_Particles
+		>(Cell_Set::outer),
+		[&](){
+			particle_outer_time_step = particle::solve<
+				Cell,
+				particle::Number_Of_Internal_Particles,
+				particle::Number_Of_External_Particles,
+				particle::Velocity,
+				particle::Internal_Particles,
+				particle::External_Particles
+			>(time_step, outer_cells, grid);
+		}
+	);
+
+	graph.add_exchange(
+		reads<particle::Number_Of_External_Particles>(Cell_Set::outer),
+		[&](){
+			Cell::set_transfer_all(true, particle::Number_Of_External_Particles());
+			grid.start_remote_neighbor_copy_updates();
+		},
+		[&](){
+			grid.wait_remote_neighbor_copy_update_receives();
+			grid.wait_remote_neighbor_copy_update_sends();
+			Cell::set_transfer_all(false, particle::Number_Of_External_Particles());
+		}
+	);
+
+	graph.add_task(
+		reads<
+			particle::Velocity,
 			particle::Internal_Particles,
 			particle::External_Particles
-		>(inner_cells, grid);
-	};
-	auto particle_incorporate_outer = [&](){
-		return particle::incorporate_external_particles<
-			Cell,
+		>(Cell_Set::inner)
+		+ writes<
 			particle::Number_Of_Internal_Particles,
+			particle::Number_Of_External_Particles,
 			particle::Internal_Particles,
 			particle::External_Particles
-		>(outer_cells, grid);
-	};
-	auto particle_remove_inner = [&](){
-		return particle::remove_external_particles<
-			Cell,
+		>(Cell_Set::inner),
+		[&](){
+			particle_inner_time_step = particle::solve<
+				Cell,
+				particle::Number_Of_Internal_Particles,
+				particle::Number_Of_External_Particles,
+				particle::Velocity,
+				particle::Internal_Particles,
+				particle::External_Particles
+			>(time_step, inner_cells, grid);
+		}
+	);
+
+	graph.add_task(
+		reads<particle::Number_Of_External_Particles>(Cell_Set::remote)
+		+ writes<particle::External_Particles>(Cell_Set::remote),
+		[&](){
+			particle::resize_receiving_containers<
+				Cell,
+				particle::Number_Of_External_Particles,
+				particle::External_Particles
+			>(grid);
+		}
+	);
+
+	graph.add_exchange(
+		reads<
+			gol::Is_Alive,
+			advection::Density,
+			advection::Velocity,
+			particle::Velocity,
+			particle::External_Particles
+		>(Cell_Set::outer),
+		[&](){
+			Cell::set_transfer_all(true, gol::Is_Alive());
+			Cell::set_transfer_all(
+				true,
+				advection::Density(),
+				advection::Velocity()
+			);
+			Cell::set_transfer_all(
+				true,
+				particle::Velocity(),
+				particle::External_Particles()
+			);
+			grid.start_remote_neighbor_copy_updates();
+		},
+		[&](){
+			grid.wait_remote_neighbor_copy_update_receives();
+			grid.wait_remote_neighbor_copy_update_sends();
+			Cell::set_transfer_all(false, gol::Is_Alive());
+			Cell::set_transfer_all(
+				false,
+				advection::Density(),
+				advection::Velocity()
+			);
+			Cell::set_transfer_all(
+				false,
+				particle::Velocity(),
+				particle::External_Particles()
+			);
+		}
+	);
+
+	// game of life
+	graph.add_task(
+		reads<gol::Is_Alive>(Cell_Set::local)
+		+ writes<gol::Live_Neighbors>(Cell_Set::inner),
+		[&](){
+			gol::solve<
+				Cell,
+				gol::Is_Alive,
+				gol::Live_Neighbors
+			>(inner_cells, grid);
+		}
+	);
+	graph.add_task(
+		reads<gol::Is_Alive>(Cell_Set::all)
+		+ writes<gol::Live_Neighbors>(Cell_Set::outer),
+		[&](){
+			gol::solve<
+				Cell,
+				gol::Is_Alive,
+				gol::Live_Neighbors
+			>(outer_cells, grid);
+		}
+	);
+	graph.add_task(
+		writes<gol::Is_Alive, gol::Live_Neighbors>(Cell_Set::inner),
+		[&](){
+			gol::apply_solution<
+				Cell,
+				gol::Is_Alive,
+				gol::Live_Neighbors
+			>(inner_cells, grid);
+		}
+	);
+	graph.add_task(
+		writes<gol::Is_Alive, gol::Live_Neighbors>(Cell_Set::outer),
+		[&](){
+			gol::apply_solution<
+				Cell,
+				gol::Is_Alive,
+				gol::Live_Neighbors
+			>(outer_cells, grid);
+		}
+	);
+
+	// advection
+	graph.add_task(
+		reads<advection::Density, advection::Velocity>(Cell_Set::local)
+		+ writes<advection::Density_Flux>(Cell_Set::inner),
+		[&](){
+			advection_inner_time_step = advection::solve<
+				Cell,
+				advection::Density,
+				advection::Density_Flux,
+				advection::Velocity
+			>(time_step, inner_cells, grid);
+		}
+	);
+	graph.add_task(
+		reads<advection::Density, advection::Velocity>(Cell_Set::all)
+		+ writes<advection::Density_Flux>(Cell_Set::outer),
+		[&](){
+			advection_outer_time_step = advection::solve<
+				Cell,
+				advection::Density,
+				advection::Density_Flux,
+				advection::Velocity
+			>(time_step, outer_cells, grid);
+		}
+	);
+	graph.add_task(
+		writes<advection::Density, advection::Density_Flux>(Cell_Set::inner),
+		[&](){
+			advection::apply_solution<
+				Cell,
+				advection::Density,
+				advection::Density_Flux
+			>(inner_cells, grid);
+		}
+	);
+	graph.add_task(
+		writes<advection::Density, advection::Density_Flux>(Cell_Set::outer),
+		[&](){
+			advection::apply_solution<
+				Cell,
+				advection::Density,
+				advection::Density_Flux
+			>(outer_cells, grid);
+		}
+	);
+
+	// particles arriving from neighbors
+	graph.add_task(
+		reads<particle::External_Particles>(Cell_Set::local)
+		+ writes<
+			particle::Number_Of_Internal_Particles,
+			particle::Internal_Particles
+		>(Cell_Set::inner),
+		[&](){
+			particle::incorporate_external_particles<
+				Cell,
+				particle::Number_Of_Internal_Particles,
+				particle::Internal_Particles,
+				particle::External_Particles
+			>(inner_cells, grid);
+		}
+	);
+	graph.add_task(
+		reads<particle::External_Particles>(Cell_Set::all)
+		+ writes<
+			particle::Number_Of_Internal_Particles,
+			particle::Internal_Particles
+		>(Cell_Set::outer),
+		[&](){
+			particle::incorporate_external_particles<
+				Cell,
+				particle::Number_Of_Internal_Particles,
+				particle::Internal_Particles,
+				particle::External_Particles
+			>(outer_cells, grid);
+		}
+	);
+	graph.add_task(
+		writes<
 			particle::Number_Of_External_Particles,
 			particle::External_Particles
-		>(inner_cells, grid);
-	};
-	auto particle_remove_outer = [&](){
-		return particle::remove_external_particles<
-			Cell,
+		>(Cell_Set::inner),
+		[&](){
+			particle::remove_external_particles<
+				Cell,
+				particle::Number_Of_External_Particles,
+				particle::External_Particles
+			>(inner_cells, grid);
+		}
+	);
+	graph.add_task(
+		writes<
 			particle::Number_Of_External_Particles,
 			particle::External_Particles
-		>(outer_cells, grid);
-	};
+		>(Cell_Set::outer),
+		[&](){
+			particle::remove_external_particles<
+				Cell,
+				particle::Number_Of_External_Particles,
+				particle::External_Particles
+			>(outer_cells, grid);
+		}
+	);
 
-	while (simulation_time <= M_PI) {
 
-		double next_time_step = std::numeric_limits<double>::max();
+	while (simulation_time <= M_PI) {
 
 		/*
 		Save simulations
@@ -327,122 +516,14 @@ int main(int argc, char* argv[])
 		Solve
 		*/
 
-		// must finish immediately
-		next_time_step
-			= std::min(
-				next_time_step,
-				particle::solve<
-					Cell,
-					particle::Number_Of_Internal_Particles,
-					particle::Number_Of_External_Particles,
-					particle::Velocity,
-					particle::Internal_Particles,
-					particle::External_Particles
-				>(time_step, outer_cells, grid)
-			);
-
-		Cell::set_transfer_all(true, particle::Number_Of_External_Particles());
-		grid.start_remote_neighbor_copy_updates();
-
-		// must finish immediately
-		next_time_step
-			= std::min(
-				next_time_step,
-				particle::solve<
-					Cell,
-					particle::Number_Of_Internal_Particles,
-					particle::Number_Of_External_Particles,
-					particle::Velocity,
-					particle::Internal_Particles,
-					particle::External_Particles
-				>(time_step, inner_cells, grid)
-			);
-
-
-		grid.wait_remote_neighbor_copy_update_receives();
-
-		// must finish almost immediately
-		particle::resize_receiving_containers<
-			Cell,
-			particle::Number_Of_External_Particles,
-			particle::External_Particles
-		>(grid);
-
-		grid.wait_remote_neighbor_copy_update_sends();
-
-
-		Cell::set_transfer_all(true, gol::Is_Alive());
-		Cell::set_transfer_all(
-			true,
-			advection::Density(),
-			advection::Velocity()
-		);
-		Cell::set_transfer_all(false, particle::Number_Of_External_Particles());
-		Cell::set_transfer_all(
-			true,
-			particle::Velocity(),
-			particle::External_Particles()
-		);
-		grid.start_remote_neighbor_copy_updates();
-
-
-		auto gol_inner_solve_future = std::async(gol_inner_solve);
-		auto advection_inner_solve_future = std::async(advection_inner_solve);
-		auto particle_incorporate_inner_future = std::async(particle_incorporate_inner);
-
-		gol_inner_solve_future.get();
-		next_time_step
-			= std::min(
-				next_time_step,
-				advection_inner_solve_future.get()
-			);
-		particle_incorporate_inner_future.get();
-
-		grid.wait_remote_neighbor_copy_update_receives();
-
-
-		auto gol_outer_solve_future = std::async(gol_outer_solve);
-		auto gol_inner_apply_future = std::async(gol_inner_apply);
-		auto advection_outer_solve_future = std::async(advection_outer_solve);
-		auto advection_inner_apply_future = std::async(advection_inner_apply);
-		auto particle_incorporate_outer_future = std::async(particle_incorporate_outer);
-		auto particle_remove_inner_future = std::async(particle_remove_inner);
-
-		gol_outer_solve_future.get();
-		next_time_step
-			= std::min(
-				next_time_step,
-				advection_outer_solve_future.get()
-			);
-		gol_inner_apply_future.get();
-		advection_inner_apply_future.get();
-		particle_incorporate_outer_future.get();
-		particle_remove_inner_future.get();
-
-
-		grid.wait_remote_neighbor_copy_update_sends();
-		Cell::set_transfer_all(false, gol::Is_Alive());
-		Cell::set_transfer_all(
-			false,
-			advection::Density(),
-			advection::Velocity()
-		);
-		Cell::set_transfer_all(
-			false,
-			particle::Velocity(),
-			particle::External_Particles()
-		);
-
-		auto gol_outer_apply_future = std::async(gol_outer_apply);
-		auto advection_outer_apply_future = std::async(advection_outer_apply);
-		auto particle_remove_outer_future = std::async(particle_remove_outer);
+		graph.run();
 
 		simulation_time += time_step;
 
-		gol_outer_apply_future.get();
-		advection_outer_apply_future.get();
-		particle_remove_outer_future.get();
-
+		const double next_time_step = std::min(
+			std::min(particle_outer_time_step, particle_inner_time_step),
+			std::min(advection_inner_time_step, advection_outer_time_step)
+		);
 		MPI_Allreduce(&next_time_step, &time_step, 1, MPI_DOUBLE, MPI_MIN, comm);
 		const double CFL = 0.5;
 		time_step *= CFL;
@@ -41,13 +41,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "dccrg_cartesian_geometry.hpp"
 
 #include "gensimcell.hpp"
+#include "kernel_access.hpp"
+#include "parallel_for.hpp"
 
 //! see ../serial.cpp for the basics
 
 namespace gol {
 
 /*!
-Calculates the number of live neighbors for given cells.
+Calculates the number of live neighbors of one cell.
 
 Uses Is_Alive to access the data corresponding to
 the life state of a cell and Live_Neighbors to access
@@ -57,12 +59,14 @@ template<
 	class Cell_T,
 	class Is_Alive_T,
 	class Live_Neighbors_T
-> void solve(
-	const std::vector<uint64_t>& cell_ids,
-	dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& game_grid
-) {
-	for (auto cell_id: cell_ids) {
-
+> struct Solve_Kernel :
+	gensimcell::Reads<Is_Alive_T>,
+	gensimcell::Writes<Live_Neighbors_T>
+{
+	void operator()(
+		const uint64_t cell_id,
+		dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& game_grid
+	) const {
 		Cell_T* current_data = game_grid[cell_id];
 		if (current_data == NULL) {
 			std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
@@ -89,22 +93,45 @@ template<
 			}
 		}
 	}
-}
+};
 
 
 /*!
-Applies the rules of Conway's Game of Life to given cells.
+Calculates the number of live neighbors for given cells.
+
+Cells are processed in parallel by gensimcell's default
+thread pool, each thread only modifies its own cells.
 */
 template<
 	class Cell_T,
 	class Is_Alive_T,
 	class Live_Neighbors_T
-> void apply_solution(
+> void solve(
 	const std::vector<uint64_t>& cell_ids,
 	dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& game_grid
 ) {
-	for (auto cell_id: cell_ids) {
+	gensimcell::parallel_for_cells(
+		cell_ids,
+		game_grid,
+		Solve_Kernel<Cell_T, Is_Alive_T, Live_Neighbors_T>()
+	);
+}
 
+
+/*!
+Applies the rules of Conway's Game of Life to one cell.
+*/
+template<
+	class Cell_T,
+	class Is_Alive_T,
+	class Live_Neighbors_T
+> struct Apply_Kernel :
+	gensimcell::Writes<Is_Alive_T, Live_Neighbors_T>
+{
+	void operator()(
+		const uint64_t cell_id,
+		dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& game_grid
+	) const {
 		Cell_T* data = game_grid[cell_id];
 		if (data == NULL) {
 			std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
@@ -118,6 +145,25 @@ template<
 		}
 		(*data)[Live_Neighbors_T()] = 0;
 	}
+};
+
+
+/*!
+Applies the rules of Conway's Game of Life to given cells.
+*/
+template<
+	class Cell_T,
+	class Is_Alive_T,
+	class Live_Neighbors_T
+> void apply_solution(
+	const std::vector<uint64_t>& cell_ids,
+	dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& game_grid
+) {
+	gensimcell::parallel_for_cells(
+		cell_ids,
+		game_grid,
+		Apply_Kernel<Cell_T, Is_Alive_T, Live_Neighbors_T>()
+	);
 }
 
 
@@ -54,13 +54,21 @@ int main(int argc, char* argv[])
 	/*
 	Set up MPI
 	*/
-	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
-		std::cerr << "Coudln't initialize MPI." << std::endl;
+	// cells are solved by threads but only main thread calls MPI
+	int provided = MPI_THREAD_SINGLE;
+	if (
+		MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided) != MPI_SUCCESS
+		or provided < MPI_THREAD_FUNNELED
+	) {
+		std::cerr << "Couldn't initialize MPI with MPI_THREAD_FUNNELED." << std::endl;
 		abort();
 	}
 
 	MPI_Comm comm = MPI_COMM_WORLD;
 
+	// share hardware threads of each node between its processes
+	gensimcell::set_default_nr_threads(gensimcell::get_nr_threads_per_process(comm));
+
 	int rank = 0, comm_size = 0;
 	MPI_Comm_rank(comm, &rank);
 	MPI_Comm_size(comm, &comm_size);
@@ -31,8 +31,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 To keep it simple use 1d grid and one cell / process.
+
+State of the game is saved into gol_no_dccrg.dc with
+save_async() while the next turn is computed.
 */
 
+#include "cstdint"
 #include "cstdlib"
 #include "iostream"
 #include "tuple"
@@ -40,6 +44,7 @@ To keep it simple use 1d grid and one cell / process.
 
 #include "mpi.h" // must be included before gensimcell.hpp
 #include "gensimcell.hpp"
+#include "async_save.hpp"
 
 using namespace std;
 
@@ -129,9 +134,21 @@ int main(int argc, char* argv[])
 
 	print_game(cell, rank, comm_size);
 
+	// saves is_alive, the only transferred variable
+	const vector<uint64_t> cell_ids{uint64_t(rank)};
+	const vector<const Cell_T*> cells{&cell};
+	gensimcell::Async_Save save;
+
 	constexpr size_t max_turns = 10;
 	for (size_t turn = 0; turn < max_turns; turn++) {
 
+		// previous save must finish before file is written again
+		if (not save.wait()) {
+			cerr << "Couldn't save game." << endl;
+			abort();
+		}
+		save = gensimcell::save_async(comm, "gol_no_dccrg.dc", cell_ids, cells);
+
 		// MPI transfer info of cell and its neighbors
 		tuple<void*, int, MPI_Datatype>
 			cell_info, neg_info, pos_info;
@@ -190,6 +207,11 @@ int main(int argc, char* argv[])
 		print_game(cell, rank, comm_size);
 	}
 
+	if (not save.wait()) {
+		cerr << "Couldn't save game." << endl;
+		abort();
+	}
+
 	MPI_Finalize();
 
 	return EXIT_SUCCESS;
@@ -75,5 +75,16 @@ int main(int, char**)
 	cout << endl;
 	// prints 3 3
 
+	// same without boost::mpl, loop over variables is unrolled
+	// and the lambda is given each variable and its data
+	gensimcell::for_each_variable(
+		cell,
+		[](auto, const auto& data){
+			cout << data << " ";
+		}
+	);
+	cout << endl;
+	// prints 3 1.5 3
+
 	return 0;
 }
@@ -43,12 +43,48 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "dccrg_cartesian_geometry.hpp"
 #include "mpi.h" // must be included before gensimcell
 #include "gensimcell.hpp"
+#include "reduction.hpp"
+#include "kernel_access.hpp"
 
 #include "particle_initialize.hpp"
 #include "particle_save.hpp"
 #include "particle_solve.hpp"
 #include "particle_variables.hpp"
 
+
+/*
+Variables accessed by each function of particle_solve.hpp,
+used for deciding what to transfer between processes.
+*/
+struct Solve :
+	gensimcell::Reads_Own<particle::Velocity>,
+	gensimcell::Writes<
+		particle::Number_Of_Internal_Particles,
+		particle::Number_Of_External_Particles,
+		particle::Internal_Particles,
+		particle::External_Particles
+	>
+{};
+
+struct Resize_Receiving_Containers :
+	gensimcell::Reads<particle::Number_Of_External_Particles>,
+	gensimcell::Writes<particle::External_Particles>
+{};
+
+using Incorporate_External_Particles = particle::Incorporate_Kernel<
+	particle::Cell,
+	particle::Number_Of_Internal_Particles,
+	particle::Internal_Particles,
+	particle::External_Particles
+>;
+
+using Remove_External_Particles = particle::Remove_Kernel<
+	particle::Cell,
+	particle::Number_Of_External_Particles,
+	particle::External_Particles
+>;
+
+
 int main(int argc, char* argv[])
 {
 	// the cell type used by this program
@@ -57,13 +93,21 @@ int main(int argc, char* argv[])
 	/*
 	Set up MPI
 	*/
-	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
-		std::cerr << "Coudln't initialize MPI." << std::endl;
+	// cells are solved by threads but only main thread calls MPI
+	int provided = MPI_THREAD_SINGLE;
+	if (
+		MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided) != MPI_SUCCESS
+		or provided < MPI_THREAD_FUNNELED
+	) {
+		std::cerr << "Couldn't initialize MPI with MPI_THREAD_FUNNELED." << std::endl;
 		abort();
 	}
 
 	MPI_Comm comm = MPI_COMM_WORLD;
 
+	// share hardware threads of each node between its processes
+	gensimcell::set_default_nr_threads(gensimcell::get_nr_threads_per_process(comm));
+
 	int rank = 0, comm_size = 0;
 	MPI_Comm_rank(comm, &rank);
 	MPI_Comm_size(comm, &comm_size);
@@ -137,13 +181,20 @@ int main(int argc, char* argv[])
 
 	double particle_next_save = 0;
 
+	// decides which variables are transferred in each update
+	gensimcell::Halo_Tracker<Cell> halo;
+
+	// reduced while the solution is applied
+	gensimcell::Async_Reduction<double> time_step_reduction(
+		comm,
+		gensimcell::Reduction::min
+	);
+
 	double
 		simulation_time = 0,
 		time_step = 0;
 	while (simulation_time < M_PI) {
 
-		double next_time_step = std::numeric_limits<double>::max();
-
 		/*
 		Save simulation to disk
 		*/
@@ -177,42 +228,48 @@ int main(int argc, char* argv[])
 		Propagate particles in outer cells first so the number of
 		resulting external particles can be sent to other processes.
 		*/
-		next_time_step
-			= std::min(
-				next_time_step,
-				particle::solve<
-					Cell,
-					particle::Number_Of_Internal_Particles,
-					particle::Number_Of_External_Particles,
-					particle::Velocity,
-					particle::Internal_Particles,
-					particle::External_Particles
-				>(time_step, outer_cells, grid)
-			);
+		time_step_reduction.add(
+			particle::solve<
+				Cell,
+				particle::Number_Of_Internal_Particles,
+				particle::Number_Of_External_Particles,
+				particle::Velocity,
+				particle::Internal_Particles,
+				particle::External_Particles
+			>(time_step, outer_cells, grid)
+		);
+		halo.written<Solve>(gensimcell::Cell_Set::outer);
 
 		/*
 		Update number of particles in external lists of remote neighbors
 		so that receiving processes can allocate memory for coordinates.
 		*/
-		Cell::set_transfer_all(true, particle::Number_Of_External_Particles());
+		halo.prepare_exchange<Resize_Receiving_Containers>();
 		grid.start_remote_neighbor_copy_updates();
 
 		/*
 		Propagate particles in inner cells while number of particles
 		in external lists of remote neighbors is transferred.
 		*/
-		next_time_step
-			= std::min(
-				next_time_step,
-				particle::solve<
-					Cell,
-					particle::Number_Of_Internal_Particles,
-					particle::Number_Of_External_Particles,
-					particle::Velocity,
-					particle::Internal_Particles,
-					particle::External_Particles
-				>(time_step, inner_cells, grid)
-			);
+		time_step_reduction.add(
+			particle::solve<
+				Cell,
+				particle::Number_Of_Internal_Particles,
+				particle::Number_Of_External_Particles,
+				particle::Velocity,
+				particle::Internal_Particles,
+				particle::External_Particles
+			>(time_step, inner_cells, grid)
+		);
+
+		// overlap the time step reduction with rest of the step
+		if (not time_step_reduction.start()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< ": Couldn't start time step reduction."
+				<< std::endl;
+			abort();
+		}
+		halo.written<Solve>(gensimcell::Cell_Set::inner);
 
 		/*
 		Wait for particle counts in external lists of
@@ -227,17 +284,14 @@ int main(int argc, char* argv[])
 		>(grid);
 
 		grid.wait_remote_neighbor_copy_update_sends();
+		halo.finish_exchange();
+		halo.written<Resize_Receiving_Containers>(gensimcell::Cell_Set::remote);
 
 		/*
 		Start transferring coordinates of particles in external lists
 		of outer cells between processes.
 		*/
-		Cell::set_transfer_all(false, particle::Number_Of_External_Particles());
-		Cell::set_transfer_all(
-			true,
-			particle::Velocity(),
-			particle::External_Particles()
-		);
+		halo.prepare_exchange<Incorporate_External_Particles>();
 		grid.start_remote_neighbor_copy_updates();
 
 		/*
@@ -250,6 +304,7 @@ int main(int argc, char* argv[])
 			particle::Internal_Particles,
 			particle::External_Particles
 		>(inner_cells, grid);
+		halo.written<Incorporate_External_Particles>(gensimcell::Cell_Set::inner);
 
 		/*
 		Wait for particles in external lists of other
@@ -268,6 +323,7 @@ int main(int argc, char* argv[])
 			particle::Internal_Particles,
 			particle::External_Particles
 		>(outer_cells, grid);
+		halo.written<Incorporate_External_Particles>(gensimcell::Cell_Set::outer);
 
 		/*
 		All local cells have incorporated the particles in
@@ -278,17 +334,14 @@ int main(int argc, char* argv[])
 			particle::Number_Of_External_Particles,
 			particle::External_Particles
 		>(inner_cells, grid);
+		halo.written<Remove_External_Particles>(gensimcell::Cell_Set::inner);
 
 		/*
 		Wait for coordinates of local particles in external
 		lists of outer cells to arrive to other processes.
 		*/
 		grid.wait_remote_neighbor_copy_update_sends();
-		Cell::set_transfer_all(
-			false,
-			particle::Velocity(),
-			particle::External_Particles()
-		);
+		halo.finish_exchange();
 
 		/*
 		Once local external lists have arrived to other
@@ -299,12 +352,18 @@ int main(int argc, char* argv[])
 			particle::Number_Of_External_Particles,
 			particle::External_Particles
 		>(outer_cells, grid);
+		halo.written<Remove_External_Particles>(gensimcell::Cell_Set::outer);
 
 		simulation_time += time_step;
 
-		MPI_Allreduce(&next_time_step, &time_step, 1, MPI_DOUBLE, MPI_MIN, comm);
+		if (not time_step_reduction.wait()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< ": Couldn't reduce time step."
+				<< std::endl;
+			abort();
+		}
 		const double CFL = 0.5;
-		time_step *= CFL;
+		time_step = CFL * time_step_reduction.get_result();
 	}
 
 	MPI_Finalize();
@@ -40,6 +40,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "string"
 #include "tuple"
 #include "unordered_map"
+#include "utility"
 #include "vector"
 
 #include "dccrg_cartesian_geometry.hpp"
@@ -47,6 +48,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "dccrg_topology.hpp"
 
 #include "particle_variables.hpp"
+#include "read_cells.hpp"
 
 using namespace std;
 using namespace particle;
@@ -138,10 +140,11 @@ int main(int argc, char* argv[])
 		);
 
 		// read the number of particles in each cell
-		unordered_map<
-			uint64_t,
-			Cell
-		> simulation_data;
+		vector<uint64_t> file_offsets;
+		file_offsets.reserve(cells_offsets.size());
+		for (const auto& item: cells_offsets) {
+			file_offsets.push_back(item.second);
+		}
 
 		/*
 		Particle data must be read in two stages as the
@@ -149,92 +152,39 @@ int main(int argc, char* argv[])
 		prior to reading that number from the file,
 		after which the particles themselves can be read
 		*/
-
-		for (const auto& item: cells_offsets) {
-			const uint64_t cell_id = item.first;
-			uint64_t file_address = item.second;
-
-			simulation_data[cell_id];
-			auto& cell_data = simulation_data.at(cell_id);
-
-			void* memory_address = NULL;
-			int memory_count = -1;
-			MPI_Datatype
-				memory_datatype = MPI_DATATYPE_NULL,
-				file_datatype = MPI_DATATYPE_NULL;
-
-			// read constant sized data
-			cell_data.set_transfer_all(true, Number_Of_Internal_Particles(), Velocity());
-
-			tie(
-				memory_address,
-				memory_count,
-				memory_datatype
-			) = cell_data.get_mpi_datatype();
-			MPI_Type_commit(&memory_datatype);
-
-			int sizeof_memory_datatype;
-			MPI_Type_size(memory_datatype, &sizeof_memory_datatype);
-			MPI_Type_contiguous(sizeof_memory_datatype, MPI_BYTE, &file_datatype);
-			MPI_Type_commit(&file_datatype);
-
-			MPI_File_set_view(
-				file,
-				file_address,
-				MPI_BYTE,
-				file_datatype,
-				const_cast<char*>("native"),
-				MPI_INFO_NULL
+		Cell::set_transfer_all(true, Number_Of_Internal_Particles(), Velocity());
+		vector<Cell> cells;
+		bool success = gensimcell::read_cells(file, file_offsets, cells);
+
+		// particles are saved after constant sized data
+		const auto constant_size = gensimcell::Schema::create(Cell()).fixed_size;
+		for (size_t i = 0; i < cells.size(); i++) {
+			cells[i][Internal_Particles()].resize(
+				cells[i][Number_Of_Internal_Particles()]
 			);
+			file_offsets[i] += constant_size;
+		}
 
-			MPI_File_read_at(
-				file,
-				0,
-				memory_address,
-				memory_count,
-				memory_datatype,
-				MPI_STATUS_IGNORE
-			);
-			file_address += sizeof_memory_datatype;
-			MPI_Type_free(&memory_datatype);
-			MPI_Type_free(&file_datatype);
-
-			cell_data[Internal_Particles()].resize(cell_data[Number_Of_Internal_Particles()]);
-
-			// read the particle coordinates and velocity
-			cell_data.set_transfer_all(false, Number_Of_Internal_Particles(), Velocity());
-			cell_data.set_transfer_all(true, Internal_Particles());
-
-			tie(
-				memory_address,
-				memory_count,
-				memory_datatype
-			) = cell_data.get_mpi_datatype();
-			MPI_Type_commit(&memory_datatype);
-
-			MPI_Type_size(memory_datatype, &sizeof_memory_datatype);
-			MPI_Type_contiguous(sizeof_memory_datatype, MPI_BYTE, &file_datatype);
-			MPI_Type_commit(&file_datatype);
-
-			MPI_File_set_view(
-				file,
-				file_address,
-				MPI_BYTE,
-				file_datatype,
-				const_cast<char*>("native"),
-				MPI_INFO_NULL
-			);
+		// read the particle coordinates and velocity
+		Cell::set_transfer_all(false, Number_Of_Internal_Particles(), Velocity());
+		Cell::set_transfer_all(true, Internal_Particles());
+		success = success and gensimcell::read_cells(file, file_offsets, cells);
+		Cell::set_transfer_all(false, Internal_Particles());
 
-			MPI_File_read_at(
-				file,
-				0,
-				memory_address,
-				memory_count,
-				memory_datatype,
-				MPI_STATUS_IGNORE
-			);
-			file_address += sizeof_memory_datatype;
-			MPI_Type_free(&file_datatype);
+		if (not success) {
+			cerr << "Process " << rank
+				<< " couldn't read cell data from file " << argv_string
+				<< endl;
+			MPI_File_close(&file);
+			continue;
+		}
+
+		unordered_map<
+			uint64_t,
+			Cell
+		> simulation_data;
+		for (size_t i = 0; i < cells_offsets.size(); i++) {
+			simulation_data[cells_offsets[i].first] = std::move(cells[i]);
 		}
 
 		MPI_File_close(&file);
@@ -42,6 +42,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "dccrg_cartesian_geometry.hpp"
 
 #include "gensimcell.hpp"
+#include "kernel_access.hpp"
+#include "parallel_for.hpp"
 
 
 //! see ../serial.cpp for the basics
@@ -83,7 +85,8 @@ Returns the longest allowed time step for given cells
 and their neighbors. Particles which propagate outside of the
 cell in which they are stored are moved to the External_Particles_T
 list of their previous cell and added to Particle_Destinations_T
-information.
+information. Cells are processed in parallel by gensimcell's
+default thread pool.
 */
 template<
 	class Cell_T,
@@ -97,11 +100,11 @@ template<
 	const std::vector<uint64_t>& cell_ids,
 	dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& grid
 ) {
-	double max_time_step = std::numeric_limits<double>::max();
-
 	// propagate particles and maybe move from internal to external list
-	for (auto cell_id: cell_ids) {
-
+	return gensimcell::parallel_min_cells(cell_ids, grid, [dt](
+		const uint64_t cell_id,
+		dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& grid
+	) {
 		const auto
 			cell_min = grid.geometry.get_min(cell_id),
 			cell_max = grid.geometry.get_max(cell_id);
@@ -180,33 +183,31 @@ template<
 
 		// check time step
 		const auto length = grid.geometry.get_length(cell_id);
-		max_time_step =
-			std::min(max_time_step,
-			std::min(
-				fabs(length[0] / vel[0]),
-				fabs(length[1] / vel[1])
-			));
-	}
-
-	return max_time_step;
+		return std::min(
+			fabs(length[0] / vel[0]),
+			fabs(length[1] / vel[1])
+		);
+	});
 }
 
 
 /*!
-Copies particles from the external particle lists of neighbors
-of given cells into internal particle lists of given cells.
+Copies particles from the external particle lists of
+neighbors of one cell into internal particle list of the cell.
 */
 template<
 	class Cell_T,
 	class Number_Of_Internal_Particles_T,
 	class Internal_Particles_T,
 	class External_Particles_T
-> void incorporate_external_particles(
-	const std::vector<uint64_t>& cell_ids,
-	dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& grid
-) {
-	for (auto cell_id: cell_ids) {
-
+> struct Incorporate_Kernel :
+	gensimcell::Reads<External_Particles_T>,
+	gensimcell::Writes<Number_Of_Internal_Particles_T, Internal_Particles_T>
+{
+	void operator()(
+		const uint64_t cell_id,
+		dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& grid
+	) const {
 		auto* const cell_data = grid[cell_id];
 		if (cell_data == NULL) {
 			std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
@@ -250,24 +251,50 @@ template<
 
 		(*cell_data)[Number_Of_Internal_Particles_T()] = int_particles.size();
 	}
-}
+};
 
 
 /*!
-Removes particles from the external particle list of given cells.
-
-Updates number of external particles.
+Copies particles from the external particle lists of neighbors
+of given cells into internal particle lists of given cells.
 */
 template<
 	class Cell_T,
-	class Number_Of_External_Particles_T,
+	class Number_Of_Internal_Particles_T,
+	class Internal_Particles_T,
 	class External_Particles_T
-> void remove_external_particles(
+> void incorporate_external_particles(
 	const std::vector<uint64_t>& cell_ids,
 	dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& grid
 ) {
+	const Incorporate_Kernel<
+		Cell_T,
+		Number_Of_Internal_Particles_T,
+		Internal_Particles_T,
+		External_Particles_T
+	> kernel{};
 	for (auto cell_id: cell_ids) {
+		kernel(cell_id, grid);
+	}
+}
 
+
+/*!
+Removes particles from the external particle list of one cell.
+
+Updates number of external particles.
+*/
+template<
+	class Cell_T,
+	class Number_Of_External_Particles_T,
+	class External_Particles_T
+> struct Remove_Kernel :
+	gensimcell::Writes<Number_Of_External_Particles_T, External_Particles_T>
+{
+	void operator()(
+		const uint64_t cell_id,
+		dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& grid
+	) const {
 		auto* const cell_data = grid[cell_id];
 		if (cell_data == NULL) {
 			std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
@@ -277,6 +304,30 @@ template<
 		(*cell_data)[Number_Of_External_Particles_T()] = 0;
 		(*cell_data)[External_Particles_T()].clear();
 	}
+};
+
+
+/*!
+Removes particles from the external particle list of given cells.
+
+Updates number of external particles.
+*/
+template<
+	class Cell_T,
+	class Number_Of_External_Particles_T,
+	class External_Particles_T
+> void remove_external_particles(
+	const std::vector<uint64_t>& cell_ids,
+	dccrg::Dccrg<Cell_T, dccrg::Cartesian_Geometry>& grid
+) {
+	const Remove_Kernel<
+		Cell_T,
+		Number_Of_External_Particles_T,
+		External_Particles_T
+	> kernel{};
+	for (auto cell_id: cell_ids) {
+		kernel(cell_id, grid);
+	}
 }
 
 
@@ -0,0 +1,224 @@
+/*
+Thread local accumulation buffers of generic simulation cell.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_ACCUMULATOR_HPP
+#define GENSIMCELL_ACCUMULATOR_HPP
+
+
+#include "cstddef"
+#include "cstdint"
+#include "type_traits"
+#include "unordered_map"
+#include "vector"
+
+#include "parallel_for.hpp"
+#include "variable_operators.hpp"
+
+
+namespace gensimcell {
+
+
+// forward declare Cell type used in Accumulator
+template<template<class> class Transfer_Policy, class... Variables> class Cell;
+
+
+/*!
+Thread local buffers of contributions to cells of a parallel
+region that are added to the cells when the region ends.
+
+Alternative to atomic_plus_equal(), etc. for scatter kernels
+in which several threads add to the same cells, e.g. particles
+depositing into neighboring cells. Each thread accumulates
+into its own copies of the cells it contributes to, indexed
+by the slot given to Thread_Pool::parallel_for(), so the
+kernel itself doesn't need atomic operations. Contributions
+are added to all variables of given cell type with
+variable_plus_equal() by merge(), the target cells can have
+other variables as well. Vectors in contributions must have
+the same size as in the target cells.
+
+Example depositing particle mass to the cell of each particle:
+@code
+using Deposit_Cell = gensimcell::Cell<gensimcell::Never_Transfer, Density>;
+gensimcell::Accumulator<Deposit_Cell> accumulator(pool.size());
+pool.parallel_for(particles.size(), 0,
+	[&](size_t begin, size_t end, size_t slot) {
+		for (size_t i = begin; i < end; i++) {
+			accumulator(slot, particles[i].cell)[Density()] += particles[i].mass;
+		}
+	}
+);
+accumulator.merge([&grid](const uint64_t cell_id) { return grid[cell_id]; });
+@endcode
+*/
+template <
+	class Cell_T,
+	class Cell_Id_T = uint64_t
+> class Accumulator;
+
+//! See the general version for documentation.
+template <
+	template<class> class Transfer_Policy,
+	class... Variables,
+	class Cell_Id_T
+> class Accumulator<Cell<Transfer_Policy, Variables...>, Cell_Id_T>
+{
+public:
+
+	using Cell_T = Cell<Transfer_Policy, Variables...>;
+
+
+	//! Creates buffers for given number of slots, e.g. pool.size().
+	explicit Accumulator(const std::size_t nr_slots) :
+		buffers(nr_slots)
+	{}
+
+
+	//! Returns the number of slots.
+	std::size_t size() const
+	{
+		return this->buffers.size();
+	}
+
+
+	/*!
+	Returns the contribution of given slot to given cell.
+
+	Contribution is value initialized, i.e. zero for arithmetic
+	data, when it's first used after construction or merge().
+	Only the thread of given slot can call this concurrently
+	with other threads using different slots.
+	*/
+	Cell_T& operator()(const std::size_t slot, const Cell_Id_T& cell_id)
+	{
+		auto& buffer = this->buffers[slot];
+		auto item = buffer.find(cell_id);
+		if (item == buffer.end()) {
+			item = buffer.emplace(cell_id, Cell_T()).first;
+		}
+		return item->second;
+	}
+
+
+	/*!
+	Adds contributions of all slots to cells and clears the buffers.
+
+	get_cell(cell_id) must return a pointer to the cell of given
+	id, contributions to cells for which nullptr is returned are
+	discarded. Must not be called concurrently with operator().
+	*/
+	template<class Get_Cell> void merge(Get_Cell get_cell)
+	{
+		for (auto& buffer: this->buffers) {
+			this->merge_buffer(buffer, get_cell, std::false_type());
+		}
+	}
+
+	/*!
+	Same as merge() but adds contributions of different
+	slots in parallel using threads of given pool.
+
+	Threads add to cells with atomic_plus_equal() so data of
+	variables must be supported by it, see gensimcell_impl.hpp.
+	*/
+	template<class Get_Cell> void merge(Get_Cell get_cell, Thread_Pool& pool)
+	{
+		pool.parallel_for(
+			this->buffers.size(),
+			1,
+			[&](const std::size_t begin, const std::size_t end, const std::size_t) {
+				for (std::size_t i = begin; i < end; i++) {
+					this->merge_buffer(this->buffers[i], get_cell, std::true_type());
+				}
+			}
+		);
+	}
+
+
+private:
+
+	std::vector<std::unordered_map<Cell_Id_T, Cell_T>> buffers;
+
+	//! Adds contributions of one slot with atomic operators or not.
+	template<
+		class Get_Cell,
+		class Atomic
+	> void merge_buffer(
+		std::unordered_map<Cell_Id_T, Cell_T>& buffer,
+		Get_Cell& get_cell,
+		const Atomic atomic
+	) {
+		for (const auto& item: buffer) {
+			auto* const cell = get_cell(item.first);
+			if (cell != nullptr) {
+				this->add(*cell, item.second, atomic);
+			}
+		}
+		buffer.clear();
+	}
+
+	template<class Target_Cell> void add(
+		Target_Cell& target,
+		const Cell_T& contribution,
+		const std::false_type
+	) {
+		int dummy[] = {0, (
+			detail::variable_plus_equal(
+				target[Variables()],
+				contribution[Variables()]
+			),
+			0
+		)...};
+		(void)dummy;
+	}
+
+	template<class Target_Cell> void add(
+		Target_Cell& target,
+		const Cell_T& contribution,
+		const std::true_type
+	) {
+		int dummy[] = {0, (
+			detail::variable_atomic_plus_equal(
+				target[Variables()],
+				contribution[Variables()]
+			),
+			0
+		)...};
+		(void)dummy;
+	}
+};
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_ACCUMULATOR_HPP
@@ -34,6 +34,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define GENSIMCELL_ASSIGN_HPP
 
 
+#include "utility"
+
 #include "type_support.hpp"
 
 #include "boost/mpl/contains.hpp"
@@ -64,6 +66,25 @@ template<class C1, class C2> struct Assigner
     }
 };
 
+template<class C1, class C2> struct Mover
+{
+	C1& source;
+	C2& target;
+
+	Mover(
+		C1& given_source,
+		C2& given_target
+	) :
+		source(given_source),
+		target(given_target)
+	{}
+
+	template<typename V> void operator()(V variable)
+	{
+		target[variable] = std::move(source[variable]);
+	}
+};
+
 } // namespace detail
 
 
@@ -104,6 +125,44 @@ template<
 }
 
 
+
+/*!
+Moves all common variables from source to target cell.
+
+For each common variable of given cells does:
+target[Variable()] = std::move(source[Variable()])
+so for example std::vector data of common variables
+is taken from source instead of copied. Variables of
+source that aren't in target are not modified.
+
+Does not change whether variables are transferred with MPI.
+*/
+template<
+	template<class> class Transfer_Policy1,
+	template<class> class Transfer_Policy2,
+	class... Variables1,
+	class... Variables2
+> void assign(
+	Cell<Transfer_Policy1, Variables1...>& target,
+	Cell<Transfer_Policy2, Variables2...>&& source
+) {
+	using Var1_List = boost::mpl::vector<Variables1...>;
+	using Var2_List = boost::mpl::vector<Variables2...>;
+	using Common_Variables
+		= boost::mpl::filter_view<
+			Var1_List,
+			boost::mpl::contains<Var2_List, boost::mpl::placeholders::_>
+		>;
+
+	boost::mpl::for_each<Common_Variables>(
+		detail::Mover<
+			Cell<Transfer_Policy2, Variables2...>,
+			Cell<Transfer_Policy1, Variables1...>
+		>(source, target)
+	);
+}
+
+
 } // namespace gensimcell
 
 
@@ -0,0 +1,319 @@
+/*
+Assignment between ranges of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_ASSIGN_RANGES_HPP
+#define GENSIMCELL_ASSIGN_RANGES_HPP
+
+
+#include "algorithm"
+#include "array"
+#include "cstddef"
+#include "cstring"
+#include "iterator"
+#include "type_traits"
+#include "vector"
+
+#include "assign.hpp"
+#include "type_support.hpp"
+
+
+namespace gensimcell {
+namespace detail {
+
+
+/*!
+Bytes copied with one memcpy per cell by range version of assign().
+
+Offsets are in bytes from the beginning of target and source cell.
+*/
+struct Assign_Block
+{
+	std::size_t target_offset, source_offset, size;
+};
+
+
+/*!
+Memcpy blocks smaller than this are assigned variable by
+variable instead, for small variables inlined assignment
+is faster than a call to memcpy.
+*/
+constexpr std::size_t min_assign_block_size = 64;
+
+
+//! Adds block of a common trivially copyable variable.
+template<
+	class Variable,
+	class Target_Cell,
+	class Source_Cell
+> void add_assign_block(
+	std::vector<Assign_Block>& blocks,
+	const Target_Cell& target,
+	const Source_Cell& source,
+	const std::true_type
+) {
+	blocks.push_back({
+		get_variable_offset(target, Variable()),
+		get_variable_offset(source, Variable()),
+		sizeof(typename Variable::data_type)
+	});
+}
+
+//! Skips variables that aren't common or trivially copyable.
+template<
+	class Variable,
+	class Target_Cell,
+	class Source_Cell
+> void add_assign_block(
+	std::vector<Assign_Block>&,
+	const Target_Cell&,
+	const Source_Cell&,
+	const std::false_type
+) {}
+
+
+/*!
+Records in memcopied whether Variable is
+covered by one of given memcpy blocks.
+*/
+template<
+	class Variable,
+	class Target_Cell,
+	size_t Nr_Of_Variables
+> void set_memcopied(
+	std::array<bool, Nr_Of_Variables>& memcopied,
+	const std::size_t index,
+	const std::vector<Assign_Block>& blocks,
+	const Target_Cell& target
+) {
+	const auto offset = get_variable_offset(target, Variable());
+	for (const auto& block: blocks) {
+		if (
+			offset >= block.target_offset
+			and offset < block.target_offset + block.size
+		) {
+			memcopied[index] = true;
+			return;
+		}
+	}
+}
+
+
+//! Assigns a common variable unless it was copied with memcpy.
+template<
+	class Variable,
+	class Target_Cell,
+	class Source_Cell
+> void assign_variable(
+	Target_Cell& target,
+	const Source_Cell& source,
+	const bool memcopied,
+	const std::true_type
+) {
+	if (not memcopied) {
+		target[Variable()] = source[Variable()];
+	}
+}
+
+//! Skips variables that aren't common.
+template<
+	class Variable,
+	class Target_Cell,
+	class Source_Cell
+> void assign_variable(
+	Target_Cell&,
+	const Source_Cell&,
+	const bool,
+	const std::false_type
+) {}
+
+
+/*!
+Implementation of range version of assign().
+
+Last two arguments are only used for deducing variables of cells.
+*/
+template<
+	class Target_Range,
+	class Source_Range,
+	template<class> class Transfer_Policy1,
+	template<class> class Transfer_Policy2,
+	class... Variables1,
+	class... Variables2
+> void assign_range(
+	Target_Range& target,
+	const Source_Range& source,
+	const Cell<Transfer_Policy1, Variables1...>*,
+	const Cell<Transfer_Policy2, Variables2...>*
+) {
+	const auto nr_of_cells = std::min(target.size(), source.size());
+	if (nr_of_cells == 0) {
+		return;
+	}
+
+	auto target_cell = std::begin(target);
+	auto source_cell = std::begin(source);
+
+	// offsets of common trivially copyable variables
+	std::vector<Assign_Block> blocks;
+	blocks.reserve(sizeof...(Variables1));
+	int dummy1[] = {0, (
+		add_assign_block<Variables1>(
+			blocks,
+			*target_cell,
+			*source_cell,
+			std::integral_constant<
+				bool,
+				contains_variable<Variables1, Variables2...>::value
+				and std::is_trivially_copyable<
+					typename Variables1::data_type
+				>::value
+			>()
+		),
+		0
+	)...};
+	(void)dummy1;
+
+	// merge blocks that are contiguous in both cells
+	std::sort(
+		blocks.begin(),
+		blocks.end(),
+		[](const Assign_Block& a, const Assign_Block& b) {
+			return a.target_offset < b.target_offset;
+		}
+	);
+	std::vector<Assign_Block> merged;
+	for (const auto& block: blocks) {
+		if (
+			merged.size() > 0
+			and merged.back().target_offset + merged.back().size
+				== block.target_offset
+			and merged.back().source_offset + merged.back().size
+				== block.source_offset
+		) {
+			merged.back().size += block.size;
+		} else {
+			merged.push_back(block);
+		}
+	}
+	merged.erase(
+		std::remove_if(
+			merged.begin(),
+			merged.end(),
+			[](const Assign_Block& block) {
+				return block.size < min_assign_block_size;
+			}
+		),
+		merged.end()
+	);
+
+	std::array<bool, sizeof...(Variables1) + 1> memcopied;
+	memcopied.fill(false);
+	std::size_t index = 0;
+	int dummy2[] = {0, (
+		set_memcopied<Variables1>(memcopied, index++, merged, *target_cell),
+		0
+	)...};
+	(void)dummy2;
+
+	for (std::size_t i = 0; i < nr_of_cells; i++, target_cell++, source_cell++) {
+		auto* const target_bytes = reinterpret_cast<char*>(&*target_cell);
+		const auto* const source_bytes
+			= reinterpret_cast<const char*>(&*source_cell);
+		for (const auto& block: merged) {
+			std::memcpy(
+				target_bytes + block.target_offset,
+				source_bytes + block.source_offset,
+				block.size
+			);
+		}
+
+		int dummy3[] = {0, (
+			assign_variable<Variables1>(
+				*target_cell,
+				*source_cell,
+				memcopied[index_of_variable<Variables1, Variables1...>::value],
+				std::integral_constant<
+					bool,
+					contains_variable<Variables1, Variables2...>::value
+				>()
+			),
+			0
+		)...};
+		(void)dummy3;
+	}
+}
+
+} // namespace detail
+
+
+/*!
+Assigns all common variables from cells in source range to target range.
+
+Equal to calling assign(target[i], source[i]) for the first
+min(target.size(), source.size()) cells but common variables
+which are trivially copyable and contiguous in both cell types
+are copied with one memcpy per cell instead of one assignment
+per variable. Which variables can be copied together is
+decided once per call from the first cells of given ranges.
+
+Does not change whether variables are transferred with MPI.
+
+Example copying game of life variables out of a combined cell:
+@code
+std::vector<Combined_Cell> combined(...);
+std::vector<GoL_Cell> gol(combined.size());
+gensimcell::assign(gol, combined);
+@endcode
+*/
+template<
+	class Target_Range,
+	class Source_Range
+> typename std::enable_if<
+	is_gensimcell_range<Target_Range>::value
+	and is_gensimcell_range<Source_Range>::value
+>::type assign(
+	Target_Range& target,
+	const Source_Range& source
+) {
+	detail::assign_range(
+		target,
+		source,
+		static_cast<const typename Target_Range::value_type*>(nullptr),
+		static_cast<const typename Source_Range::value_type*>(nullptr)
+	);
+}
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_ASSIGN_RANGES_HPP
@@ -0,0 +1,537 @@
+/*
+Asynchronous saving of data of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_ASYNC_SAVE_HPP
+#define GENSIMCELL_ASYNC_SAVE_HPP
+
+
+#include "algorithm"
+#include "cstdint"
+#include "cstring"
+#include "limits"
+#include "string"
+#include "tuple"
+#include "type_traits"
+#include "utility"
+#include "vector"
+
+#include "read_cells.hpp"
+#include "type_support.hpp"
+
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+
+namespace gensimcell {
+
+
+/*!
+Handle to a save started by save_async().
+
+Data to save is copied when the save is started so cells can
+be modified while the file is written in the background. The
+save is finished by wait(), which must be called by all processes
+that started the save, either explicitly or by the destructor.
+*/
+class Async_Save
+{
+public:
+
+	Async_Save() = default;
+	Async_Save(const Async_Save&) = delete;
+	Async_Save& operator=(const Async_Save&) = delete;
+
+	Async_Save(Async_Save&& other)
+	{
+		*this = std::move(other);
+	}
+
+	//! Finishes save of this handle before taking over other's save.
+	Async_Save& operator=(Async_Save&& other)
+	{
+		this->wait();
+		std::swap(this->file, other.file);
+		std::swap(this->requests, other.requests);
+		std::swap(this->header, other.header);
+		std::swap(this->table, other.table);
+		std::swap(this->data, other.data);
+		std::swap(this->success, other.success);
+		return *this;
+	}
+
+	~Async_Save()
+	{
+		this->wait();
+	}
+
+
+	/*!
+	Returns true if all data of this process has been written,
+	doesn't block. Returns true if no save is in progress.
+	*/
+	bool test()
+	{
+		if (this->requests.size() == 0) {
+			return true;
+		}
+		int flag = 0;
+		if (
+			MPI_Testall(
+				int(this->requests.size()),
+				this->requests.data(),
+				&flag,
+				MPI_STATUSES_IGNORE
+			) != MPI_SUCCESS
+		) {
+			this->success = false;
+			return true;
+		}
+		return flag != 0;
+	}
+
+
+	/*!
+	Waits until the save has finished and closes the file.
+
+	Collective over processes that started the save.
+	Returns true if the save succeeded and false otherwise.
+	*/
+	bool wait()
+	{
+		if (this->file == MPI_FILE_NULL) {
+			return this->success;
+		}
+
+		if (
+			this->requests.size() > 0
+			and MPI_Waitall(
+				int(this->requests.size()),
+				this->requests.data(),
+				MPI_STATUSES_IGNORE
+			) != MPI_SUCCESS
+		) {
+			this->success = false;
+		}
+		if (MPI_File_close(&this->file) != MPI_SUCCESS) {
+			this->success = false;
+		}
+		this->file = MPI_FILE_NULL;
+
+		this->requests.clear();
+		this->header.clear();
+		this->table.clear();
+		this->data.clear();
+		this->data.shrink_to_fit();
+
+		return this->success;
+	}
+
+
+private:
+
+	template<class Cell_Range> friend Async_Save save_async(
+		MPI_Comm,
+		const std::string&,
+		const std::vector<std::uint64_t>&,
+		const Cell_Range&
+	);
+
+	MPI_File file = MPI_FILE_NULL;
+	std::vector<MPI_Request> requests;
+
+	//! Staged data, kept in vectors so it doesn't move with the handle
+	std::vector<std::uint64_t> header, table;
+	std::vector<char> data;
+
+	bool success = true;
+};
+
+
+namespace detail {
+
+//! Returns given cell, see save_async().
+template<class Cell_T> typename std::enable_if<
+	is_gensimcell<Cell_T>::value,
+	const Cell_T&
+>::type dereference_cell(const Cell_T& cell)
+{
+	return cell;
+}
+
+//! Returns the cell pointed to by given pointer, see save_async().
+template<class Cell_T> const Cell_T& dereference_cell(const Cell_T* cell)
+{
+	return *cell;
+}
+
+
+/*!
+Copies data of given cells that is currently transferred
+into data packed in the same way as written by MPI, e.g.
+by dccrg or to be read by read_cells().
+
+Offset of each cell's data in data is added to offsets.
+Returns false if MPI datatypes of cells couldn't be used
+in which case offsets and data are incomplete.
+*/
+template<class Cell_Pointer_T> bool pack_cells(
+	const std::vector<Cell_Pointer_T>& cells,
+	std::vector<std::uint64_t>& offsets,
+	std::vector<char>& data
+) {
+	if (cells.size() == 0) {
+		return true;
+	}
+
+	// cells with identical layout are copied with memcpy
+	const auto blocks_size = get_packed_blocks(*cells[0]);
+	if (blocks_size.second > 0) {
+		data.resize(cells.size() * blocks_size.second);
+		for (std::size_t i = 0; i < cells.size(); i++) {
+			offsets.push_back(i * blocks_size.second);
+			const char* const source = reinterpret_cast<const char*>(cells[i]);
+			char* const target = data.data() + i * blocks_size.second;
+			for (const auto& block: blocks_size.first) {
+				std::memcpy(
+					target + block.file_offset,
+					source + block.memory_offset,
+					block.size
+				);
+			}
+		}
+		return true;
+	}
+
+	// otherwise copy via combined MPI datatypes of many cells
+	constexpr std::size_t max_chunk_cells = std::size_t(1) << 16;
+	std::vector<int> counts;
+	std::vector<MPI_Aint> addresses;
+	std::vector<MPI_Datatype> datatypes;
+	bool success = true;
+
+	for (
+		std::size_t chunk_start = 0;
+		success and chunk_start < cells.size();
+		chunk_start += max_chunk_cells
+	) {
+		const auto chunk_end = std::min(cells.size(), chunk_start + max_chunk_cells);
+		const std::uint64_t chunk_offset = data.size();
+
+		counts.clear();
+		addresses.clear();
+		datatypes.clear();
+		std::uint64_t chunk_size = 0;
+		for (std::size_t i = chunk_start; i < chunk_end; i++) {
+			offsets.push_back(chunk_offset + chunk_size);
+
+			void* address = nullptr;
+			int count = -1;
+			MPI_Datatype datatype = MPI_DATATYPE_NULL;
+			std::tie(address, count, datatype) = cells[i]->get_mpi_datatype();
+			if (count < 0) {
+				success = false;
+				break;
+			}
+			if (count == 0) {
+				continue;
+			}
+
+			int datatype_size = -1;
+			MPI_Type_size(datatype, &datatype_size);
+			chunk_size += std::uint64_t(count) * std::uint64_t(datatype_size);
+
+			MPI_Aint absolute_address = 0;
+			MPI_Get_address(address, &absolute_address);
+			counts.push_back(count);
+			addresses.push_back(absolute_address);
+			datatypes.push_back(datatype);
+		}
+
+		if (chunk_size > std::uint64_t(std::numeric_limits<int>::max())) {
+			success = false;
+		}
+
+		if (success and datatypes.size() > 0) {
+			data.resize(chunk_offset + chunk_size);
+
+			MPI_Datatype memory_datatype = MPI_DATATYPE_NULL;
+			if (
+				MPI_Type_create_struct(
+					int(datatypes.size()),
+					counts.data(),
+					addresses.data(),
+					datatypes.data(),
+					&memory_datatype
+				) != MPI_SUCCESS
+			) {
+				success = false;
+			} else {
+				// local copy from cells into packed data
+				MPI_Type_commit(&memory_datatype);
+				if (
+					MPI_Sendrecv(
+						MPI_BOTTOM,
+						1,
+						memory_datatype,
+						0,
+						0,
+						data.data() + chunk_offset,
+						int(chunk_size),
+						MPI_BYTE,
+						0,
+						0,
+						MPI_COMM_SELF,
+						MPI_STATUS_IGNORE
+					) != MPI_SUCCESS
+				) {
+					success = false;
+				}
+				MPI_Type_free(&memory_datatype);
+			}
+		}
+
+		for (auto& datatype: datatypes) {
+			int combiner = -1, tmp1 = -1, tmp2 = -1, tmp3 = -1;
+			MPI_Type_get_envelope(datatype, &tmp1, &tmp2, &tmp3, &combiner);
+			if (combiner != MPI_COMBINER_NAMED) {
+				MPI_Type_free(&datatype);
+			}
+		}
+	}
+
+	return success;
+}
+
+
+/*!
+Starts writing given bytes at given offset of file and
+adds the request to given requests. Collective if
+MPI_File_iwrite_at_all is available.
+*/
+inline bool start_write(
+	MPI_File file,
+	const std::uint64_t offset,
+	const void* const bytes,
+	const int count,
+	const MPI_Datatype datatype,
+	std::vector<MPI_Request>& requests
+) {
+	MPI_Request request = MPI_REQUEST_NULL;
+	const auto result =
+		#if (MPI_VERSION > 3) || (MPI_VERSION == 3 && MPI_SUBVERSION >= 1)
+		MPI_File_iwrite_at_all(
+		#else
+		MPI_File_iwrite_at(
+		#endif
+			file,
+			MPI_Offset(offset),
+			const_cast<void*>(bytes),
+			count,
+			datatype,
+			&request
+		);
+	requests.push_back(request);
+	return result == MPI_SUCCESS;
+}
+
+} // namespace detail
+
+
+/*!
+Starts saving data of given cells into a file without waiting for the write.
+
+Collective over given communicator, each process gives its own
+cells and an id for each of them. Data of variables that are
+currently transferred by each cell is copied into a staging
+buffer before returning, after which cells can be modified and
+transfers switched off. The copy is done with one memcpy per
+cell if all cells have the same layout of transferred data.
+The file is written with MPI_File_iwrite_at_all, or with
+MPI_File_iwrite_at if MPI is older than 3.1, while the caller
+continues, call wait() of returned handle to finish the save.
+
+cells is a range of cells, e.g. std::vector<Cell_T>, or of pointers
+to cells, e.g. std::vector<Cell_T*>, of the same length as cell_ids.
+
+Layout of the file, all integers are uint64_t in native byte order:
+- total number of cells
+- id and offset of each cell's data in the file, ordered by
+  process, same as the cell list in files saved by dccrg
+- data of cells packed in the order of variables, which can
+  be read with read_cells()
+
+Example overlapping the save with the next time step:
+@code
+gensimcell::Async_Save save;
+while (...) {
+	save.wait();
+	Cell_T::set_transfer_all(true, Density());
+	save = gensimcell::save_async(comm, "density.dc", cell_ids, cells);
+	Cell_T::set_transfer_all(false, Density());
+	solve(cells);
+}
+save.wait();
+@endcode
+*/
+template<class Cell_Range> Async_Save save_async(
+	MPI_Comm comm,
+	const std::string& file_name,
+	const std::vector<std::uint64_t>& cell_ids,
+	const Cell_Range& cells
+) {
+	using Cell_T = typename std::remove_cv<
+		typename std::remove_reference<
+			decltype(detail::dereference_cell(*std::begin(cells)))
+		>::type
+	>::type;
+
+	Async_Save save;
+
+	std::vector<const Cell_T*> cell_pointers;
+	cell_pointers.reserve(cell_ids.size());
+	for (const auto& cell: cells) {
+		if (cell_pointers.size() == cell_ids.size()) {
+			break;
+		}
+		cell_pointers.push_back(&detail::dereference_cell(cell));
+	}
+	if (cell_pointers.size() != cell_ids.size()) {
+		save.success = false;
+		cell_pointers.clear();
+	}
+
+	std::vector<std::uint64_t> offsets;
+	offsets.reserve(cell_pointers.size());
+	if (not detail::pack_cells(cell_pointers, offsets, save.data)) {
+		// offsets can be incomplete, write no cells of this process
+		save.success = false;
+		cell_pointers.clear();
+		offsets.clear();
+		save.data.clear();
+	}
+
+	// position of this process' cells and data in the file
+	std::uint64_t
+		local[2] = {cell_pointers.size(), save.data.size()},
+		before[2] = {0, 0},
+		total_cells = 0;
+	MPI_Exscan(local, before, 2, MPI_UINT64_T, MPI_SUM, comm);
+	int rank = 0;
+	MPI_Comm_rank(comm, &rank);
+	if (rank == 0) {
+		before[0] = before[1] = 0;
+	}
+	MPI_Allreduce(&local[0], &total_cells, 1, MPI_UINT64_T, MPI_SUM, comm);
+
+	const std::uint64_t
+		table_start = sizeof(std::uint64_t) + before[0] * 2 * sizeof(std::uint64_t),
+		data_start = sizeof(std::uint64_t) + total_cells * 2 * sizeof(std::uint64_t);
+
+	save.table.reserve(2 * cell_pointers.size());
+	for (std::size_t i = 0; i < cell_pointers.size(); i++) {
+		save.table.push_back(cell_ids[i]);
+		save.table.push_back(data_start + before[1] + offsets[i]);
+	}
+	if (rank == 0) {
+		save.header.push_back(total_cells);
+	}
+
+	if (
+		MPI_File_open(
+			comm,
+			const_cast<char*>(file_name.c_str()),
+			MPI_MODE_CREATE | MPI_MODE_WRONLY,
+			MPI_INFO_NULL,
+			&save.file
+		) != MPI_SUCCESS
+	) {
+		save.file = MPI_FILE_NULL;
+		save.success = false;
+		return save;
+	}
+	MPI_File_set_size(save.file, 0);
+
+	// collective writes must be started the same number of times everywhere
+	constexpr std::uint64_t max_write_size = std::uint64_t(1) << 30;
+	const std::uint64_t
+		local_writes = std::max(
+			(save.table.size() * sizeof(std::uint64_t) + max_write_size - 1)
+				/ max_write_size,
+			(save.data.size() + max_write_size - 1) / max_write_size
+		);
+	std::uint64_t nr_writes = 0;
+	MPI_Allreduce(&local_writes, &nr_writes, 1, MPI_UINT64_T, MPI_MAX, comm);
+
+	bool success = detail::start_write(
+		save.file,
+		0,
+		save.header.data(),
+		int(save.header.size()),
+		MPI_UINT64_T,
+		save.requests
+	);
+
+	const char* const table_bytes = reinterpret_cast<const char*>(save.table.data());
+	const std::uint64_t table_size = save.table.size() * sizeof(std::uint64_t);
+	for (std::uint64_t i = 0; i < nr_writes; i++) {
+		const auto table_offset = std::min(table_size, i * max_write_size);
+		success = detail::start_write(
+			save.file,
+			table_start + table_offset,
+			table_bytes + table_offset,
+			int(std::min(max_write_size, table_size - table_offset)),
+			MPI_BYTE,
+			save.requests
+		) and success;
+
+		const auto data_offset = std::min(std::uint64_t(save.data.size()), i * max_write_size);
+		success = detail::start_write(
+			save.file,
+			data_start + before[1] + data_offset,
+			save.data.data() + data_offset,
+			int(std::min(max_write_size, save.data.size() - data_offset)),
+			MPI_BYTE,
+			save.requests
+		) and success;
+	}
+	if (not success) {
+		save.success = false;
+	}
+
+	return save;
+}
+
+
+} // namespace gensimcell
+
+#endif // ifdef MPI_VERSION
+
+#endif // ifndef GENSIMCELL_ASYNC_SAVE_HPP
@@ -0,0 +1,971 @@
+/*
+Columnar checkpoint files of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_CHECKPOINT_HPP
+#define GENSIMCELL_CHECKPOINT_HPP
+
+
+#include "algorithm"
+#include "cstddef"
+#include "cstdint"
+#include "cstring"
+#include "fstream"
+#include "map"
+#include "string"
+#include "type_traits"
+#include "typeinfo"
+#include "utility"
+#include "vector"
+
+#include "fcntl.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "unistd.h"
+
+#include "boost/core/demangle.hpp"
+
+#include "compression.hpp"
+#include "schema.hpp"
+#include "type_support.hpp"
+#include "variable_table.hpp"
+
+
+namespace gensimcell {
+
+
+/*!
+Read-only view to a column of fixed size data in a checkpoint file.
+
+A value initialized view, e.g. Column_Span<T>(), is empty.
+*/
+template<class T> struct Column_Span
+{
+	const T* data;
+	std::size_t size;
+
+	const T* begin() const
+	{
+		return this->data;
+	}
+
+	const T* end() const
+	{
+		return this->data + this->size;
+	}
+
+	const T& operator[](const std::size_t index) const
+	{
+		return this->data[index];
+	}
+
+	bool empty() const
+	{
+		return this->size == 0;
+	}
+};
+
+
+/*!
+Read-only view to a column of std::vector data in a checkpoint
+file, operator[] returns the items stored in given cell.
+*/
+template<class Item_T> struct Vector_Column_Span
+{
+	const Item_T* items;
+	//! Items of cell i are at [offsets[i], offsets[i + 1])
+	const std::uint64_t* offsets;
+	std::size_t size;
+
+	Column_Span<Item_T> operator[](const std::size_t index) const
+	{
+		return Column_Span<Item_T>{
+			this->items + this->offsets[index],
+			std::size_t(this->offsets[index + 1] - this->offsets[index])
+		};
+	}
+
+	bool empty() const
+	{
+		return this->size == 0;
+	}
+};
+
+
+//! Description of one column in a checkpoint file.
+struct Checkpoint_Column
+{
+	//! See Variable_Info
+	std::string name;
+	Element_Type element_type;
+	std::uint64_t element_size, element_count;
+	bool variable_length;
+
+	//! Size of one cell's data or of one item of std::vector data
+	std::uint64_t item_size;
+
+	//! Position and size in bytes of the column in the file
+	std::uint64_t data_offset, data_size;
+
+	/*!
+	Position of nr_cells + 1 uint64_t offsets of items of
+	cells in the column if variable_length is true.
+	*/
+	std::uint64_t offsets_offset;
+
+	/*!
+	Whether data of the column, but not offsets, is stored
+	compressed by compress_bytes(), data_size is then the
+	size of compressed data.
+	*/
+	bool compressed;
+};
+
+
+//! Compression of columns in write_checkpoint().
+enum class Checkpoint_Compression : unsigned char {
+	none,
+	//! See compress_bytes()
+	shuffle_lz
+};
+
+
+namespace detail {
+
+//! Alignment of columns in checkpoint files in bytes.
+constexpr std::uint64_t checkpoint_alignment = 64;
+
+//! Returns true if a * b == product without overflowing.
+inline bool is_product(
+	const std::uint64_t a,
+	const std::uint64_t b,
+	const std::uint64_t product
+) {
+	if (b == 0) {
+		return product == 0;
+	}
+	return product % b == 0 and product / b == a;
+}
+
+
+/*!
+Type of read-only view to a variable's column,
+Vector_Column_Span for std::vector data and
+Column_Span otherwise.
+*/
+template<class Data_T> struct Column_Span_Type
+{
+	using type = Column_Span<Data_T>;
+};
+
+//! See the general version for documentation.
+template<class Item_T, class Allocator> struct Column_Span_Type<
+	std::vector<Item_T, Allocator>
+> {
+	using type = Vector_Column_Span<Item_T>;
+};
+
+
+//! Writes data of one variable of cells as a column.
+template<class Variable> struct Column_Writer
+{
+	using Data_T = typename Variable::data_type;
+	using Item_T = typename std::conditional<
+		Vector_Items<Data_T>::value,
+		typename Vector_Items<Data_T>::type,
+		Data_T
+	>::type;
+
+	static_assert(
+		std::is_trivially_copyable<Item_T>::value,
+		"Only variables of trivially copyable type or std::vector "
+		"of trivially copyable items can be saved into columns"
+	);
+
+	static std::uint64_t get_nr_items(const Data_T&, const std::false_type)
+	{
+		return 1;
+	}
+
+	static std::uint64_t get_nr_items(const Data_T& data, const std::true_type)
+	{
+		return data.size();
+	}
+
+	static const char* get_bytes(const Data_T& data, const std::false_type)
+	{
+		return reinterpret_cast<const char*>(&data);
+	}
+
+	static const char* get_bytes(const Data_T& data, const std::true_type)
+	{
+		return reinterpret_cast<const char*>(data.data());
+	}
+
+	template<class Cell_Range> static Checkpoint_Column get_column(
+		const Cell_Range& cells
+	) {
+		const std::integral_constant<bool, Vector_Items<Data_T>::value> is_vector{};
+
+		std::uint64_t nr_items = 0;
+		for (const auto& cell: cells) {
+			nr_items += get_nr_items(cell[Variable()], is_vector);
+		}
+
+		using Element_T = typename Data_Elements<Item_T>::type;
+		return Checkpoint_Column{
+			boost::core::demangle(typeid(Variable).name()),
+			get_element_type<Element_T>(),
+			get_element_size<Element_T>(),
+			Data_Elements<Item_T>::count,
+			Vector_Items<Data_T>::value,
+			sizeof(Item_T),
+			0,
+			nr_items * sizeof(Item_T),
+			0,
+			false
+		};
+	}
+
+	//! Returns the column's data of given cells contiguously.
+	template<class Cell_Range> static std::vector<char> get_data(
+		const Cell_Range& cells,
+		const Checkpoint_Column& column
+	) {
+		const std::integral_constant<bool, Vector_Items<Data_T>::value> is_vector{};
+
+		std::vector<char> data(std::size_t(column.data_size));
+		std::size_t position = 0;
+		for (const auto& cell: cells) {
+			const std::size_t size
+				= get_nr_items(cell[Variable()], is_vector) * sizeof(Item_T);
+			if (size > 0) {
+				std::memcpy(
+					data.data() + position,
+					get_bytes(cell[Variable()], is_vector),
+					size
+				);
+			}
+			position += size;
+		}
+		return data;
+	}
+
+	/*!
+	Writes the column of given cells, or given
+	compressed data if the column is compressed.
+	*/
+	template<class Cell_Range> static void write(
+		std::ofstream& file,
+		const Cell_Range& cells,
+		const Checkpoint_Column& column,
+		const std::string& compressed_data
+	) {
+		const std::integral_constant<bool, Vector_Items<Data_T>::value> is_vector{};
+
+		file.seekp(std::streamoff(column.data_offset));
+		if (column.compressed) {
+			file.write(compressed_data.data(), std::streamsize(compressed_data.size()));
+		} else {
+			for (const auto& cell: cells) {
+				file.write(
+					get_bytes(cell[Variable()], is_vector),
+					std::streamsize(
+						get_nr_items(cell[Variable()], is_vector) * sizeof(Item_T)
+					)
+				);
+			}
+		}
+
+		if (not column.variable_length) {
+			return;
+		}
+
+		file.seekp(std::streamoff(column.offsets_offset));
+		std::uint64_t offset = 0;
+		file.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+		for (const auto& cell: cells) {
+			offset += get_nr_items(cell[Variable()], is_vector);
+			file.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+		}
+	}
+};
+
+
+//! Returns given offset rounded up to checkpoint_alignment.
+inline std::uint64_t align_checkpoint_offset(const std::uint64_t offset)
+{
+	return
+		(offset + checkpoint_alignment - 1)
+		/ checkpoint_alignment
+		* checkpoint_alignment;
+}
+
+
+/*!
+Returns given data of a column compressed with element
+size of the column, or size of items if not known.
+*/
+inline std::string compress_column(
+	const std::vector<char>& data,
+	const Checkpoint_Column& column
+) {
+	return compress_bytes(
+		data.data(),
+		data.size(),
+		std::size_t(column.element_size > 0 ? column.element_size : column.item_size)
+	);
+}
+
+
+//! Returns the header and column directory of a checkpoint file.
+inline std::string get_checkpoint_header(
+	const std::uint64_t nr_cells,
+	const std::vector<Checkpoint_Column>& columns
+) {
+	std::string bytes("GSCC");
+	append_little_endian(bytes, 1, 4);
+	append_little_endian(bytes, nr_cells, 8);
+	append_little_endian(bytes, columns.size(), 4);
+	for (const auto& column: columns) {
+		append_little_endian(bytes, column.name.size(), 4);
+		bytes += column.name;
+		append_little_endian(
+			bytes,
+			static_cast<std::uint64_t>(column.element_type),
+			1
+		);
+		append_little_endian(
+			bytes,
+			(column.variable_length ? 1 : 0) | (column.compressed ? 2 : 0),
+			1
+		);
+		append_little_endian(bytes, column.element_size, 8);
+		append_little_endian(bytes, column.element_count, 8);
+		append_little_endian(bytes, column.item_size, 8);
+		append_little_endian(bytes, column.data_offset, 8);
+		append_little_endian(bytes, column.data_size, 8);
+		append_little_endian(bytes, column.offsets_offset, 8);
+	}
+	return bytes;
+}
+
+} // namespace detail
+
+
+/*!
+Saves given variables of given cells into a columnar checkpoint file.
+
+Data of each variable of all cells is stored contiguously in the
+file as one column in the same order as cells, so reading one
+variable doesn't touch the data of other variables. std::vector
+data is stored as all items of all cells followed by an offsets
+column giving the first item of each cell, see Vector_Column_Span.
+Variable's data, or items of std::vector data, must be trivially
+copyable and is saved in native byte order. Columns start at 64
+byte boundaries in the file. Returns true on success.
+
+With Checkpoint_Compression::shuffle_lz the data of each column
+is compressed with compress_bytes() using all hardware threads.
+
+Example saving density and particles, see Checkpoint_Reader
+for reading:
+@code
+std::vector<Cell_T> cells(...);
+gensimcell::write_checkpoint("data.gsc", cells, Density(), Particles());
+gensimcell::write_checkpoint(
+	"compressed.gsc",
+	cells,
+	gensimcell::Checkpoint_Compression::shuffle_lz,
+	Density(),
+	Particles()
+);
+@endcode
+*/
+template<
+	class Cell_Range,
+	class... Variables
+> typename std::enable_if<
+	is_gensimcell_range<Cell_Range>::value,
+	bool
+>::type write_checkpoint(
+	const std::string& file_name,
+	const Cell_Range& cells,
+	const Checkpoint_Compression compression,
+	const Variables&...
+) {
+	std::uint64_t nr_cells = 0;
+	for (auto cell = std::begin(cells); cell != std::end(cells); cell++) {
+		nr_cells++;
+	}
+
+	std::vector<Checkpoint_Column> columns{
+		detail::Column_Writer<Variables>::get_column(cells)...
+	};
+
+	std::vector<std::string> compressed_data(columns.size());
+	if (compression == Checkpoint_Compression::shuffle_lz) {
+		std::size_t index = 0;
+		int dummy[] = {0, (
+			compressed_data[index] = detail::compress_column(
+				detail::Column_Writer<Variables>::get_data(cells, columns[index]),
+				columns[index]
+			),
+			index++,
+			0
+		)...};
+		(void)dummy;
+	}
+
+	// header size doesn't depend on offsets
+	std::uint64_t offset = detail::align_checkpoint_offset(
+		detail::get_checkpoint_header(nr_cells, columns).size()
+	);
+	for (std::size_t i = 0; i < columns.size(); i++) {
+		auto& column = columns[i];
+		if (compression == Checkpoint_Compression::shuffle_lz) {
+			column.compressed = true;
+			column.data_size = compressed_data[i].size();
+		}
+		column.data_offset = offset;
+		offset = detail::align_checkpoint_offset(offset + column.data_size);
+		if (column.variable_length) {
+			column.offsets_offset = offset;
+			offset = detail::align_checkpoint_offset(
+				offset + (nr_cells + 1) * sizeof(std::uint64_t)
+			);
+		}
+	}
+
+	std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+	const auto header = detail::get_checkpoint_header(nr_cells, columns);
+	file.write(header.data(), std::streamsize(header.size()));
+
+	std::size_t index = 0;
+	int dummy[] = {0, (
+		detail::Column_Writer<Variables>::write(
+			file,
+			cells,
+			columns[index],
+			compressed_data[index]
+		),
+		index++,
+		0
+	)...};
+	(void)dummy;
+
+	// pad file to the end of last column
+	if (offset > 0) {
+		file.seekp(std::streamoff(offset - 1));
+		file.put(0);
+	}
+
+	return bool(file);
+}
+
+//! Saves given variables of given cells without compression.
+template<
+	class Cell_Range,
+	class... Variables
+> typename std::enable_if<
+	is_gensimcell_range<Cell_Range>::value,
+	bool
+>::type write_checkpoint(
+	const std::string& file_name,
+	const Cell_Range& cells,
+	const Variables&... variables
+) {
+	return write_checkpoint(
+		file_name,
+		cells,
+		Checkpoint_Compression::none,
+		variables...
+	);
+}
+
+
+/*!
+Reads columnar checkpoint files saved by write_checkpoint().
+
+The file is memory mapped and columns are returned as
+read-only views to the mapping so only the parts of the file
+which are accessed are read from disk. Views are valid until
+the reader is closed or destroyed.
+
+Compressed columns are decompressed into memory kept by
+the reader when they're first accessed, accessing them
+from several threads at the same time isn't safe.
+
+Example:
+@code
+gensimcell::Checkpoint_Reader reader;
+if (reader.open("data.gsc")) {
+	const auto density = reader.get(Density());
+	for (const auto& value: density) {...}
+	const auto particles = reader.get(Particles());
+	for (size_t i = 0; i < particles.size; i++) {
+		for (const auto& particle: particles[i]) {...}
+	}
+}
+@endcode
+*/
+class Checkpoint_Reader
+{
+public:
+
+	Checkpoint_Reader() = default;
+	Checkpoint_Reader(const Checkpoint_Reader&) = delete;
+	Checkpoint_Reader& operator=(const Checkpoint_Reader&) = delete;
+
+	~Checkpoint_Reader()
+	{
+		this->close();
+	}
+
+
+	/*!
+	Memory maps given checkpoint file, returns false if it
+	couldn't be opened or isn't a valid checkpoint file.
+	*/
+	bool open(const std::string& file_name)
+	{
+		this->close();
+
+		const int descriptor = ::open(file_name.c_str(), O_RDONLY);
+		if (descriptor < 0) {
+			return false;
+		}
+
+		struct stat status;
+		if (fstat(descriptor, &status) != 0 or status.st_size <= 0) {
+			::close(descriptor);
+			return false;
+		}
+		this->mapping_size = std::size_t(status.st_size);
+
+		void* const mapping_address = mmap(
+			nullptr,
+			this->mapping_size,
+			PROT_READ,
+			MAP_SHARED,
+			descriptor,
+			0
+		);
+		::close(descriptor);
+		if (mapping_address == MAP_FAILED) {
+			this->mapping_size = 0;
+			return false;
+		}
+		this->mapping = static_cast<const char*>(mapping_address);
+
+		if (not this->read_header()) {
+			this->close();
+			return false;
+		}
+		return true;
+	}
+
+
+	//! Unmaps the file, views returned by get() become invalid.
+	void close()
+	{
+		if (this->mapping != nullptr) {
+			munmap(const_cast<char*>(this->mapping), this->mapping_size);
+		}
+		this->mapping = nullptr;
+		this->mapping_size = 0;
+		this->nr_cells = 0;
+		this->columns.clear();
+		this->decompressed.clear();
+	}
+
+
+	//! Returns the number of cells in the file.
+	std::uint64_t get_nr_cells() const
+	{
+		return this->nr_cells;
+	}
+
+	//! Returns descriptions of columns in the file.
+	const std::vector<Checkpoint_Column>& get_columns() const
+	{
+		return this->columns;
+	}
+
+	//! Returns index of column with given name like Variable_Table::find().
+	std::size_t find(const std::string& name) const
+	{
+		return detail::find_variable_name(this->columns, name);
+	}
+
+	/*!
+	Returns address of data of column at given index.
+
+	Returns nullptr if the column is compressed
+	and its data couldn't be decompressed.
+	*/
+	const void* get_data(const std::size_t index) const
+	{
+		const auto& column = this->columns[index];
+		if (not column.compressed) {
+			return this->mapping + column.data_offset;
+		}
+
+		const auto cached = this->decompressed.find(index);
+		if (cached != this->decompressed.end()) {
+			return cached->second.data();
+		}
+
+		const std::uint64_t nr_items
+			= column.variable_length
+			? this->get_offsets(index)[this->nr_cells]
+			: this->nr_cells;
+		std::vector<char> data;
+		if (
+			not decompress_bytes(
+				this->mapping + column.data_offset,
+				std::size_t(column.data_size),
+				data
+			)
+			or not detail::is_product(nr_items, column.item_size, data.size())
+		) {
+			return nullptr;
+		}
+		// keep address valid for empty columns
+		data.reserve(1);
+		return this->decompressed.emplace(index, std::move(data)).first->second.data();
+	}
+
+	/*!
+	Returns address of item offsets of column at given
+	index or nullptr if column isn't of variable length.
+	*/
+	const std::uint64_t* get_offsets(const std::size_t index) const
+	{
+		if (not this->columns[index].variable_length) {
+			return nullptr;
+		}
+		return reinterpret_cast<const std::uint64_t*>(
+			this->mapping + this->columns[index].offsets_offset
+		);
+	}
+
+
+	/*!
+	Returns a read-only view to the column of given variable.
+
+	Returned view is empty if the file doesn't have a column
+	with variable's name whose type matches variable's data_type.
+	*/
+	template<class Variable> typename detail::Column_Span_Type<
+		typename Variable::data_type
+	>::type get(const Variable&) const
+	{
+		using Data_T = typename Variable::data_type;
+		using Span_T = typename detail::Column_Span_Type<Data_T>::type;
+
+		const auto index = this->find(boost::core::demangle(typeid(Variable).name()));
+		if (index >= this->columns.size()) {
+			return Span_T();
+		}
+		return this->get_span(
+			index,
+			static_cast<const Data_T*>(nullptr)
+		);
+	}
+
+
+private:
+
+	const char* mapping = nullptr;
+	std::size_t mapping_size = 0;
+	std::uint64_t nr_cells = 0;
+	std::vector<Checkpoint_Column> columns;
+	//! Data of compressed columns by index
+	mutable std::map<std::size_t, std::vector<char>> decompressed;
+
+
+	template<class Data_T> Column_Span<Data_T> get_span(
+		const std::size_t index,
+		const Data_T*
+	) const {
+		const auto& column = this->columns[index];
+		const auto* const data = this->get_data(index);
+		if (
+			column.variable_length
+			or column.item_size != sizeof(Data_T)
+			or data == nullptr
+		) {
+			return Column_Span<Data_T>();
+		}
+		return Column_Span<Data_T>{
+			static_cast<const Data_T*>(data),
+			std::size_t(this->nr_cells)
+		};
+	}
+
+	template<class Item_T, class Allocator> Vector_Column_Span<Item_T> get_span(
+		const std::size_t index,
+		const std::vector<Item_T, Allocator>*
+	) const {
+		const auto& column = this->columns[index];
+		if (not column.variable_length or column.item_size != sizeof(Item_T)) {
+			return Vector_Column_Span<Item_T>();
+		}
+		const auto* const data = this->get_data(index);
+		if (data == nullptr) {
+			return Vector_Column_Span<Item_T>();
+		}
+		return Vector_Column_Span<Item_T>{
+			static_cast<const Item_T*>(data),
+			this->get_offsets(index),
+			std::size_t(this->nr_cells)
+		};
+	}
+
+
+	//! Reads the column directory and checks that columns are inside file.
+	bool read_header()
+	{
+		const auto* const bytes = this->mapping;
+		const auto size = this->mapping_size;
+
+		std::size_t position = 4;
+		std::uint64_t version = 0, nr_columns = 0;
+		if (
+			size < 4
+			or std::string(bytes, 4) != "GSCC"
+			or not detail::extract_little_endian(bytes, size, position, version, 4)
+			or version != 1
+			or not detail::extract_little_endian(bytes, size, position, this->nr_cells, 8)
+			or not detail::extract_little_endian(bytes, size, position, nr_columns, 4)
+		) {
+			return false;
+		}
+
+		for (std::uint64_t i = 0; i < nr_columns; i++) {
+			Checkpoint_Column column;
+			std::uint64_t name_length = 0, element_type = 0, flags = 0;
+			if (
+				not detail::extract_little_endian(bytes, size, position, name_length, 4)
+				or size - position < name_length
+			) {
+				return false;
+			}
+			column.name = std::string(bytes + position, name_length);
+			position += name_length;
+
+			if (
+				not detail::extract_little_endian(bytes, size, position, element_type, 1)
+				or element_type > static_cast<std::uint64_t>(Element_Type::floating_point)
+				or not detail::extract_little_endian(bytes, size, position, flags, 1)
+				or not detail::extract_little_endian(bytes, size, position, column.element_size, 8)
+				or not detail::extract_little_endian(bytes, size, position, column.element_count, 8)
+				or not detail::extract_little_endian(bytes, size, position, column.item_size, 8)
+				or not detail::extract_little_endian(bytes, size, position, column.data_offset, 8)
+				or not detail::extract_little_endian(bytes, size, position, column.data_size, 8)
+				or not detail::extract_little_endian(bytes, size, position, column.offsets_offset, 8)
+			) {
+				return false;
+			}
+			column.element_type = static_cast<Element_Type>(element_type);
+			column.variable_length = (flags & 1) > 0;
+			column.compressed = (flags & 2) > 0;
+
+			if (
+				column.data_offset > this->mapping_size
+				or column.data_size > this->mapping_size - column.data_offset
+				or column.data_offset % detail::checkpoint_alignment != 0
+			) {
+				return false;
+			}
+			if (column.variable_length) {
+				// written as division so nr_cells + 1 can't overflow
+				if (
+					column.offsets_offset > this->mapping_size
+					or this->nr_cells
+						>= (this->mapping_size - column.offsets_offset) / sizeof(std::uint64_t)
+					or column.offsets_offset % detail::checkpoint_alignment != 0
+				) {
+					return false;
+				}
+				const auto* const offsets = reinterpret_cast<const std::uint64_t*>(
+					bytes + column.offsets_offset
+				);
+				if (offsets[0] != 0) {
+					return false;
+				}
+				for (std::uint64_t j = 0; j < this->nr_cells; j++) {
+					if (offsets[j] > offsets[j + 1]) {
+						return false;
+					}
+				}
+				// size of compressed items is checked by get_data()
+				if (
+					not column.compressed
+					and not detail::is_product(
+						offsets[this->nr_cells],
+						column.item_size,
+						column.data_size
+					)
+				) {
+					return false;
+				}
+			} else if (
+				not column.compressed
+				and not detail::is_product(this->nr_cells, column.item_size, column.data_size)
+			) {
+				return false;
+			}
+
+			this->columns.push_back(column);
+		}
+
+		return this->columns_are_disjoint(position);
+	}
+
+
+	/*!
+	Returns true if data and offsets of columns
+	don't overlap each other or the header that
+	ends at given position.
+	*/
+	bool columns_are_disjoint(const std::size_t header_end) const
+	{
+		std::vector<std::pair<std::uint64_t, std::uint64_t>> ranges;
+		for (const auto& column: this->columns) {
+			ranges.emplace_back(column.data_offset, column.data_size);
+			if (column.variable_length) {
+				ranges.emplace_back(
+					column.offsets_offset,
+					(this->nr_cells + 1) * sizeof(std::uint64_t)
+				);
+			}
+		}
+		std::sort(ranges.begin(), ranges.end());
+
+		// ranges are inside the file so their ends can't overflow
+		std::uint64_t previous_end = header_end;
+		for (const auto& range: ranges) {
+			if (range.second == 0) {
+				continue;
+			}
+			if (range.first < previous_end) {
+				return false;
+			}
+			previous_end = range.first + range.second;
+		}
+		return true;
+	}
+};
+
+
+namespace detail {
+
+//! Copies a column of fixed size data into cells.
+template<class Variable, class Cell_T, class Data_T> bool read_column(
+	const Column_Span<Data_T>& column,
+	std::vector<Cell_T>& cells
+) {
+	if (column.size != cells.size()) {
+		return false;
+	}
+	for (std::size_t i = 0; i < cells.size(); i++) {
+		cells[i][Variable()] = column[i];
+	}
+	return true;
+}
+
+//! Copies a column of std::vector data into cells.
+template<class Variable, class Cell_T, class Item_T> bool read_column(
+	const Vector_Column_Span<Item_T>& column,
+	std::vector<Cell_T>& cells
+) {
+	if (column.size != cells.size()) {
+		return false;
+	}
+	for (std::size_t i = 0; i < cells.size(); i++) {
+		const auto items = column[i];
+		cells[i][Variable()].assign(items.begin(), items.end());
+	}
+	return true;
+}
+
+} // namespace detail
+
+
+/*!
+Reads given variables of cells from given checkpoint file.
+
+cells is resized to the number of cells in the file and
+given variables are copied from their columns into cells.
+Returns false if a variable isn't in the file.
+
+Example:
+@code
+gensimcell::Checkpoint_Reader reader;
+std::vector<Cell_T> cells;
+if (
+	not reader.open("data.gsc")
+	or not gensimcell::read_checkpoint(reader, cells, Density(), Particles())
+) {
+	...
+}
+@endcode
+*/
+template<
+	class Cell_T,
+	class... Variables
+> bool read_checkpoint(
+	const Checkpoint_Reader& reader,
+	std::vector<Cell_T>& cells,
+	const Variables&... variables
+) {
+	cells.resize(std::size_t(reader.get_nr_cells()));
+
+	bool success = true;
+	int dummy[] = {0, (
+		success = detail::read_column<Variables>(
+			reader.get(variables),
+			cells
+		) and success,
+		0
+	)...};
+	(void)dummy;
+
+	return success;
+}
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_CHECKPOINT_HPP
@@ -0,0 +1,623 @@
+/*
+Collective reading and writing of generic simulation cells with MPI-IO.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_COLLECTIVE_IO_HPP
+#define GENSIMCELL_COLLECTIVE_IO_HPP
+
+
+#include "algorithm"
+#include "cstdint"
+#include "limits"
+#include "numeric"
+#include "string"
+#include "tuple"
+#include "type_traits"
+#include "vector"
+
+#include "async_save.hpp"
+
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+
+namespace gensimcell {
+
+
+namespace detail {
+
+/*!
+Creates datatypes describing data currently transferred by
+given cells in memory, relative to MPI_BOTTOM, and at given
+offsets in a file, relative to the beginning of the file.
+
+Cells are ordered by file offset as required by file views.
+Datatypes are MPI_DATATYPE_NULL if no cell transfers data,
+otherwise they're committed and must be freed by the caller.
+Returns false on failure.
+*/
+template<class Cell_Pointer_T> bool create_file_datatypes(
+	const std::vector<std::uint64_t>& file_offsets,
+	const std::vector<Cell_Pointer_T>& cells,
+	MPI_Datatype& memory_datatype,
+	MPI_Datatype& file_datatype
+) {
+	memory_datatype = file_datatype = MPI_DATATYPE_NULL;
+	if (
+		cells.size() != file_offsets.size()
+		or cells.size() > std::size_t(std::numeric_limits<int>::max())
+	) {
+		return false;
+	}
+
+	std::vector<std::size_t> order(cells.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(
+		order.begin(),
+		order.end(),
+		[&file_offsets](const std::size_t a, const std::size_t b) {
+			return file_offsets[a] < file_offsets[b];
+		}
+	);
+
+	bool success = true;
+	std::vector<int> counts, file_counts;
+	std::vector<MPI_Aint> addresses, file_displacements;
+	std::vector<MPI_Datatype> datatypes;
+	counts.reserve(cells.size());
+	file_counts.reserve(cells.size());
+	addresses.reserve(cells.size());
+	file_displacements.reserve(cells.size());
+	datatypes.reserve(cells.size());
+
+	for (const auto index: order) {
+		void* address = nullptr;
+		int count = -1;
+		MPI_Datatype datatype = MPI_DATATYPE_NULL;
+		std::tie(address, count, datatype) = cells[index]->get_mpi_datatype();
+		if (count < 0) {
+			success = false;
+			break;
+		}
+		if (count == 0) {
+			continue;
+		}
+		datatypes.push_back(datatype);
+
+		int datatype_size = -1;
+		MPI_Type_size(datatype, &datatype_size);
+		if (
+			datatype_size < 0
+			or std::uint64_t(count) * std::uint64_t(datatype_size)
+				> std::uint64_t(std::numeric_limits<int>::max())
+		) {
+			success = false;
+			break;
+		}
+
+		MPI_Aint absolute_address = 0;
+		MPI_Get_address(address, &absolute_address);
+
+		counts.push_back(count);
+		addresses.push_back(absolute_address);
+		file_counts.push_back(count * datatype_size);
+		file_displacements.push_back(MPI_Aint(file_offsets[index]));
+	}
+
+	if (success and datatypes.size() > 0) {
+		if (
+			MPI_Type_create_struct(
+				int(datatypes.size()),
+				counts.data(),
+				addresses.data(),
+				datatypes.data(),
+				&memory_datatype
+			) != MPI_SUCCESS
+		) {
+			memory_datatype = MPI_DATATYPE_NULL;
+			success = false;
+		} else if (
+			MPI_Type_create_hindexed(
+				int(file_counts.size()),
+				file_counts.data(),
+				file_displacements.data(),
+				MPI_BYTE,
+				&file_datatype
+			) != MPI_SUCCESS
+		) {
+			file_datatype = MPI_DATATYPE_NULL;
+			success = false;
+		}
+	}
+
+	for (auto& datatype: datatypes) {
+		int combiner = -1, tmp1 = -1, tmp2 = -1, tmp3 = -1;
+		MPI_Type_get_envelope(datatype, &tmp1, &tmp2, &tmp3, &combiner);
+		if (combiner != MPI_COMBINER_NAMED) {
+			MPI_Type_free(&datatype);
+		}
+	}
+
+	if (not success) {
+		if (memory_datatype != MPI_DATATYPE_NULL) {
+			MPI_Type_free(&memory_datatype);
+		}
+		if (file_datatype != MPI_DATATYPE_NULL) {
+			MPI_Type_free(&file_datatype);
+		}
+		return false;
+	}
+
+	if (memory_datatype != MPI_DATATYPE_NULL) {
+		MPI_Type_commit(&memory_datatype);
+		MPI_Type_commit(&file_datatype);
+	}
+	return true;
+}
+
+
+/*!
+Writes or reads data of given cells at given offsets of file
+with one collective call using one file view for all cells.
+
+Collective over the processes that opened file, processes
+without data take part with an empty transfer. The file view
+is reset to the default afterwards.
+*/
+template<class Cell_Pointer_T> bool transfer_cells_all(
+	MPI_File file,
+	const std::vector<std::uint64_t>& file_offsets,
+	const std::vector<Cell_Pointer_T>& cells,
+	const bool write
+) {
+	MPI_Datatype
+		memory_datatype = MPI_DATATYPE_NULL,
+		file_datatype = MPI_DATATYPE_NULL;
+	bool success = create_file_datatypes(
+		file_offsets,
+		cells,
+		memory_datatype,
+		file_datatype
+	);
+	const bool have_data = memory_datatype != MPI_DATATYPE_NULL;
+
+	if (
+		MPI_File_set_view(
+			file,
+			0,
+			MPI_BYTE,
+			have_data ? file_datatype : MPI_BYTE,
+			const_cast<char*>("native"),
+			MPI_INFO_NULL
+		) != MPI_SUCCESS
+	) {
+		success = false;
+	}
+
+	const int result
+		= write
+		? MPI_File_write_all(
+			file,
+			MPI_BOTTOM,
+			have_data ? 1 : 0,
+			have_data ? memory_datatype : MPI_BYTE,
+			MPI_STATUS_IGNORE
+		)
+		: MPI_File_read_all(
+			file,
+			MPI_BOTTOM,
+			have_data ? 1 : 0,
+			have_data ? memory_datatype : MPI_BYTE,
+			MPI_STATUS_IGNORE
+		);
+	if (result != MPI_SUCCESS) {
+		success = false;
+	}
+
+	// restore default view for reads with explicit offsets
+	MPI_File_set_view(
+		file,
+		0,
+		MPI_BYTE,
+		MPI_BYTE,
+		const_cast<char*>("native"),
+		MPI_INFO_NULL
+	);
+
+	if (have_data) {
+		MPI_Type_free(&memory_datatype);
+		MPI_Type_free(&file_datatype);
+	}
+
+	return success;
+}
+
+
+//! Returns the number of bytes currently transferred by given cell.
+template<class Cell_T> std::uint64_t get_transfer_size(const Cell_T& cell)
+{
+	void* address = nullptr;
+	int count = -1;
+	MPI_Datatype datatype = MPI_DATATYPE_NULL;
+	std::tie(address, count, datatype) = cell.get_mpi_datatype();
+
+	int datatype_size = 0;
+	MPI_Type_size(datatype, &datatype_size);
+	int combiner = -1, tmp1 = -1, tmp2 = -1, tmp3 = -1;
+	MPI_Type_get_envelope(datatype, &tmp1, &tmp2, &tmp3, &combiner);
+	if (combiner != MPI_COMBINER_NAMED) {
+		MPI_Type_free(&datatype);
+	}
+
+	if (count <= 0 or datatype_size <= 0) {
+		return 0;
+	}
+	return std::uint64_t(count) * std::uint64_t(datatype_size);
+}
+
+
+//! Returns true on all processes of comm if given value is true on all.
+inline bool all_true(MPI_Comm comm, const bool value)
+{
+	int local = value ? 1 : 0, global = 0;
+	MPI_Allreduce(&local, &global, 1, MPI_INT, MPI_MIN, comm);
+	return global == 1;
+}
+
+} // namespace detail
+
+
+/*!
+Writes data of given cells to given offsets of file with one
+collective MPI_File_write_all.
+
+Collective over the processes that opened file, each gives its
+own cells, which can be none. Data of variables currently
+transferred by cells[i] is written packed in the order of
+variables starting at file_offsets[i], which must not overlap.
+The data of all local cells is described by one file view so
+MPI-IO can aggregate writes of all processes into large
+contiguous accesses. The file view is reset to the default.
+
+cells is a range of cells or of pointers to cells with at
+least file_offsets.size() items. Returns true on success.
+*/
+template<class Cell_Range> bool write_cells_all(
+	MPI_File file,
+	const std::vector<std::uint64_t>& file_offsets,
+	const Cell_Range& cells
+) {
+	using Cell_T = typename std::remove_cv<
+		typename std::remove_reference<
+			decltype(detail::dereference_cell(*std::begin(cells)))
+		>::type
+	>::type;
+
+	std::vector<const Cell_T*> cell_pointers;
+	cell_pointers.reserve(file_offsets.size());
+	for (const auto& cell: cells) {
+		if (cell_pointers.size() == file_offsets.size()) {
+			break;
+		}
+		cell_pointers.push_back(&detail::dereference_cell(cell));
+	}
+
+	return detail::transfer_cells_all(file, file_offsets, cell_pointers, true);
+}
+
+
+/*!
+Reads data of given cells from given offsets of file with one
+collective MPI_File_read_all.
+
+Collective version of read_cells(), each process of the file's
+communicator reads its own cells, which can be none, and the
+data of all local cells is described by one file view so
+MPI-IO can aggregate reads of all processes. cells is resized
+to file_offsets.size() if it is smaller. Variable length data
+such as std::vector must have been resized to the saved length
+before calling this function. The file view is reset to the
+default. Returns true on success.
+*/
+template<class Cell_T> bool read_cells_all(
+	MPI_File file,
+	const std::vector<std::uint64_t>& file_offsets,
+	std::vector<Cell_T>& cells
+) {
+	if (cells.size() < file_offsets.size()) {
+		cells.resize(file_offsets.size());
+	}
+
+	std::vector<Cell_T*> cell_pointers;
+	cell_pointers.reserve(file_offsets.size());
+	for (std::size_t i = 0; i < file_offsets.size(); i++) {
+		cell_pointers.push_back(&cells[i]);
+	}
+
+	return detail::transfer_cells_all(file, file_offsets, cell_pointers, false);
+}
+
+
+/*!
+Reads this process' share of the cell list of a file
+saved by save_cells() or save_async().
+
+Collective over the processes that opened file. Cells are
+divided evenly in the order of the list so that together
+all processes read every cell of the file exactly once, and
+ids and offsets of data of this process' cells are returned
+in cell_ids and file_offsets. Returns true on success.
+*/
+inline bool read_cell_list(
+	MPI_File file,
+	std::vector<std::uint64_t>& cell_ids,
+	std::vector<std::uint64_t>& file_offsets
+) {
+	cell_ids.clear();
+	file_offsets.clear();
+
+	MPI_Group group;
+	MPI_File_get_group(file, &group);
+	int rank = 0, comm_size = 0;
+	MPI_Group_rank(group, &rank);
+	MPI_Group_size(group, &comm_size);
+	MPI_Group_free(&group);
+
+	bool success = true;
+	std::uint64_t total_cells = 0;
+	if (
+		MPI_File_read_at_all(
+			file,
+			0,
+			&total_cells,
+			1,
+			MPI_UINT64_T,
+			MPI_STATUS_IGNORE
+		) != MPI_SUCCESS
+	) {
+		success = false;
+		total_cells = 0;
+	}
+
+	const std::uint64_t
+		first = total_cells * std::uint64_t(rank) / std::uint64_t(comm_size),
+		end = total_cells * std::uint64_t(rank + 1) / std::uint64_t(comm_size);
+	if (2 * (end - first) > std::uint64_t(std::numeric_limits<int>::max())) {
+		success = false;
+	}
+
+	std::vector<std::uint64_t> table(success ? 2 * (end - first) : 0);
+	if (
+		MPI_File_read_at_all(
+			file,
+			MPI_Offset(sizeof(std::uint64_t) + first * 2 * sizeof(std::uint64_t)),
+			table.data(),
+			int(table.size()),
+			MPI_UINT64_T,
+			MPI_STATUS_IGNORE
+		) != MPI_SUCCESS
+	) {
+		success = false;
+	}
+
+	cell_ids.reserve(table.size() / 2);
+	file_offsets.reserve(table.size() / 2);
+	for (std::size_t i = 0; i < table.size(); i += 2) {
+		cell_ids.push_back(table[i]);
+		file_offsets.push_back(table[i + 1]);
+	}
+
+	return success;
+}
+
+
+/*!
+Saves data of given cells into a file with collective writes.
+
+Blocking counterpart of save_async() which writes the same file
+layout, see save_async() for the arguments. Data isn't copied
+into a staging buffer but written directly from cells with one
+file view and MPI_File_write_all per process.
+
+Returns true on all processes if the save succeeded on all.
+*/
+template<class Cell_Range> bool save_cells(
+	MPI_Comm comm,
+	const std::string& file_name,
+	const std::vector<std::uint64_t>& cell_ids,
+	const Cell_Range& cells
+) {
+	using Cell_T = typename std::remove_cv<
+		typename std::remove_reference<
+			decltype(detail::dereference_cell(*std::begin(cells)))
+		>::type
+	>::type;
+
+	bool success = true;
+
+	std::vector<const Cell_T*> cell_pointers;
+	cell_pointers.reserve(cell_ids.size());
+	for (const auto& cell: cells) {
+		if (cell_pointers.size() == cell_ids.size()) {
+			break;
+		}
+		cell_pointers.push_back(&detail::dereference_cell(cell));
+	}
+	if (cell_pointers.size() != cell_ids.size()) {
+		success = false;
+		cell_pointers.clear();
+	}
+
+	std::vector<std::uint64_t> offsets;
+	offsets.reserve(cell_pointers.size());
+	std::uint64_t data_size = 0;
+	for (const auto* cell: cell_pointers) {
+		offsets.push_back(data_size);
+		data_size += detail::get_transfer_size(*cell);
+	}
+
+	// position of this process' cells and data in the file
+	std::uint64_t
+		local[2] = {cell_pointers.size(), data_size},
+		before[2] = {0, 0},
+		total_cells = 0;
+	MPI_Exscan(local, before, 2, MPI_UINT64_T, MPI_SUM, comm);
+	int rank = 0;
+	MPI_Comm_rank(comm, &rank);
+	if (rank == 0) {
+		before[0] = before[1] = 0;
+	}
+	MPI_Allreduce(&local[0], &total_cells, 1, MPI_UINT64_T, MPI_SUM, comm);
+
+	const std::uint64_t
+		table_start = sizeof(std::uint64_t) + before[0] * 2 * sizeof(std::uint64_t),
+		data_start = sizeof(std::uint64_t) + total_cells * 2 * sizeof(std::uint64_t);
+
+	std::vector<std::uint64_t> table;
+	table.reserve(2 * cell_pointers.size());
+	for (std::size_t i = 0; i < cell_pointers.size(); i++) {
+		offsets[i] += data_start + before[1];
+		table.push_back(cell_ids[i]);
+		table.push_back(offsets[i]);
+	}
+	if (table.size() > std::size_t(std::numeric_limits<int>::max())) {
+		success = false;
+		table.clear();
+	}
+
+	MPI_File file;
+	if (
+		MPI_File_open(
+			comm,
+			const_cast<char*>(file_name.c_str()),
+			MPI_MODE_CREATE | MPI_MODE_WRONLY,
+			MPI_INFO_NULL,
+			&file
+		) != MPI_SUCCESS
+	) {
+		return false;
+	}
+	MPI_File_set_size(file, 0);
+
+	if (
+		MPI_File_write_at_all(
+			file,
+			0,
+			&total_cells,
+			rank == 0 ? 1 : 0,
+			MPI_UINT64_T,
+			MPI_STATUS_IGNORE
+		) != MPI_SUCCESS
+		or MPI_File_write_at_all(
+			file,
+			MPI_Offset(table_start),
+			table.data(),
+			int(table.size()),
+			MPI_UINT64_T,
+			MPI_STATUS_IGNORE
+		) != MPI_SUCCESS
+	) {
+		success = false;
+	}
+
+	if (not success) {
+		offsets.clear();
+		cell_pointers.clear();
+	}
+	success = detail::transfer_cells_all(file, offsets, cell_pointers, true) and success;
+
+	if (MPI_File_close(&file) != MPI_SUCCESS) {
+		success = false;
+	}
+
+	return detail::all_true(comm, success);
+}
+
+
+/*!
+Loads cells saved by save_cells() or save_async() with
+collective reads, dividing cells of the file evenly between
+processes of given communicator.
+
+Each process receives ids of its share of cells in cell_ids
+and their data in cells, which are resized to the number of
+cells. Only data whose size doesn't depend on the cell can be
+loaded this way, e.g. with std::vectors call read_cell_list(),
+read their lengths with read_cells_all() and then the data.
+
+Returns true on all processes if loading succeeded on all.
+
+Example restarting from a save of all processes:
+@code
+Cell_T::set_transfer_all(true, Density(), Velocity());
+std::vector<uint64_t> cell_ids;
+std::vector<Cell_T> cells;
+if (not gensimcell::load_cells(comm, "restart.dc", cell_ids, cells)) {
+	...
+}
+@endcode
+*/
+template<class Cell_T> bool load_cells(
+	MPI_Comm comm,
+	const std::string& file_name,
+	std::vector<std::uint64_t>& cell_ids,
+	std::vector<Cell_T>& cells
+) {
+	MPI_File file;
+	if (
+		MPI_File_open(
+			comm,
+			const_cast<char*>(file_name.c_str()),
+			MPI_MODE_RDONLY,
+			MPI_INFO_NULL,
+			&file
+		) != MPI_SUCCESS
+	) {
+		return false;
+	}
+
+	std::vector<std::uint64_t> file_offsets;
+	bool success = read_cell_list(file, cell_ids, file_offsets);
+	cells.resize(file_offsets.size());
+	success = read_cells_all(file, file_offsets, cells) and success;
+
+	if (MPI_File_close(&file) != MPI_SUCCESS) {
+		success = false;
+	}
+
+	return detail::all_true(comm, success);
+}
+
+
+} // namespace gensimcell
+
+#endif // ifdef MPI_VERSION
+
+#endif // ifndef GENSIMCELL_COLLECTIVE_IO_HPP
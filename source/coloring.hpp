@@ -0,0 +1,293 @@
+/*
+Coloring of cells for running kernels that write to neighbors in parallel.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_COLORING_HPP
+#define GENSIMCELL_COLORING_HPP
+
+
+#include "array"
+#include "cstddef"
+#include "unordered_map"
+#include "vector"
+
+#include "parallel_for.hpp"
+
+
+namespace gensimcell {
+
+
+/*!
+Groups given cells by color so that cells of the same color
+don't have common neighbors and aren't neighbors of each other.
+
+A kernel that writes to the cell it's called for and to that
+cell's neighbors can then be called concurrently for all cells
+of one color without atomic operations, see parallel_for_colors().
+For example a flux through a face can be added to both cells
+sharing the face instead of being computed once for each cell.
+
+get_neighbors(cell_id) must return a range of the ids of cells
+that the kernel writes to in addition to the given cell. The
+neighbors don't have to be in cell_ids, e.g. writes to copies of
+remote cells are also taken into account, and don't have to be
+symmetric. Cells are colored greedily in given order, each color
+of the result lists its cells in that order.
+
+Example with neighbor lists of dccrg:
+@code
+const auto colors = gensimcell::color_cells(cells,
+	[&grid](const uint64_t cell_id) {
+		std::vector<uint64_t> neighbors;
+		for (const auto neighbor_id: *grid.get_neighbors_of(cell_id)) {
+			if (neighbor_id != dccrg::error_cell) {
+				neighbors.push_back(neighbor_id);
+			}
+		}
+		return neighbors;
+	}
+);
+@endcode
+*/
+template<
+	class Cell_Id_T,
+	class Get_Neighbors
+> std::vector<std::vector<Cell_Id_T>> color_cells(
+	const std::vector<Cell_Id_T>& cell_ids,
+	Get_Neighbors get_neighbors
+) {
+	std::vector<std::vector<Cell_Id_T>> colors;
+
+	// colors of cells that write to each cell
+	std::unordered_map<Cell_Id_T, std::vector<std::size_t>> writers;
+	std::vector<bool> forbidden;
+	std::vector<Cell_Id_T> written;
+	for (const auto& cell_id: cell_ids) {
+		written.clear();
+		written.push_back(cell_id);
+		for (const auto& neighbor_id: get_neighbors(cell_id)) {
+			written.push_back(neighbor_id);
+		}
+
+		forbidden.assign(colors.size() + 1, false);
+		for (const auto& id: written) {
+			const auto item = writers.find(id);
+			if (item == writers.end()) {
+				continue;
+			}
+			for (const auto color: item->second) {
+				forbidden[color] = true;
+			}
+		}
+
+		std::size_t color = 0;
+		while (forbidden[color]) {
+			color++;
+		}
+		if (color == colors.size()) {
+			colors.emplace_back();
+		}
+		colors[color].push_back(cell_id);
+
+		for (const auto& id: written) {
+			writers[id].push_back(color);
+		}
+	}
+
+	return colors;
+}
+
+
+/*!
+Version of color_cells() for structured grids, e.g. nested
+std::arrays, in which kernels write to cells at most radius
+cells away from the given cell in each dimension.
+
+Cells are identified by their index in each dimension, i.e.
+[0, size[0]) in the first dimension, etc. and are colored in
+order of increasing index with the first index changing fastest.
+
+If periodic is true neighbors wrap around the grid. Grids that
+aren't periodic, and periodic grids whose size in each dimension
+is a multiple of 2 * radius + 1, use (2 * radius + 1)^Dimensions
+colors at most, other periodic grids are colored greedily.
+
+Example for the serial advection example in which
+a cell's flux is added to its face neighbors:
+@code
+const auto colors = gensimcell::color_grid<2>({{width, height}}, 1, true);
+gensimcell::parallel_for_colors(colors, grid,
+	[dt](const std::array<size_t, 2>& index, Grid_T& grid) {
+		auto& cell = grid[index[1]][index[0]];
+		...
+	}
+);
+@endcode
+*/
+template<
+	std::size_t Dimensions
+> std::vector<std::vector<std::array<std::size_t, Dimensions>>> color_grid(
+	const std::array<std::size_t, Dimensions>& size,
+	const std::size_t radius = 1,
+	const bool periodic = false
+) {
+	using Index_T = std::array<std::size_t, Dimensions>;
+
+	const std::size_t period = 2 * radius + 1;
+
+	std::size_t nr_cells = 1;
+	bool modular = true;
+	for (std::size_t dim = 0; dim < Dimensions; dim++) {
+		nr_cells *= size[dim];
+		if (periodic and size[dim] % period != 0) {
+			modular = false;
+		}
+	}
+
+	// converts between index and position in iteration order
+	const auto get_index = [&size](std::size_t position) {
+		Index_T index;
+		for (std::size_t dim = 0; dim < Dimensions; dim++) {
+			index[dim] = position % size[dim];
+			position /= size[dim];
+		}
+		return index;
+	};
+	const auto get_position = [&size](const Index_T& index) {
+		std::size_t position = 0;
+		for (std::size_t dim = Dimensions; dim > 0; dim--) {
+			position = position * size[dim - 1] + index[dim - 1];
+		}
+		return position;
+	};
+
+	std::vector<std::vector<Index_T>> colors;
+	if (nr_cells == 0) {
+		return colors;
+	}
+
+	if (modular) {
+		std::size_t nr_colors = 1;
+		for (std::size_t dim = 0; dim < Dimensions; dim++) {
+			nr_colors *= period;
+		}
+		colors.resize(nr_colors);
+
+		for (std::size_t position = 0; position < nr_cells; position++) {
+			const auto index = get_index(position);
+			std::size_t color = 0;
+			for (std::size_t dim = Dimensions; dim > 0; dim--) {
+				color = color * period + index[dim - 1] % period;
+			}
+			colors[color].push_back(index);
+		}
+
+		std::vector<std::vector<Index_T>> nonempty;
+		for (auto& color: colors) {
+			if (color.size() > 0) {
+				nonempty.push_back(std::move(color));
+			}
+		}
+		return nonempty;
+	}
+
+	std::vector<std::size_t> positions(nr_cells);
+	for (std::size_t position = 0; position < nr_cells; position++) {
+		positions[position] = position;
+	}
+
+	std::size_t nr_offsets = 1;
+	for (std::size_t dim = 0; dim < Dimensions; dim++) {
+		nr_offsets *= period;
+	}
+
+	const auto position_colors = color_cells(
+		positions,
+		[&](const std::size_t position) {
+			const auto index = get_index(position);
+			std::vector<std::size_t> neighbors;
+			neighbors.reserve(nr_offsets);
+			for (std::size_t offset = 0; offset < nr_offsets; offset++) {
+				Index_T neighbor;
+				std::size_t remaining = offset;
+				for (std::size_t dim = 0; dim < Dimensions; dim++) {
+					const std::size_t step = remaining % period;
+					remaining /= period;
+					// index + step - radius wrapped to [0, size)
+					neighbor[dim]
+						= (index[dim] + step + size[dim] * period - radius)
+						% size[dim];
+				}
+				neighbors.push_back(get_position(neighbor));
+			}
+			return neighbors;
+		}
+	);
+
+	colors.resize(position_colors.size());
+	for (std::size_t i = 0; i < position_colors.size(); i++) {
+		for (const auto position: position_colors[i]) {
+			colors[i].push_back(get_index(position));
+		}
+	}
+	return colors;
+}
+
+
+/*!
+Calls kernel(cell_id, grid) for cells of each color in parallel.
+
+Colors are processed one after another and cells of one color
+concurrently with parallel_for_cells(), so kernel can write to
+neighbors given to color_cells() or color_grid() when colors
+were created.
+*/
+template<
+	class Cell_Id_T,
+	class Grid_T,
+	class Kernel
+> void parallel_for_colors(
+	const std::vector<std::vector<Cell_Id_T>>& colors,
+	Grid_T& grid,
+	Kernel kernel,
+	const std::size_t chunk_size = 0,
+	Thread_Pool& pool = get_default_thread_pool()
+) {
+	for (const auto& cell_ids: colors) {
+		parallel_for_cells(cell_ids, grid, kernel, chunk_size, pool);
+	}
+}
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_COLORING_HPP
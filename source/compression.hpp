@@ -0,0 +1,500 @@
+/*
+Lossless compression of data of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_COMPRESSION_HPP
+#define GENSIMCELL_COMPRESSION_HPP
+
+
+#include "algorithm"
+#include "cstddef"
+#include "cstdint"
+#include "cstring"
+#include "string"
+#include "thread"
+#include "vector"
+
+#include "schema.hpp"
+
+
+namespace gensimcell {
+
+
+namespace detail {
+
+/*!
+Groups byte i of each element of given size together,
+e.g. exponents of doubles become adjacent which makes
+floating point data more compressible. Trailing bytes
+that don't form a whole element are copied as is.
+*/
+inline void shuffle_bytes(
+	const char* const input,
+	const std::size_t size,
+	const std::size_t element_size,
+	char* const output
+) {
+	const std::size_t nr_elements = size / element_size;
+	for (std::size_t byte = 0; byte < element_size; byte++) {
+		char* const target = output + byte * nr_elements;
+		for (std::size_t element = 0; element < nr_elements; element++) {
+			target[element] = input[element * element_size + byte];
+		}
+	}
+	const std::size_t shuffled = nr_elements * element_size;
+	std::memcpy(output + shuffled, input + shuffled, size - shuffled);
+}
+
+//! Reverses shuffle_bytes().
+inline void unshuffle_bytes(
+	const char* const input,
+	const std::size_t size,
+	const std::size_t element_size,
+	char* const output
+) {
+	const std::size_t nr_elements = size / element_size;
+	for (std::size_t byte = 0; byte < element_size; byte++) {
+		const char* const source = input + byte * nr_elements;
+		for (std::size_t element = 0; element < nr_elements; element++) {
+			output[element * element_size + byte] = source[element];
+		}
+	}
+	const std::size_t shuffled = nr_elements * element_size;
+	std::memcpy(output + shuffled, input + shuffled, size - shuffled);
+}
+
+
+//! Minimum length of repeated data stored as a match by lz_compress().
+constexpr std::size_t lz_min_match = 4;
+
+//! Appends given length as a sequence of bytes ending with a byte < 255.
+inline void append_lz_length(std::string& output, std::size_t length)
+{
+	while (length >= 255) {
+		output += char(255);
+		length -= 255;
+	}
+	output += char(length);
+}
+
+//! Appends literals and a match to output of lz_compress().
+inline void append_lz_sequence(
+	std::string& output,
+	const char* const literals,
+	const std::size_t nr_literals,
+	const std::size_t offset,
+	const std::size_t match_length
+) {
+	const std::size_t extra_match
+		= match_length >= lz_min_match ? match_length - lz_min_match : 0;
+	output += char(
+		(std::min<std::size_t>(nr_literals, 15) << 4)
+		| std::min<std::size_t>(extra_match, 15)
+	);
+	if (nr_literals >= 15) {
+		append_lz_length(output, nr_literals - 15);
+	}
+	output.append(literals, nr_literals);
+
+	if (match_length == 0) {
+		return;
+	}
+	output += char(offset & 0xFF);
+	output += char((offset >> 8) & 0xFF);
+	if (extra_match >= 15) {
+		append_lz_length(output, extra_match - 15);
+	}
+}
+
+
+/*!
+Compresses given bytes with a LZ77 algorithm similar to LZ4.
+
+Output is a sequence of: token byte whose high 4 bits are the
+number of literals and low 4 bits the length of match - 4,
+15 meaning that more length bytes follow, literals, 2 byte
+little-endian offset of match and more match length bytes.
+The last sequence only has literals.
+*/
+inline std::string lz_compress(const char* const input, const std::size_t size)
+{
+	std::string output;
+	output.reserve(size / 2 + 16);
+
+	constexpr std::size_t hash_bits = 16;
+	std::vector<std::uint32_t> positions(std::size_t(1) << hash_bits, 0);
+
+	std::size_t position = 0, anchor = 0;
+	while (position + lz_min_match <= size) {
+		std::uint32_t sequence = 0;
+		std::memcpy(&sequence, input + position, sizeof(sequence));
+		const std::size_t hash
+			= (sequence * std::uint32_t(2654435761U)) >> (32 - hash_bits);
+
+		const std::size_t candidate = positions[hash];
+		positions[hash] = std::uint32_t(position + 1);
+
+		std::uint32_t candidate_sequence = 0;
+		if (candidate > 0) {
+			std::memcpy(&candidate_sequence, input + candidate - 1, sizeof(candidate_sequence));
+		}
+		if (
+			candidate == 0
+			or position - (candidate - 1) > 0xFFFF
+			or candidate_sequence != sequence
+			or position > 0xFFFFFFF0
+		) {
+			position++;
+			continue;
+		}
+
+		const std::size_t match_start = candidate - 1;
+		std::size_t length = lz_min_match;
+		while (
+			position + length < size
+			and input[match_start + length] == input[position + length]
+		) {
+			length++;
+		}
+
+		append_lz_sequence(
+			output,
+			input + anchor,
+			position - anchor,
+			position - match_start,
+			length
+		);
+		position += length;
+		anchor = position;
+	}
+
+	append_lz_sequence(output, input + anchor, size - anchor, 0, 0);
+	return output;
+}
+
+
+//! Reads length bytes written by append_lz_length(), returns success.
+inline bool read_lz_length(
+	const char* const input,
+	const std::size_t size,
+	std::size_t& position,
+	std::size_t& length
+) {
+	unsigned char byte = 255;
+	while (byte == 255) {
+		if (position >= size) {
+			return false;
+		}
+		byte = static_cast<unsigned char>(input[position++]);
+		length += byte;
+	}
+	return true;
+}
+
+/*!
+Decompresses given output of lz_compress() into
+output of given size, returns false if input is
+invalid or doesn't decompress to given size.
+*/
+inline bool lz_decompress(
+	const char* const input,
+	const std::size_t size,
+	char* const output,
+	const std::size_t output_size
+) {
+	std::size_t position = 0, output_position = 0;
+	while (position < size) {
+		const auto token = static_cast<unsigned char>(input[position++]);
+
+		std::size_t nr_literals = token >> 4;
+		if (nr_literals == 15 and not read_lz_length(input, size, position, nr_literals)) {
+			return false;
+		}
+		if (
+			size - position < nr_literals
+			or output_size - output_position < nr_literals
+		) {
+			return false;
+		}
+		std::memcpy(output + output_position, input + position, nr_literals);
+		position += nr_literals;
+		output_position += nr_literals;
+
+		// last sequence
+		if (position == size) {
+			break;
+		}
+
+		if (size - position < 2) {
+			return false;
+		}
+		const std::size_t offset
+			= std::size_t(static_cast<unsigned char>(input[position]))
+			| (std::size_t(static_cast<unsigned char>(input[position + 1])) << 8);
+		position += 2;
+
+		std::size_t length = token & 15;
+		if (length == 15 and not read_lz_length(input, size, position, length)) {
+			return false;
+		}
+		length += lz_min_match;
+
+		if (
+			offset == 0
+			or offset > output_position
+			or output_size - output_position < length
+		) {
+			return false;
+		}
+		// matches can overlap the data being written
+		const char* source = output + output_position - offset;
+		for (std::size_t i = 0; i < length; i++) {
+			output[output_position + i] = source[i];
+		}
+		output_position += length;
+	}
+
+	return output_position == output_size;
+}
+
+
+//! Ways of storing chunks in compress_bytes().
+enum class Chunk_Mode : unsigned char {
+	raw,
+	shuffled_lz
+};
+
+//! Compressed data of one chunk in compress_bytes().
+struct Compressed_Chunk
+{
+	std::size_t raw_size;
+	Chunk_Mode mode;
+	std::string data;
+};
+
+
+/*!
+Runs function(i) for i in [0, n) using
+given number of threads, 0 meaning all.
+*/
+template<class Function> void parallel_for_chunks(
+	const std::size_t n,
+	unsigned int nr_threads,
+	Function function
+) {
+	if (nr_threads == 0) {
+		nr_threads = std::max(1U, std::thread::hardware_concurrency());
+	}
+	nr_threads = unsigned(std::min<std::size_t>(nr_threads, n));
+	if (nr_threads <= 1) {
+		for (std::size_t i = 0; i < n; i++) {
+			function(i);
+		}
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	for (unsigned int thread = 0; thread < nr_threads; thread++) {
+		threads.emplace_back([&function, n, nr_threads, thread]() {
+			for (std::size_t i = thread; i < n; i += nr_threads) {
+				function(i);
+			}
+		});
+	}
+	for (auto& thread: threads) {
+		thread.join();
+	}
+}
+
+} // namespace detail
+
+
+/*!
+Compresses given bytes losslessly without external libraries.
+
+Data is split into chunks of about 1 MiB which are compressed
+independently using given number of threads, 0 meaning one per
+hardware thread. Each chunk is byte shuffled with given element
+size, e.g. sizeof(double) for data of doubles, and compressed
+with a LZ77 algorithm. Chunks that don't compress are stored raw.
+
+Format of returned bytes, integers are little-endian:
+- size of uncompressed data (uint64), element size (uint64),
+  number of chunks (uint64)
+- for each chunk: uncompressed size (uint64), compressed
+  size (uint64), mode (uint8, 0 = raw, 1 = shuffled and LZ)
+- data of chunks
+*/
+inline std::string compress_bytes(
+	const char* const data,
+	const std::size_t size,
+	std::size_t element_size,
+	const unsigned int nr_threads = 0
+) {
+	element_size = std::max(element_size, std::size_t(1));
+	const std::size_t chunk_size
+		= std::max(std::size_t(1) << 20, element_size)
+		/ element_size
+		* element_size;
+	const std::size_t nr_chunks = (size + chunk_size - 1) / chunk_size;
+
+	std::vector<detail::Compressed_Chunk> chunks(nr_chunks);
+	detail::parallel_for_chunks(nr_chunks, nr_threads, [&](const std::size_t i) {
+		const std::size_t
+			begin = i * chunk_size,
+			raw_size = std::min(chunk_size, size - begin);
+
+		std::vector<char> shuffled(raw_size);
+		detail::shuffle_bytes(data + begin, raw_size, element_size, shuffled.data());
+
+		auto& chunk = chunks[i];
+		chunk.raw_size = raw_size;
+		chunk.data = detail::lz_compress(shuffled.data(), raw_size);
+		chunk.mode = detail::Chunk_Mode::shuffled_lz;
+		if (chunk.data.size() >= raw_size) {
+			chunk.data.assign(data + begin, raw_size);
+			chunk.mode = detail::Chunk_Mode::raw;
+		}
+	});
+
+	std::string output;
+	detail::append_little_endian(output, size, 8);
+	detail::append_little_endian(output, element_size, 8);
+	detail::append_little_endian(output, nr_chunks, 8);
+	for (const auto& chunk: chunks) {
+		detail::append_little_endian(output, chunk.raw_size, 8);
+		detail::append_little_endian(output, chunk.data.size(), 8);
+		detail::append_little_endian(output, static_cast<std::uint64_t>(chunk.mode), 1);
+	}
+	for (const auto& chunk: chunks) {
+		output += chunk.data;
+	}
+	return output;
+}
+
+
+/*!
+Decompresses data returned by compress_bytes() into output
+using given number of threads, 0 meaning all.
+
+Returns false if given data isn't valid.
+*/
+inline bool decompress_bytes(
+	const char* const data,
+	const std::size_t size,
+	std::vector<char>& output,
+	const unsigned int nr_threads = 0
+) {
+	std::size_t position = 0;
+	std::uint64_t raw_size = 0, element_size = 0, nr_chunks = 0;
+	if (
+		not detail::extract_little_endian(data, size, position, raw_size, 8)
+		or not detail::extract_little_endian(data, size, position, element_size, 8)
+		or element_size == 0
+		or not detail::extract_little_endian(data, size, position, nr_chunks, 8)
+		or nr_chunks > (size - position) / 17
+	) {
+		return false;
+	}
+
+	// offsets of chunks in data and output
+	std::vector<std::uint64_t> chunk_raw_sizes, chunk_sizes, modes;
+	std::vector<std::uint64_t> input_offsets, output_offsets;
+	std::uint64_t total_raw = 0;
+	for (std::uint64_t i = 0; i < nr_chunks; i++) {
+		std::uint64_t chunk_raw = 0, chunk_size = 0, mode = 0;
+		if (
+			not detail::extract_little_endian(data, size, position, chunk_raw, 8)
+			or not detail::extract_little_endian(data, size, position, chunk_size, 8)
+			or not detail::extract_little_endian(data, size, position, mode, 1)
+			or mode > static_cast<std::uint64_t>(detail::Chunk_Mode::shuffled_lz)
+			or (mode == 0 and chunk_size != chunk_raw)
+		) {
+			return false;
+		}
+		chunk_raw_sizes.push_back(chunk_raw);
+		chunk_sizes.push_back(chunk_size);
+		modes.push_back(mode);
+		output_offsets.push_back(total_raw);
+		total_raw += chunk_raw;
+	}
+	if (total_raw != raw_size) {
+		return false;
+	}
+	for (std::uint64_t i = 0; i < nr_chunks; i++) {
+		if (chunk_sizes[i] > size - position) {
+			return false;
+		}
+		input_offsets.push_back(position);
+		position += chunk_sizes[i];
+	}
+	if (position != size) {
+		return false;
+	}
+
+	output.resize(std::size_t(raw_size));
+	std::vector<char> success(std::size_t(nr_chunks), 1);
+	detail::parallel_for_chunks(std::size_t(nr_chunks), nr_threads, [&](const std::size_t i) {
+		const char* const input = data + input_offsets[i];
+		char* const target = output.data() + output_offsets[i];
+		if (modes[i] == static_cast<std::uint64_t>(detail::Chunk_Mode::raw)) {
+			std::memcpy(target, input, std::size_t(chunk_sizes[i]));
+			return;
+		}
+
+		std::vector<char> shuffled(std::size_t(chunk_raw_sizes[i]));
+		if (
+			not detail::lz_decompress(
+				input,
+				std::size_t(chunk_sizes[i]),
+				shuffled.data(),
+				shuffled.size()
+			)
+		) {
+			success[i] = 0;
+			return;
+		}
+		detail::unshuffle_bytes(
+			shuffled.data(),
+			shuffled.size(),
+			std::size_t(element_size),
+			target
+		);
+	});
+
+	return std::find(success.begin(), success.end(), 0) == success.end();
+}
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_COMPRESSION_HPP
@@ -0,0 +1,734 @@
+/*
+Incremental checkpoint files of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_DELTA_CHECKPOINT_HPP
+#define GENSIMCELL_DELTA_CHECKPOINT_HPP
+
+
+#include "algorithm"
+#include "cstddef"
+#include "cstdint"
+#include "cstring"
+#include "fstream"
+#include "iterator"
+#include "limits"
+#include "map"
+#include "string"
+#include "type_traits"
+#include "typeinfo"
+#include "vector"
+
+#include "boost/core/demangle.hpp"
+
+#include "checkpoint.hpp"
+#include "schema.hpp"
+#include "type_support.hpp"
+#include "variable_table.hpp"
+
+
+namespace gensimcell {
+
+
+namespace detail {
+
+//! Returns the 64 bit FNV-1a hash of given bytes.
+inline std::uint64_t hash_bytes(const char* const bytes, const std::size_t size)
+{
+	std::uint64_t hash = 14695981039346656037ULL;
+	for (std::size_t i = 0; i < size; i++) {
+		hash ^= static_cast<unsigned char>(bytes[i]);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+
+/*!
+Converts data of one variable in a block of consecutive
+cells to and from bytes stored in delta checkpoints.
+
+Bytes of fixed size data are the data of each cell and
+of std::vector data the number of items in each cell as
+uint64_t followed by items of all cells.
+*/
+template<class Variable> struct Delta_Block
+{
+	using Data_T = typename Variable::data_type;
+	using Is_Vector = std::integral_constant<bool, Vector_Items<Data_T>::value>;
+	using Item_T = typename std::conditional<
+		Is_Vector::value,
+		typename Vector_Items<Data_T>::type,
+		Data_T
+	>::type;
+
+	static_assert(
+		std::is_trivially_copyable<Item_T>::value,
+		"Only variables of trivially copyable type or std::vector "
+		"of trivially copyable items can be saved into checkpoints"
+	);
+
+
+	template<class Cell_T> static void get_bytes(
+		const std::vector<const Cell_T*>& cells,
+		const std::size_t begin,
+		const std::size_t end,
+		std::vector<char>& bytes,
+		const std::false_type
+	) {
+		bytes.resize((end - begin) * sizeof(Data_T));
+		for (std::size_t i = begin; i < end; i++) {
+			std::memcpy(
+				bytes.data() + (i - begin) * sizeof(Data_T),
+				&(*cells[i])[Variable()],
+				sizeof(Data_T)
+			);
+		}
+	}
+
+	template<class Cell_T> static void get_bytes(
+		const std::vector<const Cell_T*>& cells,
+		const std::size_t begin,
+		const std::size_t end,
+		std::vector<char>& bytes,
+		const std::true_type
+	) {
+		std::size_t nr_items = 0;
+		for (std::size_t i = begin; i < end; i++) {
+			nr_items += (*cells[i])[Variable()].size();
+		}
+
+		bytes.resize((end - begin) * sizeof(std::uint64_t) + nr_items * sizeof(Item_T));
+		char* position = bytes.data();
+		for (std::size_t i = begin; i < end; i++) {
+			const std::uint64_t nr = (*cells[i])[Variable()].size();
+			std::memcpy(position, &nr, sizeof(nr));
+			position += sizeof(nr);
+		}
+		for (std::size_t i = begin; i < end; i++) {
+			const auto& data = (*cells[i])[Variable()];
+			if (data.size() > 0) {
+				std::memcpy(position, data.data(), data.size() * sizeof(Item_T));
+				position += data.size() * sizeof(Item_T);
+			}
+		}
+	}
+
+	//! Stores data of given cells into bytes.
+	template<class Cell_T> static void get_bytes(
+		const std::vector<const Cell_T*>& cells,
+		const std::size_t begin,
+		const std::size_t end,
+		std::vector<char>& bytes
+	) {
+		get_bytes(cells, begin, end, bytes, Is_Vector());
+	}
+
+
+	template<class Cell_T> static bool set_bytes(
+		std::vector<Cell_T>& cells,
+		const std::size_t begin,
+		const std::size_t end,
+		const std::vector<char>& bytes,
+		const std::false_type
+	) {
+		if (bytes.size() != (end - begin) * sizeof(Data_T)) {
+			return false;
+		}
+		for (std::size_t i = begin; i < end; i++) {
+			std::memcpy(
+				&cells[i][Variable()],
+				bytes.data() + (i - begin) * sizeof(Data_T),
+				sizeof(Data_T)
+			);
+		}
+		return true;
+	}
+
+	template<class Cell_T> static bool set_bytes(
+		std::vector<Cell_T>& cells,
+		const std::size_t begin,
+		const std::size_t end,
+		const std::vector<char>& bytes,
+		const std::true_type
+	) {
+		const std::size_t counts_size = (end - begin) * sizeof(std::uint64_t);
+		if (bytes.size() < counts_size) {
+			return false;
+		}
+
+		// counts are from a file so check them before allocating
+		std::uint64_t items_size = bytes.size() - counts_size;
+		for (std::size_t i = begin; i < end; i++) {
+			std::uint64_t nr = 0;
+			std::memcpy(&nr, bytes.data() + (i - begin) * sizeof(nr), sizeof(nr));
+			if (nr > items_size / sizeof(Item_T)) {
+				return false;
+			}
+			items_size -= nr * sizeof(Item_T);
+		}
+		if (items_size != 0) {
+			return false;
+		}
+
+		const char* items = bytes.data() + counts_size;
+		for (std::size_t i = begin; i < end; i++) {
+			std::uint64_t nr = 0;
+			std::memcpy(&nr, bytes.data() + (i - begin) * sizeof(nr), sizeof(nr));
+			auto& data = cells[i][Variable()];
+			data.resize(std::size_t(nr));
+			if (nr > 0) {
+				std::memcpy(data.data(), items, std::size_t(nr) * sizeof(Item_T));
+				items += nr * sizeof(Item_T);
+			}
+		}
+		return true;
+	}
+
+	/*!
+	Sets data of given cells from bytes returned by
+	get_bytes(), returns false if bytes are invalid.
+	*/
+	template<class Cell_T> static bool set_bytes(
+		std::vector<Cell_T>& cells,
+		const std::size_t begin,
+		const std::size_t end,
+		const std::vector<char>& bytes
+	) {
+		return set_bytes(cells, begin, end, bytes, Is_Vector());
+	}
+};
+
+
+//! Writes integer of given number of bytes in little-endian order.
+inline void write_little_endian(
+	std::ofstream& file,
+	const std::uint64_t value,
+	const std::size_t nr_bytes
+) {
+	std::string bytes;
+	append_little_endian(bytes, value, nr_bytes);
+	file.write(bytes.data(), std::streamsize(bytes.size()));
+}
+
+//! Reads integer of given number of bytes in little-endian order.
+inline bool read_little_endian(
+	std::ifstream& file,
+	std::uint64_t& value,
+	const std::size_t nr_bytes
+) {
+	char bytes[8];
+	if (nr_bytes > sizeof(bytes) or not file.read(bytes, std::streamsize(nr_bytes))) {
+		return false;
+	}
+	std::size_t position = 0;
+	return extract_little_endian(bytes, nr_bytes, position, value, nr_bytes);
+}
+
+} // namespace detail
+
+
+/*!
+Writes checkpoints that only contain data which has
+changed since the previous checkpoint of the same writer.
+
+Cells are divided into blocks of consecutive cells and a
+hash of each variable's data in each block is kept. The first
+checkpoint, and every checkpoint written with write_full(),
+contains all data. Following checkpoints written with
+write_delta() only contain blocks whose hash has changed.
+The state at the time of a delta checkpoint is reconstructed
+by read_delta_checkpoints() from the previous full checkpoint
+and all delta checkpoints written after it.
+
+Full checkpoints are columnar files written by write_checkpoint()
+and delta checkpoints use the following format, integers of
+the header are little-endian and data is in native byte order:
+- "GSCD", version (uint32) = 1, number of cells (uint64),
+  cells per block (uint64), number of variables (uint32)
+- for each variable: length of name (uint32), name,
+  number of changed blocks (uint64) and for each block
+  its index (uint64), size (uint64) and data, see
+  detail::Delta_Block for the format of data
+
+Example:
+@code
+gensimcell::Delta_Checkpoint_Writer writer;
+writer.write_full("base.gsc", cells, Density(), Velocity());
+...
+writer.write_delta("delta1.gscd", cells, Density(), Velocity());
+...
+writer.write_delta("delta2.gscd", cells, Density(), Velocity());
+...
+gensimcell::read_delta_checkpoints(
+	"base.gsc", {"delta1.gscd", "delta2.gscd"}, cells, Density(), Velocity()
+);
+@endcode
+*/
+class Delta_Checkpoint_Writer
+{
+public:
+
+	explicit Delta_Checkpoint_Writer(const std::size_t given_cells_per_block = 1024) :
+		cells_per_block(std::max(given_cells_per_block, std::size_t(1)))
+	{}
+
+
+	/*!
+	Writes given variables of all given cells into a columnar
+	checkpoint file, see write_checkpoint(), and records hashes
+	of data for following delta checkpoints.
+
+	Hashes are only recorded if the file was written
+	successfully, otherwise following delta checkpoints
+	are relative to the previous successful checkpoint.
+	*/
+	template<
+		class Cell_Range,
+		class... Variables
+	> typename std::enable_if<
+		is_gensimcell_range<Cell_Range>::value,
+		bool
+	>::type write_full(
+		const std::string& file_name,
+		const Cell_Range& cells,
+		const Variables&... variables
+	) {
+		Hashes new_hashes;
+		this->update_hashes(new_hashes, cells, variables...);
+		this->last_size = 0;
+		if (not write_checkpoint(file_name, cells, variables...)) {
+			return false;
+		}
+
+		this->hashes.swap(new_hashes);
+		std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+		this->last_size = std::uint64_t(file.tellg());
+		return true;
+	}
+
+
+	/*!
+	Writes blocks of given variables of given cells whose data
+	has changed since the previous checkpoint of this writer.
+
+	Writes a full checkpoint if there's no previous checkpoint.
+	Blocks whose number of cells has changed are always written.
+	If writing fails the next checkpoint still contains blocks
+	that changed since the previous successful checkpoint.
+	*/
+	template<
+		class Cell_Range,
+		class... Variables
+	> typename std::enable_if<
+		is_gensimcell_range<Cell_Range>::value,
+		bool
+	>::type write_delta(
+		const std::string& file_name,
+		const Cell_Range& cells,
+		const Variables&... variables
+	) {
+		if (this->hashes.size() == 0) {
+			return this->write_full(file_name, cells, variables...);
+		}
+
+		using Cell_T = typename Cell_Range::value_type;
+		std::vector<const Cell_T*> cell_pointers;
+		for (const auto& cell: cells) {
+			cell_pointers.push_back(&cell);
+		}
+
+		std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+		if (not file.is_open()) {
+			return false;
+		}
+		file.write("GSCD", 4);
+		detail::write_little_endian(file, 1, 4);
+		detail::write_little_endian(file, cell_pointers.size(), 8);
+		detail::write_little_endian(file, this->cells_per_block, 8);
+		detail::write_little_endian(file, sizeof...(Variables), 4);
+
+		// unchanged variables keep their hashes
+		Hashes new_hashes(this->hashes);
+		int dummy[] = {0, (
+			this->write_changed_blocks<Variables>(file, cell_pointers, new_hashes),
+			0
+		)...};
+		(void)dummy;
+
+		const auto size = std::uint64_t(file.tellp());
+		file.close();
+		if (not file) {
+			return false;
+		}
+
+		this->hashes.swap(new_hashes);
+		this->last_size = size;
+		return true;
+	}
+
+
+	//! Returns the size in bytes of the last written checkpoint.
+	std::uint64_t get_last_size() const
+	{
+		return this->last_size;
+	}
+
+
+private:
+
+	std::size_t cells_per_block;
+	std::uint64_t last_size = 0;
+
+	//! Hash of data of each block of each variable by variable's name
+	using Hashes = std::map<std::string, std::vector<std::uint64_t>>;
+
+	//! Hashes of data in the last successfully written checkpoint
+	Hashes hashes;
+
+
+	//! Records hashes of given variables of given cells in new_hashes.
+	template<class Cell_Range, class... Variables> void update_hashes(
+		Hashes& new_hashes,
+		const Cell_Range& cells,
+		const Variables&...
+	) const {
+		using Cell_T = typename Cell_Range::value_type;
+		std::vector<const Cell_T*> cell_pointers;
+		for (const auto& cell: cells) {
+			cell_pointers.push_back(&cell);
+		}
+
+		std::vector<char> bytes;
+		int dummy[] = {0, (
+			this->get_changed_blocks<Variables>(cell_pointers, bytes, new_hashes),
+			0
+		)...};
+		(void)dummy;
+	}
+
+
+	/*!
+	Records hashes of Variable's data in new_hashes and returns
+	indices of blocks whose hash differs from the last successfully
+	written checkpoint.
+	*/
+	template<class Variable, class Cell_T> std::vector<std::size_t> get_changed_blocks(
+		const std::vector<const Cell_T*>& cells,
+		std::vector<char>& bytes,
+		Hashes& new_hashes
+	) const {
+		const auto name = boost::core::demangle(typeid(Variable).name());
+		const auto old_item = this->hashes.find(name);
+		const std::vector<std::uint64_t> no_hashes;
+		const auto& old_hashes
+			= old_item == this->hashes.end() ? no_hashes : old_item->second;
+
+		const std::size_t nr_blocks
+			= (cells.size() + this->cells_per_block - 1) / this->cells_per_block;
+		auto& variable_hashes = new_hashes[name];
+		variable_hashes.resize(nr_blocks);
+
+		std::vector<std::size_t> changed;
+		for (std::size_t block = 0; block < nr_blocks; block++) {
+			const std::size_t
+				begin = block * this->cells_per_block,
+				end = std::min(cells.size(), begin + this->cells_per_block);
+			detail::Delta_Block<Variable>::get_bytes(cells, begin, end, bytes);
+
+			// include size in hash so resized blocks always differ
+			const auto hash
+				= detail::hash_bytes(bytes.data(), bytes.size())
+				^ (std::uint64_t(end - begin) << 48);
+			if (block >= old_hashes.size() or old_hashes[block] != hash) {
+				changed.push_back(block);
+			}
+			variable_hashes[block] = hash;
+		}
+
+		return changed;
+	}
+
+
+	template<class Variable, class Cell_T> void write_changed_blocks(
+		std::ofstream& file,
+		const std::vector<const Cell_T*>& cells,
+		Hashes& new_hashes
+	) const {
+		std::vector<char> bytes;
+		const auto changed = this->get_changed_blocks<Variable>(cells, bytes, new_hashes);
+
+		const auto name = boost::core::demangle(typeid(Variable).name());
+		detail::write_little_endian(file, name.size(), 4);
+		file.write(name.data(), std::streamsize(name.size()));
+		detail::write_little_endian(file, changed.size(), 8);
+
+		for (const auto block: changed) {
+			const std::size_t
+				begin = block * this->cells_per_block,
+				end = std::min(cells.size(), begin + this->cells_per_block);
+			detail::Delta_Block<Variable>::get_bytes(cells, begin, end, bytes);
+
+			detail::write_little_endian(file, block, 8);
+			detail::write_little_endian(file, bytes.size(), 8);
+			file.write(bytes.data(), std::streamsize(bytes.size()));
+		}
+	}
+};
+
+
+namespace detail {
+
+/*!
+Applies changed blocks of Variable from given delta
+checkpoint file positioned after variable's name.
+
+Blocks from first_required_block to the end of cells
+must be in the file, e.g. those whose number of cells
+changed, otherwise returns false.
+*/
+template<class Variable, class Cell_T> bool apply_delta_blocks(
+	std::ifstream& file,
+	std::vector<Cell_T>& cells,
+	const std::uint64_t cells_per_block,
+	const std::uint64_t first_required_block
+) {
+	std::uint64_t nr_blocks = 0;
+	if (not read_little_endian(file, nr_blocks, 8)) {
+		return false;
+	}
+
+	const std::uint64_t total_blocks
+		= (cells.size() + cells_per_block - 1) / cells_per_block;
+	// blocks are written in increasing order
+	std::uint64_t next_block = 0, nr_required_blocks = 0;
+	std::vector<char> bytes;
+	for (std::uint64_t i = 0; i < nr_blocks; i++) {
+		std::uint64_t block = 0, size = 0;
+		if (
+			not read_little_endian(file, block, 8)
+			or not read_little_endian(file, size, 8)
+			or block < next_block
+			or block >= total_blocks
+		) {
+			return false;
+		}
+		next_block = block + 1;
+		if (block >= first_required_block) {
+			nr_required_blocks++;
+		}
+		bytes.resize(std::size_t(size));
+		if (not file.read(bytes.data(), std::streamsize(size))) {
+			return false;
+		}
+
+		const std::size_t
+			begin = std::size_t(block * cells_per_block),
+			end = std::min(cells.size(), std::size_t(begin + cells_per_block));
+		if (not Delta_Block<Variable>::set_bytes(cells, begin, end, bytes)) {
+			return false;
+		}
+	}
+	return
+		first_required_block >= total_blocks
+		or nr_required_blocks == total_blocks - first_required_block;
+}
+
+//! Skips changed blocks of a variable that wasn't requested.
+inline bool skip_delta_blocks(std::ifstream& file)
+{
+	std::uint64_t nr_blocks = 0;
+	if (not read_little_endian(file, nr_blocks, 8)) {
+		return false;
+	}
+	for (std::uint64_t i = 0; i < nr_blocks; i++) {
+		std::uint64_t block = 0, size = 0;
+		if (
+			not read_little_endian(file, block, 8)
+			or not read_little_endian(file, size, 8)
+			or not file.seekg(std::streamoff(size), std::ios::cur)
+		) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/*!
+Applies Variable's blocks if given name is Variable's
+name, sets found to true if it was.
+*/
+template<class Variable, class Cell_T> bool apply_delta_blocks_if(
+	std::ifstream& file,
+	const std::string& name,
+	std::vector<Cell_T>& cells,
+	const std::uint64_t cells_per_block,
+	const std::uint64_t first_required_block,
+	bool& found
+) {
+	if (found or name != boost::core::demangle(typeid(Variable).name())) {
+		return true;
+	}
+	found = true;
+	return apply_delta_blocks<Variable>(
+		file,
+		cells,
+		cells_per_block,
+		first_required_block
+	);
+}
+
+
+//! Applies one delta checkpoint file to given cells.
+template<class Cell_T, class... Variables> bool apply_delta_checkpoint(
+	const std::string& file_name,
+	std::vector<Cell_T>& cells,
+	const Variables&...
+) {
+	std::ifstream file(file_name, std::ios::binary);
+	char magic[4];
+	std::uint64_t version = 0, nr_cells = 0, cells_per_block = 0, nr_variables = 0;
+	if (
+		not file.read(magic, 4)
+		or std::string(magic, 4) != "GSCD"
+		or not read_little_endian(file, version, 4)
+		or version != 1
+		or not read_little_endian(file, nr_cells, 8)
+		or not read_little_endian(file, cells_per_block, 8)
+		or cells_per_block == 0
+		or not read_little_endian(file, nr_variables, 4)
+	) {
+		return false;
+	}
+
+	/*
+	Cells can only be added or removed by blocks in the file,
+	each new cell needs at least one byte of it. Blocks
+	whose number of cells changed must be in the file.
+	*/
+	std::uint64_t first_required_block = std::numeric_limits<std::uint64_t>::max();
+	if (nr_cells != cells.size()) {
+		const auto position = file.tellg();
+		file.seekg(0, std::ios::end);
+		const std::uint64_t remaining = std::uint64_t(file.tellg() - position);
+		file.seekg(position);
+		if (
+			nr_variables == 0
+			or (nr_cells > cells.size() and nr_cells - cells.size() > remaining)
+		) {
+			return false;
+		}
+		first_required_block = std::min<std::uint64_t>(nr_cells, cells.size()) / cells_per_block;
+		cells.resize(std::size_t(nr_cells));
+	}
+
+	for (std::uint64_t i = 0; i < nr_variables; i++) {
+		std::uint64_t name_length = 0;
+		if (not read_little_endian(file, name_length, 4)) {
+			return false;
+		}
+		std::string name(std::size_t(name_length), '\0');
+		if (not file.read(&name[0], std::streamsize(name_length))) {
+			return false;
+		}
+
+		bool found = false, success = true;
+		int dummy[] = {0, (
+			success = apply_delta_blocks_if<Variables>(
+				file,
+				name,
+				cells,
+				cells_per_block,
+				first_required_block,
+				found
+			) and success,
+			0
+		)...};
+		(void)dummy;
+
+		if (not found) {
+			success = skip_delta_blocks(file);
+		}
+		if (not success) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+} // namespace detail
+
+
+/*!
+Reconstructs given variables of cells from a full checkpoint
+and following delta checkpoints written by a
+Delta_Checkpoint_Writer, see its documentation for an example.
+
+Delta checkpoints must be given in the order they were written.
+cells is resized to the number of cells in the last checkpoint.
+Returns true on success and false otherwise, e.g. if a delta
+changes the number of cells without the blocks of changed cells.
+*/
+template<
+	class Cell_T,
+	class... Variables
+> bool read_delta_checkpoints(
+	const std::string& full_file_name,
+	const std::vector<std::string>& delta_file_names,
+	std::vector<Cell_T>& cells,
+	const Variables&... variables
+) {
+	{
+		Checkpoint_Reader reader;
+		if (
+			not reader.open(full_file_name)
+			or not read_checkpoint(reader, cells, variables...)
+		) {
+			return false;
+		}
+	}
+
+	for (const auto& delta_file_name: delta_file_names) {
+		if (not detail::apply_delta_checkpoint(delta_file_name, cells, variables...)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_DELTA_CHECKPOINT_HPP
@@ -0,0 +1,300 @@
+/*
+Compile-time iteration over variables of generic simulation cell.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_FOR_EACH_VARIABLE_HPP
+#define GENSIMCELL_FOR_EACH_VARIABLE_HPP
+
+
+#include "type_traits"
+#include "utility"
+
+#include "type_support.hpp"
+
+
+namespace gensimcell {
+
+
+// forward declare Cell type used in for_each_variable
+template<template<class> class Transfer_Policy, class... Variables> class Cell;
+
+
+/*!
+Predicate for for_each_variable_if() which is true
+for variables whose data is trivially copyable.
+*/
+template <class Variable> struct is_trivially_copyable_variable
+	: std::is_trivially_copyable<typename Variable::data_type> {};
+
+
+namespace detail {
+
+//! Calls given function with given arguments if Call is true.
+template <bool Call> struct Call_If
+{
+	template <
+		class Function,
+		class... Arguments
+	> static void call(Function& function, Arguments&&... arguments)
+	{
+		function(std::forward<Arguments>(arguments)...);
+	}
+};
+
+//! See the general version for documentation.
+template <> struct Call_If<false>
+{
+	template <
+		class Function,
+		class... Arguments
+	> static void call(Function&, Arguments&&...)
+	{}
+};
+
+
+/*!
+Implementation of for_each_variable functions.
+
+Each function is a single pack expansion over the
+variables of the cell so calls are unrolled and
+given function is called directly, not through
+a copy of it.
+*/
+template <class Cell_T> struct Variable_Iterator;
+
+//! See the general version for documentation.
+template <
+	template<class> class Transfer_Policy,
+	class... Variables
+> struct Variable_Iterator<Cell<Transfer_Policy, Variables...>>
+{
+	template <class Function> static void apply(Function& function)
+	{
+		int dummy[] = {0, (function(Variables()), 0)...};
+		(void)dummy;
+	}
+
+	template <
+		template<class> class Predicate,
+		class Function
+	> static void apply_if(Function& function)
+	{
+		int dummy[] = {0, (
+			Call_If<Predicate<Variables>::value>::call(function, Variables()),
+			0
+		)...};
+		(void)dummy;
+	}
+
+	template <
+		class Given_Cell,
+		class Function
+	> static void apply(Given_Cell& cell, Function& function)
+	{
+		int dummy[] = {0, (function(Variables(), cell[Variables()]), 0)...};
+		(void)dummy;
+		(void)cell;
+	}
+
+	template <
+		template<class> class Predicate,
+		class Given_Cell,
+		class Function
+	> static void apply_if(Given_Cell& cell, Function& function)
+	{
+		int dummy[] = {0, (
+			Call_If<Predicate<Variables>::value>::call(
+				function,
+				Variables(),
+				cell[Variables()]
+			),
+			0
+		)...};
+		(void)dummy;
+		(void)cell;
+	}
+
+	#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+
+	template <
+		class Given_Cell,
+		class Function
+	> static void apply_transferred(Given_Cell& cell, Function& function)
+	{
+		int dummy[] = {0, (
+			cell.is_transferred(Variables())
+			? (function(Variables(), cell[Variables()]), 0)
+			: 0
+		)...};
+		(void)dummy;
+		(void)cell;
+	}
+
+	#endif // ifdef MPI_VERSION
+};
+
+} // namespace detail
+
+
+/*!
+Calls given function with each variable of given cell type.
+
+Variables are given in the same order as in the template
+arguments of the cell. For example with
+@code
+struct Printer {
+	template<class Variable> void operator()(const Variable&) {
+		std::cout << sizeof(typename Variable::data_type) << " ";
+	}
+};
+using Cell_T = gensimcell::Cell<gensimcell::Never_Transfer, variable1, variable2>;
+gensimcell::for_each_variable<Cell_T>(Printer());
+@endcode
+prints the size of the data of variable1 and variable2.
+*/
+template <
+	class Cell_T,
+	class Function
+> void for_each_variable(Function&& function)
+{
+	detail::Variable_Iterator<
+		typename std::remove_cv<Cell_T>::type
+	>::apply(function);
+}
+
+
+/*!
+Calls given function with each variable of
+given cell and the data of that variable.
+
+For example
+@code
+struct Zeroer {
+	template<class Variable> void operator()(
+		const Variable&,
+		typename Variable::data_type& data
+	) {
+		data = 0;
+	}
+};
+gensimcell::for_each_variable(cell, Zeroer());
+@endcode
+sets the data of all variables of cell to zero.
+In C++14 a generic lambda can be given instead:
+@code
+gensimcell::for_each_variable(cell, [](auto, auto& data){ data = 0; });
+@endcode
+*/
+template <
+	class Cell_T,
+	class Function
+> typename std::enable_if<
+	is_gensimcell<typename std::remove_cv<Cell_T>::type>::value
+>::type for_each_variable(Cell_T& cell, Function&& function)
+{
+	detail::Variable_Iterator<
+		typename std::remove_cv<Cell_T>::type
+	>::apply(cell, function);
+}
+
+
+/*!
+Same as for_each_variable<Cell_T>() but only with
+variables for which Predicate<Variable>::value is true.
+
+Variables are filtered at compile time, for example
+@code
+gensimcell::for_each_variable_if<
+	gensimcell::is_trivially_copyable_variable,
+	Cell_T
+>(function);
+@endcode
+skips variables of type std::vector, etc.
+*/
+template <
+	template<class> class Predicate,
+	class Cell_T,
+	class Function
+> void for_each_variable_if(Function&& function)
+{
+	detail::Variable_Iterator<
+		typename std::remove_cv<Cell_T>::type
+	>::template apply_if<Predicate>(function);
+}
+
+
+/*!
+Same as for_each_variable(cell, function) but only with
+variables for which Predicate<Variable>::value is true.
+*/
+template <
+	template<class> class Predicate,
+	class Cell_T,
+	class Function
+> typename std::enable_if<
+	is_gensimcell<typename std::remove_cv<Cell_T>::type>::value
+>::type for_each_variable_if(Cell_T& cell, Function&& function)
+{
+	detail::Variable_Iterator<
+		typename std::remove_cv<Cell_T>::type
+	>::template apply_if<Predicate>(cell, function);
+}
+
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+
+/*!
+Same as for_each_variable(cell, function) but only with
+variables which are included in the transfer info returned
+by get_mpi_datatype() of given cell.
+
+Unlike the other versions which variables are given
+to function is decided at run time.
+*/
+template <
+	class Cell_T,
+	class Function
+> typename std::enable_if<
+	is_gensimcell<typename std::remove_cv<Cell_T>::type>::value
+>::type for_each_transferred_variable(Cell_T& cell, Function&& function)
+{
+	detail::Variable_Iterator<
+		typename std::remove_cv<Cell_T>::type
+	>::apply_transferred(cell, function);
+}
+
+#endif // ifdef MPI_VERSION
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_FOR_EACH_VARIABLE_HPP
@@ -0,0 +1,402 @@
+/*
+Combinator that runs several kernels in one pass over cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_FUSED_KERNEL_HPP
+#define GENSIMCELL_FUSED_KERNEL_HPP
+
+
+#include "type_traits"
+#include "utility"
+
+#include "kernel_access.hpp"
+#include "type_support.hpp"
+
+
+namespace gensimcell {
+
+
+/*!
+Kernel given as template argument annotated with given
+Reads, Reads_Own and Writes, see annotate().
+*/
+template<
+	class Kernel,
+	class... Accesses
+> class Annotated_Kernel : public Accesses...
+{
+public:
+
+	explicit Annotated_Kernel(Kernel given_kernel) :
+		kernel(std::move(given_kernel))
+	{}
+
+	template<class... Arguments> auto operator()(Arguments&&... arguments)
+		-> decltype(std::declval<Kernel&>()(std::forward<Arguments>(arguments)...))
+	{
+		return this->kernel(std::forward<Arguments>(arguments)...);
+	}
+
+
+private:
+
+	Kernel kernel;
+};
+
+
+/*!
+Returns given kernel, e.g. a lambda, annotated with given accesses.
+
+Example:
+@code
+auto apply = gensimcell::annotate<
+	gensimcell::Reads_Own<Live_Neighbors>,
+	gensimcell::Writes<Is_Alive, Live_Neighbors>
+>([](const uint64_t cell_id, Grid_T& grid) {...});
+@endcode
+*/
+template<
+	class... Accesses,
+	class Kernel
+> Annotated_Kernel<typename std::decay<Kernel>::type, Accesses...> annotate(
+	Kernel&& kernel
+) {
+	return Annotated_Kernel<typename std::decay<Kernel>::type, Accesses...>(
+		std::forward<Kernel>(kernel)
+	);
+}
+
+
+namespace detail {
+
+//! value is true if any of given values is true.
+template<bool... Values> struct Any_True : std::false_type {};
+
+//! See the general version for documentation.
+template<bool First, bool... Rest> struct Any_True<First, Rest...>
+	: std::integral_constant<bool, First or Any_True<Rest...>::value> {};
+
+
+//! type is a Variable_List of variables in given Variable_Lists.
+template<class... Lists> struct Concatenate
+{
+	using type = Variable_List<>;
+};
+
+//! See the general version for documentation.
+template<class... Variables> struct Concatenate<Variable_List<Variables...>>
+{
+	using type = Variable_List<Variables...>;
+};
+
+//! See the general version for documentation.
+template<
+	class... Variables1,
+	class... Variables2,
+	class... Rest
+> struct Concatenate<
+	Variable_List<Variables1...>,
+	Variable_List<Variables2...>,
+	Rest...
+> {
+	using type = typename Concatenate<
+		Variable_List<Variables1..., Variables2...>,
+		Rest...
+	>::type;
+};
+
+
+//! value is true if given Variable_Lists have a common variable.
+template<class List1, class List2> struct Lists_Intersect;
+
+//! See the general version for documentation.
+template<
+	class... Variables1,
+	class... Variables2
+> struct Lists_Intersect<
+	Variable_List<Variables1...>,
+	Variable_List<Variables2...>
+> :
+	Any_True<contains_variable<Variables1, Variables2...>::value...>
+{};
+
+
+//! value is true if given kernel is annotated with at least one access.
+template<class Kernel> struct Is_Annotated :
+	std::integral_constant<
+		bool,
+		not std::is_same<
+			typename Concatenate<
+				typename Neighbor_Reads<Kernel>::type,
+				typename Own_Reads<Kernel>::type,
+				typename Kernel_Writes<Kernel>::type
+			>::type,
+			Variable_List<>
+		>::value
+	>
+{};
+
+
+/*!
+value is true if running Earlier and Later one after the other
+for each cell gives the same result as running Earlier for all
+cells before running Later, i.e. Later doesn't read from neighbors
+what Earlier writes and doesn't write what Earlier reads from
+neighbors. Both can read and write the same variables of their
+own cell.
+*/
+template<class Earlier, class Later> struct Can_Fuse_Pair :
+	std::integral_constant<
+		bool,
+		not Lists_Intersect<
+			typename Kernel_Writes<Earlier>::type,
+			typename Neighbor_Reads<Later>::type
+		>::value
+		and not Lists_Intersect<
+			typename Neighbor_Reads<Earlier>::type,
+			typename Kernel_Writes<Later>::type
+		>::value
+	>
+{};
+
+//! value is true if given kernels can be fused in given order.
+template<class... Kernels> struct Can_Fuse : std::true_type {};
+
+//! See the general version for documentation.
+template<class First, class... Rest> struct Can_Fuse<First, Rest...> :
+	std::integral_constant<
+		bool,
+		not Any_True<not Can_Fuse_Pair<First, Rest>::value...>::value
+		and Can_Fuse<Rest...>::value
+	>
+{};
+
+
+//! Return type of kernel called with given cell id and grid.
+template<
+	class Kernel,
+	class Cell_Id_T,
+	class Grid_T
+> using Call_Result = decltype(
+	std::declval<Kernel&>()(
+		std::declval<const Cell_Id_T&>(),
+		std::declval<Grid_T&>()
+	)
+);
+
+
+/*!
+Calls given kernels in order for one cell and returns the
+result of the kernel that returns a value, if any.
+*/
+template<class... Kernels> class Fused_Calls;
+
+//! See the general version for documentation.
+template<class Last> class Fused_Calls<Last>
+{
+public:
+
+	explicit Fused_Calls(Last given_last) :
+		last(std::move(given_last))
+	{}
+
+	template<
+		class Cell_Id_T,
+		class Grid_T
+	> typename std::decay<Call_Result<Last, Cell_Id_T, Grid_T>>::type operator()(
+		const Cell_Id_T& cell_id,
+		Grid_T& grid
+	) {
+		return this->last(cell_id, grid);
+	}
+
+
+private:
+
+	Last last;
+};
+
+//! See the general version for documentation.
+template<
+	class First,
+	class Second,
+	class... Rest
+> class Fused_Calls<First, Second, Rest...>
+{
+public:
+
+	Fused_Calls(First given_first, Second given_second, Rest... given_rest) :
+		first(std::move(given_first)),
+		rest(std::move(given_second), std::move(given_rest)...)
+	{}
+
+	template<
+		class Cell_Id_T,
+		class Grid_T
+	> typename std::conditional<
+		std::is_void<Call_Result<First, Cell_Id_T, Grid_T>>::value,
+		Call_Result<Fused_Calls<Second, Rest...>, Cell_Id_T, Grid_T>,
+		typename std::decay<Call_Result<First, Cell_Id_T, Grid_T>>::type
+	>::type operator()(
+		const Cell_Id_T& cell_id,
+		Grid_T& grid
+	) {
+		return this->call(
+			cell_id,
+			grid,
+			std::is_void<Call_Result<First, Cell_Id_T, Grid_T>>()
+		);
+	}
+
+
+private:
+
+	First first;
+	Fused_Calls<Second, Rest...> rest;
+
+
+	//! First kernel doesn't return a value.
+	template<
+		class Cell_Id_T,
+		class Grid_T
+	> Call_Result<Fused_Calls<Second, Rest...>, Cell_Id_T, Grid_T> call(
+		const Cell_Id_T& cell_id,
+		Grid_T& grid,
+		const std::true_type
+	) {
+		this->first(cell_id, grid);
+		return this->rest(cell_id, grid);
+	}
+
+	//! Returns the value of first kernel after calling the rest.
+	template<
+		class Cell_Id_T,
+		class Grid_T
+	> typename std::decay<Call_Result<First, Cell_Id_T, Grid_T>>::type call(
+		const Cell_Id_T& cell_id,
+		Grid_T& grid,
+		const std::false_type
+	) {
+		static_assert(
+			std::is_void<
+				Call_Result<Fused_Calls<Second, Rest...>, Cell_Id_T, Grid_T>
+			>::value,
+			"At most one fused kernel can return a value"
+		);
+		auto result = this->first(cell_id, grid);
+		this->rest(cell_id, grid);
+		return result;
+	}
+};
+
+} // namespace detail
+
+
+/*!
+Kernel that calls given kernels one after the other for each
+cell, see fuse(). Is annotated with accesses of all kernels.
+*/
+template<class... Kernels> class Fused_Kernel :
+	public detail::Fused_Calls<Kernels...>
+{
+	static_assert(
+		sizeof...(Kernels) > 0,
+		"At least one kernel must be fused"
+	);
+	static_assert(
+		not detail::Any_True<not detail::Is_Annotated<Kernels>::value...>::value,
+		"Fused kernels must be annotated with Reads, Reads_Own or Writes"
+	);
+	static_assert(
+		detail::Can_Fuse<Kernels...>::value,
+		"Fused kernel reads from neighbors a variable written by another "
+		"fused kernel or writes a variable that another one reads from "
+		"neighbors, run them in separate passes instead"
+	);
+
+public:
+
+	using neighbor_reads = typename detail::Concatenate<
+		typename detail::Neighbor_Reads<Kernels>::type...
+	>::type;
+	using own_reads = typename detail::Concatenate<
+		typename detail::Own_Reads<Kernels>::type...
+	>::type;
+	using writes = typename detail::Concatenate<
+		typename detail::Kernel_Writes<Kernels>::type...
+	>::type;
+
+	explicit Fused_Kernel(Kernels... kernels) :
+		detail::Fused_Calls<Kernels...>(std::move(kernels)...)
+	{}
+};
+
+
+/*!
+Returns a kernel that calls given kernels in the given order
+for each cell, so that e.g. parallel_for_cells() streams data
+of cells through the cache once instead of once per kernel.
+
+Kernels must be annotated with Reads, Reads_Own and Writes
+from which legality of fusion is checked at compile time: a
+kernel can't read from neighbors variables written by another
+fused kernel, or write variables another one reads from
+neighbors, because neighbors might be processed before or after
+the cell. At most one kernel can return a value, e.g. the
+allowed time step for parallel_min_cells(), which is returned
+by the fused kernel.
+
+Example of solving game of life and advection in one pass:
+@code
+const double max_time_step = gensimcell::parallel_min_cells(
+	inner_cells,
+	grid,
+	gensimcell::fuse(
+		gol::Solve_Kernel<...>(),
+		advection::Solve_Kernel<...>(time_step)
+	)
+);
+@endcode
+*/
+template<class... Kernels> Fused_Kernel<
+	typename std::decay<Kernels>::type...
+> fuse(Kernels&&... kernels)
+{
+	return Fused_Kernel<typename std::decay<Kernels>::type...>(
+		std::forward<Kernels>(kernels)...
+	);
+}
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_FUSED_KERNEL_HPP
@@ -35,11 +35,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 #include "tuple"
+#include "utility"
 
 #include "assign.hpp"
+#include "for_each_variable.hpp"
 #include "operators.hpp"
 #include "type_support.hpp"
+#ifdef GENSIMCELL_FLAT_IMPL
+#include "gensimcell_flat_impl.hpp"
+#else
 #include "gensimcell_impl.hpp"
+#endif
 #include "gensimcell_transfer_policy.hpp"
 
 
@@ -57,6 +63,28 @@ generic simulation cell class is defined.
 namespace gensimcell {
 
 
+namespace detail {
+
+/*!
+Implementation of the API of gensimcell::Cell.
+
+Defining GENSIMCELL_FLAT_IMPL before including this file
+selects Flat_Cell_impl which compiles faster for cells
+with many variables, see gensimcell_flat_impl.hpp.
+*/
+template <
+	template<class> class Transfer_Policy,
+	class... Variables
+> using Cell_base =
+	#ifdef GENSIMCELL_FLAT_IMPL
+	Flat_Cell_impl<Transfer_Policy, Variables...>;
+	#else
+	Cell_impl<Transfer_Policy, sizeof...(Variables), Variables...>;
+	#endif
+
+} // namespace detail
+
+
 /*!
 Generic simulation cell that stores arbitrary simulation variables.
 
@@ -137,7 +165,7 @@ template <
 	template<class> class Transfer_Policy,
 	class... Variables
 > class Cell :
-	public detail::Cell_impl<Transfer_Policy, sizeof...(Variables), Variables...>
+	public detail::Cell_base<Transfer_Policy, Variables...>
 {
 public:
 	/*!
@@ -159,18 +187,24 @@ public:
 	cell2[GoL_Variables2()][Is_Alive()] = true;
 	@endcode
 	*/
-	using data_type = detail::Cell_impl<
-		Transfer_Policy,
-		sizeof...(Variables),
-		Variables...
-	>;
+	using data_type = detail::Cell_base<Transfer_Policy, Variables...>;
+
+
+	/*!
+	Makes assignment from scalars available, for example
+	cell = 0 sets the data of all variables to zero.
+	*/
+	using detail::Cell_base<Transfer_Policy, Variables...>::operator=;
 
 
 	/*!
+	Assigns common variables from other cell, see gensimcell::assign().
+
+	Data of common variables is moved if other is an rvalue.
 	*/
-	template<class Other> void assign(const Other& other)
+	template<class Other> void assign(Other&& other)
 	{
-		gensimcell::assign(*this, other);
+		gensimcell::assign(*this, std::forward<Other>(other));
 	}
 
 
@@ -190,9 +224,8 @@ public:
 		MPI_Datatype
 	> get_mpi_datatype() const
 	{
-		return detail::Cell_impl<
+		return detail::Cell_base<
 			Transfer_Policy,
-			sizeof...(Variables),
 			Variables...
 		>::get_mpi_datatype();
 	}
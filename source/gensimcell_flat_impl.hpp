@@ -0,0 +1,445 @@
+/*
+Flat implementation of generic simulation cell class.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_FLAT_IMPL_HPP
+#define GENSIMCELL_FLAT_IMPL_HPP
+
+
+#include "array"
+#include "cstdlib"
+#include "tuple"
+#include "type_traits"
+#include "utility"
+
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+
+#include "boost/logic/tribool.hpp"
+
+#endif // ifdef MPI_VERSION
+
+
+#include "get_var_mpi_datatype.hpp"
+#include "variable_operators.hpp"
+
+
+namespace gensimcell {
+namespace detail {
+
+
+/*!
+Stores the data of one variable of Flat_Cell_impl.
+*/
+template <
+	template<class> class Transfer_Policy,
+	class Variable
+> class Flat_Cell_Leaf :
+	public Transfer_Policy<Variable>
+{
+protected:
+
+	typename Variable::data_type data;
+};
+
+
+/*!
+Alternative to Cell_impl with the same public API.
+
+Used as the base of gensimcell::Cell if GENSIMCELL_FLAT_IMPL
+is defined before including gensimcell.hpp. The definition
+must be the same in all translation units of a program.
+
+Instead of a chain of classes that each store one variable
+and redeclare the API of all previous classes, inherits
+directly from a class storing each variable. Data of a
+variable is found at compile time by converting this to
+the variable's base class and all operations are pack
+expansions over Variables, so the depth of template
+instantiations doesn't grow with the number of variables.
+Operators with a scalar right hand side are templates
+enabled for arithmetic types instead of one overload
+per type.
+
+Variables are stored in memory in the same order as
+given in Variables while Cell_impl stores them in
+reverse order. MPI transfer info has variables in the
+order of Variables in both implementations.
+*/
+template <
+	template<class> class Transfer_Policy,
+	class... Variables
+> class Flat_Cell_impl :
+	public Flat_Cell_Leaf<Transfer_Policy, Variables>...
+{
+
+private:
+
+
+	#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+
+	/*!
+	Transfer info of variables not stored in this cell is
+	given to the transfer policy of the first variable so
+	that, as in Cell_impl, it compiles only for policies
+	that accept any variable.
+	*/
+	template<class Given_Var> using Transfer_Leaf
+		= typename std::conditional<
+			std::is_base_of<
+				Flat_Cell_Leaf<Transfer_Policy, Given_Var>,
+				Flat_Cell_impl
+			>::value,
+			Flat_Cell_Leaf<Transfer_Policy, Given_Var>,
+			Flat_Cell_Leaf<
+				Transfer_Policy,
+				typename std::tuple_element<0, std::tuple<Variables...>>::type
+			>
+		>::type;
+
+	//! Adds transfer info of given variable to given arrays if transferred.
+	template<class Variable> void add_mpi_datatype(
+		const Variable&,
+		size_t& nr_transferred,
+		std::array<void*, sizeof...(Variables)>& addresses,
+		std::array<int, sizeof...(Variables)>& counts,
+		std::array<MPI_Datatype, sizeof...(Variables)>& datatypes
+	) const {
+		if (this->is_transferred(Variable())) {
+			std::tie(
+				addresses[nr_transferred],
+				counts[nr_transferred],
+				datatypes[nr_transferred]
+			) = get_var_mpi_datatype((*this)[Variable()]);
+			nr_transferred++;
+		}
+	}
+
+	#endif // if defined MPI...
+
+
+public:
+
+
+	Flat_Cell_impl() = default;
+	Flat_Cell_impl(const Flat_Cell_impl&) = default;
+	Flat_Cell_impl(Flat_Cell_impl&&) = default;
+
+
+	//! Returns a reference to the data of given variable.
+	template<
+		class Variable
+	> typename Variable::data_type& operator[](const Variable&)
+	{
+		static_assert(
+			std::is_base_of<
+				Flat_Cell_Leaf<Transfer_Policy, Variable>,
+				Flat_Cell_impl
+			>::value,
+			"Given variable isn't stored in this cell type"
+		);
+		return this->Flat_Cell_Leaf<Transfer_Policy, Variable>::data;
+	}
+
+	//! Returns a const reference to the data of given variable.
+	template<
+		class Variable
+	> const typename Variable::data_type& operator[](const Variable&) const
+	{
+		static_assert(
+			std::is_base_of<
+				Flat_Cell_Leaf<Transfer_Policy, Variable>,
+				Flat_Cell_impl
+			>::value,
+			"Given variable isn't stored in this cell type"
+		);
+		return this->Flat_Cell_Leaf<Transfer_Policy, Variable>::data;
+	}
+
+	//! Returns references to the data of given variables.
+	template<
+		class... Given_Vars
+	> std::tuple<
+		typename Given_Vars::data_type&...
+	> operator()(const Given_Vars&...)
+	{
+		return std::forward_as_tuple((*this)[Given_Vars()]...);
+	}
+
+	//! Returns const references to the data of given variables.
+	template<
+		class... Given_Vars
+	> std::tuple<
+		const typename Given_Vars::data_type&...
+	> operator()(const Given_Vars&...) const
+	{
+		return std::forward_as_tuple((*this)[Given_Vars()]...);
+	}
+
+
+	/*!
+	Moves the data of all variables from given cell.
+
+	Like copy assignment does not change whether
+	variables are transferred with MPI.
+	*/
+	Flat_Cell_impl& operator=(Flat_Cell_impl&& rhs)
+	{
+		int dummy[] = {0, (
+			(*this)[Variables()] = std::move(rhs[Variables()]),
+			0
+		)...};
+		(void)dummy;
+		return *this;
+	}
+
+
+	/*
+	Operators, see Cell_impl for documentation.
+	*/
+
+	#define GENSIMCELL_COMMA ,
+	#define GENSIMCELL_MAKE_FLAT_OPERATOR(NAME, VARIABLE_OPERATOR, OPERATOR) \
+	template< \
+		class... Operator_Variables \
+	> void NAME( \
+		const Flat_Cell_impl& rhs GENSIMCELL_COMMA \
+		const Operator_Variables&... \
+	) { \
+		int dummy[] = {0 GENSIMCELL_COMMA ( \
+			detail::VARIABLE_OPERATOR( \
+				(*this)[Operator_Variables()] GENSIMCELL_COMMA \
+				rhs[Operator_Variables()] \
+			) GENSIMCELL_COMMA \
+			0 \
+		)...}; \
+		(void)dummy; \
+		(void)rhs; \
+	} \
+	\
+	Flat_Cell_impl& operator OPERATOR (const Flat_Cell_impl& rhs) \
+	{ \
+		this->NAME(rhs GENSIMCELL_COMMA Variables()...); \
+		return *this; \
+	} \
+	\
+	template< \
+		class Scalar_T GENSIMCELL_COMMA \
+		class... Operator_Variables \
+	> typename std::enable_if< \
+		std::is_arithmetic<Scalar_T>::value \
+	>::type NAME( \
+		const Scalar_T& rhs GENSIMCELL_COMMA \
+		const Operator_Variables&... \
+	) { \
+		int dummy[] = {0 GENSIMCELL_COMMA ( \
+			detail::VARIABLE_OPERATOR( \
+				(*this)[Operator_Variables()] GENSIMCELL_COMMA \
+				rhs \
+			) GENSIMCELL_COMMA \
+			0 \
+		)...}; \
+		(void)dummy; \
+		(void)rhs; \
+	} \
+	\
+	template< \
+		class Scalar_T \
+	> typename std::enable_if< \
+		std::is_arithmetic<Scalar_T>::value GENSIMCELL_COMMA \
+		Flat_Cell_impl& \
+	>::type operator OPERATOR (const Scalar_T& rhs) \
+	{ \
+		this->NAME(rhs GENSIMCELL_COMMA Variables()...); \
+		return *this; \
+	}
+
+	GENSIMCELL_MAKE_FLAT_OPERATOR(equal, variable_equal, =)
+	GENSIMCELL_MAKE_FLAT_OPERATOR(plus_equal, variable_plus_equal, +=)
+	GENSIMCELL_MAKE_FLAT_OPERATOR(minus_equal, variable_minus_equal, -=)
+	GENSIMCELL_MAKE_FLAT_OPERATOR(mul_equal, variable_mul_equal, *=)
+	GENSIMCELL_MAKE_FLAT_OPERATOR(div_equal, variable_div_equal, /=)
+
+	#undef GENSIMCELL_MAKE_FLAT_OPERATOR
+
+
+	#define GENSIMCELL_MAKE_FLAT_ATOMIC_OPERATOR(NAME, VARIABLE_OPERATOR) \
+	template< \
+		class... Operator_Variables \
+	> void NAME( \
+		const Flat_Cell_impl& rhs GENSIMCELL_COMMA \
+		const Operator_Variables&... \
+	) { \
+		int dummy[] = {0 GENSIMCELL_COMMA ( \
+			detail::VARIABLE_OPERATOR( \
+				(*this)[Operator_Variables()] GENSIMCELL_COMMA \
+				rhs[Operator_Variables()] \
+			) GENSIMCELL_COMMA \
+			0 \
+		)...}; \
+		(void)dummy; \
+		(void)rhs; \
+	} \
+	\
+	template< \
+		class Scalar_T GENSIMCELL_COMMA \
+		class... Operator_Variables \
+	> typename std::enable_if< \
+		std::is_arithmetic<Scalar_T>::value \
+	>::type NAME( \
+		const Scalar_T& rhs GENSIMCELL_COMMA \
+		const Operator_Variables&... \
+	) { \
+		int dummy[] = {0 GENSIMCELL_COMMA ( \
+			detail::VARIABLE_OPERATOR( \
+				(*this)[Operator_Variables()] GENSIMCELL_COMMA \
+				rhs \
+			) GENSIMCELL_COMMA \
+			0 \
+		)...}; \
+		(void)dummy; \
+		(void)rhs; \
+	}
+
+	GENSIMCELL_MAKE_FLAT_ATOMIC_OPERATOR(atomic_plus_equal, variable_atomic_plus_equal)
+	GENSIMCELL_MAKE_FLAT_ATOMIC_OPERATOR(atomic_minus_equal, variable_atomic_minus_equal)
+	GENSIMCELL_MAKE_FLAT_ATOMIC_OPERATOR(atomic_mul_equal, variable_atomic_mul_equal)
+	GENSIMCELL_MAKE_FLAT_ATOMIC_OPERATOR(atomic_div_equal, variable_atomic_div_equal)
+
+	#undef GENSIMCELL_MAKE_FLAT_ATOMIC_OPERATOR
+	#undef GENSIMCELL_COMMA
+
+
+	#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+
+	//! See Cell_impl for documentation.
+	template<class... Given_Vars> static void set_transfer_all(
+		const boost::logic::tribool given_transfer,
+		const Given_Vars&...
+	) {
+		int dummy[] = {0, (
+			Transfer_Leaf<Given_Vars>::set_transfer_all_impl(
+				given_transfer,
+				Given_Vars()
+			),
+			0
+		)...};
+		(void)dummy;
+	}
+
+	//! See Cell_impl for documentation.
+	template<class... Given_Vars> void set_transfer(
+		const bool given_transfer,
+		const Given_Vars&...
+	) {
+		int dummy[] = {0, (
+			this->Transfer_Leaf<Given_Vars>::set_transfer_impl(
+				given_transfer,
+				Given_Vars()
+			),
+			0
+		)...};
+		(void)dummy;
+	}
+
+	//! Returns the value set by set_transfer_all() for given variable.
+	template<class Variable> static boost::logic::tribool get_transfer_all(
+		const Variable&
+	) {
+		return Flat_Cell_Leaf<
+			Transfer_Policy,
+			Variable
+		>::get_transfer_all(Variable());
+	}
+
+	//! Returns the value set by set_transfer() for given variable.
+	template<class Variable> bool get_transfer(const Variable&) const
+	{
+		return this->Flat_Cell_Leaf<
+			Transfer_Policy,
+			Variable
+		>::get_transfer(Variable());
+	}
+
+	/*!
+	Returns true if given variable will be added to the transfer
+	info returned by get_mpi_datatype() and false otherwise.
+	*/
+	template<class Variable> bool is_transferred(const Variable&) const
+	{
+		return this->Flat_Cell_Leaf<
+			Transfer_Policy,
+			Variable
+		>::is_transferred(Variable());
+	}
+
+
+	//! See Cell_impl for documentation.
+	std::tuple<
+		void*,
+		int,
+		MPI_Datatype
+	> get_mpi_datatype() const
+	{
+		std::array<void*, sizeof...(Variables)> addresses;
+		std::array<int, sizeof...(Variables)> counts;
+		std::array<MPI_Datatype, sizeof...(Variables)> datatypes;
+
+		size_t nr_transferred = 0;
+		int dummy[] = {0, (
+			this->add_mpi_datatype(
+				Variables(),
+				nr_transferred,
+				addresses,
+				counts,
+				datatypes
+			),
+			0
+		)...};
+		(void)dummy;
+
+		return get_struct_mpi_datatype(
+			nr_transferred,
+			addresses,
+			counts,
+			datatypes
+		);
+	}
+
+	#endif // ifdef MPI_VERSION
+};
+
+
+} // namespace detail
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_FLAT_IMPL_HPP
@@ -38,6 +38,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cstdlib"
 #include "limits"
 #include "tuple"
+#include "type_traits"
+#include "utility"
 #include "vector"
 
 
@@ -49,6 +51,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 #include "get_var_mpi_datatype.hpp"
+#include "variable_operators.hpp"
 
 
 namespace gensimcell {
@@ -164,7 +167,11 @@ protected:
 
 
 	#define GENSIMCELL_COMMA ,
-	#define GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(NAME, OPERATOR) \
+	/*
+	Operators are applied element-wise to arrays,
+	vectors, etc. see variable_operators.hpp
+	*/
+	#define GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(NAME, VARIABLE_OPERATOR) \
 	using Cell_impl< \
 		Transfer_Policy GENSIMCELL_COMMA \
 		number_of_variables GENSIMCELL_COMMA \
@@ -175,14 +182,18 @@ protected:
 		const Current_Variable& GENSIMCELL_COMMA \
 		const Other_T& rhs \
 	) { \
-		this->data OPERATOR rhs; \
+		detail::VARIABLE_OPERATOR(this->data GENSIMCELL_COMMA rhs); \
 	}
 
-	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(equal_impl, =)
-	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(plus_equal_impl, +=)
-	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(minus_equal_impl, -=)
-	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(mul_equal_impl, *=)
-	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(div_equal_impl, /=)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(equal_impl, variable_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(plus_equal_impl, variable_plus_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(minus_equal_impl, variable_minus_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(mul_equal_impl, variable_mul_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(div_equal_impl, variable_div_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(atomic_plus_equal_impl, variable_atomic_plus_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(atomic_minus_equal_impl, variable_atomic_minus_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(atomic_mul_equal_impl, variable_atomic_mul_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION(atomic_div_equal_impl, variable_atomic_div_equal)
 	#undef GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION
 
 
@@ -233,6 +244,43 @@ public:
 	}
 
 
+	/*
+	Construction and move assignment
+	*/
+
+	Cell_impl() = default;
+	Cell_impl(const Cell_impl&) = default;
+	Cell_impl(Cell_impl&&) = default;
+
+	/*!
+	Moves the data of all variables from given cell.
+
+	Data of std::vector, etc. is moved instead of copied.
+	Like copy assignment does not change whether
+	variables are transferred with MPI.
+	*/
+	Cell_impl& operator=(Cell_impl&& rhs)
+	{
+		this->data = std::move(rhs.data);
+		Cell_impl<
+			Transfer_Policy,
+			number_of_variables,
+			Rest_Of_Variables...
+		>::operator=(
+			std::move(
+				static_cast<
+					Cell_impl<
+						Transfer_Policy,
+						number_of_variables,
+						Rest_Of_Variables...
+					>&
+				>(rhs)
+			)
+		);
+		return *this;
+	}
+
+
 	/*
 	Operators
 	*/
@@ -450,6 +498,69 @@ public:
 	#undef GENSIMCELL_MAKE_OPERATOR_OTHER
 
 
+	/*!
+	Atomic versions of plus_equal(), etc. for scatter kernels
+	in which several threads modify the same cell, for example:
+	@code
+	// called concurrently for neighbors of a cell
+	neighbor.atomic_plus_equal(deposited, Density(), Momentum());
+	neighbor.atomic_minus_equal(1.0, Density());
+	@endcode
+	applies the operator atomically to each arithmetic element
+	of given variables, see variable_operators.hpp. Data of given
+	variables must be arithmetic or std::array, std::vector or
+	std::pair of it. Right hand side is either a cell with given
+	variables or a scalar. Threads must not modify the same
+	variables concurrently with non-atomic operators.
+	*/
+	#define GENSIMCELL_MAKE_ATOMIC_OPERATOR(NAME, IMPLEMENTATION_NAME) \
+	template< \
+		class... Operator_Variables \
+	> void NAME( \
+		const Cell_impl< \
+			Transfer_Policy GENSIMCELL_COMMA \
+			number_of_variables GENSIMCELL_COMMA \
+			Current_Variable GENSIMCELL_COMMA \
+			Rest_Of_Variables... \
+		>& rhs GENSIMCELL_COMMA \
+		const Operator_Variables&... \
+	) { \
+		int dummy[] = {0 GENSIMCELL_COMMA ( \
+			this->IMPLEMENTATION_NAME( \
+				Operator_Variables() GENSIMCELL_COMMA \
+				rhs[Operator_Variables()] \
+			) GENSIMCELL_COMMA \
+			0 \
+		)...}; \
+		(void)dummy; \
+		(void)rhs; \
+	} \
+	\
+	template< \
+		class Scalar_T GENSIMCELL_COMMA \
+		class... Operator_Variables \
+	> typename std::enable_if< \
+		std::is_arithmetic<Scalar_T>::value \
+	>::type NAME( \
+		const Scalar_T& rhs GENSIMCELL_COMMA \
+		const Operator_Variables&... \
+	) { \
+		int dummy[] = {0 GENSIMCELL_COMMA ( \
+			this->IMPLEMENTATION_NAME(Operator_Variables() GENSIMCELL_COMMA rhs) GENSIMCELL_COMMA \
+			0 \
+		)...}; \
+		(void)dummy; \
+		(void)rhs; \
+	}
+
+	GENSIMCELL_MAKE_ATOMIC_OPERATOR(atomic_plus_equal, atomic_plus_equal_impl)
+	GENSIMCELL_MAKE_ATOMIC_OPERATOR(atomic_minus_equal, atomic_minus_equal_impl)
+	GENSIMCELL_MAKE_ATOMIC_OPERATOR(atomic_mul_equal, atomic_mul_equal_impl)
+	GENSIMCELL_MAKE_ATOMIC_OPERATOR(atomic_div_equal, atomic_div_equal_impl)
+
+	#undef GENSIMCELL_MAKE_ATOMIC_OPERATOR
+
+
 	#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
 
 	using Transfer_Policy<Current_Variable>::get_transfer_all;
@@ -579,65 +690,12 @@ public:
 				datatypes
 			);
 
-		if (nr_vars_to_transfer == 0) {
-
-			// assume NULL won't be dereferenced if count = 0
-			return std::make_tuple((void*) NULL, 0, MPI_BYTE);
-
-		} else if (nr_vars_to_transfer == 1) {
-
-			return std::make_tuple(
-				addresses[0],
-				counts[0],
-				datatypes[0]
-			);
-
-		} else if (nr_vars_to_transfer <= size_t(std::numeric_limits<int>::max())) {
-
-			// get displacements of variables to transfer
-			std::array<MPI_Aint, number_of_variables> displacements;
-			for (size_t i = 0; i < nr_vars_to_transfer; i++) {
-				displacements[i]
-					= static_cast<char*>(addresses[i])
-					- static_cast<char*>(addresses[0]);
-			}
-
-			MPI_Datatype final_datatype = MPI_DATATYPE_NULL;
-			if (
-				MPI_Type_create_struct(
-					int(nr_vars_to_transfer),
-					counts.data(),
-					displacements.data(),
-					datatypes.data(),
-					&final_datatype
-				) != MPI_SUCCESS
-			) {
-				return std::make_tuple((void*) NULL, -1, MPI_DATATYPE_NULL);
-			}
-
-			// free user-defined component datatypes
-			for (size_t i = 0; i < nr_vars_to_transfer; i++) {
-				if (datatypes[i] == MPI_DATATYPE_NULL) {
-					continue;
-				}
-				int combiner = -1, tmp1 = -1, tmp2 = -1, tmp3 = -1;
-				MPI_Type_get_envelope(datatypes[i], &tmp1, &tmp2, &tmp3, &combiner);
-				if (combiner != MPI_COMBINER_NAMED) {
-					MPI_Type_free(&datatypes[i]);
-				}
-			}
-
-			return std::make_tuple(addresses[0], 1, final_datatype);
-
-		} else {
-
-			return std::make_tuple(
-				(void*) NULL,
-				std::numeric_limits<int>::lowest(),
-				MPI_DATATYPE_NULL
-			);
-
-		}
+		return get_struct_mpi_datatype(
+			nr_vars_to_transfer,
+			addresses,
+			counts,
+			datatypes
+		);
 	}
 
 	#endif // ifdef MPI_VERSION
@@ -672,19 +730,23 @@ private:
 protected:
 
 
-	#define GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(NAME, OPERATOR) \
+	#define GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(NAME, VARIABLE_OPERATOR) \
 	template<class Other_T> void NAME( \
 		const Variable& GENSIMCELL_COMMA \
 		const Other_T& rhs \
 	) { \
-		this->data OPERATOR rhs; \
+		detail::VARIABLE_OPERATOR(this->data GENSIMCELL_COMMA rhs); \
 	}
 
-	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(equal_impl, =)
-	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(plus_equal_impl, +=)
-	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(minus_equal_impl, -=)
-	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(mul_equal_impl, *=)
-	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(div_equal_impl, /=)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(equal_impl, variable_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(plus_equal_impl, variable_plus_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(minus_equal_impl, variable_minus_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(mul_equal_impl, variable_mul_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(div_equal_impl, variable_div_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(atomic_plus_equal_impl, variable_atomic_plus_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(atomic_minus_equal_impl, variable_atomic_minus_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(atomic_mul_equal_impl, variable_atomic_mul_equal)
+	GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST(atomic_div_equal_impl, variable_atomic_div_equal)
 	#undef GENSIMCELL_MAKE_OPERATOR_IMPLEMENTATION_LAST
 
 
@@ -720,6 +782,17 @@ protected:
 
 public:
 
+	Cell_impl() = default;
+	Cell_impl(const Cell_impl&) = default;
+	Cell_impl(Cell_impl&&) = default;
+
+	//! See the variadic version of Cell_impl for documentation
+	Cell_impl& operator=(Cell_impl&& rhs)
+	{
+		this->data = std::move(rhs.data);
+		return *this;
+	}
+
 	//! See the variadic version of Cell_impl for documentation
 	typename Variable::data_type& operator[](const Variable&)
 	{
@@ -874,6 +947,54 @@ public:
 	GENSIMCELL_MAKE_OPERATOR_LAST_OTHER(div_equal_impl, /=, long double)
 
 	#undef GENSIMCELL_MAKE_OPERATOR_LAST_OTHER
+
+
+	#define GENSIMCELL_MAKE_ATOMIC_OPERATOR_LAST(NAME, IMPLEMENTATION_NAME) \
+	template< \
+		class... Operator_Variables \
+	> void NAME( \
+		const Cell_impl< \
+			Transfer_Policy GENSIMCELL_COMMA \
+			number_of_variables GENSIMCELL_COMMA \
+			Variable \
+		>& rhs GENSIMCELL_COMMA \
+		const Operator_Variables&... \
+	) { \
+		int dummy[] = {0 GENSIMCELL_COMMA ( \
+			this->IMPLEMENTATION_NAME( \
+				Operator_Variables() GENSIMCELL_COMMA \
+				rhs[Operator_Variables()] \
+			) GENSIMCELL_COMMA \
+			0 \
+		)...}; \
+		(void)dummy; \
+		(void)rhs; \
+	} \
+	\
+	template< \
+		class Scalar_T GENSIMCELL_COMMA \
+		class... Operator_Variables \
+	> typename std::enable_if< \
+		std::is_arithmetic<Scalar_T>::value \
+	>::type NAME( \
+		const Scalar_T& rhs GENSIMCELL_COMMA \
+		const Operator_Variables&... \
+	) { \
+		int dummy[] = {0 GENSIMCELL_COMMA ( \
+			this->IMPLEMENTATION_NAME(Operator_Variables() GENSIMCELL_COMMA rhs) GENSIMCELL_COMMA \
+			0 \
+		)...}; \
+		(void)dummy; \
+		(void)rhs; \
+	}
+
+	//! See the variadic version of Cell_impl for documentation
+	GENSIMCELL_MAKE_ATOMIC_OPERATOR_LAST(atomic_plus_equal, atomic_plus_equal_impl)
+	GENSIMCELL_MAKE_ATOMIC_OPERATOR_LAST(atomic_minus_equal, atomic_minus_equal_impl)
+	GENSIMCELL_MAKE_ATOMIC_OPERATOR_LAST(atomic_mul_equal, atomic_mul_equal_impl)
+	GENSIMCELL_MAKE_ATOMIC_OPERATOR_LAST(atomic_div_equal, atomic_div_equal_impl)
+
+	#undef GENSIMCELL_MAKE_ATOMIC_OPERATOR_LAST
 	#undef GENSIMCELL_COMMA
 
 
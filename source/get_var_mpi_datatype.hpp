@@ -785,6 +785,88 @@ template <
 }
 
 
+/*!
+Returns transfer info combining transfer info of several variables.
+
+First nr_of_variables items of given arrays must contain the
+transfer info of each variable in the order in which they
+should be in the returned datatype. Frees given datatypes
+which aren't named MPI datatypes if they were combined.
+*/
+template <
+	size_t Max_Number_Of_Variables
+> std::tuple<
+	void*,
+	int,
+	MPI_Datatype
+> get_struct_mpi_datatype(
+	const size_t nr_of_variables,
+	std::array<void*, Max_Number_Of_Variables>& addresses,
+	std::array<int, Max_Number_Of_Variables>& counts,
+	std::array<MPI_Datatype, Max_Number_Of_Variables>& datatypes
+) {
+	if (nr_of_variables == 0) {
+
+		// assume NULL won't be dereferenced if count = 0
+		return std::make_tuple((void*) NULL, 0, MPI_BYTE);
+
+	} else if (nr_of_variables == 1) {
+
+		return std::make_tuple(
+			addresses[0],
+			counts[0],
+			datatypes[0]
+		);
+
+	} else if (nr_of_variables <= size_t(std::numeric_limits<int>::max())) {
+
+		// get displacements of variables to transfer
+		std::array<MPI_Aint, Max_Number_Of_Variables> displacements;
+		for (size_t i = 0; i < nr_of_variables; i++) {
+			displacements[i]
+				= static_cast<char*>(addresses[i])
+				- static_cast<char*>(addresses[0]);
+		}
+
+		MPI_Datatype final_datatype = MPI_DATATYPE_NULL;
+		if (
+			MPI_Type_create_struct(
+				int(nr_of_variables),
+				counts.data(),
+				displacements.data(),
+				datatypes.data(),
+				&final_datatype
+			) != MPI_SUCCESS
+		) {
+			return std::make_tuple((void*) NULL, -1, MPI_DATATYPE_NULL);
+		}
+
+		// free user-defined component datatypes
+		for (size_t i = 0; i < nr_of_variables; i++) {
+			if (datatypes[i] == MPI_DATATYPE_NULL) {
+				continue;
+			}
+			int combiner = -1, tmp1 = -1, tmp2 = -1, tmp3 = -1;
+			MPI_Type_get_envelope(datatypes[i], &tmp1, &tmp2, &tmp3, &combiner);
+			if (combiner != MPI_COMBINER_NAMED) {
+				MPI_Type_free(&datatypes[i]);
+			}
+		}
+
+		return std::make_tuple(addresses[0], 1, final_datatype);
+
+	} else {
+
+		return std::make_tuple(
+			(void*) NULL,
+			std::numeric_limits<int>::lowest(),
+			MPI_DATATYPE_NULL
+		);
+
+	}
+}
+
+
 } // namespace detail
 } // namespace gensimcell
 
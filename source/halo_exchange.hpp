@@ -0,0 +1,624 @@
+/*
+Halo exchanges that can run concurrently from several threads.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_HALO_EXCHANGE_HPP
+#define GENSIMCELL_HALO_EXCHANGE_HPP
+
+
+#include "array"
+#include "cstddef"
+#include "limits"
+#include "map"
+#include "mutex"
+#include "tuple"
+#include "type_traits"
+#include "utility"
+#include "vector"
+
+#include "get_var_mpi_datatype.hpp"
+#include "type_support.hpp"
+
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+
+namespace gensimcell {
+
+
+// forward declare Cell type used in Transfer_Set
+template<template<class> class Transfer_Policy, class... Variables> class Cell;
+
+
+/*!
+Returns true if MPI was initialized with MPI_THREAD_MULTIPLE
+in which case different Halo_Exchanges can be started and
+waited for from different threads at the same time.
+*/
+inline bool has_thread_multiple()
+{
+	int provided = MPI_THREAD_SINGLE;
+	if (MPI_Query_thread(&provided) != MPI_SUCCESS) {
+		return false;
+	}
+	return provided == MPI_THREAD_MULTIPLE;
+}
+
+
+/*!
+Variables of given cell type transferred by one Halo_Exchange.
+
+Unlike set_transfer_all() which is shared by all cells of a type
+each exchange has its own transfer set so exchanges of different
+variables of the same cells can be in progress at the same time.
+*/
+template<class Cell_T> class Transfer_Set;
+
+//! See the general version for documentation.
+template<
+	template<class> class Transfer_Policy,
+	class... Variables
+> class Transfer_Set<Cell<Transfer_Policy, Variables...>>
+{
+public:
+
+	Transfer_Set() :
+		transferred(sizeof...(Variables), false)
+	{}
+
+	//! Adds given variables to the set.
+	template<class... Added_Variables> Transfer_Set& add()
+	{
+		int dummy[] = {0, (
+			this->transferred[
+				detail::index_of_variable<Added_Variables, Variables...>::value
+			] = true,
+			0
+		)...};
+		(void)dummy;
+		return *this;
+	}
+
+	//! Removes given variables from the set.
+	template<class... Removed_Variables> Transfer_Set& remove()
+	{
+		int dummy[] = {0, (
+			this->transferred[
+				detail::index_of_variable<Removed_Variables, Variables...>::value
+			] = false,
+			0
+		)...};
+		(void)dummy;
+		return *this;
+	}
+
+	//! Returns true if given variable is in the set.
+	template<class Variable> bool contains() const
+	{
+		return this->transferred[
+			detail::index_of_variable<Variable, Variables...>::value
+		];
+	}
+
+	//! Returns whether each variable is in the set by index in the cell.
+	const std::vector<bool>& get_variables() const
+	{
+		return this->transferred;
+	}
+
+
+private:
+
+	std::vector<bool> transferred;
+};
+
+
+namespace detail {
+
+/*!
+value is true if transfer info of given variable data is
+the same relative to the beginning of every cell, i.e. its
+datatype can be created once and cached. Transfer info of
+e.g. std::vector depends on the vector's size and of nested
+cells on their transfer settings.
+*/
+template<class Data_T> struct Is_Fixed_Transfer :
+	std::integral_constant<
+		bool,
+		std::is_trivially_copyable<Data_T>::value
+		and not is_gensimcell<Data_T>::value
+	>
+{};
+
+//! Returns Is_Fixed_Transfer of each variable of given cell type.
+template<
+	template<class> class Transfer_Policy,
+	class... Variables
+> std::vector<bool> get_fixed_variables(
+	const Cell<Transfer_Policy, Variables...>*
+) {
+	return std::vector<bool>{
+		Is_Fixed_Transfer<typename Variables::data_type>::value...
+	};
+}
+
+
+//! Frees given datatype unless it's a named datatype.
+inline void free_derived_datatype(MPI_Datatype& datatype)
+{
+	if (datatype == MPI_DATATYPE_NULL) {
+		return;
+	}
+	int combiner = -1, tmp1 = -1, tmp2 = -1, tmp3 = -1;
+	MPI_Type_get_envelope(datatype, &tmp1, &tmp2, &tmp3, &combiner);
+	if (combiner != MPI_COMBINER_NAMED) {
+		MPI_Type_free(&datatype);
+	}
+}
+
+
+/*!
+Transfer info of data of one variable of a cell, address
+is relative to the beginning of the cell if fixed is true.
+*/
+struct Variable_Transfer
+{
+	bool fixed;
+	MPI_Aint address;
+	int count;
+	MPI_Datatype datatype;
+};
+
+/*!
+Adds transfer info of given variable of given cell to transfers
+if the variable is in given set, fixed_only selects whether to
+add variables with fixed or other transfer info.
+*/
+template<
+	class Variable,
+	class Cell_T
+> void add_variable_transfer(
+	std::vector<Variable_Transfer>& transfers,
+	const Cell_T& cell,
+	const std::vector<bool>& transferred,
+	const std::size_t index,
+	const bool fixed_only
+) {
+	constexpr bool fixed = Is_Fixed_Transfer<typename Variable::data_type>::value;
+	if (not transferred[index] or fixed != fixed_only) {
+		return;
+	}
+
+	void* address = nullptr;
+	int count = -1;
+	MPI_Datatype datatype = MPI_DATATYPE_NULL;
+	std::tie(address, count, datatype) = get_var_mpi_datatype(cell[Variable()]);
+
+	MPI_Aint absolute_address = 0, cell_address = 0;
+	MPI_Get_address(address, &absolute_address);
+	MPI_Get_address(const_cast<Cell_T*>(&cell), &cell_address);
+
+	transfers.push_back({
+		fixed,
+		fixed ? absolute_address - cell_address : absolute_address,
+		count,
+		datatype
+	});
+}
+
+//! Returns transfer info of variables of given cell in given set.
+template<
+	template<class> class Transfer_Policy,
+	class... Variables
+> std::vector<Variable_Transfer> get_variable_transfers(
+	const Cell<Transfer_Policy, Variables...>& cell,
+	const std::vector<bool>& transferred,
+	const bool fixed_only
+) {
+	std::vector<Variable_Transfer> transfers;
+	std::size_t index = 0;
+	int dummy[] = {0, (
+		add_variable_transfer<Variables>(
+			transfers,
+			cell,
+			transferred,
+			index++,
+			fixed_only
+		),
+		0
+	)...};
+	(void)dummy;
+	return transfers;
+}
+
+
+/*!
+Returns committed datatype of variables with fixed transfer info
+in given set relative to the beginning of a cell of given type,
+MPI_DATATYPE_NULL if there are no such variables or on error.
+
+Datatypes are created once for each set and cached until the
+end of the program, the cache can be used from several threads.
+Returned datatypes must not be freed.
+*/
+template<class Cell_T> MPI_Datatype get_cached_datatype(
+	const std::vector<bool>& transferred
+) {
+	static std::mutex mutex;
+	static std::map<std::vector<bool>, MPI_Datatype> cache;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	const auto cached = cache.find(transferred);
+	if (cached != cache.end()) {
+		return cached->second;
+	}
+
+	const Cell_T cell{};
+	auto transfers = get_variable_transfers(cell, transferred, true);
+
+	MPI_Datatype datatype = MPI_DATATYPE_NULL;
+	if (transfers.size() > 0) {
+		std::vector<int> counts;
+		std::vector<MPI_Aint> displacements;
+		std::vector<MPI_Datatype> datatypes;
+		for (const auto& transfer: transfers) {
+			counts.push_back(transfer.count);
+			displacements.push_back(transfer.address);
+			datatypes.push_back(transfer.datatype);
+		}
+		if (
+			MPI_Type_create_struct(
+				int(transfers.size()),
+				counts.data(),
+				displacements.data(),
+				datatypes.data(),
+				&datatype
+			) != MPI_SUCCESS
+			or MPI_Type_commit(&datatype) != MPI_SUCCESS
+		) {
+			datatype = MPI_DATATYPE_NULL;
+		}
+		for (auto& transfer: transfers) {
+			free_derived_datatype(transfer.datatype);
+		}
+	}
+
+	// don't cache failures
+	if (transfers.size() == 0 or datatype != MPI_DATATYPE_NULL) {
+		cache[transferred] = datatype;
+	}
+	return datatype;
+}
+
+
+/*!
+Creates committed datatype relative to MPI_BOTTOM of data in
+given set of given cells, MPI_DATATYPE_NULL if there's no data.
+Returns false on error.
+*/
+template<class Cell_T> bool create_cells_datatype(
+	const std::vector<Cell_T*>& cells,
+	const std::vector<bool>& transferred,
+	MPI_Datatype& datatype
+) {
+	datatype = MPI_DATATYPE_NULL;
+
+	// cache datatypes by fixed variables only
+	auto fixed_variables = get_fixed_variables(static_cast<const Cell_T*>(nullptr));
+	bool has_fixed = false, has_other = false;
+	for (std::size_t i = 0; i < transferred.size(); i++) {
+		if (not transferred[i]) {
+			fixed_variables[i] = false;
+		} else if (fixed_variables[i]) {
+			has_fixed = true;
+		} else {
+			has_other = true;
+		}
+	}
+
+	MPI_Datatype fixed_datatype = MPI_DATATYPE_NULL;
+	if (has_fixed) {
+		fixed_datatype = get_cached_datatype<Cell_T>(fixed_variables);
+		if (fixed_datatype == MPI_DATATYPE_NULL) {
+			return false;
+		}
+	}
+
+	std::vector<int> counts;
+	std::vector<MPI_Aint> addresses;
+	std::vector<MPI_Datatype> datatypes;
+	counts.reserve(cells.size());
+	addresses.reserve(cells.size());
+	datatypes.reserve(cells.size());
+
+	bool success = true;
+	for (const auto* const cell: cells) {
+		if (has_fixed) {
+			MPI_Aint address = 0;
+			MPI_Get_address(const_cast<Cell_T*>(cell), &address);
+			counts.push_back(1);
+			addresses.push_back(address);
+			datatypes.push_back(fixed_datatype);
+		}
+		if (not has_other) {
+			continue;
+		}
+		for (const auto& transfer: get_variable_transfers(*cell, transferred, false)) {
+			if (transfer.count < 0) {
+				success = false;
+			}
+			counts.push_back(transfer.count);
+			addresses.push_back(transfer.address);
+			datatypes.push_back(transfer.datatype);
+		}
+	}
+
+	if (
+		success
+		and counts.size() > std::size_t(std::numeric_limits<int>::max())
+	) {
+		success = false;
+	}
+
+	if (success and counts.size() > 0) {
+		if (
+			MPI_Type_create_struct(
+				int(counts.size()),
+				counts.data(),
+				addresses.data(),
+				datatypes.data(),
+				&datatype
+			) != MPI_SUCCESS
+			or MPI_Type_commit(&datatype) != MPI_SUCCESS
+		) {
+			datatype = MPI_DATATYPE_NULL;
+			success = false;
+		}
+	}
+
+	// cached datatype is freed at the end of the program
+	for (auto& item: datatypes) {
+		if (item != fixed_datatype) {
+			free_derived_datatype(item);
+		}
+	}
+
+	return success;
+}
+
+} // namespace detail
+
+
+/*!
+Updates copies of cells of other processes with data of given
+variables, independently of other exchanges of the same cells.
+
+Each exchange has its own duplicate of the communicator and its
+own message tag so messages of different exchanges can't be
+mixed. If MPI was initialized with MPI_THREAD_MULTIPLE, see
+has_thread_multiple(), different exchanges can be started and
+waited for at the same time from different threads, e.g. by
+tasks of each physics module. One exchange must not be used
+from several threads at the same time.
+
+Variables are given to start() instead of set_transfer_all() so
+exchanges don't modify and aren't affected by transfer settings
+shared by all cells. Cells of each process are transferred with
+one message in each direction, fixed size data of cells is
+described by datatypes cached for each set of variables.
+
+Example exchanging game of life and advection variables
+concurrently from two threads:
+@code
+gensimcell::Halo_Exchange<Cell> gol_exchange(comm, send, receive);
+gensimcell::Halo_Exchange<Cell> advection_exchange(comm, send, receive);
+...
+auto gol = std::async(std::launch::async, [&](){
+	gol_exchange.start<Is_Alive>();
+	...
+	gol_exchange.wait();
+});
+advection_exchange.start<Density, Velocity>();
+...
+advection_exchange.wait();
+gol.wait();
+@endcode
+*/
+template<class Cell_T> class Halo_Exchange
+{
+public:
+
+	/*!
+	Creates an exchange that sends data of send_cells[process]
+	to given processes and receives data from given processes to
+	receive_cells[process].
+
+	Cells received from a process must be in the same order as
+	that process sends them. Collective over comm, exchanges must
+	be created in the same order on all processes because comm is
+	duplicated. Receiving cells with variable length data, e.g.
+	std::vector, must be resized before starting an exchange.
+	*/
+	Halo_Exchange(
+		MPI_Comm comm,
+		std::map<int, std::vector<Cell_T*>> given_send_cells,
+		std::map<int, std::vector<Cell_T*>> given_receive_cells,
+		const int given_tag = 0
+	) :
+		send_cells(std::move(given_send_cells)),
+		receive_cells(std::move(given_receive_cells)),
+		tag(given_tag)
+	{
+		if (MPI_Comm_dup(comm, &this->comm) != MPI_SUCCESS) {
+			this->comm = MPI_COMM_NULL;
+		}
+	}
+
+	Halo_Exchange(const Halo_Exchange&) = delete;
+	Halo_Exchange& operator=(const Halo_Exchange&) = delete;
+
+	~Halo_Exchange()
+	{
+		int finalized = 0;
+		MPI_Finalized(&finalized);
+		if (finalized != 0) {
+			return;
+		}
+		this->wait();
+		if (this->comm != MPI_COMM_NULL) {
+			MPI_Comm_free(&this->comm);
+		}
+	}
+
+
+	/*!
+	Starts sending and receiving data of variables in given set.
+
+	Returns false if an exchange is already in progress or on
+	error, in which case transfers that were already started are
+	waited for.
+	*/
+	bool start(const Transfer_Set<Cell_T>& variables)
+	{
+		if (this->comm == MPI_COMM_NULL or this->active) {
+			return false;
+		}
+		this->active = true;
+
+		const auto& transferred = variables.get_variables();
+		bool success = true;
+		for (int receive = 1; receive >= 0; receive--) {
+			for (const auto& item: receive ? this->receive_cells : this->send_cells) {
+				MPI_Datatype datatype = MPI_DATATYPE_NULL;
+				if (not detail::create_cells_datatype(item.second, transferred, datatype)) {
+					success = false;
+					break;
+				}
+				if (datatype == MPI_DATATYPE_NULL) {
+					continue;
+				}
+				this->datatypes.push_back(datatype);
+
+				this->requests.push_back(MPI_REQUEST_NULL);
+				const int result
+					= receive
+					? MPI_Irecv(
+						MPI_BOTTOM, 1, datatype, item.first,
+						this->tag, this->comm, &this->requests.back()
+					)
+					: MPI_Isend(
+						MPI_BOTTOM, 1, datatype, item.first,
+						this->tag, this->comm, &this->requests.back()
+					);
+				if (result != MPI_SUCCESS) {
+					this->requests.pop_back();
+					success = false;
+					break;
+				}
+			}
+			if (not success) {
+				break;
+			}
+		}
+
+		if (not success) {
+			this->wait();
+		}
+		return success;
+	}
+
+	//! Starts exchange of given variables, see the other version.
+	template<class... Variables> bool start()
+	{
+		Transfer_Set<Cell_T> variables;
+		variables.template add<Variables...>();
+		return this->start(variables);
+	}
+
+
+	/*!
+	Waits until data of this process has been sent
+	and received. Returns false on error, true if no
+	exchange is in progress.
+	*/
+	bool wait()
+	{
+		bool success = true;
+		if (
+			this->requests.size() > 0
+			and MPI_Waitall(
+				int(this->requests.size()),
+				this->requests.data(),
+				MPI_STATUSES_IGNORE
+			) != MPI_SUCCESS
+		) {
+			success = false;
+		}
+		this->requests.clear();
+		this->active = false;
+
+		for (auto& datatype: this->datatypes) {
+			MPI_Type_free(&datatype);
+		}
+		this->datatypes.clear();
+
+		return success;
+	}
+
+
+	//! Returns true if an exchange has been started but not waited for.
+	bool is_active() const
+	{
+		return this->active;
+	}
+
+	//! Returns the communicator used by this exchange.
+	MPI_Comm get_comm() const
+	{
+		return this->comm;
+	}
+
+
+private:
+
+	MPI_Comm comm = MPI_COMM_NULL;
+	std::map<int, std::vector<Cell_T*>> send_cells, receive_cells;
+	int tag;
+	bool active = false;
+	std::vector<MPI_Request> requests;
+	std::vector<MPI_Datatype> datatypes;
+};
+
+
+} // namespace gensimcell
+
+#endif // ifdef MPI_VERSION
+
+#endif // ifndef GENSIMCELL_HALO_EXCHANGE_HPP
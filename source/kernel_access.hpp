@@ -0,0 +1,482 @@
+/*
+Compile time annotations of variables accessed by kernels.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_KERNEL_ACCESS_HPP
+#define GENSIMCELL_KERNEL_ACCESS_HPP
+
+
+#include "array"
+#include "cstddef"
+#include "type_traits"
+#include "vector"
+
+#include "gensimcell_transfer_policy.hpp"
+#include "task_graph.hpp"
+#include "type_support.hpp"
+
+
+namespace gensimcell {
+
+
+// forward declare Cell type used in Halo_Tracker
+template<template<class> class Transfer_Policy, class... Variables> class Cell;
+
+
+namespace detail {
+
+//! Compile time list of variables.
+template<class... Variables> struct Variable_List {};
+
+//! type is void for any given type.
+template<class> struct Always_Void
+{
+	using type = void;
+};
+
+/*!
+True for Optional_Transfer, the only transfer
+policy whose transfers can be switched.
+*/
+template<template<class> class Transfer_Policy> struct Is_Optional_Transfer :
+	std::false_type
+{};
+
+//! See the general version for documentation.
+template<> struct Is_Optional_Transfer<Optional_Transfer> :
+	std::true_type
+{};
+
+} // namespace detail
+
+
+/*!
+Declares that a kernel reads given variables from the cells it
+processes and from their neighbors, so remote copies of outer
+cells must be up to date before the kernel runs.
+
+A kernel is annotated by deriving it, or a tag class describing
+it, from at most one of each of Reads, Reads_Own and Writes:
+@code
+struct GoL_Solve :
+	gensimcell::Reads<Is_Alive>,
+	gensimcell::Writes<Live_Neighbors>
+{};
+struct GoL_Apply :
+	gensimcell::Reads_Own<Live_Neighbors>,
+	gensimcell::Writes<Is_Alive>
+{};
+@endcode
+*/
+template<class... Variables> struct Reads
+{
+	using neighbor_reads = detail::Variable_List<Variables...>;
+};
+
+/*!
+Declares that a kernel reads given variables only from the
+cells it processes, which never requires an exchange.
+*/
+template<class... Variables> struct Reads_Own
+{
+	using own_reads = detail::Variable_List<Variables...>;
+};
+
+//! Declares that a kernel writes given variables in the cells it processes.
+template<class... Variables> struct Writes
+{
+	using writes = detail::Variable_List<Variables...>;
+};
+
+
+namespace detail {
+
+/*!
+type is the Variable_List of variables that
+given kernel reads from neighbors, if any.
+*/
+template<class Kernel, class Enable = void> struct Neighbor_Reads
+{
+	using type = Variable_List<>;
+};
+
+//! See the general version for documentation.
+template<class Kernel> struct Neighbor_Reads<
+	Kernel,
+	typename Always_Void<typename Kernel::neighbor_reads>::type
+> {
+	using type = typename Kernel::neighbor_reads;
+};
+
+//! Variables that given kernel reads only from its own cells.
+template<class Kernel, class Enable = void> struct Own_Reads
+{
+	using type = Variable_List<>;
+};
+
+//! See the general version for documentation.
+template<class Kernel> struct Own_Reads<
+	Kernel,
+	typename Always_Void<typename Kernel::own_reads>::type
+> {
+	using type = typename Kernel::own_reads;
+};
+
+//! Variables that given kernel writes.
+template<class Kernel, class Enable = void> struct Kernel_Writes
+{
+	using type = Variable_List<>;
+};
+
+//! See the general version for documentation.
+template<class Kernel> struct Kernel_Writes<
+	Kernel,
+	typename Always_Void<typename Kernel::writes>::type
+> {
+	using type = typename Kernel::writes;
+};
+
+
+//! Returns accesses of given variables for Task_Graph.
+template<class... Variables> std::vector<Variable_Access> get_list_accesses(
+	const Variable_List<Variables...>&,
+	const Cell_Set cells,
+	const bool write
+) {
+	// unused if there are no variables
+	(void)cells;
+	(void)write;
+	return std::vector<Variable_Access>{
+		Variable_Access{std::type_index(typeid(Variables)), cells, write}...
+	};
+}
+
+} // namespace detail
+
+
+/*!
+Returns accesses of kernel annotated with Reads, Reads_Own
+and Writes when it processes given cells, for Task_Graph.
+
+Neighbors of inner cells are inner or outer cells and
+neighbors of outer cells can be in any set of cells.
+@code
+graph.add_task(
+	gensimcell::get_accesses<GoL_Solve>(gensimcell::Cell_Set::inner),
+	[&](){ gol::solve<...>(inner_cells, grid); }
+);
+@endcode
+*/
+template<class Kernel> std::vector<Variable_Access> get_accesses(
+	const Cell_Set cells
+) {
+	Cell_Set neighbor_cells = cells;
+	if ((cells & Cell_Set::inner) != Cell_Set::none) {
+		neighbor_cells = neighbor_cells | Cell_Set::outer;
+	}
+	if ((cells & (Cell_Set::outer | Cell_Set::remote)) != Cell_Set::none) {
+		neighbor_cells = Cell_Set::all;
+	}
+
+	return
+		detail::get_list_accesses(
+			typename detail::Neighbor_Reads<Kernel>::type(),
+			neighbor_cells,
+			false
+		)
+		+ detail::get_list_accesses(
+			typename detail::Own_Reads<Kernel>::type(),
+			cells,
+			false
+		)
+		+ detail::get_list_accesses(
+			typename detail::Kernel_Writes<Kernel>::type(),
+			cells,
+			true
+		);
+}
+
+
+/*!
+Keeps track of which variables of given cell type have been
+written since remote copies of outer cells were last updated
+and decides from Reads annotations of kernels which variables
+must be transferred before they run.
+
+Replaces switching transfers of variables on and off by hand
+around each update of remote neighbors, e.g. in dccrg:
+@code
+gensimcell::Halo_Tracker<Cell> halo;
+...
+halo.written<GoL_Apply>(gensimcell::Cell_Set::outer);
+if (halo.prepare_exchange<GoL_Solve>()) {
+	grid.start_remote_neighbor_copy_updates();
+	...
+	grid.wait_remote_neighbor_copy_updates();
+	halo.finish_exchange();
+}
+@endcode
+Remote copies of all variables are initially
+considered out of date. Transfers are switched
+with set_transfer_all() so they affect all cells.
+With Always_Transfer and Never_Transfer transfers
+can't be switched and are left as they are.
+*/
+template<class Cell_T> class Halo_Tracker;
+
+//! See the general version for documentation.
+template<
+	template<class> class Transfer_Policy,
+	class... Variables
+> class Halo_Tracker<Cell<Transfer_Policy, Variables...>>
+{
+public:
+
+	using Cell_T = Cell<Transfer_Policy, Variables...>;
+
+
+	Halo_Tracker()
+	{
+		this->write_version.fill(1);
+		this->exchanged_version.fill(0);
+		this->transferred_version.fill(0);
+		this->transferred.fill(false);
+	}
+
+
+	/*!
+	Records that a kernel annotated with Writes has
+	written its variables in given cells.
+
+	Writes to inner cells don't make remote copies out of
+	date. Variables can be written while remote copies are
+	updated as long as outer cells aren't, e.g. by
+	kernels processing only inner cells.
+	*/
+	template<class Kernel> void written(const Cell_Set cells = Cell_Set::all)
+	{
+		this->set_written(typename detail::Kernel_Writes<Kernel>::type(), cells);
+	}
+
+	/*!
+	Records that given variables have been written in given
+	cells by code without annotations, e.g. initialization.
+	*/
+	template<class... Written_Variables> void variables_written(
+		const Cell_Set cells = Cell_Set::all
+	) {
+		this->set_written(detail::Variable_List<Written_Variables...>(), cells);
+	}
+
+
+	/*!
+	Returns true if any variable that given kernels read from
+	neighbors has been written since remote copies of it
+	were last updated, false otherwise.
+	*/
+	template<class... Kernels> bool needs_exchange() const
+	{
+		std::array<bool, sizeof...(Variables) + 1> needed;
+		needed.fill(false);
+		int dummy[] = {0, (
+			this->add_needed(needed, typename detail::Neighbor_Reads<Kernels>::type()),
+			0
+		)...};
+		(void)dummy;
+
+		for (const auto variable_needed: needed) {
+			if (variable_needed) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+	/*!
+	Switches on the transfer of out of date variables that
+	given kernels read from neighbors and switches off the
+	transfer of all other variables.
+
+	Returns true if at least one variable must be transferred,
+	in which case the caller must update remote copies and call
+	finish_exchange(), false if no update is needed.
+	*/
+	template<class... Kernels> bool prepare_exchange()
+	{
+		this->transferred.fill(false);
+		int dummy[] = {0, (
+			this->add_needed(
+				this->transferred,
+				typename detail::Neighbor_Reads<Kernels>::type()
+			),
+			0
+		)...};
+		(void)dummy;
+
+		bool needed = false;
+		for (std::size_t i = 0; i < sizeof...(Variables); i++) {
+			this->transferred_version[i] = this->write_version[i];
+			needed = needed or this->transferred[i];
+		}
+
+		this->switch_transfers(Variables()...);
+		return needed;
+	}
+
+
+	/*!
+	Records that remote copies of variables switched on by
+	the latest prepare_exchange() have been updated and
+	switches off their transfer.
+	*/
+	void finish_exchange()
+	{
+		for (std::size_t i = 0; i < sizeof...(Variables); i++) {
+			if (this->transferred[i]) {
+				this->exchanged_version[i] = this->transferred_version[i];
+			}
+		}
+		this->transferred.fill(false);
+		this->switch_transfers(Variables()...);
+	}
+
+
+	/*!
+	Returns true if given variable has been written
+	since remote copies of it were last updated.
+	*/
+	template<class Variable> bool is_out_of_date() const
+	{
+		constexpr std::size_t index
+			= detail::index_of_variable<Variable, Variables...>::value;
+		return this->exchanged_version[index] != this->write_version[index];
+	}
+
+	/*!
+	Returns true if transfer of given variable was
+	switched on by the latest prepare_exchange().
+	*/
+	template<class Variable> bool is_transferred() const
+	{
+		return this->transferred[
+			detail::index_of_variable<Variable, Variables...>::value
+		];
+	}
+
+
+private:
+
+	/*
+	Writes of outer cells increase the version of a variable,
+	remote copies are up to date if they have the same version.
+	Last items are unused so that arrays aren't empty.
+	*/
+	std::array<std::size_t, sizeof...(Variables) + 1>
+		write_version,
+		exchanged_version,
+		transferred_version;
+	std::array<bool, sizeof...(Variables) + 1> transferred;
+
+
+	template<class... Written_Variables> void set_written(
+		const detail::Variable_List<Written_Variables...>&,
+		const Cell_Set cells
+	) {
+		if ((cells & (Cell_Set::outer | Cell_Set::remote)) == Cell_Set::none) {
+			return;
+		}
+		int dummy[] = {0, (
+			this->write_version[
+				detail::index_of_variable<Written_Variables, Variables...>::value
+			]++,
+			0
+		)...};
+		(void)dummy;
+	}
+
+	//! Marks out of date variables of given list as needed.
+	template<class... Read_Variables> void add_needed(
+		std::array<bool, sizeof...(Variables) + 1>& needed,
+		const detail::Variable_List<Read_Variables...>&
+	) const {
+		int dummy[] = {0, (
+			needed[
+				detail::index_of_variable<Read_Variables, Variables...>::value
+			] = needed[
+				detail::index_of_variable<Read_Variables, Variables...>::value
+			] or this->template is_out_of_date<Read_Variables>(),
+			0
+		)...};
+		(void)dummy;
+	}
+
+	//! Sets transfer of each variable of the cell from transferred.
+	template<class... Given_Variables> void switch_transfers(
+		const Given_Variables&... variables
+	) const {
+		this->set_transfers(
+			detail::Is_Optional_Transfer<Transfer_Policy>(),
+			variables...
+		);
+	}
+
+	//! Leaves transfers of other policies as they are.
+	template<class... Given_Variables> void set_transfers(
+		const std::false_type,
+		const Given_Variables&...
+	) const {}
+
+	//! Switches transfers of Optional_Transfer cells.
+	template<class... Given_Variables> void set_transfers(
+		const std::true_type,
+		const Given_Variables&...
+	) const {
+		#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+		int dummy[] = {0, (
+			Cell_T::set_transfer_all(
+				this->transferred[
+					detail::index_of_variable<Given_Variables, Variables...>::value
+				],
+				Given_Variables()
+			),
+			0
+		)...};
+		(void)dummy;
+		#endif
+	}
+};
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_KERNEL_ACCESS_HPP
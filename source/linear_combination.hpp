@@ -0,0 +1,790 @@
+/*
+Fused linear combinations of variables of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_LINEAR_COMBINATION_HPP
+#define GENSIMCELL_LINEAR_COMBINATION_HPP
+
+
+#include "array"
+#include "cassert"
+#include "cstddef"
+#include "type_traits"
+#include "utility"
+#include "vector"
+
+#include "range_operators.hpp"
+#include "type_support.hpp"
+
+
+namespace gensimcell {
+
+
+// forward declare Cell type used in nested cells
+template<template<class> class Transfer_Policy, class... Variables> class Cell;
+
+
+namespace detail {
+
+
+// forward declarations to support nested containers
+template <
+	class Y_T, class Scalar_T, class X_T
+> void variable_axpy(Y_T&, const Scalar_T&, const X_T&);
+
+template <
+	class Y_T, class X_T, std::size_t Number_Of_Items, class Scalar_T
+> void variable_axpy(
+	std::array<Y_T, Number_Of_Items>&,
+	const Scalar_T&,
+	const std::array<X_T, Number_Of_Items>&
+);
+
+template <
+	class Y_T, class X_T, class Scalar_T
+> void variable_axpy(
+	std::vector<Y_T>&,
+	const Scalar_T&,
+	const std::vector<X_T>&
+);
+
+template <
+	class Y1_T, class Y2_T, class X1_T, class X2_T, class Scalar_T
+> void variable_axpy(
+	std::pair<Y1_T, Y2_T>&,
+	const Scalar_T&,
+	const std::pair<X1_T, X2_T>&
+);
+
+template <
+	template<class> class Transfer_Policy, class... Variables, class Scalar_T
+> void variable_axpy(
+	Cell<Transfer_Policy, Variables...>&,
+	const Scalar_T&,
+	const Cell<Transfer_Policy, Variables...>&
+);
+
+
+template <
+	class Y_T, class Scalar_T, class X_T
+> void variable_axpby(Y_T&, const Scalar_T&, const X_T&, const Scalar_T&);
+
+template <
+	class Y_T, class X_T, std::size_t Number_Of_Items, class Scalar_T
+> void variable_axpby(
+	std::array<Y_T, Number_Of_Items>&,
+	const Scalar_T&,
+	const std::array<X_T, Number_Of_Items>&,
+	const Scalar_T&
+);
+
+template <
+	class Y_T, class X_T, class Scalar_T
+> void variable_axpby(
+	std::vector<Y_T>&,
+	const Scalar_T&,
+	const std::vector<X_T>&,
+	const Scalar_T&
+);
+
+template <
+	class Y1_T, class Y2_T, class X1_T, class X2_T, class Scalar_T
+> void variable_axpby(
+	std::pair<Y1_T, Y2_T>&,
+	const Scalar_T&,
+	const std::pair<X1_T, X2_T>&,
+	const Scalar_T&
+);
+
+template <
+	template<class> class Transfer_Policy, class... Variables, class Scalar_T
+> void variable_axpby(
+	Cell<Transfer_Policy, Variables...>&,
+	const Scalar_T&,
+	const Cell<Transfer_Policy, Variables...>&,
+	const Scalar_T&
+);
+
+
+template <
+	class Y_T, class Scalar_T, class X_T, class Z_T
+> void variable_lincomb(
+	Y_T&,
+	const Scalar_T&,
+	const X_T&,
+	const Scalar_T&,
+	const Z_T&
+);
+
+template <
+	class Y_T, class X_T, class Z_T, std::size_t Number_Of_Items, class Scalar_T
+> void variable_lincomb(
+	std::array<Y_T, Number_Of_Items>&,
+	const Scalar_T&,
+	const std::array<X_T, Number_Of_Items>&,
+	const Scalar_T&,
+	const std::array<Z_T, Number_Of_Items>&
+);
+
+template <
+	class Y_T, class X_T, class Z_T, class Scalar_T
+> void variable_lincomb(
+	std::vector<Y_T>&,
+	const Scalar_T&,
+	const std::vector<X_T>&,
+	const Scalar_T&,
+	const std::vector<Z_T>&
+);
+
+template <
+	class Y1_T, class Y2_T,
+	class X1_T, class X2_T,
+	class Z1_T, class Z2_T,
+	class Scalar_T
+> void variable_lincomb(
+	std::pair<Y1_T, Y2_T>&,
+	const Scalar_T&,
+	const std::pair<X1_T, X2_T>&,
+	const Scalar_T&,
+	const std::pair<Z1_T, Z2_T>&
+);
+
+template <
+	template<class> class Transfer_Policy, class... Variables, class Scalar_T
+> void variable_lincomb(
+	Cell<Transfer_Policy, Variables...>&,
+	const Scalar_T&,
+	const Cell<Transfer_Policy, Variables...>&,
+	const Scalar_T&,
+	const Cell<Transfer_Policy, Variables...>&
+);
+
+
+
+/*!
+Does y += a * x for the data of one variable.
+
+By default the operation is applied directly to the data.
+Versions for std::array, std::vector, std::pair and generic
+cells process their items one by one without temporaries.
+Vectors must have equal sizes, which is checked with assert().
+Eigen matrices use the default version which Eigen
+evaluates in one pass without temporaries.
+*/
+template <
+	class Y_T, class Scalar_T, class X_T
+> void variable_axpy(Y_T& y, const Scalar_T& a, const X_T& x)
+{
+	y += a * x;
+}
+
+template <
+	class Y_T, class X_T, std::size_t Number_Of_Items, class Scalar_T
+> void variable_axpy(
+	std::array<Y_T, Number_Of_Items>& y,
+	const Scalar_T& a,
+	const std::array<X_T, Number_Of_Items>& x
+) {
+	Y_T* const y_data = y.data();
+	const X_T* const x_data = x.data();
+	for (std::size_t i = 0; i < Number_Of_Items; i++) {
+		variable_axpy(y_data[i], a, x_data[i]);
+	}
+}
+
+template <
+	class Y_T, class X_T, class Scalar_T
+> void variable_axpy(
+	std::vector<Y_T>& y,
+	const Scalar_T& a,
+	const std::vector<X_T>& x
+) {
+	assert(y.size() == x.size());
+	Y_T* const y_data = y.data();
+	const X_T* const x_data = x.data();
+	// don't read past x if assert is disabled
+	const std::size_t size = y.size() < x.size() ? y.size() : x.size();
+	for (std::size_t i = 0; i < size; i++) {
+		variable_axpy(y_data[i], a, x_data[i]);
+	}
+}
+
+template <
+	class Y1_T, class Y2_T, class X1_T, class X2_T, class Scalar_T
+> void variable_axpy(
+	std::pair<Y1_T, Y2_T>& y,
+	const Scalar_T& a,
+	const std::pair<X1_T, X2_T>& x
+) {
+	variable_axpy(y.first, a, x.first);
+	variable_axpy(y.second, a, x.second);
+}
+
+//! Applies the operation to all variables of a nested cell
+template <
+	template<class> class Transfer_Policy, class... Variables, class Scalar_T
+> void variable_axpy(
+	Cell<Transfer_Policy, Variables...>& y,
+	const Scalar_T& a,
+	const Cell<Transfer_Policy, Variables...>& x
+) {
+	const int dummy[] = {
+		0,
+		(variable_axpy(y[Variables()], a, x[Variables()]), 0)...
+	};
+	(void) dummy;
+}
+
+
+/*!
+Does y = a * x + b * y for the data of one variable.
+
+See variable_axpy() for details.
+*/
+template <
+	class Y_T, class Scalar_T, class X_T
+> void variable_axpby(Y_T& y, const Scalar_T& a, const X_T& x, const Scalar_T& b)
+{
+	y = a * x + b * y;
+}
+
+template <
+	class Y_T, class X_T, std::size_t Number_Of_Items, class Scalar_T
+> void variable_axpby(
+	std::array<Y_T, Number_Of_Items>& y,
+	const Scalar_T& a,
+	const std::array<X_T, Number_Of_Items>& x,
+	const Scalar_T& b
+) {
+	Y_T* const y_data = y.data();
+	const X_T* const x_data = x.data();
+	for (std::size_t i = 0; i < Number_Of_Items; i++) {
+		variable_axpby(y_data[i], a, x_data[i], b);
+	}
+}
+
+template <
+	class Y_T, class X_T, class Scalar_T
+> void variable_axpby(
+	std::vector<Y_T>& y,
+	const Scalar_T& a,
+	const std::vector<X_T>& x,
+	const Scalar_T& b
+) {
+	assert(y.size() == x.size());
+	Y_T* const y_data = y.data();
+	const X_T* const x_data = x.data();
+	// don't read past x if assert is disabled
+	const std::size_t size = y.size() < x.size() ? y.size() : x.size();
+	for (std::size_t i = 0; i < size; i++) {
+		variable_axpby(y_data[i], a, x_data[i], b);
+	}
+}
+
+template <
+	class Y1_T, class Y2_T, class X1_T, class X2_T, class Scalar_T
+> void variable_axpby(
+	std::pair<Y1_T, Y2_T>& y,
+	const Scalar_T& a,
+	const std::pair<X1_T, X2_T>& x,
+	const Scalar_T& b
+) {
+	variable_axpby(y.first, a, x.first, b);
+	variable_axpby(y.second, a, x.second, b);
+}
+
+template <
+	template<class> class Transfer_Policy, class... Variables, class Scalar_T
+> void variable_axpby(
+	Cell<Transfer_Policy, Variables...>& y,
+	const Scalar_T& a,
+	const Cell<Transfer_Policy, Variables...>& x,
+	const Scalar_T& b
+) {
+	const int dummy[] = {
+		0,
+		(variable_axpby(y[Variables()], a, x[Variables()], b), 0)...
+	};
+	(void) dummy;
+}
+
+
+/*!
+Does y = a * x + b * z for the data of one variable.
+
+Vectors in x and z must have equal sizes, which is checked
+with assert(), and vectors in y are resized to their size like
+in assignment. See variable_axpy() for details.
+*/
+template <
+	class Y_T, class Scalar_T, class X_T, class Z_T
+> void variable_lincomb(
+	Y_T& y,
+	const Scalar_T& a,
+	const X_T& x,
+	const Scalar_T& b,
+	const Z_T& z
+) {
+	y = a * x + b * z;
+}
+
+template <
+	class Y_T, class X_T, class Z_T, std::size_t Number_Of_Items, class Scalar_T
+> void variable_lincomb(
+	std::array<Y_T, Number_Of_Items>& y,
+	const Scalar_T& a,
+	const std::array<X_T, Number_Of_Items>& x,
+	const Scalar_T& b,
+	const std::array<Z_T, Number_Of_Items>& z
+) {
+	Y_T* const y_data = y.data();
+	const X_T* const x_data = x.data();
+	const Z_T* const z_data = z.data();
+	for (std::size_t i = 0; i < Number_Of_Items; i++) {
+		variable_lincomb(y_data[i], a, x_data[i], b, z_data[i]);
+	}
+}
+
+template <
+	class Y_T, class X_T, class Z_T, class Scalar_T
+> void variable_lincomb(
+	std::vector<Y_T>& y,
+	const Scalar_T& a,
+	const std::vector<X_T>& x,
+	const Scalar_T& b,
+	const std::vector<Z_T>& z
+) {
+	assert(x.size() == z.size());
+	// don't read past x or z if assert is disabled
+	const std::size_t size = x.size() < z.size() ? x.size() : z.size();
+	y.resize(size);
+
+	Y_T* const y_data = y.data();
+	const X_T* const x_data = x.data();
+	const Z_T* const z_data = z.data();
+	for (std::size_t i = 0; i < size; i++) {
+		variable_lincomb(y_data[i], a, x_data[i], b, z_data[i]);
+	}
+}
+
+template <
+	class Y1_T, class Y2_T,
+	class X1_T, class X2_T,
+	class Z1_T, class Z2_T,
+	class Scalar_T
+> void variable_lincomb(
+	std::pair<Y1_T, Y2_T>& y,
+	const Scalar_T& a,
+	const std::pair<X1_T, X2_T>& x,
+	const Scalar_T& b,
+	const std::pair<Z1_T, Z2_T>& z
+) {
+	variable_lincomb(y.first, a, x.first, b, z.first);
+	variable_lincomb(y.second, a, x.second, b, z.second);
+}
+
+template <
+	template<class> class Transfer_Policy, class... Variables, class Scalar_T
+> void variable_lincomb(
+	Cell<Transfer_Policy, Variables...>& y,
+	const Scalar_T& a,
+	const Cell<Transfer_Policy, Variables...>& x,
+	const Scalar_T& b,
+	const Cell<Transfer_Policy, Variables...>& z
+) {
+	const int dummy[] = {
+		0,
+		(
+			variable_lincomb(
+				y[Variables()],
+				a,
+				x[Variables()],
+				b,
+				z[Variables()]
+			),
+			0
+		)...
+	};
+	(void) dummy;
+}
+
+
+/*!
+Functions that process given cells of ranges for each given variable.
+
+See the range version of axpy() for details.
+*/
+template <
+	class Range_T, class Scalar_T
+> void axpy_block(
+	Range_T&,
+	const Scalar_T&,
+	const Range_T&,
+	const std::size_t,
+	const std::size_t
+) {}
+
+template <
+	class Range_T,
+	class Scalar_T,
+	class First_Variable,
+	class... Rest_Of_Variables
+> void axpy_block(
+	Range_T& y,
+	const Scalar_T& a,
+	const Range_T& x,
+	const std::size_t begin,
+	const std::size_t end,
+	const First_Variable& first_variable,
+	const Rest_Of_Variables&... rest_of_variables
+) {
+	for (std::size_t i = begin; i < end; i++) {
+		variable_axpy(y[i][first_variable], a, x[i][first_variable]);
+	}
+	axpy_block(y, a, x, begin, end, rest_of_variables...);
+}
+
+template <
+	class Range_T, class Scalar_T
+> void axpby_block(
+	Range_T&,
+	const Scalar_T&,
+	const Range_T&,
+	const Scalar_T&,
+	const std::size_t,
+	const std::size_t
+) {}
+
+template <
+	class Range_T,
+	class Scalar_T,
+	class First_Variable,
+	class... Rest_Of_Variables
+> void axpby_block(
+	Range_T& y,
+	const Scalar_T& a,
+	const Range_T& x,
+	const Scalar_T& b,
+	const std::size_t begin,
+	const std::size_t end,
+	const First_Variable& first_variable,
+	const Rest_Of_Variables&... rest_of_variables
+) {
+	for (std::size_t i = begin; i < end; i++) {
+		variable_axpby(y[i][first_variable], a, x[i][first_variable], b);
+	}
+	axpby_block(y, a, x, b, begin, end, rest_of_variables...);
+}
+
+template <
+	class Range_T, class Scalar_T
+> void lincomb_block(
+	Range_T&,
+	const Scalar_T&,
+	const Range_T&,
+	const Scalar_T&,
+	const Range_T&,
+	const std::size_t,
+	const std::size_t
+) {}
+
+template <
+	class Range_T,
+	class Scalar_T,
+	class First_Variable,
+	class... Rest_Of_Variables
+> void lincomb_block(
+	Range_T& y,
+	const Scalar_T& a,
+	const Range_T& x,
+	const Scalar_T& b,
+	const Range_T& z,
+	const std::size_t begin,
+	const std::size_t end,
+	const First_Variable& first_variable,
+	const Rest_Of_Variables&... rest_of_variables
+) {
+	for (std::size_t i = begin; i < end; i++) {
+		variable_lincomb(
+			y[i][first_variable],
+			a,
+			x[i][first_variable],
+			b,
+			z[i][first_variable]
+		);
+	}
+	lincomb_block(y, a, x, b, z, begin, end, rest_of_variables...);
+}
+
+} // namespace detail
+
+
+
+/*!
+Stops the iteration over variables of axpy().
+
+See the variadic version for documentation.
+*/
+template <
+	class Cell_T,
+	class Scalar_T
+> typename std::enable_if<
+	is_gensimcell<Cell_T>::value or is_gensimcell_range<Cell_T>::value
+>::type axpy(Cell_T&, const Scalar_T&, const Cell_T&) {}
+
+/*!
+Does y[Variable()] += a * x[Variable()] for each given variable.
+
+Each variable is processed in one pass without temporaries,
+e.g. for a std::array variable the operation is done element
+by element. Nested cells are processed recursively.
+Variables not given are not modified.
+
+Example of the first stage of a Runge-Kutta integrator
+where only Density of cell changes:
+@code
+gensimcell::axpy(cell, dt, derivative, Density());
+@endcode
+*/
+template <
+	class Cell_T,
+	class Scalar_T,
+	class First_Variable,
+	class... Rest_Of_Variables
+> typename std::enable_if<
+	is_gensimcell<Cell_T>::value
+>::type axpy(
+	Cell_T& y,
+	const Scalar_T& a,
+	const Cell_T& x,
+	const First_Variable& first_variable,
+	const Rest_Of_Variables&... rest_of_variables
+) {
+	detail::variable_axpy(y[first_variable], a, x[first_variable]);
+	axpy(y, a, x, rest_of_variables...);
+}
+
+/*!
+Does axpy() for each cell in given ranges.
+
+Ranges are containers of cells such as std::vector<Cell> or
+std::array<Cell, N>, cells at the same index in y and x are
+processed together up to the size of the smaller range.
+Variables are processed one at a time over a block of cells,
+i.e. variable-major, so that the loop over cells only
+contains the operation of one variable which the compiler
+can vectorize. See the range versions of cell operators in
+range_operators.hpp for details.
+*/
+template <
+	class Range_T,
+	class Scalar_T,
+	class First_Variable,
+	class... Rest_Of_Variables
+> typename std::enable_if<
+	is_gensimcell_range<Range_T>::value
+>::type axpy(
+	Range_T& y,
+	const Scalar_T& a,
+	const Range_T& x,
+	const First_Variable& first_variable,
+	const Rest_Of_Variables&... rest_of_variables
+) {
+	constexpr std::size_t block_size
+		= detail::get_range_block_size<Range_T>();
+	const std::size_t size = y.size() < x.size() ? y.size() : x.size();
+	for (std::size_t begin = 0; begin < size; begin += block_size) {
+		const std::size_t end
+			= begin + block_size < size
+			? begin + block_size
+			: size;
+		detail::axpy_block(
+			y, a, x,
+			begin, end,
+			first_variable, rest_of_variables...
+		);
+	}
+}
+
+
+//! Stops the iteration over variables of axpby()
+template <
+	class Cell_T,
+	class Scalar_T
+> typename std::enable_if<
+	is_gensimcell<Cell_T>::value or is_gensimcell_range<Cell_T>::value
+>::type axpby(Cell_T&, const Scalar_T&, const Cell_T&, const Scalar_T&) {}
+
+/*!
+Does y[Variable()] = a * x[Variable()] + b * y[Variable()]
+for each given variable.
+
+See axpy() for details.
+*/
+template <
+	class Cell_T,
+	class Scalar_T,
+	class First_Variable,
+	class... Rest_Of_Variables
+> typename std::enable_if<
+	is_gensimcell<Cell_T>::value
+>::type axpby(
+	Cell_T& y,
+	const Scalar_T& a,
+	const Cell_T& x,
+	const Scalar_T& b,
+	const First_Variable& first_variable,
+	const Rest_Of_Variables&... rest_of_variables
+) {
+	detail::variable_axpby(y[first_variable], a, x[first_variable], b);
+	axpby(y, a, x, b, rest_of_variables...);
+}
+
+//! Range version of axpby(), see range version of axpy() for details
+template <
+	class Range_T,
+	class Scalar_T,
+	class First_Variable,
+	class... Rest_Of_Variables
+> typename std::enable_if<
+	is_gensimcell_range<Range_T>::value
+>::type axpby(
+	Range_T& y,
+	const Scalar_T& a,
+	const Range_T& x,
+	const Scalar_T& b,
+	const First_Variable& first_variable,
+	const Rest_Of_Variables&... rest_of_variables
+) {
+	constexpr std::size_t block_size
+		= detail::get_range_block_size<Range_T>();
+	const std::size_t size = y.size() < x.size() ? y.size() : x.size();
+	for (std::size_t begin = 0; begin < size; begin += block_size) {
+		const std::size_t end
+			= begin + block_size < size
+			? begin + block_size
+			: size;
+		detail::axpby_block(
+			y, a, x, b,
+			begin, end,
+			first_variable, rest_of_variables...
+		);
+	}
+}
+
+
+//! Stops the iteration over variables of lincomb()
+template <
+	class Cell_T,
+	class Scalar_T
+> typename std::enable_if<
+	is_gensimcell<Cell_T>::value or is_gensimcell_range<Cell_T>::value
+>::type lincomb(
+	Cell_T&,
+	const Scalar_T&,
+	const Cell_T&,
+	const Scalar_T&,
+	const Cell_T&
+) {}
+
+/*!
+Does y[Variable()] = a * x[Variable()] + b * z[Variable()]
+for each given variable.
+
+y can be the same cell as x or z. See axpy() for details.
+*/
+template <
+	class Cell_T,
+	class Scalar_T,
+	class First_Variable,
+	class... Rest_Of_Variables
+> typename std::enable_if<
+	is_gensimcell<Cell_T>::value
+>::type lincomb(
+	Cell_T& y,
+	const Scalar_T& a,
+	const Cell_T& x,
+	const Scalar_T& b,
+	const Cell_T& z,
+	const First_Variable& first_variable,
+	const Rest_Of_Variables&... rest_of_variables
+) {
+	detail::variable_lincomb(
+		y[first_variable],
+		a,
+		x[first_variable],
+		b,
+		z[first_variable]
+	);
+	lincomb(y, a, x, b, z, rest_of_variables...);
+}
+
+//! Range version of lincomb(), see range version of axpy() for details
+template <
+	class Range_T,
+	class Scalar_T,
+	class First_Variable,
+	class... Rest_Of_Variables
+> typename std::enable_if<
+	is_gensimcell_range<Range_T>::value
+>::type lincomb(
+	Range_T& y,
+	const Scalar_T& a,
+	const Range_T& x,
+	const Scalar_T& b,
+	const Range_T& z,
+	const First_Variable& first_variable,
+	const Rest_Of_Variables&... rest_of_variables
+) {
+	constexpr std::size_t block_size
+		= detail::get_range_block_size<Range_T>();
+	std::size_t size = y.size() < x.size() ? y.size() : x.size();
+	if (z.size() < size) {
+		size = z.size();
+	}
+	for (std::size_t begin = 0; begin < size; begin += block_size) {
+		const std::size_t end
+			= begin + block_size < size
+			? begin + block_size
+			: size;
+		detail::lincomb_block(
+			y, a, x, b, z,
+			begin, end,
+			first_variable, rest_of_variables...
+		);
+	}
+}
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_LINEAR_COMBINATION_HPP
@@ -34,6 +34,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define GENSIMCELL_OPERATORS_HPP
 
 
+#include "type_traits"
+
 #include "type_support.hpp"
 
 
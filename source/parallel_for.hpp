@@ -0,0 +1,740 @@
+/*
+Work-stealing thread pool for running kernels over cells in parallel.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_PARALLEL_FOR_HPP
+#define GENSIMCELL_PARALLEL_FOR_HPP
+
+
+#include "algorithm"
+#include "atomic"
+#include "condition_variable"
+#include "cstddef"
+#include "deque"
+#include "functional"
+#include "limits"
+#include "memory"
+#include "mutex"
+#include "thread"
+#include "type_traits"
+#include "utility"
+#include "vector"
+
+
+namespace gensimcell {
+
+
+namespace detail {
+
+//! Chunks of a Parallel_Job owned by one thread, [begin, end).
+struct Work_Range
+{
+	std::mutex mutex;
+	std::size_t begin = 0, end = 0;
+};
+
+
+/*!
+Work of one Thread_Pool::parallel_for() call.
+
+Chunks are initially divided evenly between slots, each thread
+taking part in the job owns one slot and processes its chunks
+from the beginning. A thread without chunks steals the latter
+half of the remaining chunks of another slot.
+*/
+struct Parallel_Job
+{
+	std::size_t nr_items, chunk_size, nr_chunks, nr_slots;
+	std::function<void(std::size_t, std::size_t, std::size_t)> function;
+	std::vector<Work_Range> ranges;
+
+	//! Next slot given to a worker, protected by mutex of the pool
+	std::size_t next_slot = 1;
+
+	std::atomic<std::size_t> finished_chunks;
+	std::mutex mutex;
+	std::condition_variable done;
+
+	Parallel_Job(
+		const std::size_t given_nr_items,
+		const std::size_t given_chunk_size,
+		const std::size_t given_nr_slots
+	) :
+		nr_items(given_nr_items),
+		chunk_size(given_chunk_size),
+		nr_chunks((given_nr_items + given_chunk_size - 1) / given_chunk_size),
+		nr_slots(given_nr_slots),
+		ranges(given_nr_slots),
+		finished_chunks(0)
+	{
+		for (std::size_t i = 0; i < this->nr_slots; i++) {
+			this->ranges[i].begin = i * this->nr_chunks / this->nr_slots;
+			this->ranges[i].end = (i + 1) * this->nr_chunks / this->nr_slots;
+		}
+	}
+
+
+	//! Returns true and next chunk of given slot or false if none left.
+	bool take_chunk(const std::size_t slot, std::size_t& chunk)
+	{
+		auto& range = this->ranges[slot];
+		std::lock_guard<std::mutex> lock(range.mutex);
+		if (range.begin >= range.end) {
+			return false;
+		}
+		chunk = range.begin++;
+		return true;
+	}
+
+	/*!
+	Moves half of the remaining chunks of another slot to
+	given slot, returns false if there was nothing to steal.
+	*/
+	bool steal_chunks(const std::size_t slot)
+	{
+		for (std::size_t i = 1; i < this->nr_slots; i++) {
+			auto& victim = this->ranges[(slot + i) % this->nr_slots];
+			std::size_t begin = 0, end = 0;
+			{
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				if (victim.begin >= victim.end) {
+					continue;
+				}
+				end = victim.end;
+				begin = end - (end - victim.begin + 1) / 2;
+				victim.end = begin;
+			}
+
+			auto& range = this->ranges[slot];
+			std::lock_guard<std::mutex> lock(range.mutex);
+			range.begin = begin;
+			range.end = end;
+			return true;
+		}
+		return false;
+	}
+
+	//! Processes chunks as given slot until all chunks have been started.
+	void run(const std::size_t slot)
+	{
+		std::size_t chunk = 0;
+		while (
+			this->take_chunk(slot, chunk)
+			or (this->steal_chunks(slot) and this->take_chunk(slot, chunk))
+		) {
+			const std::size_t begin = chunk * this->chunk_size;
+			this->function(
+				begin,
+				std::min(this->nr_items, begin + this->chunk_size),
+				slot
+			);
+			if (++this->finished_chunks == this->nr_chunks) {
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->done.notify_all();
+			}
+		}
+	}
+};
+
+
+//! Calls of Thread_Pool::for_each_thread() that haven't finished.
+struct Thread_Job
+{
+	std::atomic<std::size_t> remaining;
+	std::mutex mutex;
+	std::condition_variable done;
+
+	explicit Thread_Job(const std::size_t nr_calls) :
+		remaining(nr_calls)
+	{}
+};
+
+} // namespace detail
+
+
+/*!
+Chunk size that makes Thread_Pool::parallel_for(), and
+parallel_for_cells(), etc., give the same range of items
+to the same thread in every call with the same number of
+items instead of dividing work dynamically.
+
+Data first written by a thread is usually allocated from
+the memory of the NUMA domain of that thread, so cells
+initialized with static_schedule are later processed
+with static_schedule by threads close to their memory,
+for example:
+@code
+// vectors of particles are allocated by the thread that
+// also runs solve_kernel for the cell in the loop below
+gensimcell::parallel_for_cells(cells, grid, initialize_kernel, gensimcell::static_schedule);
+while (...) {
+	gensimcell::parallel_for_cells(cells, grid, solve_kernel, gensimcell::static_schedule);
+}
+@endcode
+See also Partitioned_Cells.
+*/
+constexpr std::size_t static_schedule = std::numeric_limits<std::size_t>::max();
+
+
+/*!
+Pool of threads that run loops in parallel with work stealing.
+
+The thread calling parallel_for() takes part in the work so
+a pool of size N has N - 1 worker threads. parallel_for()
+can be called concurrently from several threads, e.g. from
+std::async tasks, and from inside another parallel_for().
+Independent functions can also be queued with submit().
+
+Example:
+@code
+gensimcell::Thread_Pool pool(4);
+std::vector<double> data(1000000);
+pool.parallel_for(data.size(), 0,
+	[&data](size_t begin, size_t end, size_t) {
+		for (size_t i = begin; i < end; i++) {
+			data[i] = i;
+		}
+	}
+);
+@endcode
+*/
+class Thread_Pool
+{
+public:
+
+	/*!
+	Creates a pool of given number of threads including the
+	caller of parallel_for(), 0 meaning one per hardware thread.
+	*/
+	explicit Thread_Pool(unsigned int nr_threads = 0)
+	{
+		if (nr_threads == 0) {
+			nr_threads = std::max(1U, std::thread::hardware_concurrency());
+		}
+		this->pinned.resize(nr_threads);
+		for (unsigned int i = 1; i < nr_threads; i++) {
+			this->workers.emplace_back([this, i]() { this->work(i); });
+		}
+	}
+
+	Thread_Pool(const Thread_Pool&) = delete;
+	Thread_Pool& operator=(const Thread_Pool&) = delete;
+
+	~Thread_Pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stop = true;
+		}
+		this->work_available.notify_all();
+		for (auto& worker: this->workers) {
+			worker.join();
+		}
+	}
+
+
+	//! Returns the number of threads including the caller of parallel_for().
+	std::size_t size() const
+	{
+		return this->workers.size() + 1;
+	}
+
+
+	/*!
+	Calls function(begin, end, slot) for consecutive ranges
+	[begin, end) of at most chunk_size items that together
+	cover [0, nr_items) and returns after all calls finish.
+
+	Different ranges are processed concurrently by different
+	threads, slot < size() identifies the thread processing a
+	range within this call and can be used to index per thread
+	data, e.g. partial results of a reduction. chunk_size 0
+	gives each thread about 8 chunks.
+
+	With chunk_size equal to static_schedule thread i processes
+	items [i * nr_items / size(), (i + 1) * nr_items / size())
+	as slot i, where thread 0 is the caller, see for_each_thread().
+	Called from a thread of this pool static_schedule is
+	treated as 0 because the other threads might be busy.
+	*/
+	template<class Function> void parallel_for(
+		const std::size_t nr_items,
+		std::size_t chunk_size,
+		Function function
+	) {
+		if (nr_items == 0) {
+			return;
+		}
+		if (chunk_size == static_schedule) {
+			if (not this->is_worker()) {
+				const std::size_t nr_slots = this->size();
+				this->for_each_thread([&](const std::size_t slot) {
+					const std::size_t
+						begin = slot * nr_items / nr_slots,
+						end = (slot + 1) * nr_items / nr_slots;
+					if (begin < end) {
+						function(begin, end, slot);
+					}
+				});
+				return;
+			}
+			chunk_size = 0;
+		}
+		if (chunk_size == 0) {
+			chunk_size = std::max(std::size_t(1), nr_items / (8 * this->size()));
+		}
+		const std::size_t nr_chunks = (nr_items + chunk_size - 1) / chunk_size;
+		if (this->size() == 1 or nr_chunks == 1) {
+			for (std::size_t begin = 0; begin < nr_items; begin += chunk_size) {
+				function(begin, std::min(nr_items, begin + chunk_size), 0);
+			}
+			return;
+		}
+
+		const auto job = std::make_shared<detail::Parallel_Job>(
+			nr_items,
+			chunk_size,
+			std::min(this->size(), nr_chunks)
+		);
+		job->function = [&function](
+			const std::size_t begin,
+			const std::size_t end,
+			const std::size_t slot
+		) {
+			function(begin, end, slot);
+		};
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->jobs.push_back(job);
+		}
+		this->work_available.notify_all();
+
+		job->run(0);
+
+		// workers that haven't joined yet can't get any work
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			const auto position = std::find(this->jobs.begin(), this->jobs.end(), job);
+			if (position != this->jobs.end()) {
+				this->jobs.erase(position);
+			}
+		}
+
+		std::unique_lock<std::mutex> lock(job->mutex);
+		job->done.wait(lock, [&job]() {
+			return job->finished_chunks == job->nr_chunks;
+		});
+	}
+
+
+	/*!
+	Calls function(thread) once on each thread of the pool
+	and returns after all calls finish.
+
+	thread is 0 for the calling thread and i for the ith
+	worker so the same worker always gets the same value,
+	e.g. for first touch of data or thread local state.
+	Workers run these calls before other work. Called from
+	a thread of this pool all calls are made by the caller
+	because the other threads might be busy.
+	*/
+	template<class Function> void for_each_thread(Function function)
+	{
+		if (this->is_worker()) {
+			for (std::size_t i = 0; i < this->size(); i++) {
+				function(i);
+			}
+			return;
+		}
+
+		const auto job = std::make_shared<detail::Thread_Job>(this->workers.size());
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			for (std::size_t i = 1; i < this->size(); i++) {
+				this->pinned[i].push_back([job, &function, i]() {
+					function(i);
+					if (--job->remaining == 0) {
+						std::lock_guard<std::mutex> lock(job->mutex);
+						job->done.notify_all();
+					}
+				});
+			}
+		}
+		this->work_available.notify_all();
+
+		function(0);
+
+		std::unique_lock<std::mutex> lock(job->mutex);
+		job->done.wait(lock, [&job]() {
+			return job->remaining == 0;
+		});
+	}
+
+
+	/*!
+	Queues given function to be called once by a worker thread
+	or by a thread calling run_pending_task(), returns without
+	waiting for the call. Workers prefer chunks of parallel_for()
+	over queued functions.
+	*/
+	void submit(std::function<void()> function)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->tasks.push_back(std::move(function));
+		}
+		this->work_available.notify_one();
+	}
+
+	/*!
+	Calls the oldest function queued with submit() on the calling
+	thread, returns false without waiting if none are queued.
+	*/
+	bool run_pending_task()
+	{
+		std::function<void()> task;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if (this->tasks.size() == 0) {
+				return false;
+			}
+			task = std::move(this->tasks.front());
+			this->tasks.pop_front();
+		}
+		task();
+		return true;
+	}
+
+
+private:
+
+	std::vector<std::thread> workers;
+	std::deque<std::shared_ptr<detail::Parallel_Job>> jobs;
+	std::deque<std::function<void()>> tasks;
+	// calls of for_each_thread() for each worker
+	std::vector<std::deque<std::function<void()>>> pinned;
+	std::mutex mutex;
+	std::condition_variable work_available;
+	bool stop = false;
+
+
+	//! Returns the pool whose worker is the calling thread or nullptr.
+	static const Thread_Pool*& get_current_pool()
+	{
+		static thread_local const Thread_Pool* current_pool = nullptr;
+		return current_pool;
+	}
+
+	//! Returns true if the calling thread is a worker of this pool.
+	bool is_worker() const
+	{
+		return get_current_pool() == this;
+	}
+
+
+	/*!
+	Takes part in jobs and runs tasks until the pool is
+	destroyed as given worker, index is >= 1.
+	*/
+	void work(const std::size_t index)
+	{
+		get_current_pool() = this;
+
+		while (true) {
+			std::shared_ptr<detail::Parallel_Job> job;
+			std::size_t slot = 0;
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->work_available.wait(lock, [this, index]() {
+					return
+						this->stop
+						or this->pinned[index].size() > 0
+						or this->jobs.size() > 0
+						or this->tasks.size() > 0;
+				});
+				if (this->pinned[index].size() > 0) {
+					auto call = std::move(this->pinned[index].front());
+					this->pinned[index].pop_front();
+					lock.unlock();
+					call();
+					continue;
+				}
+				if (this->jobs.size() == 0) {
+					if (this->tasks.size() == 0) {
+						return;
+					}
+					auto task = std::move(this->tasks.front());
+					this->tasks.pop_front();
+					lock.unlock();
+					task();
+					continue;
+				}
+				job = this->jobs.front();
+				slot = job->next_slot++;
+				if (job->next_slot >= job->nr_slots) {
+					this->jobs.pop_front();
+				}
+			}
+			job->run(slot);
+		}
+	}
+};
+
+
+namespace detail {
+
+//! Number of threads of the default pool, 0 for one per hardware thread.
+inline unsigned int& get_default_nr_threads()
+{
+	static unsigned int nr_threads = 0;
+	return nr_threads;
+}
+
+} // namespace detail
+
+
+/*!
+Sets the number of threads of the pool returned by
+get_default_thread_pool(), 0 meaning one per hardware thread.
+
+Has no effect after the default pool was first used.
+*/
+inline void set_default_nr_threads(const unsigned int nr_threads)
+{
+	detail::get_default_nr_threads() = nr_threads;
+}
+
+
+/*!
+Returns a pool with one thread per hardware thread, or the
+number given to set_default_nr_threads(), created when first
+used, e.g. by parallel_for_cells().
+
+When running several MPI processes per node give each
+fewer threads, e.g. get_nr_threads_per_process().
+*/
+inline Thread_Pool& get_default_thread_pool()
+{
+	static Thread_Pool pool(detail::get_default_nr_threads());
+	return pool;
+}
+
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 3)
+
+/*!
+Returns the number of hardware threads of this node divided
+by the number of processes of given communicator on it, at
+least 1. Collective over given communicator.
+
+Example sharing each node between its processes:
+@code
+gensimcell::set_default_nr_threads(
+	gensimcell::get_nr_threads_per_process(MPI_COMM_WORLD)
+);
+@endcode
+*/
+inline unsigned int get_nr_threads_per_process(MPI_Comm comm)
+{
+	int node_size = 1;
+	MPI_Comm node_comm;
+	if (
+		MPI_Comm_split_type(
+			comm,
+			MPI_COMM_TYPE_SHARED,
+			0,
+			MPI_INFO_NULL,
+			&node_comm
+		) == MPI_SUCCESS
+	) {
+		MPI_Comm_size(node_comm, &node_size);
+		MPI_Comm_free(&node_comm);
+	}
+	return std::max(
+		1U,
+		std::thread::hardware_concurrency() / unsigned(std::max(node_size, 1))
+	);
+}
+
+#endif // ifdef MPI_VERSION
+
+
+namespace detail {
+
+//! Type returned by kernel of parallel_reduce_cells().
+template<
+	class Kernel,
+	class Cell_Id_T,
+	class Grid_T
+> using Kernel_Result = typename std::decay<
+	decltype(
+		std::declval<Kernel&>()(
+			std::declval<const Cell_Id_T&>(),
+			std::declval<Grid_T&>()
+		)
+	)
+>::type;
+
+} // namespace detail
+
+
+/*!
+Calls kernel(cell_id, grid) for each of given cell ids in parallel.
+
+Cells are processed in chunks of chunk_size ids, 0 meaning
+automatic, by threads of given pool which steal chunks from
+each other when they run out of work. kernel is called
+concurrently from several threads and must only modify data
+of the given cell, e.g. data of other cells can be read but
+not written.
+
+Example computing the number of live neighbors in game of life:
+@code
+gensimcell::parallel_for_cells(inner_cells, grid,
+	[](const uint64_t cell_id, Grid_T& grid) {
+		auto* const cell = grid[cell_id];
+		for (const auto neighbor_id: *grid.get_neighbors_of(cell_id)) {
+			...
+		}
+	}
+);
+@endcode
+*/
+template<
+	class Cell_Id_T,
+	class Grid_T,
+	class Kernel
+> void parallel_for_cells(
+	const std::vector<Cell_Id_T>& cell_ids,
+	Grid_T& grid,
+	Kernel kernel,
+	const std::size_t chunk_size = 0,
+	Thread_Pool& pool = get_default_thread_pool()
+) {
+	pool.parallel_for(
+		cell_ids.size(),
+		chunk_size,
+		[&](const std::size_t begin, const std::size_t end, const std::size_t) {
+			for (std::size_t i = begin; i < end; i++) {
+				kernel(cell_ids[i], grid);
+			}
+		}
+	);
+}
+
+
+/*!
+Combines results of kernel(cell_id, grid) for given cells in parallel.
+
+Same as parallel_for_cells() but returns the return values of
+kernel combined with combine, which must be associative and
+commutative, e.g. std::plus. identity must not change values
+it's combined with, e.g. 0 for std::plus, and is returned if
+there are no cells. Results are combined within each thread
+first and then between threads.
+*/
+template<
+	class Cell_Id_T,
+	class Grid_T,
+	class Kernel,
+	class Combine
+> detail::Kernel_Result<Kernel, Cell_Id_T, Grid_T> parallel_reduce_cells(
+	const std::vector<Cell_Id_T>& cell_ids,
+	Grid_T& grid,
+	Kernel kernel,
+	const detail::Kernel_Result<Kernel, Cell_Id_T, Grid_T>& identity,
+	Combine combine,
+	const std::size_t chunk_size = 0,
+	Thread_Pool& pool = get_default_thread_pool()
+) {
+	using Result_T = detail::Kernel_Result<Kernel, Cell_Id_T, Grid_T>;
+
+	std::vector<Result_T> results(pool.size(), identity);
+	pool.parallel_for(
+		cell_ids.size(),
+		chunk_size,
+		[&](const std::size_t begin, const std::size_t end, const std::size_t slot) {
+			Result_T result = identity;
+			for (std::size_t i = begin; i < end; i++) {
+				result = combine(result, kernel(cell_ids[i], grid));
+			}
+			results[slot] = combine(results[slot], result);
+		}
+	);
+
+	Result_T result = identity;
+	for (const auto& partial: results) {
+		result = combine(result, partial);
+	}
+	return result;
+}
+
+
+/*!
+Returns the minimum of kernel(cell_id, grid) over given
+cells computed in parallel, or the largest value of the
+result type if there are no cells.
+
+For kernels that return e.g. the longest allowed time step
+of a cell, see parallel_reduce_cells() for details.
+*/
+template<
+	class Cell_Id_T,
+	class Grid_T,
+	class Kernel
+> detail::Kernel_Result<Kernel, Cell_Id_T, Grid_T> parallel_min_cells(
+	const std::vector<Cell_Id_T>& cell_ids,
+	Grid_T& grid,
+	Kernel kernel,
+	const std::size_t chunk_size = 0,
+	Thread_Pool& pool = get_default_thread_pool()
+) {
+	using Result_T = detail::Kernel_Result<Kernel, Cell_Id_T, Grid_T>;
+
+	return parallel_reduce_cells(
+		cell_ids,
+		grid,
+		kernel,
+		std::numeric_limits<Result_T>::max(),
+		[](const Result_T& a, const Result_T& b) {
+			return std::min(a, b);
+		},
+		chunk_size,
+		pool
+	);
+}
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_PARALLEL_FOR_HPP
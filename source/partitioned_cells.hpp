@@ -0,0 +1,236 @@
+/*
+Storage of cells first touched by the threads that process them.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_PARTITIONED_CELLS_HPP
+#define GENSIMCELL_PARTITIONED_CELLS_HPP
+
+
+#include "cstddef"
+#include "limits"
+#include "new"
+#include "utility"
+
+#include "parallel_for.hpp"
+
+
+namespace gensimcell {
+
+
+/*!
+Fixed number of cells stored contiguously like in std::vector
+but constructed and destroyed by threads of a Thread_Pool.
+
+Memory of cells is allocated without writing to it and the
+cells of each thread's range of static_schedule are constructed
+by that thread, so on NUMA systems the cells are usually placed
+in the memory of the NUMA domain of the thread that processes
+them in loops using static_schedule, e.g. for_each_partition().
+Data allocated later by cells, e.g. by std::vector variables, is
+placed similarly if it's allocated in such loops.
+
+Only placement of memory depends on the threads, cells can be
+accessed from any thread and the class can be used as a range
+of cells, e.g. with gensimcell::assign() of assign_ranges.hpp.
+
+Example:
+@code
+gensimcell::Thread_Pool pool;
+gensimcell::Partitioned_Cells<Cell_T> cells(1000000, pool);
+cells.for_each_partition([&cells](size_t begin, size_t end, size_t) {
+	for (size_t i = begin; i < end; i++) {
+		cells[i][Density()] = 1;
+	}
+});
+@endcode
+*/
+template <class Cell_T> class Partitioned_Cells
+{
+	static_assert(
+		alignof(Cell_T) <= alignof(std::max_align_t),
+		"Partitioned_Cells doesn't support over-aligned cell types"
+	);
+
+public:
+
+	using value_type = Cell_T;
+	using iterator = Cell_T*;
+	using const_iterator = const Cell_T*;
+
+
+	/*!
+	Creates given number of value initialized cells, each
+	thread of given pool constructing its static_schedule
+	range of cells.
+
+	Throws std::bad_alloc if memory for cells can't be allocated.
+	*/
+	explicit Partitioned_Cells(
+		const std::size_t nr_cells,
+		Thread_Pool& given_pool = get_default_thread_pool()
+	) :
+		pool(&given_pool),
+		nr_of_cells(nr_cells),
+		cells(allocate(nr_cells))
+	{
+		this->for_each_partition(
+			[this](const std::size_t begin, const std::size_t end, const std::size_t) {
+				for (std::size_t i = begin; i < end; i++) {
+					new (&this->cells[i]) Cell_T();
+				}
+			}
+		);
+	}
+
+	Partitioned_Cells(const Partitioned_Cells&) = delete;
+	Partitioned_Cells& operator=(const Partitioned_Cells&) = delete;
+
+	Partitioned_Cells(Partitioned_Cells&& other) :
+		pool(other.pool),
+		nr_of_cells(other.nr_of_cells),
+		cells(other.cells)
+	{
+		other.nr_of_cells = 0;
+		other.cells = nullptr;
+	}
+
+	Partitioned_Cells& operator=(Partitioned_Cells&& other)
+	{
+		std::swap(this->pool, other.pool);
+		std::swap(this->nr_of_cells, other.nr_of_cells);
+		std::swap(this->cells, other.cells);
+		return *this;
+	}
+
+	~Partitioned_Cells()
+	{
+		if (this->cells == nullptr) {
+			return;
+		}
+		this->for_each_partition(
+			[this](const std::size_t begin, const std::size_t end, const std::size_t) {
+				for (std::size_t i = begin; i < end; i++) {
+					this->cells[i].~Cell_T();
+				}
+			}
+		);
+		::operator delete(this->cells);
+	}
+
+
+	/*!
+	Calls function(begin, end, thread) for the range of cells
+	[begin, end) constructed by each thread of the pool, on
+	that thread, and returns after all calls finish.
+
+	Call from the same thread that created the cells, called
+	from a thread of the pool cells are processed dynamically,
+	see Thread_Pool::parallel_for().
+	*/
+	template<class Function> void for_each_partition(Function function)
+	{
+		this->pool->parallel_for(this->nr_of_cells, static_schedule, function);
+	}
+
+
+	//! Returns the pool that processes the cells.
+	Thread_Pool& get_pool() const
+	{
+		return *this->pool;
+	}
+
+	std::size_t size() const
+	{
+		return this->nr_of_cells;
+	}
+
+	Cell_T& operator[](const std::size_t index)
+	{
+		return this->cells[index];
+	}
+
+	const Cell_T& operator[](const std::size_t index) const
+	{
+		return this->cells[index];
+	}
+
+	Cell_T* data()
+	{
+		return this->cells;
+	}
+
+	const Cell_T* data() const
+	{
+		return this->cells;
+	}
+
+	iterator begin()
+	{
+		return this->cells;
+	}
+
+	iterator end()
+	{
+		return this->cells + this->nr_of_cells;
+	}
+
+	const_iterator begin() const
+	{
+		return this->cells;
+	}
+
+	const_iterator end() const
+	{
+		return this->cells + this->nr_of_cells;
+	}
+
+
+private:
+
+	Thread_Pool* pool;
+	std::size_t nr_of_cells;
+	Cell_T* cells;
+
+	//! Returns uninitialized memory for given number of cells.
+	static Cell_T* allocate(const std::size_t nr_cells)
+	{
+		if (nr_cells > std::numeric_limits<std::size_t>::max() / sizeof(Cell_T)) {
+			throw std::bad_alloc();
+		}
+		return static_cast<Cell_T*>(::operator new(nr_cells * sizeof(Cell_T)));
+	}
+};
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_PARTITIONED_CELLS_HPP
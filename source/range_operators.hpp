@@ -0,0 +1,242 @@
+/*
+Operators for ranges of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_RANGE_OPERATORS_HPP
+#define GENSIMCELL_RANGE_OPERATORS_HPP
+
+
+#include "cstddef"
+#include "type_traits"
+
+#include "type_support.hpp"
+#include "variable_operators.hpp"
+
+
+namespace gensimcell {
+
+
+namespace detail {
+
+/*!
+Returns the number of cells processed by range operators
+for all given variables before moving to the next cells.
+
+Cells are processed in blocks of a few cache lines which stay
+in L1 cache between variables so that the range is streamed
+through memory only once regardless of the number of variables.
+Larger blocks were measured to be slower with cells of a few
+variables as hardware prefetching is then spread over several
+strided streams.
+*/
+template <class Range_T> constexpr std::size_t get_range_block_size()
+{
+	return
+		sizeof(typename Range_T::value_type) < 512
+		? 512 / sizeof(typename Range_T::value_type)
+		: 1;
+}
+
+} // namespace detail
+
+
+/*!
+Range versions of cell operators.
+
+A range is a container of cells such as std::vector<Cell> or
+std::array<Cell, N> (see is_gensimcell_range), cells at the
+same index in lhs and rhs are processed together up to the size
+of the smaller range. For example
+@code
+gensimcell::plus_equal(cells1, cells2, Density(), Velocity());
+@endcode
+is equal to
+@code
+for (size_t i = 0; i < cells1.size(); i++) {
+	cells1[i].plus_equal(cells2[i], Density(), Velocity());
+}
+@endcode
+but processes one variable at a time over a block of cells, i.e.
+in variable-major order, so that the loop over cells contains the
+operation of only one variable which the compiler can vectorize
+instead of recursing through all given variables in every cell.
+Blocks are small enough to stay in cache between variables.
+Variables not given are not modified.
+
+Call these functions with the namespace, i.e. gensimcell::copy(),
+to avoid argument dependent lookup of e.g. std::copy().
+*/
+#define GENSIMCELL_MAKE_RANGE_OPERATOR(NAME, VARIABLE_OPERATOR) \
+namespace detail { \
+\
+template < \
+	class Range_T \
+> void NAME##_block( \
+	Range_T&, \
+	const Range_T&, \
+	const std::size_t, \
+	const std::size_t \
+) {} \
+\
+template < \
+	class Range_T, \
+	class First_Variable, \
+	class... Rest_Of_Variables \
+> void NAME##_block( \
+	Range_T& lhs, \
+	const Range_T& rhs, \
+	const std::size_t begin, \
+	const std::size_t end, \
+	const First_Variable& first_variable, \
+	const Rest_Of_Variables&... rest_of_variables \
+) { \
+	for (std::size_t i = begin; i < end; i++) { \
+		VARIABLE_OPERATOR( \
+			lhs[i][first_variable], \
+			rhs[i][first_variable] \
+		); \
+	} \
+	NAME##_block(lhs, rhs, begin, end, rest_of_variables...); \
+} \
+\
+} \
+\
+template < \
+	class Range_T, \
+	class... Variables \
+> typename std::enable_if< \
+	is_gensimcell_range<Range_T>::value \
+>::type NAME( \
+	Range_T& lhs, \
+	const Range_T& rhs, \
+	const Variables&... variables \
+) { \
+	constexpr std::size_t block_size \
+		= detail::get_range_block_size<Range_T>(); \
+	const std::size_t size \
+		= lhs.size() < rhs.size() \
+		? lhs.size() \
+		: rhs.size(); \
+	for (std::size_t begin = 0; begin < size; begin += block_size) { \
+		const std::size_t end \
+			= begin + block_size < size \
+			? begin + block_size \
+			: size; \
+		detail::NAME##_block(lhs, rhs, begin, end, variables...); \
+	} \
+}
+
+GENSIMCELL_MAKE_RANGE_OPERATOR(copy, variable_equal)
+GENSIMCELL_MAKE_RANGE_OPERATOR(plus_equal, variable_plus_equal)
+GENSIMCELL_MAKE_RANGE_OPERATOR(minus_equal, variable_minus_equal)
+GENSIMCELL_MAKE_RANGE_OPERATOR(mul_equal, variable_mul_equal)
+GENSIMCELL_MAKE_RANGE_OPERATOR(div_equal, variable_div_equal)
+
+#undef GENSIMCELL_MAKE_RANGE_OPERATOR
+
+
+/*!
+Range versions of cell operators with a scalar right hand side.
+
+fill(cells, 0, Density()) sets Density of all given cells to 0
+and scale(cells, 2, Density(), Velocity()) multiplies the data
+of given variables in all cells by 2. Scalars are broadcast to
+each element of arrays, vectors, etc. See the range versions
+of cell operators for details.
+*/
+#define GENSIMCELL_MAKE_RANGE_OPERATOR_SCALAR(NAME, VARIABLE_OPERATOR) \
+namespace detail { \
+\
+template < \
+	class Range_T, \
+	class Scalar_T \
+> void NAME##_block( \
+	Range_T&, \
+	const Scalar_T&, \
+	const std::size_t, \
+	const std::size_t \
+) {} \
+\
+template < \
+	class Range_T, \
+	class Scalar_T, \
+	class First_Variable, \
+	class... Rest_Of_Variables \
+> void NAME##_block( \
+	Range_T& lhs, \
+	const Scalar_T& rhs, \
+	const std::size_t begin, \
+	const std::size_t end, \
+	const First_Variable& first_variable, \
+	const Rest_Of_Variables&... rest_of_variables \
+) { \
+	for (std::size_t i = begin; i < end; i++) { \
+		VARIABLE_OPERATOR(lhs[i][first_variable], rhs); \
+	} \
+	NAME##_block(lhs, rhs, begin, end, rest_of_variables...); \
+} \
+\
+} \
+\
+template < \
+	class Range_T, \
+	class Scalar_T, \
+	class... Variables \
+> typename std::enable_if< \
+	is_gensimcell_range<Range_T>::value \
+	and std::is_arithmetic<Scalar_T>::value \
+>::type NAME( \
+	Range_T& lhs, \
+	const Scalar_T& rhs, \
+	const Variables&... variables \
+) { \
+	constexpr std::size_t block_size \
+		= detail::get_range_block_size<Range_T>(); \
+	const std::size_t size = lhs.size(); \
+	for (std::size_t begin = 0; begin < size; begin += block_size) { \
+		const std::size_t end \
+			= begin + block_size < size \
+			? begin + block_size \
+			: size; \
+		detail::NAME##_block(lhs, rhs, begin, end, variables...); \
+	} \
+}
+
+GENSIMCELL_MAKE_RANGE_OPERATOR_SCALAR(fill, variable_equal)
+GENSIMCELL_MAKE_RANGE_OPERATOR_SCALAR(scale, variable_mul_equal)
+
+#undef GENSIMCELL_MAKE_RANGE_OPERATOR_SCALAR
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_RANGE_OPERATORS_HPP
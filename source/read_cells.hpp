@@ -0,0 +1,433 @@
+/*
+Bulk reading of saved data of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_READ_CELLS_HPP
+#define GENSIMCELL_READ_CELLS_HPP
+
+
+#include "algorithm"
+#include "cstddef"
+#include "cstdint"
+#include "cstring"
+#include "limits"
+#include "numeric"
+#include "tuple"
+#include "utility"
+#include "vector"
+
+#include "schema.hpp"
+#include "variable_table.hpp"
+
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+
+namespace gensimcell {
+
+
+namespace detail {
+
+/*!
+Bytes of one variable copied between saved data of a cell
+and memory by read_cells() and save_async(), offsets are from
+the beginning of a cell's saved data and of a cell in memory.
+*/
+struct Packed_Block
+{
+	std::size_t file_offset, memory_offset, size;
+};
+
+
+/*!
+Returns blocks to copy between saved data and cells of given
+type if each cell's saved data has the same layout and the
+total size of a cell's saved data.
+
+Returns no blocks if the layout depends on the cell, e.g. if
+a std::vector or a nested cell is transferred, or if saved data
+doesn't match the size of the MPI datatype of given cell.
+*/
+template<class Cell_T> std::pair<
+	std::vector<Packed_Block>,
+	std::size_t
+> get_packed_blocks(const Cell_T& cell)
+{
+	using Table = Variable_Table<Cell_T>;
+
+	std::vector<Packed_Block> blocks;
+	const auto schema = Schema::create(cell);
+	for (std::size_t i = 0; i < schema.variables.size(); i++) {
+		const auto& variable = schema.variables[i];
+		if (not variable.transferred) {
+			continue;
+		}
+		if (
+			variable.packed_offset == unknown_packed_offset
+			or variable.variable_length
+			or variable.transfer_per_cell
+			or variable.element_count == 0
+			or not Table::info(i).trivially_copyable
+		) {
+			return std::make_pair(std::vector<Packed_Block>(), 0);
+		}
+
+		const std::size_t size = variable.element_size * variable.element_count;
+		if (
+			blocks.size() > 0
+			and blocks.back().file_offset + blocks.back().size == variable.packed_offset
+			and blocks.back().memory_offset + blocks.back().size == Table::info(i).offset
+		) {
+			blocks.back().size += size;
+		} else {
+			blocks.push_back({variable.packed_offset, Table::info(i).offset, size});
+		}
+	}
+
+	// make sure MPI would transfer the same bytes
+	void* address = nullptr;
+	int count = -1;
+	MPI_Datatype datatype = MPI_DATATYPE_NULL;
+	std::tie(address, count, datatype) = cell.get_mpi_datatype();
+	int datatype_size = -1;
+	MPI_Type_size(datatype, &datatype_size);
+	int combiner = -1, tmp1 = -1, tmp2 = -1, tmp3 = -1;
+	MPI_Type_get_envelope(datatype, &tmp1, &tmp2, &tmp3, &combiner);
+	if (combiner != MPI_COMBINER_NAMED) {
+		MPI_Type_free(&datatype);
+	}
+
+	if (
+		count < 0
+		or std::uint64_t(count) * std::uint64_t(datatype_size) != schema.fixed_size
+	) {
+		return std::make_pair(std::vector<Packed_Block>(), 0);
+	}
+
+	return std::make_pair(blocks, schema.fixed_size);
+}
+
+
+/*!
+Reads cells with identical layout of saved data by reading
+the file in large contiguous chunks and copying given blocks
+from each chunk into cells.
+*/
+template<class Cell_T> bool read_cells_with_blocks(
+	MPI_File file,
+	const std::vector<std::uint64_t>& file_offsets,
+	const std::vector<std::size_t>& order,
+	std::vector<Cell_T>& cells,
+	const std::vector<Packed_Block>& blocks,
+	const std::uint64_t cell_size,
+	const std::uint64_t max_chunk_size
+) {
+	std::vector<char> buffer;
+	std::size_t chunk_start = 0;
+	while (chunk_start < order.size()) {
+
+		// extend chunk while it fits into max_chunk_size
+		const auto first_offset = file_offsets[order[chunk_start]];
+		std::size_t chunk_end = chunk_start + 1;
+		while (
+			chunk_end < order.size()
+			and file_offsets[order[chunk_end]] + cell_size - first_offset
+				<= max_chunk_size
+		) {
+			chunk_end++;
+		}
+		const auto chunk_size
+			= file_offsets[order[chunk_end - 1]] + cell_size - first_offset;
+		if (chunk_size > std::uint64_t(std::numeric_limits<int>::max())) {
+			return false;
+		}
+
+		buffer.resize(chunk_size);
+		if (
+			MPI_File_read_at(
+				file,
+				MPI_Offset(first_offset),
+				buffer.data(),
+				int(chunk_size),
+				MPI_BYTE,
+				MPI_STATUS_IGNORE
+			) != MPI_SUCCESS
+		) {
+			return false;
+		}
+
+		for (std::size_t i = chunk_start; i < chunk_end; i++) {
+			const auto index = order[i];
+			const char* const source
+				= buffer.data() + (file_offsets[index] - first_offset);
+			char* const target = reinterpret_cast<char*>(&cells[index]);
+			for (const auto& block: blocks) {
+				std::memcpy(
+					target + block.memory_offset,
+					source + block.file_offset,
+					block.size
+				);
+			}
+		}
+
+		chunk_start = chunk_end;
+	}
+
+	return true;
+}
+
+
+/*!
+Reads cells whose saved data can have different layouts,
+e.g. std::vectors of different length, by combining the
+MPI datatypes of many cells into one file view and read.
+*/
+template<class Cell_T> bool read_cells_with_datatypes(
+	MPI_File file,
+	const std::vector<std::uint64_t>& file_offsets,
+	const std::vector<std::size_t>& order,
+	std::vector<Cell_T>& cells,
+	const std::size_t max_chunk_cells
+) {
+	bool success = true;
+	std::vector<int> counts, file_counts;
+	std::vector<MPI_Aint> addresses, file_displacements;
+	std::vector<MPI_Datatype> datatypes;
+
+	std::size_t chunk_start = 0;
+	while (success and chunk_start < order.size()) {
+		const auto chunk_end = std::min(order.size(), chunk_start + max_chunk_cells);
+
+		counts.clear();
+		file_counts.clear();
+		addresses.clear();
+		file_displacements.clear();
+		datatypes.clear();
+
+		for (std::size_t i = chunk_start; i < chunk_end; i++) {
+			const auto index = order[i];
+
+			void* address = nullptr;
+			int count = -1;
+			MPI_Datatype datatype = MPI_DATATYPE_NULL;
+			std::tie(address, count, datatype) = cells[index].get_mpi_datatype();
+			if (count < 0) {
+				success = false;
+				break;
+			}
+			if (count == 0) {
+				continue;
+			}
+
+			int datatype_size = -1;
+			MPI_Type_size(datatype, &datatype_size);
+
+			MPI_Aint absolute_address = 0;
+			MPI_Get_address(address, &absolute_address);
+
+			counts.push_back(count);
+			addresses.push_back(absolute_address);
+			datatypes.push_back(datatype);
+			file_counts.push_back(count * datatype_size);
+			file_displacements.push_back(MPI_Aint(file_offsets[index]));
+		}
+
+		MPI_Datatype
+			memory_datatype = MPI_DATATYPE_NULL,
+			file_datatype = MPI_DATATYPE_NULL;
+		if (success and datatypes.size() > 0) {
+			if (
+				MPI_Type_create_struct(
+					int(datatypes.size()),
+					counts.data(),
+					addresses.data(),
+					datatypes.data(),
+					&memory_datatype
+				) != MPI_SUCCESS
+				or MPI_Type_create_hindexed(
+					int(file_counts.size()),
+					file_counts.data(),
+					file_displacements.data(),
+					MPI_BYTE,
+					&file_datatype
+				) != MPI_SUCCESS
+			) {
+				success = false;
+			}
+		}
+
+		if (success and datatypes.size() > 0) {
+			MPI_Type_commit(&memory_datatype);
+			MPI_Type_commit(&file_datatype);
+			if (
+				MPI_File_set_view(
+					file,
+					0,
+					MPI_BYTE,
+					file_datatype,
+					const_cast<char*>("native"),
+					MPI_INFO_NULL
+				) != MPI_SUCCESS
+				or MPI_File_read_at(
+					file,
+					0,
+					MPI_BOTTOM,
+					1,
+					memory_datatype,
+					MPI_STATUS_IGNORE
+				) != MPI_SUCCESS
+			) {
+				success = false;
+			}
+		}
+
+		if (memory_datatype != MPI_DATATYPE_NULL) {
+			MPI_Type_free(&memory_datatype);
+		}
+		if (file_datatype != MPI_DATATYPE_NULL) {
+			MPI_Type_free(&file_datatype);
+		}
+		for (auto& datatype: datatypes) {
+			int combiner = -1, tmp1 = -1, tmp2 = -1, tmp3 = -1;
+			MPI_Type_get_envelope(datatype, &tmp1, &tmp2, &tmp3, &combiner);
+			if (combiner != MPI_COMBINER_NAMED) {
+				MPI_Type_free(&datatype);
+			}
+		}
+
+		chunk_start = chunk_end;
+	}
+
+	// restore default view for reads with explicit offsets
+	MPI_File_set_view(
+		file,
+		0,
+		MPI_BYTE,
+		MPI_BYTE,
+		const_cast<char*>("native"),
+		MPI_INFO_NULL
+	);
+
+	return success;
+}
+
+} // namespace detail
+
+
+/*!
+Reads saved data of many cells from given file.
+
+file_offsets[i] is the offset in bytes of saved data of
+cells[i] in file, which must contain the variables currently
+transferred by cells[i] packed in the order of the variables,
+as written by for example dccrg::Dccrg::save_grid_data().
+cells is resized to file_offsets.size() if it is smaller.
+
+If all cells store their transferred data with the same layout,
+which is checked with gensimcell::Schema, the file is read in
+contiguous chunks of at most max_chunk_size bytes which are
+decoded into cells with memcpy. Otherwise the MPI datatypes of
+at most max_chunk_cells cells are combined into one read, in
+which case variable length data such as std::vector must have
+been resized to the saved length before calling this function.
+Either way the file is read with a few large reads instead of
+setting the file view once per cell.
+
+The file view is reset to the default so file must have been
+opened by one process, e.g. using MPI_COMM_SELF.
+
+Returns true on success and false otherwise.
+
+Example reading cell ids and data offsets saved by dccrg:
+@code
+vector<pair<uint64_t, uint64_t>> cells_offsets(total_cells);
+MPI_File_read_at(file, offset, cells_offsets.data(), ...);
+vector<uint64_t> file_offsets;
+for (const auto& item: cells_offsets) {
+	file_offsets.push_back(item.second);
+}
+Cell::set_transfer_all(true, Density(), Velocity());
+vector<Cell> cells;
+gensimcell::read_cells(file, file_offsets, cells);
+@endcode
+*/
+template<class Cell_T> bool read_cells(
+	MPI_File file,
+	const std::vector<std::uint64_t>& file_offsets,
+	std::vector<Cell_T>& cells,
+	const std::uint64_t max_chunk_size = std::uint64_t(1) << 26,
+	const std::size_t max_chunk_cells = std::size_t(1) << 16
+) {
+	if (cells.size() < file_offsets.size()) {
+		cells.resize(file_offsets.size());
+	}
+	if (file_offsets.size() == 0) {
+		return true;
+	}
+
+	// read file from beginning to end
+	std::vector<std::size_t> order(file_offsets.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(
+		order.begin(),
+		order.end(),
+		[&file_offsets](const std::size_t a, const std::size_t b) {
+			return file_offsets[a] < file_offsets[b];
+		}
+	);
+
+	const auto blocks_size = detail::get_packed_blocks(cells[order[0]]);
+	if (blocks_size.second > 0) {
+		return detail::read_cells_with_blocks(
+			file,
+			file_offsets,
+			order,
+			cells,
+			blocks_size.first,
+			blocks_size.second,
+			max_chunk_size
+		);
+	} else {
+		return detail::read_cells_with_datatypes(
+			file,
+			file_offsets,
+			order,
+			cells,
+			max_chunk_cells
+		);
+	}
+}
+
+
+} // namespace gensimcell
+
+#endif // ifdef MPI_VERSION
+
+#endif // ifndef GENSIMCELL_READ_CELLS_HPP
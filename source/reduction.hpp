@@ -0,0 +1,1015 @@
+/*
+Reductions of cell data within and between processes.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_REDUCTION_HPP
+#define GENSIMCELL_REDUCTION_HPP
+
+
+#include "algorithm"
+#include "array"
+#include "cstddef"
+#include "limits"
+#include "tuple"
+#include "type_traits"
+#include "vector"
+
+#include "parallel_for.hpp"
+#include "variable_table.hpp"
+
+
+namespace gensimcell {
+
+
+//! Operation used to combine values in reductions.
+enum class Reduction {
+	min,
+	max,
+	sum
+};
+
+
+namespace detail {
+
+/*!
+Arithmetic type of elements of reduced data, data
+must be arithmetic or std::array of such data.
+*/
+template<class Data_T> using Reduced_Element = typename Data_Elements<Data_T>::type;
+
+//! Checks that data of given type can be reduced.
+template<class Data_T> constexpr bool is_reducible()
+{
+	return
+		Data_Elements<Data_T>::count > 0
+		and not std::is_same<Reduced_Element<Data_T>, bool>::value
+		and sizeof(Data_T)
+			== Data_Elements<Data_T>::count * sizeof(Reduced_Element<Data_T>);
+}
+
+//! value is true if data of all given types can be reduced.
+template<class... Data_T> struct Are_Reducible : std::true_type {};
+
+//! See the general version for documentation.
+template<
+	class First_Data_T,
+	class... Rest_Of_Data_T
+> struct Are_Reducible<First_Data_T, Rest_Of_Data_T...> :
+	std::integral_constant<
+		bool,
+		is_reducible<First_Data_T>()
+		and Are_Reducible<Rest_Of_Data_T...>::value
+	>
+{};
+
+
+//! Returns the value that doesn't change elements combined with it.
+template<class Element_T> Element_T get_reduction_identity(const Reduction op)
+{
+	switch (op) {
+	case Reduction::min:
+		return std::numeric_limits<Element_T>::max();
+	case Reduction::max:
+		return std::numeric_limits<Element_T>::lowest();
+	default:
+		return Element_T(0);
+	}
+}
+
+
+//! Combines elements with Reduction::min.
+struct Min_Reduction
+{
+	template<class Element_T> Element_T operator()(
+		const Element_T a,
+		const Element_T b
+	) const {
+		return std::min(a, b);
+	}
+};
+
+//! Combines elements with Reduction::max.
+struct Max_Reduction
+{
+	template<class Element_T> Element_T operator()(
+		const Element_T a,
+		const Element_T b
+	) const {
+		return std::max(a, b);
+	}
+};
+
+//! Combines elements with Reduction::sum.
+struct Sum_Reduction
+{
+	template<class Element_T> Element_T operator()(
+		const Element_T a,
+		const Element_T b
+	) const {
+		return a + b;
+	}
+};
+
+
+//! Combines count elements of source into target with given operation.
+template<
+	class Element_T,
+	class Combine
+> void combine_elements(
+	Element_T* const target,
+	const Element_T* const source,
+	const std::size_t count,
+	Combine combine
+) {
+	for (std::size_t i = 0; i < count; i++) {
+		target[i] = combine(target[i], source[i]);
+	}
+}
+
+/*!
+Combines count elements of source into target with given operation.
+
+Operation is selected outside of the loops so each
+of them can be vectorized by the compiler.
+*/
+template<class Element_T> void reduce_elements(
+	const Reduction op,
+	Element_T* const target,
+	const Element_T* const source,
+	const std::size_t count
+) {
+	switch (op) {
+	case Reduction::min:
+		combine_elements(target, source, count, Min_Reduction());
+		break;
+	case Reduction::max:
+		combine_elements(target, source, count, Max_Reduction());
+		break;
+	default:
+		combine_elements(target, source, count, Sum_Reduction());
+		break;
+	}
+}
+
+
+//! Returns data whose every element is the identity of given operation.
+template<class Data_T> Data_T get_reduction_identity_data(const Reduction op)
+{
+	using Element_T = Reduced_Element<Data_T>;
+
+	Data_T data;
+	auto* const elements = reinterpret_cast<Element_T*>(&data);
+	for (std::size_t i = 0; i < Data_Elements<Data_T>::count; i++) {
+		elements[i] = get_reduction_identity<Element_T>(op);
+	}
+	return data;
+}
+
+
+//! Combines source into target element-wise with given operation.
+template<class Data_T> void reduce_data(
+	const Reduction op,
+	Data_T& target,
+	const Data_T& source
+) {
+	using Element_T = Reduced_Element<Data_T>;
+
+	reduce_elements(
+		op,
+		reinterpret_cast<Element_T*>(&target),
+		reinterpret_cast<const Element_T*>(&source),
+		Data_Elements<Data_T>::count
+	);
+}
+
+
+/*!
+Combines given variable of cells [begin, end) of
+given range into result element-wise with combine.
+*/
+template<
+	class Variable,
+	class Range,
+	class Combine
+> void combine_variable(
+	typename Variable::data_type& result,
+	const Range& cells,
+	const std::size_t begin,
+	const std::size_t end,
+	Combine combine
+) {
+	using Data_T = typename Variable::data_type;
+	using Element_T = Reduced_Element<Data_T>;
+
+	// local copy can't alias data of cells
+	Data_T combined = result;
+	auto* const target = reinterpret_cast<Element_T*>(&combined);
+	for (std::size_t i = begin; i < end; i++) {
+		combine_elements(
+			target,
+			reinterpret_cast<const Element_T*>(&(cells[i][Variable()])),
+			Data_Elements<Data_T>::count,
+			combine
+		);
+	}
+	result = combined;
+}
+
+/*!
+Combines given variable of cells [begin, end) of given
+range into result element-wise with given operation.
+*/
+template<
+	class Variable,
+	class Range
+> void reduce_variable(
+	const Reduction op,
+	typename Variable::data_type& result,
+	const Range& cells,
+	const std::size_t begin,
+	const std::size_t end
+) {
+	switch (op) {
+	case Reduction::min:
+		combine_variable<Variable>(result, cells, begin, end, Min_Reduction());
+		break;
+	case Reduction::max:
+		combine_variable<Variable>(result, cells, begin, end, Max_Reduction());
+		break;
+	default:
+		combine_variable<Variable>(result, cells, begin, end, Sum_Reduction());
+		break;
+	}
+}
+
+
+/*!
+Combines elements of source tuple into target
+with operations at the same index in ops, or sets
+elements to the identity of those operations,
+up to given index.
+*/
+template<std::size_t Index> struct Tuple_Reducer
+{
+	template<
+		std::size_t Nr_Of_Items,
+		class Tuple
+	> static void set_identity(
+		const std::array<Reduction, Nr_Of_Items>& ops,
+		Tuple& target
+	) {
+		using Data_T = typename std::tuple_element<Index - 1, Tuple>::type;
+
+		Tuple_Reducer<Index - 1>::set_identity(ops, target);
+		std::get<Index - 1>(target)
+			= get_reduction_identity_data<Data_T>(ops[Index - 1]);
+	}
+
+	template<
+		std::size_t Nr_Of_Items,
+		class Tuple
+	> static void reduce(
+		const std::array<Reduction, Nr_Of_Items>& ops,
+		Tuple& target,
+		const Tuple& source
+	) {
+		Tuple_Reducer<Index - 1>::reduce(ops, target, source);
+		reduce_data(
+			ops[Index - 1],
+			std::get<Index - 1>(target),
+			std::get<Index - 1>(source)
+		);
+	}
+};
+
+//! Stops recursion over elements of tuples.
+template<> struct Tuple_Reducer<0>
+{
+	template<
+		std::size_t Nr_Of_Items,
+		class Tuple
+	> static void set_identity(
+		const std::array<Reduction, Nr_Of_Items>&,
+		Tuple&
+	) {}
+
+	template<
+		std::size_t Nr_Of_Items,
+		class Tuple
+	> static void reduce(
+		const std::array<Reduction, Nr_Of_Items>&,
+		Tuple&,
+		const Tuple&
+	) {}
+};
+
+
+/*!
+Combines variables of cells [begin, end) of given range into
+elements of results starting from Index, each variable with
+operation at the same index in ops. Variables are given by
+position instead of type so one can be reduced several times.
+*/
+template<std::size_t Index, class... Variables> struct Block_Reducer
+{
+	template<
+		std::size_t Nr_Of_Items,
+		class Tuple,
+		class Range
+	> static void reduce(
+		const std::array<Reduction, Nr_Of_Items>&,
+		Tuple&,
+		const Range&,
+		const std::size_t,
+		const std::size_t
+	) {}
+};
+
+//! See the general version for documentation.
+template<
+	std::size_t Index,
+	class First_Variable,
+	class... Rest_Of_Variables
+> struct Block_Reducer<Index, First_Variable, Rest_Of_Variables...>
+{
+	template<
+		std::size_t Nr_Of_Items,
+		class Tuple,
+		class Range
+	> static void reduce(
+		const std::array<Reduction, Nr_Of_Items>& ops,
+		Tuple& results,
+		const Range& cells,
+		const std::size_t begin,
+		const std::size_t end
+	) {
+		reduce_variable<First_Variable>(
+			ops[Index],
+			std::get<Index>(results),
+			cells,
+			begin,
+			end
+		);
+		Block_Reducer<Index + 1, Rest_Of_Variables...>::reduce(
+			ops,
+			results,
+			cells,
+			begin,
+			end
+		);
+	}
+};
+
+
+/*!
+Cells reduced at a time by one thread, all variables are
+reduced over a block before the next one so cells are
+read from memory once and from cache afterwards.
+*/
+constexpr std::size_t reduce_block_size = 256;
+
+//! Implementation of variable versions of reduce().
+template<
+	class... Variables,
+	class Range
+> std::tuple<typename Variables::data_type...> reduce_variables(
+	const Range& cells,
+	const std::array<Reduction, sizeof...(Variables)>& ops,
+	const std::size_t chunk_size,
+	Thread_Pool& pool
+) {
+	using Result_T = std::tuple<typename Variables::data_type...>;
+
+	Result_T identity;
+	Tuple_Reducer<sizeof...(Variables)>::set_identity(ops, identity);
+
+	std::vector<Result_T> results(pool.size(), identity);
+	pool.parallel_for(
+		cells.size(),
+		chunk_size,
+		[&](const std::size_t begin, const std::size_t end, const std::size_t slot) {
+			auto& result = results[slot];
+			for (std::size_t block = begin; block < end; block += reduce_block_size) {
+				const auto block_end = std::min(block + reduce_block_size, end);
+				Block_Reducer<0, Variables...>::reduce(
+					ops,
+					result,
+					cells,
+					block,
+					block_end
+				);
+			}
+		}
+	);
+
+	Result_T result = identity;
+	for (const auto& partial: results) {
+		Tuple_Reducer<sizeof...(Variables)>::reduce(ops, result, partial);
+	}
+	return result;
+}
+
+} // namespace detail
+
+
+/*!
+Returns the results of kernel(cell_id, grid) over given cells
+combined with given operation in parallel, element-wise if
+kernel returns std::array. Returns the identity of op, e.g.
+the largest value for Reduction::min, if there are no cells.
+
+Generalization of parallel_min_cells() that can e.g. also
+sum up the mass in each cell or find the largest speed:
+@code
+const double total_mass = gensimcell::reduce_cells(
+	gensimcell::Reduction::sum, cell_ids, grid,
+	[](const uint64_t cell_id, Grid_T& grid) {
+		const auto& cell = *grid[cell_id];
+		return cell[Density()] * cell[Volume()];
+	}
+);
+@endcode
+*/
+template<
+	class Cell_Id_T,
+	class Grid_T,
+	class Kernel
+> detail::Kernel_Result<Kernel, Cell_Id_T, Grid_T> reduce_cells(
+	const Reduction op,
+	const std::vector<Cell_Id_T>& cell_ids,
+	Grid_T& grid,
+	Kernel kernel,
+	const std::size_t chunk_size = 0,
+	Thread_Pool& pool = get_default_thread_pool()
+) {
+	using Result_T = detail::Kernel_Result<Kernel, Cell_Id_T, Grid_T>;
+	static_assert(
+		detail::is_reducible<Result_T>(),
+		"Kernel must return arithmetic data or std::array of it"
+	);
+
+	return parallel_reduce_cells(
+		cell_ids,
+		grid,
+		kernel,
+		detail::get_reduction_identity_data<Result_T>(op),
+		[op](Result_T a, const Result_T& b) {
+			detail::reduce_data(op, a, b);
+			return a;
+		},
+		chunk_size,
+		pool
+	);
+}
+
+/*!
+Returns data of given variable over cells of given
+range combined with given operation, element-wise if
+the variable's data is std::array. Returns the identity
+of op, e.g. the largest value for Reduction::min, if
+the range is empty.
+
+Range must be a random access range of cells, e.g.
+std::vector or Partitioned_Cells. Cells are reduced in
+parallel by threads of given pool in chunks of chunk_size
+cells, 0 meaning automatic, and within each thread with
+loops that can be vectorized by the compiler.
+
+Example:
+@code
+std::vector<Cell> cells(...);
+const double total_density
+	= gensimcell::reduce<Density>(cells, gensimcell::Reduction::sum);
+@endcode
+*/
+template<
+	class Variable,
+	class Range
+> typename Variable::data_type reduce(
+	const Range& cells,
+	const Reduction op,
+	const std::size_t chunk_size = 0,
+	Thread_Pool& pool = get_default_thread_pool()
+) {
+	static_assert(
+		detail::is_reducible<typename Variable::data_type>(),
+		"Data of Variable must be arithmetic or std::array of it"
+	);
+
+	return std::get<0>(
+		detail::reduce_variables<Variable>(cells, {{op}}, chunk_size, pool)
+	);
+}
+
+/*!
+Returns data of given variables over cells of given range,
+each combined with operation at the same index in ops.
+
+Same as the single variable version of reduce() but all
+variables are reduced in one pass over cells. Example
+computing total density, largest velocity components and
+number of particles:
+@code
+double total_density;
+std::array<double, 3> max_velocity;
+uint64_t total_particles;
+std::tie(total_density, max_velocity, total_particles)
+	= gensimcell::reduce<Density, Velocity, Number_Of_Particles>(
+		cells,
+		{{
+			gensimcell::Reduction::sum,
+			gensimcell::Reduction::max,
+			gensimcell::Reduction::sum
+		}}
+	);
+@endcode
+*/
+template<
+	class... Variables,
+	class Range
+> std::tuple<typename Variables::data_type...> reduce(
+	const Range& cells,
+	const std::array<Reduction, sizeof...(Variables)>& ops,
+	const std::size_t chunk_size = 0,
+	Thread_Pool& pool = get_default_thread_pool()
+) {
+	static_assert(
+		sizeof...(Variables) > 0,
+		"At least one variable must be given"
+	);
+	static_assert(
+		detail::Are_Reducible<typename Variables::data_type...>::value,
+		"Data of Variables must be arithmetic or std::array of it"
+	);
+
+	return detail::reduce_variables<Variables...>(cells, ops, chunk_size, pool);
+}
+
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 3)
+
+namespace detail {
+
+//! Returns the MPI operation equal to given one.
+inline MPI_Op get_reduction_mpi_op(const Reduction op)
+{
+	switch (op) {
+	case Reduction::min:
+		return MPI_MIN;
+	case Reduction::max:
+		return MPI_MAX;
+	default:
+		return MPI_SUM;
+	}
+}
+
+
+/*!
+Data of this process sent by the variable versions of
+reduce() with the operations used to combine it.
+*/
+template<class... Data_T> struct Reduction_Buffer
+{
+	std::array<Reduction, sizeof...(Data_T)> ops;
+	std::tuple<Data_T...> data;
+};
+
+/*!
+MPI_User_function combining len Buffer_Ts of in
+into inout with the operations stored in them.
+*/
+template<class Buffer_T> void reduce_buffers(
+	void* in,
+	void* inout,
+	int* len,
+	MPI_Datatype*
+) {
+	const auto* const source = static_cast<const Buffer_T*>(in);
+	auto* const target = static_cast<Buffer_T*>(inout);
+	for (int i = 0; i < *len; i++) {
+		Tuple_Reducer<std::tuple_size<decltype(target[i].data)>::value>::reduce(
+			target[i].ops,
+			target[i].data,
+			source[i].data
+		);
+	}
+}
+
+/*!
+Returns committed datatype of Buffer_T as bytes,
+MPI_DATATYPE_NULL on error. Created once and cached
+until the end of the program, must not be freed.
+*/
+template<class Buffer_T> MPI_Datatype get_buffer_datatype()
+{
+	static const MPI_Datatype datatype = [](){
+		MPI_Datatype created = MPI_DATATYPE_NULL;
+		if (
+			MPI_Type_contiguous(int(sizeof(Buffer_T)), MPI_BYTE, &created) != MPI_SUCCESS
+			or MPI_Type_commit(&created) != MPI_SUCCESS
+		) {
+			return MPI_DATATYPE_NULL;
+		}
+		return created;
+	}();
+	return datatype;
+}
+
+/*!
+Returns MPI operation that combines Buffer_Ts with
+reduce_buffers(), MPI_OP_NULL on error. Created once
+and cached until the end of the program, must not be
+freed.
+*/
+template<class Buffer_T> MPI_Op get_buffer_op()
+{
+	static const MPI_Op op = [](){
+		MPI_Op created = MPI_OP_NULL;
+		if (MPI_Op_create(&reduce_buffers<Buffer_T>, 1, &created) != MPI_SUCCESS) {
+			return MPI_OP_NULL;
+		}
+		return created;
+	}();
+	return op;
+}
+
+/*!
+Combines result of this process with results of other
+processes of comm, each element with operation at the
+same index in ops. Returns false on error.
+*/
+template<class... Data_T> bool all_reduce_tuple(
+	std::tuple<Data_T...>& result,
+	const std::array<Reduction, sizeof...(Data_T)>& ops,
+	MPI_Comm comm
+) {
+	using Buffer_T = Reduction_Buffer<Data_T...>;
+
+	const auto datatype = get_buffer_datatype<Buffer_T>();
+	const auto op = get_buffer_op<Buffer_T>();
+	if (datatype == MPI_DATATYPE_NULL or op == MPI_OP_NULL) {
+		return false;
+	}
+
+	const Buffer_T local{ops, result};
+	Buffer_T global(local);
+	if (
+		MPI_Allreduce(
+			&local,
+			&global,
+			1,
+			datatype,
+			op,
+			comm
+		) != MPI_SUCCESS
+	) {
+		return false;
+	}
+	result = global.data;
+	return true;
+}
+
+} // namespace detail
+
+/*!
+Reduces data of given variable over cells of given range
+on all processes of comm, see the local version of reduce().
+
+Stores the result in result on all processes and returns
+true, returns false on error. Collective over comm.
+*/
+template<
+	class Variable,
+	class Range
+> bool reduce(
+	const Range& cells,
+	const Reduction op,
+	MPI_Comm comm,
+	typename Variable::data_type& result,
+	const std::size_t chunk_size = 0,
+	Thread_Pool& pool = get_default_thread_pool()
+) {
+	static_assert(
+		detail::is_reducible<typename Variable::data_type>(),
+		"Data of Variable must be arithmetic or std::array of it"
+	);
+
+	const std::array<Reduction, 1> ops{{op}};
+	auto reduced = detail::reduce_variables<Variable>(cells, ops, chunk_size, pool);
+	if (not detail::all_reduce_tuple(reduced, ops, comm)) {
+		return false;
+	}
+	result = std::get<0>(reduced);
+	return true;
+}
+
+/*!
+Reduces data of given variables over cells of given range
+on all processes of comm, see the local version of reduce().
+
+Variables are reduced locally in one pass over cells and
+then between processes with one MPI_Allreduce regardless
+of their types or operations. Data is transferred as bytes
+so all processes must have the same data representation.
+
+Stores the results in result on all processes and returns
+true, returns false on error. Collective over comm.
+
+Example checking conservation of mass and particles:
+@code
+std::tuple<double, uint64_t> totals;
+if (not gensimcell::reduce<Density, Number_Of_Particles>(
+	cells,
+	{{gensimcell::Reduction::sum, gensimcell::Reduction::sum}},
+	comm,
+	totals
+)) {
+	abort();
+}
+@endcode
+*/
+template<
+	class... Variables,
+	class Range
+> bool reduce(
+	const Range& cells,
+	const std::array<Reduction, sizeof...(Variables)>& ops,
+	MPI_Comm comm,
+	std::tuple<typename Variables::data_type...>& result,
+	const std::size_t chunk_size = 0,
+	Thread_Pool& pool = get_default_thread_pool()
+) {
+	static_assert(
+		sizeof...(Variables) > 0,
+		"At least one variable must be given"
+	);
+	static_assert(
+		detail::Are_Reducible<typename Variables::data_type...>::value,
+		"Data of Variables must be arithmetic or std::array of it"
+	);
+
+	auto reduced = detail::reduce_variables<Variables...>(cells, ops, chunk_size, pool);
+	if (not detail::all_reduce_tuple(reduced, ops, comm)) {
+		return false;
+	}
+	result = reduced;
+	return true;
+}
+
+
+/*!
+Reduces a value over all processes without blocking, e.g.
+the time step of the next step while the solution of the
+current step is applied.
+
+Values of this process are added with add() or add_cells()
+and combined over processes with MPI_Iallreduce posted by
+start(). Other work can be done until the result is needed
+and retrieved with wait(). Values can be added for the next
+reduction while one is in progress.
+
+Data_T must be arithmetic or std::array of arithmetic
+data which is reduced element-wise. One reduction must
+not be used from several threads at the same time.
+
+Example overlapping the time step reduction with
+applying the solution:
+@code
+gensimcell::Async_Reduction<double> time_step(comm, gensimcell::Reduction::min);
+...
+time_step.add_cells(inner_cells, grid, solve_kernel);
+time_step.add_cells(outer_cells, grid, solve_kernel);
+time_step.start();
+gensimcell::parallel_for_cells(inner_cells, grid, apply_kernel);
+gensimcell::parallel_for_cells(outer_cells, grid, apply_kernel);
+if (not time_step.wait()) {
+	abort();
+}
+dt = CFL * time_step.get_result();
+@endcode
+*/
+template<class Data_T> class Async_Reduction
+{
+	static_assert(
+		detail::is_reducible<Data_T>(),
+		"Data_T must be arithmetic or std::array of it"
+	);
+
+public:
+
+	/*!
+	Creates a reduction over processes of comm with given
+	operation.
+
+	Collective over comm, reductions must be created in
+	the same order on all processes because comm is
+	duplicated. Reductions of the same object must be
+	started in the same order on all processes.
+	*/
+	Async_Reduction(
+		MPI_Comm comm,
+		const Reduction given_op
+	) :
+		op(given_op),
+		local(detail::get_reduction_identity_data<Data_T>(given_op)),
+		sent(local),
+		result(local)
+	{
+		if (MPI_Comm_dup(comm, &this->comm) != MPI_SUCCESS) {
+			this->comm = MPI_COMM_NULL;
+		}
+	}
+
+	Async_Reduction(const Async_Reduction&) = delete;
+	Async_Reduction& operator=(const Async_Reduction&) = delete;
+
+	~Async_Reduction()
+	{
+		int finalized = 0;
+		MPI_Finalized(&finalized);
+		if (finalized != 0) {
+			return;
+		}
+		this->wait();
+		if (this->comm != MPI_COMM_NULL) {
+			MPI_Comm_free(&this->comm);
+		}
+	}
+
+
+	//! Combines given value with values of this process.
+	void add(const Data_T& value)
+	{
+		detail::reduce_data(this->op, this->local, value);
+	}
+
+	/*!
+	Combines results of kernel(cell_id, grid) over given
+	cells computed in parallel with values of this process,
+	see reduce_cells().
+	*/
+	template<
+		class Cell_Id_T,
+		class Grid_T,
+		class Kernel
+	> void add_cells(
+		const std::vector<Cell_Id_T>& cell_ids,
+		Grid_T& grid,
+		Kernel kernel,
+		const std::size_t chunk_size = 0,
+		Thread_Pool& pool = get_default_thread_pool()
+	) {
+		this->add(reduce_cells(this->op, cell_ids, grid, kernel, chunk_size, pool));
+	}
+
+
+	/*!
+	Starts combining values added since previous
+	start() with those of other processes.
+
+	Returns false if a reduction is already in progress
+	or on error. Added values are reset to the identity
+	of the operation if the reduction was started.
+	*/
+	bool start()
+	{
+		if (this->comm == MPI_COMM_NULL or this->active) {
+			return false;
+		}
+
+		this->sent = this->local;
+		if (
+			MPI_Iallreduce(
+				&this->sent,
+				&this->result,
+				int(Data_Elements_T::count),
+				detail::get_element_mpi_datatype<Element_T>(),
+				detail::get_reduction_mpi_op(this->op),
+				this->comm,
+				&this->request
+			) != MPI_SUCCESS
+		) {
+			this->request = MPI_REQUEST_NULL;
+			return false;
+		}
+
+		this->active = true;
+		this->local = detail::get_reduction_identity_data<Data_T>(this->op);
+		return true;
+	}
+
+	//! Adds given value and starts the reduction, see start().
+	bool start(const Data_T& value)
+	{
+		if (this->active) {
+			return false;
+		}
+		this->add(value);
+		return this->start();
+	}
+
+
+	/*!
+	Progresses the reduction in progress and returns
+	true if it has finished, after which wait() returns
+	immediately. Returns true if no reduction is in
+	progress and false on error.
+	*/
+	bool test()
+	{
+		if (not this->active) {
+			return true;
+		}
+		int finished = 0;
+		if (MPI_Test(&this->request, &finished, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+			return false;
+		}
+		return finished != 0;
+	}
+
+	/*!
+	Waits until the reduction in progress has finished.
+	Returns false on error, true if no reduction is in
+	progress.
+	*/
+	bool wait()
+	{
+		if (not this->active) {
+			return true;
+		}
+		this->active = false;
+		return MPI_Wait(&this->request, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+	}
+
+
+	/*!
+	Returns the result of the latest reduction that
+	has been waited for, the identity of the operation
+	if no reduction has been waited for. Must not be
+	called while a reduction is in progress.
+	*/
+	const Data_T& get_result() const
+	{
+		return this->result;
+	}
+
+	//! Returns true if a reduction has been started but not waited for.
+	bool is_active() const
+	{
+		return this->active;
+	}
+
+	//! Returns the communicator used by this reduction.
+	MPI_Comm get_comm() const
+	{
+		return this->comm;
+	}
+
+
+private:
+
+	using Data_Elements_T = detail::Data_Elements<Data_T>;
+	using Element_T = detail::Reduced_Element<Data_T>;
+
+	MPI_Comm comm = MPI_COMM_NULL;
+	const Reduction op;
+	Data_T local, sent, result;
+	bool active = false;
+	MPI_Request request = MPI_REQUEST_NULL;
+};
+
+#endif // ifdef MPI_VERSION
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_REDUCTION_HPP
@@ -0,0 +1,459 @@
+/*
+Self-describing schema of saved data of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_SCHEMA_HPP
+#define GENSIMCELL_SCHEMA_HPP
+
+
+#include "cstddef"
+#include "cstdint"
+#include "fstream"
+#include "iterator"
+#include "limits"
+#include "string"
+#include "utility"
+#include "vector"
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+
+#include "boost/logic/tribool.hpp"
+
+#endif // ifdef MPI_VERSION
+
+#include "for_each_variable.hpp"
+#include "variable_table.hpp"
+
+
+namespace gensimcell {
+
+
+namespace detail {
+
+//! Appends given number of bytes of value in little-endian order.
+inline void append_little_endian(
+	std::string& bytes,
+	const std::uint64_t value,
+	const std::size_t nr_bytes
+) {
+	for (std::size_t i = 0; i < nr_bytes; i++) {
+		bytes += char((value >> (8 * i)) & 0xFF);
+	}
+}
+
+/*!
+Reads given number of little-endian bytes at position of
+bytes of given size into value and advances position,
+returns false if there aren't enough bytes.
+*/
+inline bool extract_little_endian(
+	const char* const bytes,
+	const std::size_t size,
+	std::size_t& position,
+	std::uint64_t& value,
+	const std::size_t nr_bytes
+) {
+	if (size < position or size - position < nr_bytes) {
+		return false;
+	}
+	value = 0;
+	for (std::size_t i = 0; i < nr_bytes; i++) {
+		value |= std::uint64_t(
+			static_cast<unsigned char>(bytes[position + i])
+		) << (8 * i);
+	}
+	position += nr_bytes;
+	return true;
+}
+
+//! See the general version for documentation.
+inline bool extract_little_endian(
+	const std::string& bytes,
+	std::size_t& position,
+	std::uint64_t& value,
+	const std::size_t nr_bytes
+) {
+	return extract_little_endian(
+		bytes.data(),
+		bytes.size(),
+		position,
+		value,
+		nr_bytes
+	);
+}
+
+} // namespace detail
+
+
+//! Value of Schema_Variable::packed_offset when it isn't known.
+constexpr std::uint64_t unknown_packed_offset
+	= std::numeric_limits<std::uint64_t>::max();
+
+
+//! Description of one variable in a Schema.
+struct Schema_Variable
+{
+	//! See Variable_Info
+	std::string name;
+	Element_Type element_type;
+	std::uint64_t element_size, element_count, size;
+	bool variable_length;
+
+	//! Whether variable's data is included in saved data
+	bool transferred;
+
+	/*!
+	Whether the transfer of this variable was decided per
+	cell in which case transferred only tells whether the
+	cell given to Schema::create() included it.
+	*/
+	bool transfer_per_cell;
+
+	/*!
+	Offset in bytes of variable's data from the beginning of
+	a cell's saved data or unknown_packed_offset if it depends
+	on the cell, e.g. after a variable of variable length.
+	*/
+	std::uint64_t packed_offset;
+
+
+	#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+
+	/*!
+	Returns the named MPI datatype of the elements
+	of this variable or MPI_DATATYPE_NULL.
+	*/
+	MPI_Datatype get_element_datatype() const
+	{
+		switch (this->element_type) {
+		case Element_Type::boolean:
+			#ifdef MPI_CXX_BOOL
+			return MPI_CXX_BOOL;
+			#else
+			return MPI_DATATYPE_NULL;
+			#endif
+		case Element_Type::signed_integer:
+			switch (this->element_size) {
+			case 1: return MPI_INT8_T;
+			case 2: return MPI_INT16_T;
+			case 4: return MPI_INT32_T;
+			case 8: return MPI_INT64_T;
+			default: return MPI_DATATYPE_NULL;
+			}
+		case Element_Type::unsigned_integer:
+			switch (this->element_size) {
+			case 1: return MPI_UINT8_T;
+			case 2: return MPI_UINT16_T;
+			case 4: return MPI_UINT32_T;
+			case 8: return MPI_UINT64_T;
+			default: return MPI_DATATYPE_NULL;
+			}
+		case Element_Type::floating_point:
+			if (this->element_size == sizeof(float)) {
+				return MPI_FLOAT;
+			} else if (this->element_size == sizeof(double)) {
+				return MPI_DOUBLE;
+			} else if (this->element_size == sizeof(long double)) {
+				return MPI_LONG_DOUBLE;
+			} else {
+				return MPI_DATATYPE_NULL;
+			}
+		default:
+			return MPI_DATATYPE_NULL;
+		}
+	}
+
+	#endif // ifdef MPI_VERSION
+};
+
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+
+namespace detail {
+
+//! Records in a Schema whether each variable of a cell is transferred.
+template <class Cell_T> struct Schema_Transfer_Setter
+{
+	const Cell_T& cell;
+	std::vector<Schema_Variable>& variables;
+	std::size_t index;
+
+	template<class Variable, class Data_T> void operator()(
+		const Variable& variable,
+		const Data_T&
+	) {
+		auto& schema_variable = this->variables[this->index++];
+		schema_variable.transferred = this->cell.is_transferred(variable);
+		schema_variable.transfer_per_cell = boost::logic::indeterminate(
+			Cell_T::get_transfer_all(variable)
+		);
+	}
+};
+
+} // namespace detail
+
+#endif // ifdef MPI_VERSION
+
+
+/*!
+Describes which variables of a cell type are saved and how.
+
+Created from a cell with Schema::create() when variables to
+be saved have been selected with set_transfer_all(), etc.
+Can be serialized into a compact binary format which is stored
+alongside saved data so that readers can decode the data
+without knowing the cell type:
+@code
+Cell_T::set_transfer_all(true, Density(), Velocity());
+const auto schema = gensimcell::Schema::create(Cell_T());
+schema.write("data.dc.schema");
+...
+gensimcell::Schema schema;
+if (schema.read("data.dc.schema")) {
+	const auto i = schema.find("Density");
+	...
+}
+@endcode
+
+Binary format, all integers little-endian:
+- "GSCS", version (uint32) = 1, fixed_size (uint64),
+  number of variables (uint32)
+- for each variable: length of name (uint32), name,
+  element_type (uint8), flags (uint8, bit 0 = transferred,
+  1 = transfer_per_cell, 2 = variable_length), element_size,
+  element_count, size and packed_offset (uint64)
+*/
+class Schema
+{
+public:
+
+	//! Variables in the same order as in the cell type.
+	std::vector<Schema_Variable> variables;
+
+	/*!
+	Number of bytes of saved data of each cell whose offset
+	doesn't depend on the cell, e.g. size of the saved data if
+	all transferred variables are of fixed size.
+	*/
+	std::uint64_t fixed_size = 0;
+
+
+	/*!
+	Returns the schema of given cell type with the
+	variables which given cell currently transfers.
+
+	Without MPI all variables are assumed to be saved.
+	*/
+	template<class Cell_T> static Schema create(const Cell_T& cell)
+	{
+		using Table = Variable_Table<Cell_T>;
+
+		Schema schema;
+		for (std::size_t i = 0; i < Table::size(); i++) {
+			const auto& info = Table::info(i);
+			schema.variables.push_back(Schema_Variable{
+				info.name,
+				info.element_type,
+				info.element_size,
+				info.element_count,
+				info.size,
+				info.variable_length,
+				true,
+				false,
+				unknown_packed_offset
+			});
+		}
+
+		#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+		for_each_variable(
+			cell,
+			detail::Schema_Transfer_Setter<Cell_T>{cell, schema.variables, 0}
+		);
+		#else
+		(void)cell;
+		#endif
+
+		// offsets of saved data in order of variables
+		std::uint64_t offset = 0;
+		bool offset_known = true;
+		for (auto& variable: schema.variables) {
+			if (not variable.transferred) {
+				continue;
+			}
+			if (not offset_known) {
+				break;
+			}
+
+			variable.packed_offset = offset;
+			if (
+				variable.variable_length
+				or variable.transfer_per_cell
+				or variable.element_count == 0
+			) {
+				offset_known = false;
+			} else {
+				offset += variable.element_size * variable.element_count;
+			}
+		}
+		schema.fixed_size = offset;
+
+		return schema;
+	}
+
+
+	//! Returns index of variable with given name like Variable_Table::find().
+	std::size_t find(const std::string& name) const
+	{
+		return detail::find_variable_name(this->variables, name);
+	}
+
+
+	//! Returns the schema in binary format.
+	std::string to_bytes() const
+	{
+		std::string bytes("GSCS");
+		detail::append_little_endian(bytes, 1, 4);
+		detail::append_little_endian(bytes, this->fixed_size, 8);
+		detail::append_little_endian(bytes, this->variables.size(), 4);
+		for (const auto& variable: this->variables) {
+			detail::append_little_endian(bytes, variable.name.size(), 4);
+			bytes += variable.name;
+			detail::append_little_endian(
+				bytes,
+				static_cast<std::uint64_t>(variable.element_type),
+				1
+			);
+			detail::append_little_endian(
+				bytes,
+				(variable.transferred ? 1 : 0)
+				| (variable.transfer_per_cell ? 2 : 0)
+				| (variable.variable_length ? 4 : 0),
+				1
+			);
+			detail::append_little_endian(bytes, variable.element_size, 8);
+			detail::append_little_endian(bytes, variable.element_count, 8);
+			detail::append_little_endian(bytes, variable.size, 8);
+			detail::append_little_endian(bytes, variable.packed_offset, 8);
+		}
+		return bytes;
+	}
+
+	/*!
+	Sets this schema from given binary format.
+
+	Returns false if given bytes aren't a valid schema
+	in which case this schema isn't modified.
+	*/
+	bool from_bytes(const std::string& bytes)
+	{
+		std::size_t position = 4;
+		std::uint64_t version = 0, fixed_size = 0, nr_variables = 0;
+		if (
+			bytes.compare(0, 4, "GSCS") != 0
+			or not detail::extract_little_endian(bytes, position, version, 4)
+			or version != 1
+			or not detail::extract_little_endian(bytes, position, fixed_size, 8)
+			or not detail::extract_little_endian(bytes, position, nr_variables, 4)
+		) {
+			return false;
+		}
+
+		std::vector<Schema_Variable> variables;
+		for (std::uint64_t i = 0; i < nr_variables; i++) {
+			Schema_Variable variable;
+			std::uint64_t name_length = 0, element_type = 0, flags = 0;
+			if (
+				not detail::extract_little_endian(bytes, position, name_length, 4)
+				or bytes.size() - position < name_length
+			) {
+				return false;
+			}
+			variable.name = bytes.substr(position, name_length);
+			position += name_length;
+
+			if (
+				not detail::extract_little_endian(bytes, position, element_type, 1)
+				or element_type > static_cast<std::uint64_t>(Element_Type::floating_point)
+				or not detail::extract_little_endian(bytes, position, flags, 1)
+				or not detail::extract_little_endian(bytes, position, variable.element_size, 8)
+				or not detail::extract_little_endian(bytes, position, variable.element_count, 8)
+				or not detail::extract_little_endian(bytes, position, variable.size, 8)
+				or not detail::extract_little_endian(bytes, position, variable.packed_offset, 8)
+			) {
+				return false;
+			}
+			variable.element_type = static_cast<Element_Type>(element_type);
+			variable.transferred = (flags & 1) > 0;
+			variable.transfer_per_cell = (flags & 2) > 0;
+			variable.variable_length = (flags & 4) > 0;
+
+			variables.push_back(variable);
+		}
+
+		if (position != bytes.size()) {
+			return false;
+		}
+
+		this->fixed_size = fixed_size;
+		this->variables = std::move(variables);
+		return true;
+	}
+
+
+	//! Writes the schema in binary format into given file, returns success.
+	bool write(const std::string& file_name) const
+	{
+		std::ofstream file(file_name, std::ios::binary);
+		const auto bytes = this->to_bytes();
+		file.write(bytes.data(), std::streamsize(bytes.size()));
+		return bool(file);
+	}
+
+	//! Reads the schema from given file written by write(), returns success.
+	bool read(const std::string& file_name)
+	{
+		std::ifstream file(file_name, std::ios::binary);
+		if (not file) {
+			return false;
+		}
+		const std::string bytes{
+			std::istreambuf_iterator<char>(file),
+			std::istreambuf_iterator<char>()
+		};
+		return this->from_bytes(bytes);
+	}
+};
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_SCHEMA_HPP
@@ -0,0 +1,494 @@
+/*
+Task graph that runs kernels of a time step in dependency order.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_TASK_GRAPH_HPP
+#define GENSIMCELL_TASK_GRAPH_HPP
+
+
+#include "algorithm"
+#include "condition_variable"
+#include "cstddef"
+#include "functional"
+#include "map"
+#include "mutex"
+#include "string"
+#include "typeindex"
+#include "typeinfo"
+#include "utility"
+#include "vector"
+
+#include "parallel_for.hpp"
+
+
+namespace gensimcell {
+
+
+/*!
+Cells of a process accessed by a task of Task_Graph.
+
+Inner cells have only local neighbors, outer cells have
+neighbors on other processes and remote cells are the local
+copies of those neighbors, e.g. dccrg's local cells not on
+process boundary, local cells on process boundary and remote
+cells on process boundary. Values can be combined with |.
+*/
+enum class Cell_Set : unsigned char {
+	none = 0,
+	inner = 1,
+	outer = 2,
+	remote = 4,
+	local = 3,
+	all = 7
+};
+
+inline Cell_Set operator|(const Cell_Set a, const Cell_Set b)
+{
+	return static_cast<Cell_Set>(
+		static_cast<unsigned char>(a) | static_cast<unsigned char>(b)
+	);
+}
+
+inline Cell_Set operator&(const Cell_Set a, const Cell_Set b)
+{
+	return static_cast<Cell_Set>(
+		static_cast<unsigned char>(a) & static_cast<unsigned char>(b)
+	);
+}
+
+
+//! Access of a task to data of one variable in a set of cells.
+struct Variable_Access
+{
+	std::type_index variable;
+	Cell_Set cells;
+	bool write;
+};
+
+
+/*!
+Returns accesses that read given variables in given cells, e.g.
+a kernel using data of neighbors of inner cells reads inner and
+outer cells and one using neighbors of outer cells reads all.
+*/
+template<class... Variables> std::vector<Variable_Access> reads(
+	const Cell_Set cells
+) {
+	return std::vector<Variable_Access>{
+		Variable_Access{std::type_index(typeid(Variables)), cells, false}...
+	};
+}
+
+//! Returns accesses that write given variables in given cells.
+template<class... Variables> std::vector<Variable_Access> writes(
+	const Cell_Set cells
+) {
+	return std::vector<Variable_Access>{
+		Variable_Access{std::type_index(typeid(Variables)), cells, true}...
+	};
+}
+
+//! Returns accesses of both given lists.
+inline std::vector<Variable_Access> operator+(
+	std::vector<Variable_Access> a,
+	const std::vector<Variable_Access>& b
+) {
+	a.insert(a.end(), b.begin(), b.end());
+	return a;
+}
+
+
+/*!
+Runs tasks of e.g. one time step of a simulation in an order
+derived from the variables and cells each task reads and writes.
+
+Tasks are added in the order in which they would be run serially
+and a task depends on every earlier task that writes data it
+accesses or reads data it writes, so the result is the same as
+when running tasks serially. Tasks whose dependencies have
+finished run on a Thread_Pool, except main thread tasks and
+exchanges which run on the thread that calls run() in the order
+they were added, as needed by e.g. MPI without thread support.
+
+A halo exchange is split into a start and a wait. Start runs as
+soon as outer cells of exchanged variables are no longer written
+and wait is delayed until remote copies are needed or there is
+no other work, so that the exchange overlaps with computation.
+Exchanges run one at a time in the order they were added, e.g.
+dccrg supports only one update of remote neighbors at a time.
+
+The graph can be run any number of times, e.g. once per time step.
+
+Example of game of life in dccrg:
+@code
+gensimcell::Task_Graph graph;
+graph.add_exchange(
+	gensimcell::reads<Is_Alive>(gensimcell::Cell_Set::outer),
+	[&](){
+		Cell::set_transfer_all(true, Is_Alive());
+		grid.start_remote_neighbor_copy_updates();
+	},
+	[&](){
+		grid.wait_remote_neighbor_copy_updates();
+		Cell::set_transfer_all(false, Is_Alive());
+	}
+);
+graph.add_task(
+	gensimcell::reads<Is_Alive>(gensimcell::Cell_Set::local)
+	+ gensimcell::writes<Live_Neighbors>(gensimcell::Cell_Set::inner),
+	[&](){ gol::solve<...>(inner_cells, grid); }
+);
+...
+while (...) {
+	graph.run();
+}
+@endcode
+*/
+class Task_Graph
+{
+public:
+
+	using Task_Id = std::size_t;
+
+
+	/*!
+	Adds a task that calls given function on a thread of the pool
+	given to run(), returns its id. function can use the same pool
+	e.g. via parallel_for_cells().
+	*/
+	Task_Id add_task(
+		const std::vector<Variable_Access>& accesses,
+		std::function<void()> function
+	) {
+		return this->add(accesses, accesses, std::move(function), Kind::pool);
+	}
+
+
+	/*!
+	Adds a task that calls given function on the thread calling
+	run(), after all earlier main thread tasks, returns its id.
+	*/
+	Task_Id add_main_thread_task(
+		const std::vector<Variable_Access>& accesses,
+		std::function<void()> function
+	) {
+		return this->add(accesses, accesses, std::move(function), Kind::main);
+	}
+
+
+	/*!
+	Adds an update of remote copies of outer cells of given
+	variables, returns id of the task waiting for the update.
+
+	Variables are read from accesses, which can be e.g.
+	reads<Is_Alive, Density>(Cell_Set::outer), regardless of
+	the cells they specify. start starts the update, e.g. switches
+	on the transfer of variables and starts sending and receiving,
+	and wait finishes it. Both are called on the thread calling
+	run(). Outer cells of variables aren't written and remote cells
+	aren't accessed by other tasks between start and wait.
+	*/
+	Task_Id add_exchange(
+		const std::vector<Variable_Access>& accesses,
+		std::function<void()> start,
+		std::function<void()> wait
+	) {
+		std::vector<Variable_Access> exchange_accesses;
+		for (const auto& access: accesses) {
+			exchange_accesses.push_back({access.variable, Cell_Set::outer, false});
+			exchange_accesses.push_back({access.variable, Cell_Set::remote, true});
+		}
+
+		// later tasks must wait for the wait instead of start
+		const auto start_id = this->add(
+			exchange_accesses,
+			std::vector<Variable_Access>(),
+			std::move(start),
+			Kind::main
+		);
+		const auto wait_id = this->add(
+			std::vector<Variable_Access>(),
+			exchange_accesses,
+			std::move(wait),
+			Kind::wait
+		);
+		this->add_dependency(start_id, wait_id);
+		return wait_id;
+	}
+
+
+	/*!
+	Makes task after wait for task before in addition
+	to dependencies derived from accesses of tasks.
+	*/
+	void add_dependency(const Task_Id before, const Task_Id after)
+	{
+		auto& successors = this->tasks[before].successors;
+		if (std::find(successors.begin(), successors.end(), after) == successors.end()) {
+			successors.push_back(after);
+			this->tasks[after].nr_dependencies++;
+		}
+	}
+
+
+	//! Returns the number of tasks including both parts of exchanges.
+	std::size_t size() const
+	{
+		return this->tasks.size();
+	}
+
+	//! Returns ids of tasks that must finish before given task starts.
+	std::vector<Task_Id> get_dependencies(const Task_Id task) const
+	{
+		std::vector<Task_Id> dependencies;
+		for (Task_Id i = 0; i < this->tasks.size(); i++) {
+			const auto& successors = this->tasks[i].successors;
+			if (std::find(successors.begin(), successors.end(), task) != successors.end()) {
+				dependencies.push_back(i);
+			}
+		}
+		return dependencies;
+	}
+
+
+	/*!
+	Runs all tasks once using given pool and returns after they
+	have finished, the calling thread also runs tasks of the pool.
+	*/
+	void run(Thread_Pool& pool = get_default_thread_pool())
+	{
+		State state;
+		state.dependencies.resize(this->tasks.size());
+		for (Task_Id i = 0; i < this->tasks.size(); i++) {
+			state.dependencies[i] = this->tasks[i].nr_dependencies;
+			if (state.dependencies[i] == 0) {
+				this->make_ready(state, i);
+			}
+		}
+
+		std::unique_lock<std::mutex> lock(state.mutex);
+		while (state.finished < this->tasks.size()) {
+
+			while (state.ready_pool.size() > 0) {
+				const auto task = state.ready_pool.back();
+				state.ready_pool.pop_back();
+				pool.submit([this, &state, task]() {
+					this->tasks[task].function();
+					this->finish(state, task);
+				});
+			}
+
+			if (state.ready_main.size() > 0) {
+				const auto task = state.ready_main.front();
+				state.ready_main.erase(state.ready_main.begin());
+				lock.unlock();
+				this->tasks[task].function();
+				this->finish(state, task);
+				lock.lock();
+				continue;
+			}
+
+			lock.unlock();
+			const bool ran_task = pool.run_pending_task();
+			lock.lock();
+			if (ran_task) {
+				continue;
+			}
+
+			if (state.ready_wait.size() > 0) {
+				const auto task = state.ready_wait.front();
+				state.ready_wait.erase(state.ready_wait.begin());
+				lock.unlock();
+				this->tasks[task].function();
+				this->finish(state, task);
+				lock.lock();
+				continue;
+			}
+
+			if (
+				state.finished < this->tasks.size()
+				and state.ready_pool.size() == 0
+				and state.ready_main.size() == 0
+			) {
+				state.changed.wait(lock);
+			}
+		}
+	}
+
+
+private:
+
+	enum class Kind {
+		//! runs on a thread of the pool
+		pool,
+		//! runs on the thread calling run()
+		main,
+		//! wait of an exchange, runs on the thread calling run()
+		wait
+	};
+
+	struct Task
+	{
+		std::function<void()> function;
+		Kind kind;
+		std::vector<Task_Id> successors;
+		std::size_t nr_dependencies;
+	};
+
+	//! Earlier tasks that accessed one variable in one set of cells.
+	struct Access_History
+	{
+		bool has_writer = false;
+		Task_Id last_writer = 0;
+		std::vector<Task_Id> readers;
+	};
+
+	//! State of one call to run().
+	struct State
+	{
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::vector<std::size_t> dependencies;
+		std::vector<Task_Id> ready_pool, ready_main, ready_wait;
+		std::size_t finished = 0;
+	};
+
+
+	std::vector<Task> tasks;
+	std::map<std::pair<std::type_index, unsigned char>, Access_History> history;
+	bool has_main_task = false;
+	Task_Id last_main_task = 0;
+
+
+	/*!
+	Adds a task whose dependencies are derived from
+	given_accesses and whose accesses later tasks
+	depend on are given by taken_accesses.
+	*/
+	Task_Id add(
+		const std::vector<Variable_Access>& given_accesses,
+		const std::vector<Variable_Access>& taken_accesses,
+		std::function<void()> function,
+		const Kind kind
+	) {
+		const Task_Id id = this->tasks.size();
+		this->tasks.push_back({std::move(function), kind, {}, 0});
+
+		for (const auto& access: given_accesses) {
+			for (unsigned char cells = 1; cells <= 4; cells <<= 1) {
+				if ((access.cells & static_cast<Cell_Set>(cells)) == Cell_Set::none) {
+					continue;
+				}
+				const auto item = this->history.find(std::make_pair(access.variable, cells));
+				if (item == this->history.end()) {
+					continue;
+				}
+				const auto& earlier = item->second;
+				if (earlier.has_writer and earlier.last_writer != id) {
+					this->add_dependency(earlier.last_writer, id);
+				}
+				if (access.write) {
+					for (const auto reader: earlier.readers) {
+						if (reader != id) {
+							this->add_dependency(reader, id);
+						}
+					}
+				}
+			}
+		}
+
+		for (const auto& access: taken_accesses) {
+			for (unsigned char cells = 1; cells <= 4; cells <<= 1) {
+				if ((access.cells & static_cast<Cell_Set>(cells)) == Cell_Set::none) {
+					continue;
+				}
+				auto& earlier = this->history[std::make_pair(access.variable, cells)];
+				if (access.write) {
+					earlier.has_writer = true;
+					earlier.last_writer = id;
+					earlier.readers.clear();
+				} else if (
+					earlier.readers.size() == 0
+					or earlier.readers.back() != id
+				) {
+					earlier.readers.push_back(id);
+				}
+			}
+		}
+
+		// main thread tasks run in the order they were added
+		if (kind != Kind::pool) {
+			if (this->has_main_task) {
+				this->add_dependency(this->last_main_task, id);
+			}
+			this->has_main_task = true;
+			this->last_main_task = id;
+		}
+
+		return id;
+	}
+
+
+	//! Adds given task to ready tasks of its kind, caller holds the lock if needed.
+	void make_ready(State& state, const Task_Id task) const
+	{
+		switch (this->tasks[task].kind) {
+		case Kind::pool:
+			state.ready_pool.push_back(task);
+			break;
+		case Kind::main:
+			state.ready_main.push_back(task);
+			break;
+		case Kind::wait:
+			state.ready_wait.push_back(task);
+			break;
+		}
+	}
+
+	//! Records that given task has finished and wakes up run().
+	void finish(State& state, const Task_Id task) const
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		for (const auto successor: this->tasks[task].successors) {
+			if (--state.dependencies[successor] == 0) {
+				this->make_ready(state, successor);
+			}
+		}
+		state.finished++;
+		state.changed.notify_all();
+	}
+};
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_TASK_GRAPH_HPP
@@ -34,6 +34,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define GENSIMCELL_TYPE_SUPPORT_HPP
 
 
+#include "cstddef"
 #include "type_traits"
 
 
@@ -60,6 +61,97 @@ template <
 > struct is_gensimcell<Cell<Transfer_Policy, Variables...>> : std::true_type {};
 
 
+/*!
+Indicates whether has been given a range of generic simulation cells.
+
+Derives from std::true_type if given a container whose value_type
+is a generic simulation cell, for example std::vector<Cell> or
+std::array<Cell, N>, otherwise derives from std::false_type.
+*/
+template <class T, class Enable = void> struct is_gensimcell_range
+	: std::false_type {};
+
+
+//! std::true_type version of is_gensimcell_range.
+template <class T> struct is_gensimcell_range<
+	T,
+	typename std::enable_if<
+		is_gensimcell<typename T::value_type>::value
+	>::type
+> : std::true_type {};
+
+
+namespace detail {
+
+/*!
+contains_variable<Variable, Variables...>::value is true
+if Variable is one of Variables and false otherwise.
+*/
+template <class Variable, class... Variables> struct contains_variable
+	: std::false_type {};
+
+//! See the general version for documentation.
+template <
+	class Variable,
+	class First_Variable,
+	class... Rest_Of_Variables
+> struct contains_variable<Variable, First_Variable, Rest_Of_Variables...>
+	: std::integral_constant<
+		bool,
+		std::is_same<Variable, First_Variable>::value
+		or contains_variable<Variable, Rest_Of_Variables...>::value
+	> {};
+
+
+/*!
+index_of_variable<Variable, Variables...>::value is the
+index of the first Variable in Variables.
+
+Compilation fails if Variable isn't one of Variables.
+*/
+template <class Variable, class... Variables> struct index_of_variable;
+
+//! See the general version for documentation.
+template <
+	class Variable,
+	class... Rest_Of_Variables
+> struct index_of_variable<Variable, Variable, Rest_Of_Variables...>
+	: std::integral_constant<std::size_t, 0> {};
+
+//! See the general version for documentation.
+template <
+	class Variable,
+	class First_Variable,
+	class... Rest_Of_Variables
+> struct index_of_variable<Variable, First_Variable, Rest_Of_Variables...>
+	: std::integral_constant<
+		std::size_t,
+		1 + index_of_variable<Variable, Rest_Of_Variables...>::value
+	> {};
+
+
+/*!
+Returns the distance in bytes from the beginning
+of given cell to the data of given variable.
+
+The distance is the same in all instances of a cell
+type but isn't a constant expression because cells
+aren't standard layout classes.
+*/
+template <
+	class Cell_T,
+	class Variable
+> std::size_t get_variable_offset(const Cell_T& cell, const Variable& variable)
+{
+	return std::size_t(
+		reinterpret_cast<const char*>(&cell[variable])
+		- reinterpret_cast<const char*>(&cell)
+	);
+}
+
+} // namespace detail
+
+
 } // namespace gensimcell
 
 
@@ -0,0 +1,552 @@
+/*
+Element-wise operators for data of generic simulation cell variables.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_VARIABLE_OPERATORS_HPP
+#define GENSIMCELL_VARIABLE_OPERATORS_HPP
+
+
+#include "array"
+#include "cassert"
+#include "cstddef"
+#include "type_traits"
+#include "utility"
+#include "vector"
+
+
+namespace gensimcell {
+namespace detail {
+
+
+/*
+Forward declarations of all versions so that
+nested containers find each other regardless
+of the order in which they are defined below.
+*/
+#define GENSIMCELL_DECLARE_VARIABLE_OPERATOR(NAME) \
+template < \
+	class Lhs_T, \
+	class Rhs_T \
+> void NAME(Lhs_T& lhs, const Rhs_T& rhs); \
+\
+template < \
+	class Lhs_T, \
+	class Rhs_T, \
+	std::size_t Number_Of_Items \
+> void NAME( \
+	std::array<Lhs_T, Number_Of_Items>& lhs, \
+	const std::array<Rhs_T, Number_Of_Items>& rhs \
+); \
+\
+template < \
+	class Lhs_T, \
+	std::size_t Number_Of_Items, \
+	class Scalar_T \
+> typename std::enable_if< \
+	std::is_arithmetic<Scalar_T>::value \
+>::type NAME( \
+	std::array<Lhs_T, Number_Of_Items>& lhs, \
+	const Scalar_T& rhs \
+); \
+\
+template < \
+	class Lhs_T, \
+	class Scalar_T \
+> typename std::enable_if< \
+	std::is_arithmetic<Scalar_T>::value \
+>::type NAME( \
+	std::vector<Lhs_T>& lhs, \
+	const Scalar_T& rhs \
+); \
+\
+template < \
+	class Lhs1_T, \
+	class Lhs2_T, \
+	class Scalar_T \
+> typename std::enable_if< \
+	std::is_arithmetic<Scalar_T>::value \
+>::type NAME( \
+	std::pair<Lhs1_T, Lhs2_T>& lhs, \
+	const Scalar_T& rhs \
+);
+
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR(variable_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR(variable_plus_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR(variable_minus_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR(variable_mul_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR(variable_div_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR(variable_atomic_plus_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR(variable_atomic_minus_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR(variable_atomic_mul_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR(variable_atomic_div_equal)
+
+#undef GENSIMCELL_DECLARE_VARIABLE_OPERATOR
+
+
+/*
+Containers of equal type are assigned as a whole
+so only the arithmetic ones need the element-wise
+versions of vectors and pairs.
+*/
+#define GENSIMCELL_DECLARE_VARIABLE_OPERATOR_ARITHMETIC(NAME) \
+template < \
+	class Lhs_T, \
+	class Rhs_T \
+> void NAME( \
+	std::vector<Lhs_T>& lhs, \
+	const std::vector<Rhs_T>& rhs \
+); \
+\
+template < \
+	class Lhs1_T, \
+	class Lhs2_T, \
+	class Rhs1_T, \
+	class Rhs2_T \
+> void NAME( \
+	std::pair<Lhs1_T, Lhs2_T>& lhs, \
+	const std::pair<Rhs1_T, Rhs2_T>& rhs \
+);
+
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR_ARITHMETIC(variable_plus_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR_ARITHMETIC(variable_minus_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR_ARITHMETIC(variable_mul_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR_ARITHMETIC(variable_div_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR_ARITHMETIC(variable_atomic_plus_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR_ARITHMETIC(variable_atomic_minus_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR_ARITHMETIC(variable_atomic_mul_equal)
+GENSIMCELL_DECLARE_VARIABLE_OPERATOR_ARITHMETIC(variable_atomic_div_equal)
+
+#undef GENSIMCELL_DECLARE_VARIABLE_OPERATOR_ARITHMETIC
+
+
+#ifdef EIGEN_WORLD_VERSION
+
+#define GENSIMCELL_DECLARE_EIGEN_VARIABLE_OPERATOR(NAME) \
+template < \
+	class Lhs_T, \
+	class Rhs_T, \
+	int Rows, \
+	int Columns, \
+	int Options, \
+	int Max_Rows, \
+	int Max_Columns \
+> void NAME( \
+	Eigen::Matrix<Lhs_T, Rows, Columns, Options, Max_Rows, Max_Columns>& lhs, \
+	const Eigen::Matrix<Rhs_T, Rows, Columns, Options, Max_Rows, Max_Columns>& rhs \
+); \
+\
+template < \
+	class Lhs_T, \
+	int Rows, \
+	int Columns, \
+	int Options, \
+	int Max_Rows, \
+	int Max_Columns, \
+	class Scalar_T \
+> typename std::enable_if< \
+	std::is_arithmetic<Scalar_T>::value \
+>::type NAME( \
+	Eigen::Matrix<Lhs_T, Rows, Columns, Options, Max_Rows, Max_Columns>& lhs, \
+	const Scalar_T& rhs \
+);
+
+GENSIMCELL_DECLARE_EIGEN_VARIABLE_OPERATOR(variable_plus_equal)
+GENSIMCELL_DECLARE_EIGEN_VARIABLE_OPERATOR(variable_minus_equal)
+GENSIMCELL_DECLARE_EIGEN_VARIABLE_OPERATOR(variable_mul_equal)
+GENSIMCELL_DECLARE_EIGEN_VARIABLE_OPERATOR(variable_div_equal)
+
+#undef GENSIMCELL_DECLARE_EIGEN_VARIABLE_OPERATOR
+
+// only scalar broadcast is different from plain assignment
+template <
+	class Lhs_T,
+	int Rows,
+	int Columns,
+	int Options,
+	int Max_Rows,
+	int Max_Columns,
+	class Scalar_T
+> typename std::enable_if<
+	std::is_arithmetic<Scalar_T>::value
+>::type variable_equal(
+	Eigen::Matrix<Lhs_T, Rows, Columns, Options, Max_Rows, Max_Columns>& lhs,
+	const Scalar_T& rhs
+);
+
+#endif // ifdef EIGEN_WORLD_VERSION
+
+
+
+/*!
+Applies an operator to the data of one variable.
+
+The variable_*equal functions are used by the operators of
+generic simulation cells to modify the data of each variable.
+By default the operator is applied directly to the data, i.e.
+variable_plus_equal(lhs, rhs) is equal to lhs += rhs.
+
+Versions for std::array, std::vector and std::pair, and Eigen
+matrices if Eigen/Core was included before this file, apply
+the operator element by element and versions with an arithmetic
+right hand side broadcast the scalar to every element. Nested
+containers are processed recursively so for example a
+std::vector<std::array<double, 3>> can be multiplied by a double
+or by another vector of arrays. Vectors given to the same
+operation must have equal sizes, which is checked with assert().
+
+The loops over contiguous elements are written so that
+the compiler can vectorize them when the innermost
+operation is between arithmetic types.
+*/
+#define GENSIMCELL_MAKE_VARIABLE_OPERATOR_CONTAINERS(NAME) \
+template < \
+	class Lhs_T, \
+	class Rhs_T, \
+	std::size_t Number_Of_Items \
+> void NAME( \
+	std::array<Lhs_T, Number_Of_Items>& lhs, \
+	const std::array<Rhs_T, Number_Of_Items>& rhs \
+) { \
+	Lhs_T* const lhs_data = lhs.data(); \
+	const Rhs_T* const rhs_data = rhs.data(); \
+	for (std::size_t i = 0; i < Number_Of_Items; i++) { \
+		NAME(lhs_data[i], rhs_data[i]); \
+	} \
+} \
+\
+template < \
+	class Lhs_T, \
+	std::size_t Number_Of_Items, \
+	class Scalar_T \
+> typename std::enable_if< \
+	std::is_arithmetic<Scalar_T>::value \
+>::type NAME( \
+	std::array<Lhs_T, Number_Of_Items>& lhs, \
+	const Scalar_T& rhs \
+) { \
+	Lhs_T* const lhs_data = lhs.data(); \
+	for (std::size_t i = 0; i < Number_Of_Items; i++) { \
+		NAME(lhs_data[i], rhs); \
+	} \
+} \
+\
+template < \
+	class Lhs_T, \
+	class Scalar_T \
+> typename std::enable_if< \
+	std::is_arithmetic<Scalar_T>::value \
+>::type NAME( \
+	std::vector<Lhs_T>& lhs, \
+	const Scalar_T& rhs \
+) { \
+	Lhs_T* const lhs_data = lhs.data(); \
+	const std::size_t size = lhs.size(); \
+	for (std::size_t i = 0; i < size; i++) { \
+		NAME(lhs_data[i], rhs); \
+	} \
+} \
+\
+template < \
+	class Lhs1_T, \
+	class Lhs2_T, \
+	class Scalar_T \
+> typename std::enable_if< \
+	std::is_arithmetic<Scalar_T>::value \
+>::type NAME( \
+	std::pair<Lhs1_T, Lhs2_T>& lhs, \
+	const Scalar_T& rhs \
+) { \
+	NAME(lhs.first, rhs); \
+	NAME(lhs.second, rhs); \
+}
+
+#define GENSIMCELL_MAKE_VARIABLE_OPERATOR(NAME, OPERATOR) \
+template < \
+	class Lhs_T, \
+	class Rhs_T \
+> void NAME(Lhs_T& lhs, const Rhs_T& rhs) \
+{ \
+	lhs OPERATOR rhs; \
+} \
+\
+GENSIMCELL_MAKE_VARIABLE_OPERATOR_CONTAINERS(NAME)
+
+GENSIMCELL_MAKE_VARIABLE_OPERATOR(variable_equal, =)
+GENSIMCELL_MAKE_VARIABLE_OPERATOR(variable_plus_equal, +=)
+GENSIMCELL_MAKE_VARIABLE_OPERATOR(variable_minus_equal, -=)
+GENSIMCELL_MAKE_VARIABLE_OPERATOR(variable_mul_equal, *=)
+GENSIMCELL_MAKE_VARIABLE_OPERATOR(variable_div_equal, /=)
+
+#undef GENSIMCELL_MAKE_VARIABLE_OPERATOR
+
+
+#define GENSIMCELL_MAKE_VARIABLE_OPERATOR_ARITHMETIC(NAME) \
+template < \
+	class Lhs_T, \
+	class Rhs_T \
+> void NAME( \
+	std::vector<Lhs_T>& lhs, \
+	const std::vector<Rhs_T>& rhs \
+) { \
+	assert(lhs.size() == rhs.size()); \
+	Lhs_T* const lhs_data = lhs.data(); \
+	const Rhs_T* const rhs_data = rhs.data(); \
+	/* don't read past rhs if assert is disabled */ \
+	const std::size_t size \
+		= lhs.size() < rhs.size() \
+		? lhs.size() \
+		: rhs.size(); \
+	for (std::size_t i = 0; i < size; i++) { \
+		NAME(lhs_data[i], rhs_data[i]); \
+	} \
+} \
+\
+template < \
+	class Lhs1_T, \
+	class Lhs2_T, \
+	class Rhs1_T, \
+	class Rhs2_T \
+> void NAME( \
+	std::pair<Lhs1_T, Lhs2_T>& lhs, \
+	const std::pair<Rhs1_T, Rhs2_T>& rhs \
+) { \
+	NAME(lhs.first, rhs.first); \
+	NAME(lhs.second, rhs.second); \
+}
+
+GENSIMCELL_MAKE_VARIABLE_OPERATOR_ARITHMETIC(variable_plus_equal)
+GENSIMCELL_MAKE_VARIABLE_OPERATOR_ARITHMETIC(variable_minus_equal)
+GENSIMCELL_MAKE_VARIABLE_OPERATOR_ARITHMETIC(variable_mul_equal)
+GENSIMCELL_MAKE_VARIABLE_OPERATOR_ARITHMETIC(variable_div_equal)
+
+
+//! Operations of the variable_atomic_*equal functions.
+#define GENSIMCELL_MAKE_ATOMIC_OPERATION(NAME, OPERATOR) \
+struct NAME \
+{ \
+	template < \
+		class Lhs_T, \
+		class Rhs_T \
+	> static void apply(Lhs_T& lhs, const Rhs_T& rhs) \
+	{ \
+		lhs OPERATOR rhs; \
+	} \
+};
+
+GENSIMCELL_MAKE_ATOMIC_OPERATION(Atomic_Plus, +=)
+GENSIMCELL_MAKE_ATOMIC_OPERATION(Atomic_Minus, -=)
+GENSIMCELL_MAKE_ATOMIC_OPERATION(Atomic_Mul, *=)
+GENSIMCELL_MAKE_ATOMIC_OPERATION(Atomic_Div, /=)
+
+#undef GENSIMCELL_MAKE_ATOMIC_OPERATION
+
+
+/*!
+Applies given operation atomically to lhs.
+
+Other threads can modify lhs concurrently with atomic
+operations but not with plain ones. Uses a compare and
+exchange loop so the result is the same as from some
+serial order of the concurrent operations. Memory order
+is relaxed, e.g. joining the threads makes the result
+visible to the joining thread.
+*/
+template <
+	class Lhs_T,
+	class Rhs_T,
+	class Operation
+> void atomic_update(Lhs_T& lhs, const Rhs_T& rhs, const Operation&)
+{
+	static_assert(
+		std::is_arithmetic<Lhs_T>::value
+		and not std::is_same<Lhs_T, bool>::value,
+		"Atomic operators only support arithmetic data and std::array, "
+		"std::vector and std::pair of it"
+	);
+	static_assert(
+		__atomic_always_lock_free(sizeof(Lhs_T), 0),
+		"Atomic operations on data of this size aren't lock free"
+	);
+
+	Lhs_T old_value, new_value;
+	__atomic_load(&lhs, &old_value, __ATOMIC_RELAXED);
+	do {
+		new_value = old_value;
+		Operation::apply(new_value, rhs);
+	} while (
+		not __atomic_compare_exchange(
+			&lhs,
+			&old_value,
+			&new_value,
+			true,
+			__ATOMIC_RELAXED,
+			__ATOMIC_RELAXED
+		)
+	);
+}
+
+//! Integers are added with one instruction instead of a loop.
+template <
+	class Lhs_T,
+	class Rhs_T
+> typename std::enable_if<
+	std::is_integral<Lhs_T>::value
+	and std::is_integral<Rhs_T>::value
+	and not std::is_same<Lhs_T, bool>::value
+>::type atomic_update(Lhs_T& lhs, const Rhs_T& rhs, const Atomic_Plus&)
+{
+	__atomic_fetch_add(&lhs, static_cast<Lhs_T>(rhs), __ATOMIC_RELAXED);
+}
+
+//! Integers are subtracted with one instruction instead of a loop.
+template <
+	class Lhs_T,
+	class Rhs_T
+> typename std::enable_if<
+	std::is_integral<Lhs_T>::value
+	and std::is_integral<Rhs_T>::value
+	and not std::is_same<Lhs_T, bool>::value
+>::type atomic_update(Lhs_T& lhs, const Rhs_T& rhs, const Atomic_Minus&)
+{
+	__atomic_fetch_sub(&lhs, static_cast<Lhs_T>(rhs), __ATOMIC_RELAXED);
+}
+
+
+/*!
+Atomic versions of variable_*equal for scatter kernels
+in which several threads can modify the same variable,
+e.g. when depositing particles into neighboring cells.
+
+Containers are processed element by element like in
+variable_*equal and each arithmetic element is updated
+atomically with atomic_update(), which is equivalent to
+std::atomic_ref of C++20. Elements of vectors and arrays
+are updated independently so other threads can observe
+a partially updated container until all threads have
+finished. Sizes of vectors must not change concurrently.
+*/
+#define GENSIMCELL_MAKE_ATOMIC_VARIABLE_OPERATOR(NAME, OPERATION) \
+template < \
+	class Lhs_T, \
+	class Rhs_T \
+> void NAME(Lhs_T& lhs, const Rhs_T& rhs) \
+{ \
+	atomic_update(lhs, rhs, OPERATION()); \
+} \
+\
+GENSIMCELL_MAKE_VARIABLE_OPERATOR_CONTAINERS(NAME) \
+GENSIMCELL_MAKE_VARIABLE_OPERATOR_ARITHMETIC(NAME)
+
+GENSIMCELL_MAKE_ATOMIC_VARIABLE_OPERATOR(variable_atomic_plus_equal, Atomic_Plus)
+GENSIMCELL_MAKE_ATOMIC_VARIABLE_OPERATOR(variable_atomic_minus_equal, Atomic_Minus)
+GENSIMCELL_MAKE_ATOMIC_VARIABLE_OPERATOR(variable_atomic_mul_equal, Atomic_Mul)
+GENSIMCELL_MAKE_ATOMIC_VARIABLE_OPERATOR(variable_atomic_div_equal, Atomic_Div)
+
+#undef GENSIMCELL_MAKE_ATOMIC_VARIABLE_OPERATOR
+#undef GENSIMCELL_MAKE_VARIABLE_OPERATOR_ARITHMETIC
+#undef GENSIMCELL_MAKE_VARIABLE_OPERATOR_CONTAINERS
+
+
+
+#ifdef EIGEN_WORLD_VERSION
+/*!
+Versions of variable_*equal for Eigen matrices.
+
+Multiplication and division are done element by element
+(i.e. Eigen's array semantics) instead of as matrix
+product so that all operators behave consistently
+with std::array.
+*/
+#define GENSIMCELL_MAKE_EIGEN_VARIABLE_OPERATOR(NAME, OPERATOR) \
+template < \
+	class Lhs_T, \
+	class Rhs_T, \
+	int Rows, \
+	int Columns, \
+	int Options, \
+	int Max_Rows, \
+	int Max_Columns \
+> void NAME( \
+	Eigen::Matrix<Lhs_T, Rows, Columns, Options, Max_Rows, Max_Columns>& lhs, \
+	const Eigen::Matrix<Rhs_T, Rows, Columns, Options, Max_Rows, Max_Columns>& rhs \
+) { \
+	lhs.array() OPERATOR rhs.array(); \
+} \
+\
+template < \
+	class Lhs_T, \
+	int Rows, \
+	int Columns, \
+	int Options, \
+	int Max_Rows, \
+	int Max_Columns, \
+	class Scalar_T \
+> typename std::enable_if< \
+	std::is_arithmetic<Scalar_T>::value \
+>::type NAME( \
+	Eigen::Matrix<Lhs_T, Rows, Columns, Options, Max_Rows, Max_Columns>& lhs, \
+	const Scalar_T& rhs \
+) { \
+	lhs.array() OPERATOR Lhs_T(rhs); \
+}
+
+GENSIMCELL_MAKE_EIGEN_VARIABLE_OPERATOR(variable_plus_equal, +=)
+GENSIMCELL_MAKE_EIGEN_VARIABLE_OPERATOR(variable_minus_equal, -=)
+GENSIMCELL_MAKE_EIGEN_VARIABLE_OPERATOR(variable_mul_equal, *=)
+GENSIMCELL_MAKE_EIGEN_VARIABLE_OPERATOR(variable_div_equal, /=)
+
+#undef GENSIMCELL_MAKE_EIGEN_VARIABLE_OPERATOR
+
+template <
+	class Lhs_T,
+	int Rows,
+	int Columns,
+	int Options,
+	int Max_Rows,
+	int Max_Columns,
+	class Scalar_T
+> typename std::enable_if<
+	std::is_arithmetic<Scalar_T>::value
+>::type variable_equal(
+	Eigen::Matrix<Lhs_T, Rows, Columns, Options, Max_Rows, Max_Columns>& lhs,
+	const Scalar_T& rhs
+) {
+	lhs.setConstant(Lhs_T(rhs));
+}
+
+#endif // ifdef EIGEN_WORLD_VERSION
+
+
+} // namespace detail
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_VARIABLE_OPERATORS_HPP
@@ -0,0 +1,393 @@
+/*
+Run time table of variables of generic simulation cell.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GENSIMCELL_VARIABLE_TABLE_HPP
+#define GENSIMCELL_VARIABLE_TABLE_HPP
+
+
+#include "array"
+#include "cstddef"
+#include "string"
+#include "type_traits"
+#include "typeinfo"
+#include "vector"
+
+#include "boost/core/demangle.hpp"
+
+#include "get_var_mpi_datatype.hpp"
+#include "type_support.hpp"
+
+
+namespace gensimcell {
+
+
+// forward declare Cell type used in Variable_Table
+template<template<class> class Transfer_Policy, class... Variables> class Cell;
+
+
+//! Kind of the elements of a variable's data, see Variable_Info.
+enum class Element_Type : unsigned char {
+	none,
+	boolean,
+	signed_integer,
+	unsigned_integer,
+	floating_point
+};
+
+
+namespace detail {
+
+/*!
+Describes the data of a variable as a contiguous
+array of count elements of arithmetic type.
+
+type is void and count is 0 for data that
+can't be described that way, e.g. std::vector.
+*/
+template <class Data_T, class Enable = void> struct Data_Elements
+{
+	using type = void;
+	static constexpr std::size_t count = 0;
+};
+
+//! See the general version for documentation.
+template <class Data_T> struct Data_Elements<
+	Data_T,
+	typename std::enable_if<std::is_arithmetic<Data_T>::value>::type
+> {
+	using type = Data_T;
+	static constexpr std::size_t count = 1;
+};
+
+//! See the general version for documentation.
+template <class Data_T, std::size_t Number_Of_Items> struct Data_Elements<
+	std::array<Data_T, Number_Of_Items>,
+	void
+> {
+	using type = typename Data_Elements<Data_T>::type;
+	static constexpr std::size_t
+		count = Number_Of_Items * Data_Elements<Data_T>::count;
+};
+
+
+/*!
+Describes the items of std::vector data, value is
+false and type is void for other types of data.
+*/
+template <class Data_T> struct Vector_Items
+{
+	static constexpr bool value = false;
+	using type = void;
+};
+
+//! See the general version for documentation.
+template <class Item_T, class Allocator> struct Vector_Items<
+	std::vector<Item_T, Allocator>
+> {
+	static constexpr bool value = true;
+	using type = Item_T;
+};
+
+
+//! Returns the Element_Type of given arithmetic type.
+template <class Element_T> constexpr Element_Type get_element_type()
+{
+	return
+		std::is_same<Element_T, void>::value
+		? Element_Type::none
+		: std::is_same<Element_T, bool>::value
+		? Element_Type::boolean
+		: std::is_floating_point<Element_T>::value
+		? Element_Type::floating_point
+		: std::is_signed<Element_T>::value
+		? Element_Type::signed_integer
+		: Element_Type::unsigned_integer;
+}
+
+//! sizeof(Element_T) or 0 for void.
+template <class Element_T> constexpr std::size_t get_element_size()
+{
+	return std::is_same<Element_T, void>::value ? 0 : sizeof(
+		typename std::conditional<
+			std::is_same<Element_T, void>::value,
+			char,
+			Element_T
+		>::type
+	);
+}
+
+
+#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+
+//! Returns the named MPI datatype of given arithmetic type.
+template <class Element_T> typename std::enable_if<
+	std::is_arithmetic<Element_T>::value,
+	MPI_Datatype
+>::type get_element_mpi_datatype()
+{
+	const Element_T element{};
+	return std::get<2>(get_var_mpi_datatype(element));
+}
+
+//! Returns MPI_DATATYPE_NULL for data without elements.
+template <class Element_T> typename std::enable_if<
+	not std::is_arithmetic<Element_T>::value,
+	MPI_Datatype
+>::type get_element_mpi_datatype()
+{
+	return MPI_DATATYPE_NULL;
+}
+
+#endif // ifdef MPI_VERSION
+
+} // namespace detail
+
+
+/*!
+Information about one variable of a cell type.
+*/
+struct Variable_Info
+{
+	//! Name of the variable's class including namespaces
+	std::string name;
+
+	//! Distance in bytes from the beginning of the cell to the data
+	std::size_t offset;
+
+	//! sizeof the variable's data_type
+	std::size_t size;
+
+	//! Whether data can be copied with memcpy
+	bool trivially_copyable;
+
+	/*!
+	Kind, size in bytes and number of arithmetic elements if
+	data is a contiguous array of them, e.g. double or
+	std::array<float, 3>, Element_Type::none, 0 and 0 otherwise.
+
+	If variable_length is true data is a std::vector and
+	these describe one item of the vector instead, e.g.
+	std::vector<std::array<double, 3>> has 3 elements.
+	*/
+	Element_Type element_type;
+	std::size_t element_size, element_count;
+	bool variable_length;
+
+	#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+	/*!
+	Named MPI datatype of elements,
+	MPI_DATATYPE_NULL if there are no elements.
+	*/
+	MPI_Datatype element_datatype;
+	#endif
+};
+
+
+namespace detail {
+
+//! Adds information of given variable to given table.
+template <
+	class Variable,
+	class Cell_T
+> void add_variable_info(
+	std::vector<Variable_Info>& table,
+	const Cell_T& cell
+) {
+	using Data_T = typename Variable::data_type;
+	// describe items of vectors instead
+	using Item_T = typename std::conditional<
+		Vector_Items<Data_T>::value,
+		typename Vector_Items<Data_T>::type,
+		Data_T
+	>::type;
+	using Element_T = typename Data_Elements<Item_T>::type;
+
+	table.push_back(Variable_Info{
+		boost::core::demangle(typeid(Variable).name()),
+		get_variable_offset(cell, Variable()),
+		sizeof(Data_T),
+		std::is_trivially_copyable<Data_T>::value,
+		get_element_type<Element_T>(),
+		get_element_size<Element_T>(),
+		Data_Elements<Item_T>::count,
+		Vector_Items<Data_T>::value
+		#if defined(MPI_VERSION) && (MPI_VERSION >= 2)
+		, get_element_mpi_datatype<Element_T>()
+		#endif
+	});
+}
+
+
+/*!
+Returns the index of item with given name in items or
+items.size() if not found. Given name can be either full
+name, e.g. "particle::Velocity", or without namespaces,
+e.g. "Velocity". Item_T must have a std::string member name.
+*/
+template <class Item_T> std::size_t find_variable_name(
+	const std::vector<Item_T>& items,
+	const std::string& name
+) {
+	for (std::size_t i = 0; i < items.size(); i++) {
+		if (items[i].name == name) {
+			return i;
+		}
+	}
+	for (std::size_t i = 0; i < items.size(); i++) {
+		const auto& full_name = items[i].name;
+		if (
+			full_name.size() > name.size() + 2
+			and full_name.compare(
+				full_name.size() - name.size() - 2,
+				std::string::npos,
+				"::" + name
+			) == 0
+		) {
+			return i;
+		}
+	}
+	return items.size();
+}
+
+} // namespace detail
+
+
+/*!
+Table of variables of given cell type for selecting
+variables at run time, e.g. by name from a config file.
+
+Index of each variable is its position in the template
+arguments of the cell. The table is created when it's
+first used and is shared by all cells of given type.
+
+For variables with variable_length get() returns the address
+of the std::vector itself so its type must be known in order
+to access the items.
+
+Example that zeroes a variable given by name:
+@code
+using Table = gensimcell::Variable_Table<Cell_T>;
+const auto index = Table::find("density");
+if (
+	index < Table::size()
+	and Table::info(index).element_type == gensimcell::Element_Type::floating_point
+	and Table::info(index).element_size == sizeof(double)
+) {
+	if (not Table::info(index).variable_length) {
+		auto* data = static_cast<double*>(Table::get(cell, index));
+		for (size_t i = 0; i < Table::info(index).element_count; i++) {
+			data[i] = 0;
+		}
+	} else if (Table::info(index).element_count == 1) {
+		auto* data = static_cast<std::vector<double>*>(Table::get(cell, index));
+		std::fill(data->begin(), data->end(), 0);
+	}
+}
+@endcode
+*/
+template <class Cell_T> class Variable_Table;
+
+//! See the general version for documentation.
+template <
+	template<class> class Transfer_Policy,
+	class... Variables
+> class Variable_Table<Cell<Transfer_Policy, Variables...>>
+{
+public:
+
+	using Cell_T = Cell<Transfer_Policy, Variables...>;
+
+	//! Returns information of all variables.
+	static const std::vector<Variable_Info>& get_table()
+	{
+		static const std::vector<Variable_Info> table = create_table();
+		return table;
+	}
+
+	//! Returns the number of variables.
+	static constexpr std::size_t size()
+	{
+		return sizeof...(Variables);
+	}
+
+	//! Returns information of variable at given index.
+	static const Variable_Info& info(const std::size_t index)
+	{
+		return get_table()[index];
+	}
+
+	/*!
+	Returns the index of variable with given name or size()
+	if not found. Given name can be either full name, e.g.
+	"particle::Velocity", or without namespaces, e.g. "Velocity".
+	*/
+	static std::size_t find(const std::string& name)
+	{
+		return detail::find_variable_name(get_table(), name);
+	}
+
+	//! Returns address of data of variable at given index.
+	static void* get(Cell_T& cell, const std::size_t index)
+	{
+		return reinterpret_cast<char*>(&cell) + info(index).offset;
+	}
+
+	//! Returns address of data of variable at given index.
+	static const void* get(const Cell_T& cell, const std::size_t index)
+	{
+		return reinterpret_cast<const char*>(&cell) + info(index).offset;
+	}
+
+
+private:
+
+	static std::vector<Variable_Info> create_table()
+	{
+		std::vector<Variable_Info> table;
+		table.reserve(sizeof...(Variables));
+
+		const Cell_T cell{};
+		int dummy[] = {0, (
+			detail::add_variable_info<Variables>(table, cell),
+			0
+		)...};
+		(void)dummy;
+
+		return table;
+	}
+};
+
+
+} // namespace gensimcell
+
+
+#endif // ifndef GENSIMCELL_VARIABLE_TABLE_HPP
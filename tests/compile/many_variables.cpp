@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "array"
+#include "cstdint"
 #include "cstdlib"
 #include "tuple"
 #include "vector"
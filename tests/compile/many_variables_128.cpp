@@ -0,0 +1,105 @@
+/*
+Compiles a generic simulation cell with many variables.
+
+Used for measuring compilation time, see compile_time target in Makefile.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdlib"
+
+#ifdef HAVE_MPI
+#include "mpi.h"
+#endif
+
+#include "boost/preprocessor/repetition/enum_params.hpp"
+#include "boost/preprocessor/repetition/repeat.hpp"
+
+#include "gensimcell.hpp"
+
+#ifndef NUMBER_OF_VARIABLES
+#define NUMBER_OF_VARIABLES 128
+#endif
+
+#define MAKE_VARIABLE(z, n, data) \
+struct variable##n { \
+	using data_type = std::array<double, n % 3 + 2>; \
+};
+
+BOOST_PP_REPEAT(NUMBER_OF_VARIABLES, MAKE_VARIABLE, ~)
+
+#undef MAKE_VARIABLE
+
+#ifdef HAVE_MPI
+using cell_t = gensimcell::Cell<
+	gensimcell::Optional_Transfer,
+	BOOST_PP_ENUM_PARAMS(NUMBER_OF_VARIABLES, variable)
+>;
+#else
+using cell_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	BOOST_PP_ENUM_PARAMS(NUMBER_OF_VARIABLES, variable)
+>;
+#endif
+
+
+int main(int, char**)
+{
+	cell_t cell1, cell2;
+	cell1 = 0;
+
+	#define SET_VARIABLE(z, n, data) \
+	cell1[variable##n()][0] = n;
+
+	BOOST_PP_REPEAT(NUMBER_OF_VARIABLES, SET_VARIABLE, ~)
+
+	#undef SET_VARIABLE
+
+	cell2 = 1;
+	cell2 += cell1;
+	cell2 *= 2;
+	cell2 = cell2 - cell1 / 2.0;
+	cell2.plus_equal(cell1, variable0(), variable1());
+
+	#ifdef HAVE_MPI
+	cell_t::set_transfer_all(true, variable0(), variable1());
+	cell1.set_transfer(true, variable2());
+	void* address = nullptr;
+	int count = -1;
+	MPI_Datatype datatype = MPI_DATATYPE_NULL;
+	std::tie(address, count, datatype) = cell1.get_mpi_datatype();
+	#endif
+
+	if (cell2[variable1()][0] < 0) {
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,246 @@
+/*
+Tests for asynchronous saving of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "iostream"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "mpi.h"
+
+#include "async_save.hpp"
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "read_cells.hpp"
+
+using namespace std;
+
+struct density { using data_type = double; };
+struct velocity { using data_type = std::array<float, 3>; };
+struct particles { using data_type = std::vector<std::array<double, 3>>; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Optional_Transfer,
+	density,
+	velocity,
+	particles
+>;
+
+// data whose MPI transfer info is always invalid
+struct broken_data
+{
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype() const
+	{
+		return std::make_tuple(nullptr, -1, MPI_DATATYPE_NULL);
+	}
+};
+struct broken { using data_type = broken_data; };
+
+using broken_cell_t = gensimcell::Cell<
+	gensimcell::Optional_Transfer,
+	density,
+	broken
+>;
+
+/*
+Reads cell ids and data offsets from given
+file saved by save_async, returns ids and offsets.
+*/
+std::pair<
+	std::vector<std::uint64_t>,
+	std::vector<std::uint64_t>
+> read_table(MPI_File file)
+{
+	std::uint64_t total_cells = 0;
+	MPI_File_read_at(file, 0, &total_cells, 1, MPI_UINT64_T, MPI_STATUS_IGNORE);
+	std::vector<std::uint64_t> table(2 * total_cells);
+	MPI_File_read_at(
+		file,
+		sizeof(std::uint64_t),
+		table.data(),
+		int(table.size()),
+		MPI_UINT64_T,
+		MPI_STATUS_IGNORE
+	);
+
+	std::vector<std::uint64_t> ids, offsets;
+	for (size_t i = 0; i < total_cells; i++) {
+		ids.push_back(table[2 * i]);
+		offsets.push_back(table[2 * i + 1]);
+	}
+	return std::make_pair(ids, offsets);
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	const std::string file_name("tests/parallel/async_save.mexe.dc");
+
+	// different number of cells on each process
+	const size_t nr_cells = 10 + 5 * size_t(rank);
+	std::vector<std::uint64_t> cell_ids;
+	std::vector<cell_t> cells(nr_cells);
+	for (size_t i = 0; i < nr_cells; i++) {
+		const auto id = 1000 * std::uint64_t(rank) + i;
+		cell_ids.push_back(id);
+		cells[i][density()] = double(id);
+		cells[i][velocity()] = {{float(id), 1, 2}};
+		for (size_t j = 0; j < id % 3; j++) {
+			cells[i][particles()].push_back({{double(id), double(j), 0.0}});
+		}
+	}
+
+	// fixed size data
+	cell_t::set_transfer_all(true, density(), velocity());
+	cell_t::set_transfer_all(false, particles());
+	auto save = gensimcell::save_async(comm, file_name, cell_ids, cells);
+	cell_t::set_transfer_all(false, density(), velocity());
+
+	// saved data isn't affected by modifying cells
+	for (auto& cell: cells) {
+		cell[density()] = -1;
+	}
+	save.test();
+	CHECK_TRUE(save.wait())
+	CHECK_TRUE(save.test())
+
+	if (rank == 0) {
+		MPI_File file;
+		CHECK_TRUE(
+			MPI_File_open(
+				MPI_COMM_SELF,
+				const_cast<char*>(file_name.c_str()),
+				MPI_MODE_RDONLY,
+				MPI_INFO_NULL,
+				&file
+			) == MPI_SUCCESS
+		)
+		const auto ids_offsets = read_table(file);
+		size_t total_cells = 0;
+		for (int i = 0; i < comm_size; i++) {
+			total_cells += 10 + 5 * size_t(i);
+		}
+		CHECK_TRUE(ids_offsets.first.size() == total_cells)
+
+		cell_t::set_transfer_all(true, density(), velocity());
+		std::vector<cell_t> read;
+		CHECK_TRUE(gensimcell::read_cells(file, ids_offsets.second, read))
+		for (size_t i = 0; i < read.size(); i++) {
+			const auto id = ids_offsets.first[i];
+			CHECK_TRUE(read[i][density()] == double(id))
+			CHECK_TRUE(read[i][velocity()][0] == float(id))
+			CHECK_TRUE(read[i][velocity()][2] == 2)
+		}
+		cell_t::set_transfer_all(false, density(), velocity());
+		MPI_File_close(&file);
+	}
+	MPI_Barrier(comm);
+
+	// variable length data from pointers to cells
+	cell_t::set_transfer_all(true, particles());
+	std::vector<cell_t*> cell_pointers;
+	for (auto& cell: cells) {
+		cell_pointers.push_back(&cell);
+	}
+	gensimcell::Async_Save other_save;
+	other_save = gensimcell::save_async(comm, file_name, cell_ids, cell_pointers);
+	cell_t::set_transfer_all(false, particles());
+	for (auto& cell: cells) {
+		cell[particles()].clear();
+	}
+	CHECK_TRUE(other_save.wait())
+
+	if (rank == 0) {
+		MPI_File file;
+		MPI_File_open(
+			MPI_COMM_SELF,
+			const_cast<char*>(file_name.c_str()),
+			MPI_MODE_RDONLY,
+			MPI_INFO_NULL,
+			&file
+		);
+		const auto ids_offsets = read_table(file);
+
+		cell_t::set_transfer_all(true, particles());
+		std::vector<cell_t> read(ids_offsets.first.size());
+		for (size_t i = 0; i < read.size(); i++) {
+			read[i][particles()].resize(ids_offsets.first[i] % 3);
+		}
+		CHECK_TRUE(gensimcell::read_cells(file, ids_offsets.second, read))
+		for (size_t i = 0; i < read.size(); i++) {
+			const auto id = ids_offsets.first[i];
+			for (size_t j = 0; j < id % 3; j++) {
+				CHECK_TRUE(read[i][particles()][j][0] == double(id))
+				CHECK_TRUE(read[i][particles()][j][1] == double(j))
+			}
+		}
+		MPI_File_close(&file);
+		std::remove(file_name.c_str());
+	}
+
+	// cells that can't be packed aren't written
+	MPI_Barrier(comm);
+	std::vector<broken_cell_t> broken_cells(nr_cells);
+	broken_cell_t::set_transfer_all(false, density());
+	broken_cell_t::set_transfer_all(true, broken());
+	CHECK_TRUE(not gensimcell::save_async(comm, file_name, cell_ids, broken_cells).wait())
+	if (rank == 0) {
+		MPI_File file;
+		MPI_File_open(
+			MPI_COMM_SELF,
+			const_cast<char*>(file_name.c_str()),
+			MPI_MODE_RDONLY,
+			MPI_INFO_NULL,
+			&file
+		);
+		CHECK_TRUE(read_table(file).first.size() == 0)
+		MPI_File_close(&file);
+		std::remove(file_name.c_str());
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
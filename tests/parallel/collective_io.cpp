@@ -0,0 +1,227 @@
+/*
+Tests for collective reading and writing of cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "fstream"
+#include "iostream"
+#include "iterator"
+#include "string"
+#include "vector"
+
+#include "mpi.h"
+
+#include "async_save.hpp"
+#include "check_true.hpp"
+#include "collective_io.hpp"
+#include "gensimcell.hpp"
+
+using namespace std;
+
+struct density { using data_type = double; };
+struct velocity { using data_type = std::array<float, 3>; };
+struct number { using data_type = std::uint64_t; };
+struct particles { using data_type = std::vector<std::array<double, 3>>; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Optional_Transfer,
+	density,
+	velocity,
+	number,
+	particles
+>;
+
+std::string read_file(const std::string& file_name)
+{
+	std::ifstream file(file_name, std::ios::binary);
+	return std::string(
+		std::istreambuf_iterator<char>(file),
+		std::istreambuf_iterator<char>()
+	);
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	const std::string
+		file_name("tests/parallel/collective_io.mexe.dc"),
+		async_file_name("tests/parallel/collective_io.mexe.async.dc");
+
+	// different number of cells on each process, none on the last
+	const size_t nr_cells = rank == comm_size - 1 ? 0 : 10 + 5 * size_t(rank);
+	size_t total_cells = 0;
+	for (int i = 0; i < comm_size - 1; i++) {
+		total_cells += 10 + 5 * size_t(i);
+	}
+
+	std::vector<std::uint64_t> cell_ids;
+	std::vector<cell_t> cells(nr_cells);
+	for (size_t i = 0; i < nr_cells; i++) {
+		const auto id = 1000 * std::uint64_t(rank) + i;
+		cell_ids.push_back(id);
+		cells[i][density()] = double(id);
+		cells[i][velocity()] = {{float(id), 1, 2}};
+		cells[i][number()] = id % 3;
+		for (size_t j = 0; j < id % 3; j++) {
+			cells[i][particles()].push_back({{double(id), double(j), 0.0}});
+		}
+	}
+
+	// same file as save_async
+	cell_t::set_transfer_all(true, density(), velocity(), number(), particles());
+	CHECK_TRUE(gensimcell::save_cells(comm, file_name, cell_ids, cells))
+	CHECK_TRUE(gensimcell::save_async(comm, async_file_name, cell_ids, cells).wait())
+	if (rank == 0) {
+		const auto saved = read_file(file_name);
+		CHECK_TRUE(saved.size() > 0)
+		CHECK_TRUE(saved == read_file(async_file_name))
+	}
+	MPI_Barrier(comm);
+
+	// fixed size data divided evenly
+	cell_t::set_transfer_all(false, particles());
+	std::vector<std::uint64_t> loaded_ids;
+	std::vector<cell_t> loaded;
+	CHECK_TRUE(gensimcell::load_cells(comm, file_name, loaded_ids, loaded))
+	CHECK_TRUE(loaded.size() == loaded_ids.size())
+	std::uint64_t nr_loaded = loaded.size(), total_loaded = 0;
+	MPI_Allreduce(&nr_loaded, &total_loaded, 1, MPI_UINT64_T, MPI_SUM, comm);
+	CHECK_TRUE(total_loaded == total_cells)
+	CHECK_TRUE(
+		loaded.size() == total_cells * size_t(rank + 1) / size_t(comm_size)
+			- total_cells * size_t(rank) / size_t(comm_size)
+	)
+	for (size_t i = 0; i < loaded.size(); i++) {
+		const auto id = loaded_ids[i];
+		CHECK_TRUE(loaded[i][density()] == double(id))
+		CHECK_TRUE(loaded[i][velocity()][0] == float(id))
+		CHECK_TRUE(loaded[i][velocity()][2] == 2)
+		CHECK_TRUE(loaded[i][number()] == id % 3)
+	}
+
+	// variable length data after its length is known
+	MPI_File file;
+	CHECK_TRUE(
+		MPI_File_open(
+			comm,
+			const_cast<char*>(file_name.c_str()),
+			MPI_MODE_RDONLY,
+			MPI_INFO_NULL,
+			&file
+		) == MPI_SUCCESS
+	)
+	std::vector<std::uint64_t> list_ids, file_offsets;
+	CHECK_TRUE(gensimcell::read_cell_list(file, list_ids, file_offsets))
+	CHECK_TRUE(list_ids == loaded_ids)
+
+	cell_t::set_transfer_all(false, density(), velocity());
+	for (auto& offset: file_offsets) {
+		offset += sizeof(double) + 3 * sizeof(float);
+	}
+	std::vector<cell_t> read;
+	CHECK_TRUE(gensimcell::read_cells_all(file, file_offsets, read))
+	CHECK_TRUE(read.size() == list_ids.size())
+
+	cell_t::set_transfer_all(false, number());
+	cell_t::set_transfer_all(true, particles());
+	for (size_t i = 0; i < read.size(); i++) {
+		CHECK_TRUE(read[i][number()] == list_ids[i] % 3)
+		file_offsets[i] += sizeof(std::uint64_t);
+		read[i][particles()].resize(read[i][number()]);
+	}
+	CHECK_TRUE(gensimcell::read_cells_all(file, file_offsets, read))
+	for (size_t i = 0; i < read.size(); i++) {
+		const auto id = list_ids[i];
+		CHECK_TRUE(read[i][particles()].size() == id % 3)
+		for (size_t j = 0; j < id % 3; j++) {
+			CHECK_TRUE(read[i][particles()][j][0] == double(id))
+			CHECK_TRUE(read[i][particles()][j][1] == double(j))
+		}
+	}
+	MPI_File_close(&file);
+
+	// write into an existing file from pointers in reverse order
+	cell_t::set_transfer_all(false, particles());
+	cell_t::set_transfer_all(true, density());
+	CHECK_TRUE(
+		MPI_File_open(
+			comm,
+			const_cast<char*>(file_name.c_str()),
+			MPI_MODE_WRONLY,
+			MPI_INFO_NULL,
+			&file
+		) == MPI_SUCCESS
+	)
+	std::vector<cell_t*> reversed;
+	std::vector<std::uint64_t> reversed_offsets;
+	for (size_t i = loaded.size() - 1; i < loaded.size(); i--) {
+		loaded[i][density()] = -double(loaded_ids[i]);
+		reversed.push_back(&loaded[i]);
+		reversed_offsets.push_back(
+			file_offsets[i]
+			- sizeof(std::uint64_t)
+			- 3 * sizeof(float)
+			- sizeof(double)
+		);
+	}
+	CHECK_TRUE(gensimcell::write_cells_all(file, reversed_offsets, reversed))
+	MPI_File_close(&file);
+
+	cell_t::set_transfer_all(true, density(), velocity(), number());
+	CHECK_TRUE(gensimcell::load_cells(comm, file_name, loaded_ids, loaded))
+	for (size_t i = 0; i < loaded.size(); i++) {
+		const auto id = loaded_ids[i];
+		CHECK_TRUE(loaded[i][density()] == -double(id))
+		CHECK_TRUE(loaded[i][velocity()][0] == float(id))
+	}
+
+	MPI_Barrier(comm);
+	if (rank == 0) {
+		std::remove(file_name.c_str());
+		std::remove(async_file_name.c_str());
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+/*
+Tests concurrent halo exchanges.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "map"
+#include "thread"
+#include "vector"
+
+#include "mpi.h"
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "halo_exchange.hpp"
+
+using namespace std;
+
+struct density { using data_type = double; };
+struct velocity { using data_type = std::array<float, 3>; };
+struct number { using data_type = std::uint64_t; };
+struct particles { using data_type = std::vector<std::array<double, 3>>; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Optional_Transfer,
+	density,
+	velocity,
+	number,
+	particles
+>;
+
+//! Sets data of local cell with given index on given process.
+void set_cell(cell_t& cell, const int rank, const int index, const int step)
+{
+	const double value = 1000 * rank + 10 * index + step;
+	cell[density()] = value;
+	cell[velocity()] = {{float(value), float(value + 1), float(value + 2)}};
+	cell[number()] = std::uint64_t(value);
+	cell[particles()].resize(size_t(rank + index + 1));
+	for (auto& particle: cell[particles()]) {
+		particle = {{value, -value, 2 * value}};
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int provided = MPI_THREAD_SINGLE;
+	if (MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	CHECK_TRUE(gensimcell::has_thread_multiple() == (provided == MPI_THREAD_MULTIPLE))
+
+	// transfer settings shared by all cells don't affect exchanges
+	cell_t::set_transfer_all(false, density(), velocity(), number(), particles());
+
+	// first and last local cells are sent to previous and next process
+	std::array<cell_t, 4> local_cells;
+	std::map<int, std::vector<cell_t>> remote_cells;
+	std::map<int, std::vector<cell_t*>> send_cells, receive_cells;
+	for (const int neighbor: {(rank + comm_size - 1) % comm_size, (rank + 1) % comm_size}) {
+		if (neighbor == rank or remote_cells.count(neighbor) > 0) {
+			continue;
+		}
+		remote_cells[neighbor].resize(2);
+		send_cells[neighbor] = {&local_cells[0], &local_cells[3]};
+	}
+	for (auto& item: remote_cells) {
+		for (auto& cell: item.second) {
+			receive_cells[item.first].push_back(&cell);
+		}
+	}
+
+	gensimcell::Halo_Exchange<cell_t>
+		fixed_exchange(comm, send_cells, receive_cells),
+		vector_exchange(comm, send_cells, receive_cells, 1);
+
+	CHECK_TRUE(not fixed_exchange.is_active())
+	CHECK_TRUE(fixed_exchange.get_comm() != MPI_COMM_NULL)
+	CHECK_TRUE(fixed_exchange.get_comm() != vector_exchange.get_comm())
+
+	gensimcell::Transfer_Set<cell_t> fixed_variables, vector_variables;
+	fixed_variables.add<density, velocity>();
+	vector_variables.add<number, particles>();
+	CHECK_TRUE(fixed_variables.contains<velocity>())
+	CHECK_TRUE(not fixed_variables.contains<number>())
+	CHECK_TRUE(not gensimcell::Transfer_Set<cell_t>().add<number>().remove<number>().contains<number>())
+
+	for (int step = 0; step < 20; step++) {
+		for (int i = 0; i < int(local_cells.size()); i++) {
+			set_cell(local_cells[size_t(i)], rank, i, step);
+		}
+		for (auto& item: remote_cells) {
+			for (size_t i = 0; i < item.second.size(); i++) {
+				auto& cell = item.second[i];
+				cell[density()] = -1;
+				cell[velocity()] = {{-1, -1, -1}};
+				cell[number()] = 0;
+				cell[particles()].clear();
+				// receiving vectors are allocated beforehand
+				cell[particles()].resize(size_t(item.first + (i == 0 ? 0 : 3) + 1));
+			}
+		}
+
+		if (step == 0) {
+			// only given variables are transferred
+			CHECK_TRUE(fixed_exchange.start(fixed_variables))
+			CHECK_TRUE(fixed_exchange.is_active())
+			CHECK_TRUE(not fixed_exchange.start(fixed_variables))
+			CHECK_TRUE(fixed_exchange.wait())
+			CHECK_TRUE(not fixed_exchange.is_active())
+			for (const auto& item: remote_cells) {
+				CHECK_TRUE(item.second[0][density()] == 1000 * item.first + step)
+				CHECK_TRUE(item.second[0][number()] == 0)
+				CHECK_TRUE(item.second[0][particles()][0][0] == 0)
+			}
+			CHECK_TRUE((vector_exchange.start<number, particles>()))
+			CHECK_TRUE(vector_exchange.wait())
+		} else if (gensimcell::has_thread_multiple()) {
+			// exchanges progress independently in different threads
+			std::thread vector_thread([&](){
+				CHECK_TRUE(vector_exchange.start(vector_variables))
+				CHECK_TRUE(vector_exchange.wait())
+			});
+			CHECK_TRUE(fixed_exchange.start(fixed_variables))
+			CHECK_TRUE(fixed_exchange.wait())
+			vector_thread.join();
+		} else {
+			CHECK_TRUE(vector_exchange.start(vector_variables))
+			CHECK_TRUE(fixed_exchange.start(fixed_variables))
+			CHECK_TRUE(fixed_exchange.wait())
+			CHECK_TRUE(vector_exchange.wait())
+		}
+
+		for (const auto& item: remote_cells) {
+			for (size_t i = 0; i < item.second.size(); i++) {
+				cell_t expected;
+				set_cell(expected, item.first, i == 0 ? 0 : 3, step);
+				const auto& cell = item.second[i];
+				CHECK_TRUE(cell[density()] == expected[density()])
+				CHECK_TRUE(cell[velocity()] == expected[velocity()])
+				CHECK_TRUE(cell[number()] == expected[number()])
+				CHECK_TRUE(cell[particles()] == expected[particles()])
+			}
+		}
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
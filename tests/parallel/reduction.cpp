@@ -0,0 +1,181 @@
+/*
+Tests reductions of kernel results and variables over processes.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "algorithm"
+#include "array"
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "limits"
+#include "thread"
+#include "tuple"
+#include "vector"
+
+#include "mpi.h"
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "reduction.hpp"
+
+using namespace std;
+
+struct density { using data_type = double; };
+struct counts { using data_type = std::array<int, 2>; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	density,
+	counts
+>;
+
+using grid_t = std::vector<cell_t>;
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	// all test processes are on the same node
+	const auto nr_threads = gensimcell::get_nr_threads_per_process(comm);
+	CHECK_TRUE(nr_threads >= 1)
+	CHECK_TRUE(nr_threads <= std::max(1U, std::thread::hardware_concurrency()))
+
+	gensimcell::Thread_Pool pool(3);
+
+	// cell i of process r has density r + i
+	grid_t grid(100);
+	std::vector<std::uint64_t> cell_ids;
+	for (std::size_t i = 0; i < grid.size(); i++) {
+		grid[i][density()] = rank + double(i);
+		grid[i][counts()] = {{1, rank + int(i)}};
+		cell_ids.push_back(i);
+	}
+	const auto get_density = [](const std::uint64_t cell_id, grid_t& grid) {
+		return grid[cell_id][density()];
+	};
+	const auto get_counts = [](const std::uint64_t cell_id, grid_t& grid) {
+		return grid[cell_id][counts()];
+	};
+
+	// local reductions of kernel results
+	CHECK_TRUE(gensimcell::reduce_cells(gensimcell::Reduction::min, cell_ids, grid, get_density, 7, pool) == rank)
+	CHECK_TRUE(gensimcell::reduce_cells(gensimcell::Reduction::max, cell_ids, grid, get_density, 7, pool) == rank + 99)
+	CHECK_TRUE(gensimcell::reduce_cells(gensimcell::Reduction::sum, cell_ids, grid, get_density, 7, pool) == 100 * rank + 4950)
+	CHECK_TRUE((gensimcell::reduce_cells(gensimcell::Reduction::max, cell_ids, grid, get_counts, 0, pool) == std::array<int, 2>{{1, rank + 99}}))
+	CHECK_TRUE((gensimcell::reduce_cells(gensimcell::Reduction::sum, cell_ids, grid, get_counts, 0, pool) == std::array<int, 2>{{100, 100 * rank + 4950}}))
+	CHECK_TRUE(gensimcell::reduce_cells(gensimcell::Reduction::min, std::vector<std::uint64_t>(), grid, get_density) == std::numeric_limits<double>::max())
+	CHECK_TRUE(gensimcell::reduce_cells(gensimcell::Reduction::max, std::vector<std::uint64_t>(), grid, get_density) == std::numeric_limits<double>::lowest())
+
+	gensimcell::Async_Reduction<double>
+		min_density(comm, gensimcell::Reduction::min),
+		max_density(comm, gensimcell::Reduction::max);
+	gensimcell::Async_Reduction<std::array<int, 2>> total_counts(comm, gensimcell::Reduction::sum);
+
+	CHECK_TRUE(not min_density.is_active())
+	CHECK_TRUE(min_density.get_comm() != MPI_COMM_NULL)
+	CHECK_TRUE(min_density.get_comm() != max_density.get_comm())
+	CHECK_TRUE(min_density.get_result() == std::numeric_limits<double>::max())
+	CHECK_TRUE(min_density.test())
+	CHECK_TRUE(min_density.wait())
+
+	const int rank_sum = comm_size * (comm_size - 1) / 2;
+	for (int step = 0; step < 10; step++) {
+		// split like inner and outer cells
+		const std::vector<std::uint64_t>
+			inner(cell_ids.begin(), cell_ids.begin() + 60),
+			outer(cell_ids.begin() + 60, cell_ids.end());
+
+		min_density.add_cells(inner, grid, get_density, 0, pool);
+		min_density.add_cells(outer, grid, get_density, 0, pool);
+		CHECK_TRUE(min_density.start())
+		CHECK_TRUE(min_density.is_active())
+		CHECK_TRUE(not min_density.start())
+
+		max_density.add_cells(cell_ids, grid, get_density, 0, pool);
+		CHECK_TRUE(max_density.start(step))
+
+		total_counts.add_cells(inner, grid, get_counts, 5, pool);
+		CHECK_TRUE(total_counts.start(gensimcell::reduce_cells(gensimcell::Reduction::sum, outer, grid, get_counts, 5, pool)))
+
+		// values added during a reduction go to the next one
+		min_density.add(-step);
+
+		// work that overlaps the reductions
+		for (auto& cell: grid) {
+			cell[density()] += 1;
+		}
+
+		while (not total_counts.test()) {}
+		CHECK_TRUE(total_counts.wait())
+		CHECK_TRUE(max_density.wait())
+		CHECK_TRUE(min_density.wait())
+		CHECK_TRUE(not min_density.is_active())
+
+		CHECK_TRUE(min_density.get_result() == (step == 0 ? 0 : 1 - step))
+		CHECK_TRUE(max_density.get_result() == comm_size - 1 + 99 + step)
+		CHECK_TRUE(total_counts.get_result()[0] == 100 * comm_size)
+		CHECK_TRUE(total_counts.get_result()[1] == 100 * rank_sum + 4950 * comm_size)
+	}
+
+	// reductions of variables with one collective
+	for (auto& cell: grid) {
+		cell[density()] = 0.5 * rank;
+	}
+	double total_density = -1;
+	CHECK_TRUE(gensimcell::reduce<density>(grid, gensimcell::Reduction::sum, comm, total_density, 0, pool))
+	CHECK_TRUE(total_density == 50 * rank_sum)
+
+	std::tuple<double, std::array<int, 2>, std::array<int, 2>> totals;
+	CHECK_TRUE((gensimcell::reduce<density, counts, counts>(
+		grid,
+		{{gensimcell::Reduction::max, gensimcell::Reduction::sum, gensimcell::Reduction::min}},
+		comm,
+		totals,
+		9,
+		pool
+	)))
+	CHECK_TRUE(std::get<0>(totals) == 0.5 * (comm_size - 1))
+	CHECK_TRUE(std::get<1>(totals)[0] == 100 * comm_size)
+	CHECK_TRUE(std::get<1>(totals)[1] == 100 * rank_sum + 4950 * comm_size)
+	CHECK_TRUE((std::get<2>(totals) == std::array<int, 2>{{1, 0}}))
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
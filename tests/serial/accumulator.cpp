@@ -0,0 +1,157 @@
+/*
+Tests thread local accumulation buffers of generic simulation cell.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdint"
+#include "cstdlib"
+#include "vector"
+
+#include "accumulator.hpp"
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "parallel_for.hpp"
+
+using namespace std;
+
+struct density { using data_type = double; };
+struct momentum { using data_type = std::array<double, 2>; };
+struct nr_particles { using data_type = uint64_t; };
+struct other { using data_type = std::vector<int>; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	other,
+	density,
+	momentum,
+	nr_particles
+>;
+
+using deposit_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	density,
+	momentum,
+	nr_particles
+>;
+
+int main(int, char**)
+{
+	const size_t nr_cells = 100, nr_particles_ = 100000;
+	gensimcell::Thread_Pool pool(4);
+
+	std::vector<cell_t> cells(nr_cells), reference(nr_cells);
+	for (auto& cell: cells) {
+		cell = 0;
+		cell[other()].resize(1, 3);
+	}
+	reference = cells;
+
+	// each particle deposits to its cell and both neighbors
+	const auto deposit = [&](const size_t particle, deposit_t& target, const size_t offset) {
+		const double weight = offset == 1 ? 0.5 : 0.25;
+		target[density()] += weight;
+		target[momentum()][0] += weight * particle;
+		target[momentum()][1] -= weight;
+		target[nr_particles()] += offset == 1 ? 1 : 0;
+	};
+
+	// serial version of scatter below
+	const auto add_reference = [&]() {
+		for (size_t i = 0; i < nr_particles_; i++) {
+			for (size_t offset = 0; offset < 3; offset++) {
+				const size_t cell_id = (i + nr_cells + offset - 1) % nr_cells;
+				deposit_t target;
+				target = 0;
+				deposit(i, target, offset);
+				auto& cell = reference[cell_id];
+				cell[density()] += target[density()];
+				cell[momentum()][0] += target[momentum()][0];
+				cell[momentum()][1] += target[momentum()][1];
+				cell[nr_particles()] += target[nr_particles()];
+			}
+		}
+	};
+
+	gensimcell::Accumulator<deposit_t> accumulator(pool.size());
+	CHECK_TRUE(accumulator.size() == pool.size())
+
+	const auto scatter = [&]() {
+		pool.parallel_for(nr_particles_, 0,
+			[&](const size_t begin, const size_t end, const size_t slot) {
+				for (size_t i = begin; i < end; i++) {
+					for (size_t offset = 0; offset < 3; offset++) {
+						const size_t cell_id = (i + nr_cells + offset - 1) % nr_cells;
+						deposit(i, accumulator(slot, cell_id), offset);
+					}
+				}
+			}
+		);
+	};
+
+	const auto compare = [&]() {
+		for (size_t i = 0; i < nr_cells; i++) {
+			CHECK_TRUE(cells[i][density()] == reference[i][density()])
+			CHECK_TRUE(cells[i][momentum()][0] == reference[i][momentum()][0])
+			CHECK_TRUE(cells[i][momentum()][1] == reference[i][momentum()][1])
+			CHECK_TRUE(cells[i][nr_particles()] == reference[i][nr_particles()])
+			CHECK_TRUE(cells[i][other()].size() == 1)
+			CHECK_TRUE(cells[i][other()][0] == 3)
+		}
+	};
+
+	const auto get_cell = [&cells](const uint64_t cell_id) {
+		return &cells[cell_id];
+	};
+
+	add_reference();
+	scatter();
+	accumulator.merge(get_cell);
+	compare();
+
+	// buffers are cleared by merge
+	for (auto& cell: cells) {
+		cell.plus_equal(cell, density(), momentum(), nr_particles());
+	}
+	for (auto& cell: reference) {
+		cell.plus_equal(cell, density(), momentum(), nr_particles());
+	}
+	scatter();
+	accumulator.merge(get_cell, pool);
+	add_reference();
+	compare();
+
+	// contributions to missing cells are discarded
+	scatter();
+	accumulator.merge([](const uint64_t) { return (cell_t*)nullptr; });
+	compare();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+/*
+Tests assign() between ranges of different generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdlib"
+#include "iostream"
+#include "vector"
+
+#include "assign_ranges.hpp"
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+
+using namespace std;
+
+struct v1 { using data_type = int; };
+struct v2 { using data_type = double; };
+struct v3 { using data_type = std::array<double, 16>; };
+struct v4 { using data_type = std::array<double, 16>; };
+struct v5 { using data_type = std::vector<int>; };
+struct v6 { using data_type = char; };
+struct v7 { using data_type = char; };
+
+using source_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	v1, v2, v3, v4, v5, v6
+>;
+
+// v3 and v4 are contiguous in both cell types
+using target_n_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	v6, v3, v4, v5
+>;
+
+// transfer flags between variables prevent merging
+using target_o_t = gensimcell::Cell<
+	gensimcell::Optional_Transfer,
+	v2, v3, v4, v5
+>;
+
+// no common variables
+using target_none_t = gensimcell::Cell<
+	gensimcell::Always_Transfer,
+	v7
+>;
+
+int main(int, char**)
+{
+	std::vector<source_t> source(10);
+	for (size_t i = 0; i < source.size(); i++) {
+		source[i][v1()] = int(i);
+		source[i][v2()] = double(i) / 2;
+		source[i][v3()].fill(double(i) + 0.25);
+		source[i][v4()].fill(double(i) + 0.5);
+		source[i][v5()] = std::vector<int>(i, int(i));
+		source[i][v6()] = char('a' + i);
+	}
+
+	std::vector<target_n_t> target_n(10);
+	gensimcell::assign(target_n, source);
+	for (size_t i = 0; i < target_n.size(); i++) {
+		CHECK_TRUE(target_n[i][v6()] == char('a' + i))
+		CHECK_TRUE(target_n[i][v3()] == source[i][v3()])
+		CHECK_TRUE(target_n[i][v4()] == source[i][v4()])
+		CHECK_TRUE(target_n[i][v5()] == source[i][v5()])
+	}
+
+	// other direction only affects common variables
+	for (auto& cell: target_n) {
+		cell[v3()].fill(-1);
+		cell[v6()] = 'z';
+	}
+	gensimcell::assign(source, target_n);
+	for (size_t i = 0; i < source.size(); i++) {
+		CHECK_TRUE(source[i][v1()] == int(i))
+		CHECK_TRUE(source[i][v2()] == double(i) / 2)
+		CHECK_TRUE(source[i][v3()][15] == -1)
+		CHECK_TRUE(source[i][v4()][15] == double(i) + 0.5)
+		CHECK_TRUE(source[i][v6()] == 'z')
+	}
+
+	// target smaller than source
+	std::array<target_o_t, 5> target_o;
+	#ifdef MPI_VERSION
+	target_o[0].set_transfer(true, v3());
+	#endif
+	gensimcell::assign(target_o, source);
+	for (size_t i = 0; i < target_o.size(); i++) {
+		CHECK_TRUE(target_o[i][v2()] == source[i][v2()])
+		CHECK_TRUE(target_o[i][v3()] == source[i][v3()])
+		CHECK_TRUE(target_o[i][v4()] == source[i][v4()])
+		CHECK_TRUE(target_o[i][v5()] == source[i][v5()])
+	}
+	#ifdef MPI_VERSION
+	CHECK_TRUE(target_o[0].get_transfer(v3()))
+	CHECK_TRUE(not target_o[1].get_transfer(v3()))
+	#endif
+
+	std::vector<target_none_t> target_none(10);
+	target_none[0][v7()] = 'x';
+	gensimcell::assign(target_none, source);
+	CHECK_TRUE(target_none[0][v7()] == 'x')
+
+	// empty ranges
+	std::vector<target_n_t> empty;
+	gensimcell::assign(empty, source);
+	gensimcell::assign(source, empty);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+/*
+Compares speed of assign() between ranges to assign() between cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "chrono"
+#include "cstdlib"
+#include "iostream"
+#include "vector"
+
+#include "assign_ranges.hpp"
+#include "gensimcell.hpp"
+
+using namespace std;
+using namespace std::chrono;
+
+struct is_alive { using data_type = bool; };
+struct live_neighbors { using data_type = int; };
+struct density { using data_type = double; };
+struct velocity { using data_type = std::array<double, 3>; };
+struct magnetic_field { using data_type = std::array<double, 3>; };
+struct pressure { using data_type = double; };
+struct particles { using data_type = std::vector<std::array<double, 3>>; };
+
+using combined_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	is_alive,
+	live_neighbors,
+	particles,
+	density,
+	velocity,
+	magnetic_field,
+	pressure
+>;
+
+using gol_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	is_alive,
+	live_neighbors
+>;
+
+using mhd_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	density,
+	velocity,
+	magnetic_field,
+	pressure
+>;
+
+
+template<class Target_T> double run(
+	std::vector<Target_T>& target,
+	const std::vector<combined_t>& source,
+	const size_t max_turns,
+	const bool use_range
+) {
+	const auto start = high_resolution_clock::now();
+	for (size_t turn = 0; turn < max_turns; turn++) {
+		if (use_range) {
+			gensimcell::assign(target, source);
+		} else {
+			for (size_t i = 0; i < target.size(); i++) {
+				gensimcell::assign(target[i], source[i]);
+			}
+		}
+	}
+	const auto end = high_resolution_clock::now();
+	return duration_cast<duration<double>>(end - start).count();
+}
+
+
+int main(int, char**)
+{
+	constexpr size_t
+		number_of_cells = 100000,
+		max_turns = 500;
+
+	std::vector<combined_t> combined(number_of_cells);
+	for (size_t i = 0; i < number_of_cells; i++) {
+		combined[i][is_alive()] = i % 2 == 0;
+		combined[i][live_neighbors()] = int(i % 9);
+		combined[i][density()] = double(i);
+		combined[i][velocity()] = {{1, 2, double(i)}};
+		combined[i][magnetic_field()] = {{4, 5, double(i)}};
+		combined[i][pressure()] = double(i) / 3;
+	}
+
+	std::vector<gol_t> gol(number_of_cells);
+	std::vector<mhd_t> mhd1(number_of_cells), mhd2(number_of_cells);
+
+	const double gol_cell = run(gol, combined, max_turns, false);
+	const double gol_range = run(gol, combined, max_turns, true);
+	const double mhd_cell = run(mhd1, combined, max_turns, false);
+	const double mhd_range = run(mhd2, combined, max_turns, true);
+
+	for (size_t i = 0; i < number_of_cells; i++) {
+		if (
+			gol[i][live_neighbors()] != int(i % 9)
+			or mhd1[i][magnetic_field()] != mhd2[i][magnetic_field()]
+			or mhd2[i][pressure()] != double(i) / 3
+		) {
+			std::cerr << __FILE__ << ":" << __LINE__ << " FAILED" << std::endl;
+			abort();
+		}
+	}
+
+	cout << "GoL per cell: " << gol_cell
+		<< " s, range: " << gol_range
+		<< " s\nMHD per cell: " << mhd_cell
+		<< " s, range: " << mhd_range << " s" << endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,219 @@
+/*
+Tests for columnar checkpoint files of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "fstream"
+#include "string"
+#include "vector"
+
+#include "check_true.hpp"
+#include "checkpoint.hpp"
+#include "gensimcell.hpp"
+
+using namespace std;
+
+namespace test {
+	struct density { using data_type = double; };
+}
+struct velocity { using data_type = std::array<float, 3>; };
+struct particles { using data_type = std::vector<std::array<double, 3>>; };
+struct number { using data_type = int; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	test::density,
+	velocity,
+	particles,
+	number
+>;
+
+int main()
+{
+	const std::string file_name("tests/serial/checkpoint.exe.gsc");
+
+	constexpr size_t nr_cells = 50;
+	std::vector<cell_t> cells(nr_cells);
+	for (size_t i = 0; i < nr_cells; i++) {
+		cells[i][test::density()] = double(i) / 2;
+		cells[i][velocity()] = {{float(i), 0, 0}};
+		cells[i][number()] = -int(i);
+		for (size_t j = 0; j < i % 4; j++) {
+			cells[i][particles()].push_back({{double(i), double(j), 0.0}});
+		}
+	}
+
+	CHECK_TRUE(
+		gensimcell::write_checkpoint(
+			file_name,
+			cells,
+			test::density(),
+			particles(),
+			number()
+		)
+	)
+
+	gensimcell::Checkpoint_Reader reader;
+	CHECK_TRUE(reader.open(file_name))
+	CHECK_TRUE(reader.get_nr_cells() == nr_cells)
+	CHECK_TRUE(reader.get_columns().size() == 3)
+	CHECK_TRUE(reader.find("density") == 0)
+	CHECK_TRUE(reader.find("particles") == 1)
+	CHECK_TRUE(reader.find("velocity") == 3)
+
+	const auto& density_column = reader.get_columns()[0];
+	CHECK_TRUE(density_column.name == "test::density")
+	CHECK_TRUE(density_column.element_type == gensimcell::Element_Type::floating_point)
+	CHECK_TRUE(density_column.element_count == 1)
+	CHECK_TRUE(not density_column.variable_length)
+	CHECK_TRUE(density_column.data_offset % 64 == 0)
+	CHECK_TRUE(density_column.data_size == nr_cells * sizeof(double))
+	CHECK_TRUE(reader.get_columns()[1].variable_length)
+	CHECK_TRUE(reader.get_columns()[1].element_count == 3)
+	CHECK_TRUE(reader.get_offsets(0) == nullptr)
+	CHECK_TRUE(reader.get_offsets(1) != nullptr)
+
+	const auto density = reader.get(test::density());
+	CHECK_TRUE(density.size == nr_cells)
+	size_t index = 0;
+	for (const auto& value: density) {
+		CHECK_TRUE(value == double(index) / 2)
+		index++;
+	}
+	CHECK_TRUE(index == nr_cells)
+	CHECK_TRUE(
+		static_cast<const double*>(reader.get_data(0)) == density.data
+	)
+
+	const auto numbers = reader.get(number());
+	CHECK_TRUE(numbers.size == nr_cells)
+	CHECK_TRUE(numbers[7] == -7)
+
+	const auto particle_column = reader.get(particles());
+	CHECK_TRUE(particle_column.size == nr_cells)
+	for (size_t i = 0; i < nr_cells; i++) {
+		const auto cell_particles = particle_column[i];
+		CHECK_TRUE(cell_particles.size == i % 4)
+		for (size_t j = 0; j < cell_particles.size; j++) {
+			CHECK_TRUE(cell_particles[j][0] == double(i))
+			CHECK_TRUE(cell_particles[j][1] == double(j))
+		}
+	}
+
+	// variables that weren't saved
+	CHECK_TRUE(reader.get(velocity()).empty())
+	CHECK_TRUE(reader.get(velocity()).data == nullptr)
+
+	const auto columns = reader.get_columns();
+	reader.close();
+	CHECK_TRUE(reader.get_nr_cells() == 0)
+	CHECK_TRUE(reader.get(test::density()).empty())
+
+	// corrupted headers, names are unchanged so header size is too
+	const auto write_header = [&](const std::vector<gensimcell::Checkpoint_Column>& new_columns) {
+		std::fstream file(file_name, std::ios::binary | std::ios::in | std::ios::out);
+		const auto header = gensimcell::detail::get_checkpoint_header(nr_cells, new_columns);
+		file.seekp(0);
+		file.write(header.data(), header.size());
+	};
+	auto corrupted = columns;
+	corrupted[2].data_offset = corrupted[0].data_offset;
+	write_header(corrupted);
+	CHECK_TRUE(not reader.open(file_name))
+
+	corrupted = columns;
+	corrupted[1].offsets_offset = corrupted[2].data_offset;
+	write_header(corrupted);
+	CHECK_TRUE(not reader.open(file_name))
+
+	corrupted = columns;
+	corrupted[0].data_offset = 0;
+	write_header(corrupted);
+	CHECK_TRUE(not reader.open(file_name))
+
+	corrupted = columns;
+	corrupted[0].data_offset = std::uint64_t(-64);
+	write_header(corrupted);
+	CHECK_TRUE(not reader.open(file_name))
+
+	write_header(columns);
+	CHECK_TRUE(reader.open(file_name))
+	reader.close();
+
+	// corrupted item offsets of particles
+	const auto write_offset = [&](const size_t cell, const std::uint64_t offset) {
+		std::fstream file(file_name, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(std::streamoff(columns[1].offsets_offset + cell * sizeof(offset)));
+		file.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+	};
+	write_offset(0, 1);
+	CHECK_TRUE(not reader.open(file_name))
+	write_offset(0, 0);
+	CHECK_TRUE(reader.open(file_name))
+	const auto total_particles = reader.get_offsets(1)[nr_cells];
+	const auto offset_5 = reader.get_offsets(1)[5];
+	reader.close();
+	write_offset(5, total_particles + 1);
+	CHECK_TRUE(not reader.open(file_name))
+	write_offset(5, total_particles);
+	CHECK_TRUE(not reader.open(file_name))
+	write_offset(5, offset_5);
+	CHECK_TRUE(reader.open(file_name))
+	reader.close();
+
+	// invalid files
+	CHECK_TRUE(not reader.open(file_name + ".nonexistent"))
+	{
+		std::fstream file(file_name, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(0);
+		file.put('X');
+	}
+	CHECK_TRUE(not reader.open(file_name))
+	{
+		std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+		file.write("GSCC", 4);
+	}
+	CHECK_TRUE(not reader.open(file_name))
+
+	// no cells
+	std::vector<cell_t> no_cells;
+	CHECK_TRUE(gensimcell::write_checkpoint(file_name, no_cells, particles()))
+	CHECK_TRUE(reader.open(file_name))
+	CHECK_TRUE(reader.get_nr_cells() == 0)
+	CHECK_TRUE(reader.get(particles()).empty())
+
+	std::remove(file_name.c_str());
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,289 @@
+/*
+Tests coloring of cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cmath"
+#include "cstdint"
+#include "cstdlib"
+#include "set"
+#include "vector"
+
+#include "check_true.hpp"
+#include "coloring.hpp"
+#include "gensimcell.hpp"
+#include "parallel_for.hpp"
+
+using namespace std;
+
+struct density { using data_type = double; };
+struct density_flux { using data_type = double; };
+struct velocity { using data_type = std::array<double, 2>; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	density,
+	density_flux,
+	velocity
+>;
+
+constexpr size_t width = 20, height = 20;
+using grid_t = std::array<std::array<cell_t, width>, height>;
+
+
+/*!
+Returns true if every cell is in exactly one color and
+cells of the same color don't write to the same cells.
+*/
+template<
+	class Cell_Id_T,
+	class Get_Neighbors
+> bool is_valid(
+	const std::vector<Cell_Id_T>& cell_ids,
+	const std::vector<std::vector<Cell_Id_T>>& colors,
+	Get_Neighbors get_neighbors
+) {
+	std::set<Cell_Id_T> colored;
+	for (const auto& color: colors) {
+		if (color.size() == 0) {
+			return false;
+		}
+		std::set<Cell_Id_T> written;
+		for (const auto& cell_id: color) {
+			if (not colored.insert(cell_id).second) {
+				return false;
+			}
+			std::set<Cell_Id_T> current{cell_id};
+			for (const auto& neighbor_id: get_neighbors(cell_id)) {
+				current.insert(neighbor_id);
+			}
+			for (const auto& id: current) {
+				if (not written.insert(id).second) {
+					return false;
+				}
+			}
+		}
+	}
+	return colored == std::set<Cell_Id_T>(cell_ids.begin(), cell_ids.end());
+}
+
+
+//! Returns neighbors within radius of given cell in a periodic grid.
+template<size_t Dimensions> std::vector<std::array<size_t, Dimensions>> get_grid_neighbors(
+	const std::array<size_t, Dimensions>& index,
+	const std::array<size_t, Dimensions>& size,
+	const size_t radius,
+	const bool periodic
+) {
+	std::vector<std::array<size_t, Dimensions>> neighbors{index};
+	for (size_t dim = 0; dim < Dimensions; dim++) {
+		std::vector<std::array<size_t, Dimensions>> extended;
+		for (const auto& neighbor: neighbors) {
+			for (size_t step = 0; step <= 2 * radius; step++) {
+				auto shifted = neighbor;
+				const size_t value = neighbor[dim] + size[dim] * (radius + 1) + step - radius;
+				if (periodic) {
+					shifted[dim] = value % size[dim];
+				} else if (
+					value >= size[dim] * (radius + 1)
+					and value < size[dim] * (radius + 2)
+				) {
+					shifted[dim] = value - size[dim] * (radius + 1);
+				} else {
+					continue;
+				}
+				extended.push_back(shifted);
+			}
+		}
+		neighbors = extended;
+	}
+	return neighbors;
+}
+
+
+template<size_t Dimensions> bool is_valid_grid(
+	const std::array<size_t, Dimensions>& size,
+	const size_t radius,
+	const bool periodic,
+	const size_t max_colors
+) {
+	const auto colors = gensimcell::color_grid<Dimensions>(size, radius, periodic);
+	if (colors.size() > max_colors) {
+		return false;
+	}
+
+	std::vector<std::array<size_t, Dimensions>> cell_ids;
+	for (const auto& color: colors) {
+		cell_ids.insert(cell_ids.end(), color.begin(), color.end());
+	}
+	size_t nr_cells = 1;
+	for (const auto s: size) {
+		nr_cells *= s;
+	}
+	if (cell_ids.size() != nr_cells) {
+		return false;
+	}
+
+	return is_valid(
+		cell_ids,
+		colors,
+		[&](const std::array<size_t, Dimensions>& index) {
+			return get_grid_neighbors<Dimensions>(index, size, radius, periodic);
+		}
+	);
+}
+
+
+//! Advection flux through each face computed once and added to both cells.
+void solve_faces(grid_t& grid, const std::array<size_t, 2>& index, const double dt)
+{
+	auto& cell = grid[index[1]][index[0]];
+	// faces on the positive side of the cell
+	for (size_t dim = 0; dim < 2; dim++) {
+		auto neighbor_index = index;
+		neighbor_index[dim] = (index[dim] + 1) % (dim == 0 ? width : height);
+		auto& neighbor = grid[neighbor_index[1]][neighbor_index[0]];
+
+		const double v = (cell[velocity()][dim] + neighbor[velocity()][dim]) / 2;
+		const double flux
+			= v > 0
+			? v * dt * cell[density()]
+			: v * dt * neighbor[density()];
+		cell[density_flux()] -= flux;
+		neighbor[density_flux()] += flux;
+	}
+}
+
+//! Same as solve_faces() but only changes the given cell.
+void solve_cell(grid_t& grid, const std::array<size_t, 2>& index, const double dt)
+{
+	auto& cell = grid[index[1]][index[0]];
+	for (size_t dim = 0; dim < 2; dim++) {
+		const size_t size = dim == 0 ? width : height;
+		for (const size_t offset: {size_t(1), size - 1}) {
+			auto neighbor_index = index;
+			neighbor_index[dim] = (index[dim] + offset) % size;
+			const auto& neighbor = grid[neighbor_index[1]][neighbor_index[0]];
+
+			const double v = (cell[velocity()][dim] + neighbor[velocity()][dim]) / 2;
+			double flux
+				= v > 0
+				? v * dt * cell[density()]
+				: v * dt * neighbor[density()];
+			if (offset != 1) {
+				// face on the negative side of the cell
+				flux
+					= v > 0
+					? -v * dt * neighbor[density()]
+					: -v * dt * cell[density()];
+			}
+			cell[density_flux()] -= flux;
+		}
+	}
+}
+
+
+int main(int, char**)
+{
+	// generic graph with neighbors outside of given cells
+	std::vector<uint64_t> cell_ids;
+	for (uint64_t i = 1; i <= 200; i++) {
+		cell_ids.push_back(i);
+	}
+	const auto get_neighbors = [](const uint64_t cell_id) {
+		std::vector<uint64_t> neighbors{
+			(cell_id % 200) + 1,
+			((cell_id + 198) % 200) + 1,
+			1000 + cell_id / 10
+		};
+		if (cell_id % 7 == 0) {
+			neighbors.push_back((cell_id * 37) % 200 + 1);
+		}
+		return neighbors;
+	};
+	const auto colors = gensimcell::color_cells(cell_ids, get_neighbors);
+	CHECK_TRUE(is_valid(cell_ids, colors, get_neighbors))
+	CHECK_TRUE(colors.size() < 20)
+
+	CHECK_TRUE(gensimcell::color_cells(std::vector<uint64_t>(), get_neighbors).size() == 0)
+
+	// structured grids
+	CHECK_TRUE((is_valid_grid<1>({{10}}, 1, false, 3)))
+	CHECK_TRUE((is_valid_grid<2>({{10, 7}}, 1, false, 9)))
+	CHECK_TRUE((is_valid_grid<2>({{2, 2}}, 1, false, 4)))
+	CHECK_TRUE((is_valid_grid<2>({{9, 6}}, 1, true, 9)))
+	CHECK_TRUE((is_valid_grid<2>({{20, 20}}, 1, true, 20)))
+	CHECK_TRUE((is_valid_grid<2>({{12, 11}}, 2, false, 25)))
+	CHECK_TRUE((is_valid_grid<3>({{5, 4, 6}}, 1, false, 27)))
+	// all cells write to common cells in such a small periodic grid
+	CHECK_TRUE((is_valid_grid<3>({{4, 5, 5}}, 1, true, 100)))
+	CHECK_TRUE((is_valid_grid<3>({{7, 8, 6}}, 1, true, 64)))
+	CHECK_TRUE(gensimcell::color_grid<2>({{0, 5}}).size() == 0)
+
+	// fluxes through faces computed once in parallel
+	grid_t grid, reference;
+	for (size_t y = 0; y < height; y++)
+	for (size_t x = 0; x < width; x++) {
+		auto& cell = grid[y][x];
+		cell[density()] = (x * 7 + y * 3) % 11;
+		cell[density_flux()] = 0;
+		cell[velocity()] = {{double(y) - height / 2.0, width / 2.0 - double(x)}};
+	}
+	reference = grid;
+
+	const double dt = 0.01;
+	for (size_t y = 0; y < height; y++)
+	for (size_t x = 0; x < width; x++) {
+		solve_cell(reference, {{x, y}}, dt);
+	}
+
+	gensimcell::Thread_Pool pool(4);
+	const auto grid_colors = gensimcell::color_grid<2>({{width, height}}, 1, true);
+	gensimcell::parallel_for_colors(
+		grid_colors,
+		grid,
+		[dt](const std::array<size_t, 2>& index, grid_t& grid) {
+			solve_faces(grid, index, dt);
+		},
+		0,
+		pool
+	);
+
+	for (size_t y = 0; y < height; y++)
+	for (size_t x = 0; x < width; x++) {
+		CHECK_TRUE(
+			std::fabs(grid[y][x][density_flux()] - reference[y][x][density_flux()])
+			< 1e-12
+		)
+	}
+
+	return EXIT_SUCCESS;
+}
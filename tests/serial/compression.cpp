@@ -0,0 +1,194 @@
+/*
+Tests for lossless compression of checkpoint columns.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "random"
+#include "string"
+#include "vector"
+
+#include "check_true.hpp"
+#include "checkpoint.hpp"
+#include "compression.hpp"
+#include "gensimcell.hpp"
+
+using namespace std;
+
+struct density { using data_type = double; };
+struct particles { using data_type = std::vector<std::array<double, 3>>; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	density,
+	particles
+>;
+
+
+bool roundtrip(
+	const std::vector<char>& data,
+	const size_t element_size,
+	const unsigned int nr_threads
+) {
+	const auto compressed = gensimcell::compress_bytes(
+		data.data(),
+		data.size(),
+		element_size,
+		nr_threads
+	);
+	std::vector<char> decompressed;
+	return
+		gensimcell::decompress_bytes(
+			compressed.data(),
+			compressed.size(),
+			decompressed,
+			nr_threads
+		)
+		and decompressed == data;
+}
+
+
+int main()
+{
+	std::mt19937 random_source(123);
+
+	// several chunks of random, repetitive and constant data
+	std::vector<char> random_data(3 << 20);
+	for (auto& byte: random_data) {
+		byte = char(random_source());
+	}
+	CHECK_TRUE(roundtrip(random_data, 1, 0))
+	CHECK_TRUE(roundtrip(random_data, 8, 2))
+
+	std::vector<double> values(300000);
+	for (size_t i = 0; i < values.size(); i++) {
+		values[i] = double(i % 1000) / 10;
+	}
+	std::vector<char> value_data(
+		reinterpret_cast<const char*>(values.data()),
+		reinterpret_cast<const char*>(values.data() + values.size())
+	);
+	CHECK_TRUE(roundtrip(value_data, sizeof(double), 0))
+	CHECK_TRUE(roundtrip(value_data, 3, 1))
+
+	const std::vector<char> constant_data((1 << 20) + 5, 'a');
+	CHECK_TRUE(roundtrip(constant_data, 8, 0))
+	const auto constant_compressed = gensimcell::compress_bytes(
+		constant_data.data(),
+		constant_data.size(),
+		8
+	);
+	CHECK_TRUE(constant_compressed.size() < constant_data.size() / 100)
+
+	CHECK_TRUE(roundtrip(std::vector<char>(), 8, 0))
+	CHECK_TRUE(roundtrip(std::vector<char>(1, 'b'), 8, 0))
+	CHECK_TRUE(roundtrip(std::vector<char>(7, 'c'), 0, 0))
+
+	// invalid data
+	std::vector<char> decompressed;
+	auto corrupted = constant_compressed;
+	CHECK_TRUE(not gensimcell::decompress_bytes(corrupted.data(), 10, decompressed))
+	corrupted[0]++;
+	CHECK_TRUE(not gensimcell::decompress_bytes(corrupted.data(), corrupted.size(), decompressed))
+	corrupted = constant_compressed;
+	CHECK_TRUE(not gensimcell::decompress_bytes(corrupted.data(), corrupted.size() - 1, decompressed))
+	corrupted = constant_compressed + "x";
+	CHECK_TRUE(not gensimcell::decompress_bytes(corrupted.data(), corrupted.size(), decompressed))
+
+
+	// compressed checkpoint
+	const std::string file_name("tests/serial/compression.exe.gsc");
+
+	constexpr size_t nr_cells = 10000;
+	std::vector<cell_t> cells(nr_cells);
+	for (size_t i = 0; i < nr_cells; i++) {
+		cells[i][density()] = double(i % 100);
+		for (size_t j = 0; j < i % 3; j++) {
+			cells[i][particles()].push_back({{double(i), double(j), 0.5}});
+		}
+	}
+
+	CHECK_TRUE(
+		gensimcell::write_checkpoint(
+			file_name,
+			cells,
+			gensimcell::Checkpoint_Compression::shuffle_lz,
+			density(),
+			particles()
+		)
+	)
+
+	gensimcell::Checkpoint_Reader reader;
+	CHECK_TRUE(reader.open(file_name))
+	CHECK_TRUE(reader.get_nr_cells() == nr_cells)
+	CHECK_TRUE(reader.get_columns()[0].compressed)
+	CHECK_TRUE(reader.get_columns()[0].data_size < nr_cells * sizeof(double))
+
+	const auto density_column = reader.get(density());
+	CHECK_TRUE(density_column.size == nr_cells)
+	CHECK_TRUE(density_column[1234] == 34)
+	// decompressed once
+	CHECK_TRUE(reader.get(density()).data == density_column.data)
+
+	const auto particle_column = reader.get(particles());
+	CHECK_TRUE(particle_column.size == nr_cells)
+	CHECK_TRUE(particle_column[5].size == 2)
+	CHECK_TRUE(particle_column[5][1][1] == 1)
+
+	std::vector<cell_t> read_cells;
+	CHECK_TRUE(gensimcell::read_checkpoint(reader, read_cells, density(), particles()))
+	CHECK_TRUE(read_cells.size() == nr_cells)
+	for (size_t i = 0; i < nr_cells; i++) {
+		CHECK_TRUE(read_cells[i][density()] == cells[i][density()])
+		CHECK_TRUE(read_cells[i][particles()] == cells[i][particles()])
+	}
+
+	// no cells
+	std::vector<cell_t> no_cells;
+	CHECK_TRUE(
+		gensimcell::write_checkpoint(
+			file_name,
+			no_cells,
+			gensimcell::Checkpoint_Compression::shuffle_lz,
+			density(),
+			particles()
+		)
+	)
+	CHECK_TRUE(reader.open(file_name))
+	CHECK_TRUE(reader.get_nr_cells() == 0)
+	CHECK_TRUE(reader.get(particles()).empty())
+
+	std::remove(file_name.c_str());
+
+	return EXIT_SUCCESS;
+}
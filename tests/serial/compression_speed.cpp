@@ -0,0 +1,240 @@
+/*
+Speed and ratio of compressing checkpoints of example simulations.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "chrono"
+#include "cmath"
+#include "cstdio"
+#include "cstdlib"
+#include "fstream"
+#include "iostream"
+#include "string"
+#include "vector"
+
+#include "checkpoint.hpp"
+#include "compression.hpp"
+#include "gensimcell.hpp"
+
+using namespace std;
+using namespace std::chrono;
+
+// variables as in examples/advection/serial.cpp
+struct Density { using data_type = double; };
+struct Velocity { using data_type = std::array<double, 2>; };
+// and examples/particle_propagation/serial.cpp
+struct Particles { using data_type = std::vector<std::array<double, 2>>; };
+
+using advection_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	Density,
+	Velocity
+>;
+
+using particle_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	Velocity,
+	Particles
+>;
+
+
+//! Returns center of cell in a grid spanning [-1, 1] in both dimensions.
+std::array<double, 2> get_cell_center(
+	const size_t width,
+	const size_t height,
+	const size_t index
+) {
+	return {{
+		-1.0 + (0.5 + double(index % width)) * 2.0 / double(width),
+		-1.0 + (0.5 + double(index / width)) * 2.0 / double(height)
+	}};
+}
+
+
+//! Initial condition of examples/advection/serial.cpp.
+std::vector<advection_t> create_advection(const size_t width, const size_t height)
+{
+	std::vector<advection_t> cells(width * height);
+	for (size_t i = 0; i < cells.size(); i++) {
+		const auto center = get_cell_center(width, height, i);
+		const double r = sqrt(pow(center[0] + 0.45, 2) + pow(center[1], 2));
+
+		auto& cell = cells[i];
+		cell[Density()] = 0;
+		if (
+			center[0] > 0.1
+			and center[0] < 0.6
+			and center[1] > -0.25
+			and center[1] < 0.25
+		) {
+			cell[Density()] = 1;
+		} else if (r < 0.35) {
+			cell[Density()] = 1 - r / 0.35;
+		}
+		cell[Velocity()] = {{+2 * center[1], -2 * center[0]}};
+	}
+	return cells;
+}
+
+
+//! Initial condition of examples/particle_propagation/serial.cpp.
+std::vector<particle_t> create_particles(const size_t width, const size_t height)
+{
+	std::vector<particle_t> cells(width * height);
+	const double
+		cell_width = 2.0 / double(width),
+		cell_height = 2.0 / double(height);
+	for (size_t i = 0; i < cells.size(); i++) {
+		const auto center = get_cell_center(width, height, i);
+		const size_t cell_i = i % width, row_i = i / width;
+
+		auto& cell = cells[i];
+		cell[Velocity()] = {{-2 * center[1], +2 * center[0]}};
+		if (
+			row_i < height / 4
+			or row_i >= height - height / 4
+			or cell_i < width / 4
+			or cell_i >= width - width / 4
+		) {
+			continue;
+		}
+		cell[Particles()].push_back({{
+			center[0] - cell_width / 4,
+			center[1] - cell_height / 4
+		}});
+		cell[Particles()].push_back({{
+			center[0],
+			center[1] + cell_height / 4
+		}});
+		cell[Particles()].push_back({{
+			center[0] + cell_width / 4,
+			center[1] - cell_height / 4
+		}});
+	}
+	return cells;
+}
+
+
+size_t get_file_size(const std::string& file_name)
+{
+	std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+	return size_t(file.tellg());
+}
+
+
+/*!
+Saves given cells with and without compression,
+reads them back and prints sizes and throughputs.
+*/
+template<class Cell_T, class... Variables> void run(
+	const std::string& name,
+	const std::vector<Cell_T>& cells,
+	const Variables&... variables
+) {
+	const std::string
+		raw_name("tests/serial/compression_speed.exe.raw.gsc"),
+		compressed_name("tests/serial/compression_speed.exe.compressed.gsc");
+
+	auto start = high_resolution_clock::now();
+	if (not gensimcell::write_checkpoint(raw_name, cells, variables...)) {
+		std::cerr << __FILE__ << ":" << __LINE__ << " FAILED" << std::endl;
+		abort();
+	}
+	const double raw_write = duration_cast<duration<double>>(
+		high_resolution_clock::now() - start
+	).count();
+
+	start = high_resolution_clock::now();
+	if (
+		not gensimcell::write_checkpoint(
+			compressed_name,
+			cells,
+			gensimcell::Checkpoint_Compression::shuffle_lz,
+			variables...
+		)
+	) {
+		std::cerr << __FILE__ << ":" << __LINE__ << " FAILED" << std::endl;
+		abort();
+	}
+	const double compressed_write = duration_cast<duration<double>>(
+		high_resolution_clock::now() - start
+	).count();
+
+	gensimcell::Checkpoint_Reader reader;
+	std::vector<Cell_T> read_cells;
+	start = high_resolution_clock::now();
+	if (
+		not reader.open(compressed_name)
+		or not gensimcell::read_checkpoint(reader, read_cells, variables...)
+	) {
+		std::cerr << __FILE__ << ":" << __LINE__ << " FAILED" << std::endl;
+		abort();
+	}
+	const double compressed_read = duration_cast<duration<double>>(
+		high_resolution_clock::now() - start
+	).count();
+	reader.close();
+
+	for (size_t i = 0; i < cells.size(); i++) {
+		int dummy[] = {0, (
+			read_cells[i][Variables()] != cells[i][Variables()]
+				? (std::cerr << __FILE__ << ":" << __LINE__ << " FAILED" << std::endl, abort(), 0)
+				: 0
+		)...};
+		(void)dummy;
+	}
+
+	const size_t
+		raw_size = get_file_size(raw_name),
+		compressed_size = get_file_size(compressed_name);
+	const double megabytes = double(raw_size) / 1e6;
+
+	cout << name << ": " << raw_size << " -> " << compressed_size
+		<< " bytes, ratio " << double(raw_size) / double(compressed_size)
+		<< "\n  write raw: " << megabytes / raw_write
+		<< " MB/s, compressed: " << megabytes / compressed_write
+		<< " MB/s, read compressed: " << megabytes / compressed_read
+		<< " MB/s" << endl;
+
+	std::remove(raw_name.c_str());
+	std::remove(compressed_name.c_str());
+}
+
+
+int main(int, char**)
+{
+	constexpr size_t width = 2000, height = 2000;
+
+	run("advection", create_advection(width, height), Density(), Velocity());
+	run("particles", create_particles(width, height), Velocity(), Particles());
+
+	return EXIT_SUCCESS;
+}
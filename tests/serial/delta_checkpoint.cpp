@@ -0,0 +1,206 @@
+/*
+Tests for incremental checkpoint files of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "cstring"
+#include "fstream"
+#include "iostream"
+#include "iterator"
+#include "limits"
+#include "string"
+#include "vector"
+
+#include "check_true.hpp"
+#include "delta_checkpoint.hpp"
+#include "gensimcell.hpp"
+
+using namespace std;
+
+struct density { using data_type = double; };
+struct velocity { using data_type = std::array<double, 3>; };
+struct particles { using data_type = std::vector<std::array<double, 3>>; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	density,
+	velocity,
+	particles
+>;
+
+bool equal(const std::vector<cell_t>& cells1, const std::vector<cell_t>& cells2)
+{
+	if (cells1.size() != cells2.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < cells1.size(); i++) {
+		if (
+			cells1[i][density()] != cells2[i][density()]
+			or cells1[i][velocity()] != cells2[i][velocity()]
+			or cells1[i][particles()] != cells2[i][particles()]
+		) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	const std::string
+		full_name("tests/serial/delta_checkpoint.exe.gsc"),
+		delta_name("tests/serial/delta_checkpoint.exe.gscd");
+
+	std::vector<cell_t> cells(10000);
+	for (size_t i = 0; i < cells.size(); i++) {
+		cells[i][density()] = double(i);
+		cells[i][velocity()] = {{double(i), 1, 2}};
+		if (i % 100 == 0) {
+			cells[i][particles()].push_back({{double(i), 0, 0}});
+		}
+	}
+
+	gensimcell::Delta_Checkpoint_Writer writer(256);
+	CHECK_TRUE(writer.write_full(full_name, cells, density(), velocity(), particles()))
+	const auto full_size = writer.get_last_size();
+	CHECK_TRUE(full_size > cells.size() * (sizeof(double) + 3 * sizeof(double)))
+
+	std::vector<std::string> delta_names;
+	std::vector<std::vector<cell_t>> states;
+	for (size_t step = 0; step < 3; step++) {
+		// change a few cells
+		for (size_t i = 1000 * step; i < 1000 * step + 10; i++) {
+			cells[i][density()] += 0.5;
+		}
+		cells[5000 + step][particles()].push_back({{1, 2, 3}});
+		if (step == 2) {
+			cells.resize(cells.size() + 10);
+		}
+
+		delta_names.push_back(delta_name + std::to_string(step));
+		CHECK_TRUE(
+			writer.write_delta(delta_names.back(), cells, density(), velocity(), particles())
+		)
+		CHECK_TRUE(writer.get_last_size() * 10 < full_size)
+		states.push_back(cells);
+	}
+
+	// nothing changed
+	delta_names.push_back(delta_name + "3");
+	CHECK_TRUE(writer.write_delta(delta_names.back(), cells, density(), velocity(), particles()))
+	CHECK_TRUE(writer.get_last_size() < 200)
+
+	// changes aren't lost if writing fails
+	cells[42][density()] = -1;
+	const std::string bad_name("tests/serial/nonexistent/delta_checkpoint.exe.gsc");
+	CHECK_TRUE(not writer.write_delta(bad_name + "d", cells, density(), velocity(), particles()))
+	CHECK_TRUE(not writer.write_full(bad_name, cells, density(), velocity(), particles()))
+	delta_names.push_back(delta_name + "4");
+	CHECK_TRUE(writer.write_delta(delta_names.back(), cells, density(), velocity(), particles()))
+	CHECK_TRUE(writer.get_last_size() > 200)
+	CHECK_TRUE(writer.get_last_size() * 10 < full_size)
+
+	// reconstruct each state
+	for (size_t step = 0; step < 3; step++) {
+		std::vector<cell_t> read;
+		CHECK_TRUE(
+			gensimcell::read_delta_checkpoints(
+				full_name,
+				std::vector<std::string>(delta_names.begin(), delta_names.begin() + step + 1),
+				read,
+				density(),
+				velocity(),
+				particles()
+			)
+		)
+		CHECK_TRUE(equal(read, states[step]))
+	}
+	std::vector<cell_t> read;
+	CHECK_TRUE(
+		gensimcell::read_delta_checkpoints(
+			full_name, delta_names, read, density(), velocity(), particles()
+		)
+	)
+	CHECK_TRUE(equal(read, cells))
+
+	// subset of variables
+	read.clear();
+	CHECK_TRUE(gensimcell::read_delta_checkpoints(full_name, delta_names, read, density()))
+	CHECK_TRUE(read.size() == cells.size())
+	CHECK_TRUE(read[1000][density()] == cells[1000][density()])
+	CHECK_TRUE(read[5002][particles()].size() == 0)
+
+	// corrupted number of cells
+	const std::string corrupt_name(delta_name + "c");
+	const auto write_corrupt = [&](const std::uint64_t nr_cells) {
+		std::ifstream in(delta_names[0], std::ios::binary);
+		std::string bytes(
+			(std::istreambuf_iterator<char>(in)),
+			std::istreambuf_iterator<char>()
+		);
+		std::memcpy(&bytes[8], &nr_cells, sizeof(nr_cells));
+		std::ofstream out(corrupt_name, std::ios::binary | std::ios::trunc);
+		out.write(bytes.data(), std::streamsize(bytes.size()));
+	};
+	write_corrupt(std::numeric_limits<std::uint64_t>::max() / 2);
+	CHECK_TRUE(not gensimcell::read_delta_checkpoints(full_name, {corrupt_name}, read, density()))
+	// new cells without their blocks
+	write_corrupt(10100);
+	CHECK_TRUE(not gensimcell::read_delta_checkpoints(full_name, {corrupt_name}, read, density()))
+	write_corrupt(10000);
+	CHECK_TRUE(gensimcell::read_delta_checkpoints(full_name, {corrupt_name}, read, density()))
+	std::remove(corrupt_name.c_str());
+
+	// corrupted number of items
+	std::vector<cell_t> two_cells(2);
+	std::vector<char> counts(2 * sizeof(std::uint64_t), 0);
+	const std::uint64_t huge = std::numeric_limits<std::uint64_t>::max() / 16;
+	std::memcpy(counts.data(), &huge, sizeof(huge));
+	CHECK_TRUE(not gensimcell::detail::Delta_Block<particles>::set_bytes(two_cells, 0, 2, counts))
+	CHECK_TRUE(two_cells[0][particles()].size() == 0)
+
+	// missing file
+	CHECK_TRUE(
+		not gensimcell::read_delta_checkpoints(
+			full_name, {delta_name + "x"}, read, density()
+		)
+	)
+
+	std::remove(full_name.c_str());
+	for (const auto& name: delta_names) {
+		std::remove(name.c_str());
+	}
+
+	return EXIT_SUCCESS;
+}
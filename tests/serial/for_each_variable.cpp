@@ -0,0 +1,158 @@
+/*
+Tests compile-time iteration over variables of generic simulation cell.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdlib"
+#include "iostream"
+#include "vector"
+
+#ifdef HAVE_MPI
+#include "mpi.h"
+#endif
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+
+using namespace std;
+
+struct v1 { using data_type = int; };
+struct v2 { using data_type = std::vector<double>; };
+struct v3 { using data_type = std::array<float, 3>; };
+
+#ifdef HAVE_MPI
+using cell_t = gensimcell::Cell<gensimcell::Optional_Transfer, v1, v2, v3>;
+#else
+using cell_t = gensimcell::Cell<gensimcell::Never_Transfer, v1, v2, v3>;
+#endif
+
+// records order in which variables are given
+struct Recorder
+{
+	std::vector<size_t> sizes;
+
+	template<class Variable> void operator()(const Variable&)
+	{
+		this->sizes.push_back(sizeof(typename Variable::data_type));
+	}
+
+	template<class Variable> void operator()(
+		const Variable&,
+		const typename Variable::data_type&
+	) {
+		this->sizes.push_back(sizeof(typename Variable::data_type));
+	}
+};
+
+struct Adder
+{
+	void operator()(const v1&, int& data)
+	{
+		data += 1;
+	}
+
+	void operator()(const v2&, std::vector<double>& data)
+	{
+		data.push_back(1);
+	}
+
+	void operator()(const v3&, std::array<float, 3>& data)
+	{
+		data[2] += 1;
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	#ifdef HAVE_MPI
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	#else
+	(void)argc;
+	(void)argv;
+	#endif
+
+	Recorder recorder;
+	gensimcell::for_each_variable<cell_t>(recorder);
+	CHECK_TRUE(recorder.sizes.size() == 3)
+	CHECK_TRUE(recorder.sizes[0] == sizeof(int))
+	CHECK_TRUE(recorder.sizes[1] == sizeof(std::vector<double>))
+	CHECK_TRUE(recorder.sizes[2] == sizeof(std::array<float, 3>))
+
+	recorder.sizes.clear();
+	gensimcell::for_each_variable_if<
+		gensimcell::is_trivially_copyable_variable,
+		cell_t
+	>(recorder);
+	CHECK_TRUE(recorder.sizes.size() == 2)
+	CHECK_TRUE(recorder.sizes[0] == sizeof(int))
+	CHECK_TRUE(recorder.sizes[1] == sizeof(std::array<float, 3>))
+
+	cell_t cell;
+	cell[v1()] = 1;
+	cell[v3()] = {{1, 2, 3}};
+	gensimcell::for_each_variable(cell, Adder());
+	CHECK_TRUE(cell[v1()] == 2)
+	CHECK_TRUE(cell[v2()].size() == 1)
+	CHECK_TRUE(cell[v3()][2] == 4)
+
+	const cell_t& const_cell = cell;
+	recorder.sizes.clear();
+	gensimcell::for_each_variable_if<
+		gensimcell::is_trivially_copyable_variable
+	>(const_cell, recorder);
+	CHECK_TRUE(recorder.sizes.size() == 2)
+
+	#ifdef HAVE_MPI
+	cell_t::set_transfer_all(true, v1());
+	cell_t::set_transfer_all(false, v2());
+	cell_t::set_transfer_all(boost::logic::indeterminate, v3());
+	cell.set_transfer(true, v3());
+	cell_t other;
+	other.set_transfer(false, v3());
+
+	recorder.sizes.clear();
+	gensimcell::for_each_transferred_variable(cell, recorder);
+	CHECK_TRUE(recorder.sizes.size() == 2)
+	CHECK_TRUE(recorder.sizes[1] == sizeof(std::array<float, 3>))
+
+	recorder.sizes.clear();
+	gensimcell::for_each_transferred_variable(other, recorder);
+	CHECK_TRUE(recorder.sizes.size() == 1)
+	CHECK_TRUE(recorder.sizes[0] == sizeof(int))
+
+	MPI_Finalize();
+	#endif
+
+	return EXIT_SUCCESS;
+}
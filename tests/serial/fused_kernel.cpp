@@ -0,0 +1,211 @@
+/*
+Tests fusing kernels into one pass over cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "cstdint"
+#include "cstdlib"
+#include "type_traits"
+#include "vector"
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "fused_kernel.hpp"
+#include "parallel_for.hpp"
+
+using namespace std;
+
+struct value { using data_type = double; };
+struct neighbor_sum { using data_type = double; };
+struct scaled { using data_type = double; };
+struct calls { using data_type = int; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	value,
+	neighbor_sum,
+	scaled,
+	calls
+>;
+
+//! One dimensional grid with [] returning a pointer to cell like dccrg.
+struct grid_t
+{
+	std::vector<cell_t> cells;
+
+	cell_t* operator[](const std::uint64_t cell_id)
+	{
+		return &this->cells[size_t(cell_id)];
+	}
+};
+
+//! Sums values of neighbors.
+struct Sum_Kernel :
+	gensimcell::Reads<value>,
+	gensimcell::Writes<neighbor_sum, calls>
+{
+	void operator()(const std::uint64_t cell_id, grid_t& grid) const
+	{
+		auto& cell = *grid[cell_id];
+		cell[neighbor_sum()] = 0;
+		if (cell_id > 0) {
+			cell[neighbor_sum()] += (*grid[cell_id - 1])[value()];
+		}
+		if (cell_id + 1 < grid.cells.size()) {
+			cell[neighbor_sum()] += (*grid[cell_id + 1])[value()];
+		}
+		cell[calls()]++;
+	}
+};
+
+//! Scales value of cell and returns it.
+struct Scale_Kernel :
+	gensimcell::Reads_Own<value>,
+	gensimcell::Writes<scaled, calls>
+{
+	double factor;
+
+	double operator()(const std::uint64_t cell_id, grid_t& grid) const
+	{
+		auto& cell = *grid[cell_id];
+		cell[scaled()] = this->factor * cell[value()];
+		cell[calls()]++;
+		return cell[scaled()];
+	}
+};
+
+//! Copies sum of neighbors to value.
+struct Apply_Kernel :
+	gensimcell::Reads_Own<neighbor_sum>,
+	gensimcell::Writes<value>
+{
+	void operator()(const std::uint64_t cell_id, grid_t& grid) const
+	{
+		auto& cell = *grid[cell_id];
+		cell[value()] = cell[neighbor_sum()];
+	}
+};
+
+int main()
+{
+	using gensimcell::detail::Can_Fuse;
+
+	// legality is decided from annotations
+	static_assert(Can_Fuse<Sum_Kernel, Scale_Kernel>::value, "");
+	static_assert(Can_Fuse<Scale_Kernel, Apply_Kernel>::value, "");
+	// apply writes what sum reads from neighbors
+	static_assert(not Can_Fuse<Sum_Kernel, Apply_Kernel>::value, "");
+	static_assert(not Can_Fuse<Apply_Kernel, Sum_Kernel>::value, "");
+	static_assert(not Can_Fuse<Scale_Kernel, Sum_Kernel, Apply_Kernel>::value, "");
+
+	gensimcell::Thread_Pool pool(4);
+
+	const size_t nr_cells = 1000;
+	grid_t fused_grid, reference_grid;
+	fused_grid.cells.resize(nr_cells);
+	std::vector<std::uint64_t> cell_ids;
+	for (size_t i = 0; i < nr_cells; i++) {
+		fused_grid.cells[i][value()] = double(i % 17) + 1;
+		fused_grid.cells[i][calls()] = 0;
+		cell_ids.push_back(i);
+	}
+	reference_grid = fused_grid;
+
+	// reference result with one pass per kernel
+	Scale_Kernel scale;
+	scale.factor = 3;
+	gensimcell::parallel_for_cells(cell_ids, reference_grid, Sum_Kernel(), 0, pool);
+	const double reference_min
+		= gensimcell::parallel_min_cells(cell_ids, reference_grid, scale, 0, pool);
+
+	auto fused = gensimcell::fuse(Sum_Kernel(), scale);
+	static_assert(
+		std::is_same<
+			decltype(fused(std::uint64_t(0), fused_grid)),
+			double
+		>::value,
+		"Fused kernel should return the result of scale kernel"
+	);
+	const double fused_min
+		= gensimcell::parallel_min_cells(cell_ids, fused_grid, fused, 7, pool);
+	CHECK_TRUE(fused_min == reference_min)
+	CHECK_TRUE(fused_min == 3)
+
+	for (size_t i = 0; i < nr_cells; i++) {
+		CHECK_TRUE(fused_grid.cells[i][neighbor_sum()] == reference_grid.cells[i][neighbor_sum()])
+		CHECK_TRUE(fused_grid.cells[i][scaled()] == reference_grid.cells[i][scaled()])
+		CHECK_TRUE(fused_grid.cells[i][calls()] == 2)
+	}
+
+	// lambdas are annotated explicitly
+	auto apply = gensimcell::annotate<
+		gensimcell::Reads_Own<neighbor_sum>,
+		gensimcell::Writes<value, calls>
+	>([](const std::uint64_t cell_id, grid_t& grid) {
+		auto& cell = *grid[cell_id];
+		cell[value()] = cell[neighbor_sum()];
+		cell[calls()] = 0;
+	});
+	gensimcell::parallel_for_cells(
+		cell_ids,
+		fused_grid,
+		gensimcell::fuse(scale, apply),
+		0,
+		pool
+	);
+	for (size_t i = 0; i < nr_cells; i++) {
+		CHECK_TRUE(fused_grid.cells[i][value()] == reference_grid.cells[i][neighbor_sum()])
+		CHECK_TRUE(fused_grid.cells[i][calls()] == 0)
+	}
+
+	// fused kernel is annotated with accesses of all kernels
+	using fused_t = decltype(fused);
+	static_assert(
+		std::is_same<
+			fused_t::neighbor_reads,
+			gensimcell::detail::Variable_List<value>
+		>::value
+		and std::is_same<
+			fused_t::own_reads,
+			gensimcell::detail::Variable_List<value>
+		>::value,
+		""
+	);
+	CHECK_TRUE(gensimcell::get_accesses<fused_t>(gensimcell::Cell_Set::inner).size() == 6)
+	static_assert(
+		std::is_same<
+			decltype(apply)::writes,
+			gensimcell::detail::Variable_List<value, calls>
+		>::value,
+		""
+	);
+
+	return EXIT_SUCCESS;
+}
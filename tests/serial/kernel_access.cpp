@@ -0,0 +1,221 @@
+/*
+Tests kernel access annotations and Halo_Tracker.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "algorithm"
+#include "cstdlib"
+#include "iostream"
+#include "typeindex"
+#include "vector"
+
+#ifdef HAVE_MPI
+#include "mpi.h"
+#endif
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "kernel_access.hpp"
+
+using namespace std;
+
+struct Number_Of_External { using data_type = unsigned int; };
+struct Velocity { using data_type = double; };
+struct External { using data_type = std::vector<double>; };
+struct Internal { using data_type = std::vector<double>; };
+
+using Cell = gensimcell::Cell<
+	#ifdef HAVE_MPI
+	gensimcell::Optional_Transfer,
+	#else
+	gensimcell::Never_Transfer,
+	#endif
+	Number_Of_External,
+	Velocity,
+	External,
+	Internal
+>;
+
+// kernels of particle propagation
+struct Solve :
+	gensimcell::Reads_Own<Velocity, Internal>,
+	gensimcell::Writes<Number_Of_External, External, Internal>
+{};
+struct Resize :
+	gensimcell::Reads<Number_Of_External>,
+	gensimcell::Writes<External>
+{};
+struct Incorporate :
+	gensimcell::Reads<External>,
+	gensimcell::Writes<Internal>
+{};
+struct Remove : gensimcell::Writes<Number_Of_External, External> {};
+struct Nothing {};
+
+bool has_access(
+	const std::vector<gensimcell::Variable_Access>& accesses,
+	const std::type_index variable,
+	const gensimcell::Cell_Set cells,
+	const bool write
+) {
+	return std::find_if(
+		accesses.begin(),
+		accesses.end(),
+		[&](const gensimcell::Variable_Access& access) {
+			return
+				access.variable == variable
+				and access.cells == cells
+				and access.write == write;
+		}
+	) != accesses.end();
+}
+
+int main(int argc, char* argv[])
+{
+	#ifdef HAVE_MPI
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	#else
+	(void)argc;
+	(void)argv;
+	#endif
+
+	using gensimcell::Cell_Set;
+
+	// accesses for task graph
+	const auto resize_inner = gensimcell::get_accesses<Resize>(Cell_Set::inner);
+	CHECK_TRUE(resize_inner.size() == 2)
+	CHECK_TRUE(has_access(
+		resize_inner,
+		typeid(Number_Of_External),
+		Cell_Set::inner | Cell_Set::outer,
+		false
+	))
+	CHECK_TRUE(has_access(resize_inner, typeid(External), Cell_Set::inner, true))
+
+	const auto solve_outer = gensimcell::get_accesses<Solve>(Cell_Set::outer);
+	CHECK_TRUE(solve_outer.size() == 5)
+	CHECK_TRUE(has_access(solve_outer, typeid(Velocity), Cell_Set::outer, false))
+	CHECK_TRUE(has_access(solve_outer, typeid(Internal), Cell_Set::outer, true))
+
+	const auto incorporate_outer
+		= gensimcell::get_accesses<Incorporate>(Cell_Set::outer);
+	CHECK_TRUE(has_access(incorporate_outer, typeid(External), Cell_Set::all, false))
+
+	CHECK_TRUE(gensimcell::get_accesses<Nothing>(Cell_Set::all).size() == 0)
+
+
+	gensimcell::Halo_Tracker<Cell> halo;
+
+	// remote copies are initially out of date
+	CHECK_TRUE(halo.is_out_of_date<Number_Of_External>())
+	CHECK_TRUE(halo.is_out_of_date<Velocity>())
+	CHECK_TRUE(halo.needs_exchange<Resize>())
+	CHECK_TRUE(not halo.needs_exchange<Solve>())
+	CHECK_TRUE(not halo.needs_exchange<Nothing>())
+
+	// only variables read from neighbors are transferred
+	CHECK_TRUE(halo.prepare_exchange<Resize>())
+	CHECK_TRUE(halo.is_transferred<Number_Of_External>())
+	CHECK_TRUE(not halo.is_transferred<Velocity>())
+	CHECK_TRUE(not halo.is_transferred<External>())
+	#ifdef HAVE_MPI
+	CHECK_TRUE(Cell::get_transfer_all(Number_Of_External()))
+	CHECK_TRUE(not Cell::get_transfer_all(Velocity()))
+	CHECK_TRUE(not Cell::get_transfer_all(External()))
+	#endif
+	halo.finish_exchange();
+	CHECK_TRUE(not halo.is_out_of_date<Number_Of_External>())
+	CHECK_TRUE(not halo.is_transferred<Number_Of_External>())
+	#ifdef HAVE_MPI
+	CHECK_TRUE(not Cell::get_transfer_all(Number_Of_External()))
+	#endif
+
+	// up to date variables aren't transferred again
+	CHECK_TRUE(not halo.needs_exchange<Resize>())
+	CHECK_TRUE(not halo.prepare_exchange<Resize>())
+	halo.finish_exchange();
+
+	// writes to inner cells don't affect remote copies
+	halo.written<Solve>(Cell_Set::inner);
+	CHECK_TRUE(not halo.needs_exchange<Resize>())
+	halo.written<Solve>(Cell_Set::outer);
+	CHECK_TRUE(halo.needs_exchange<Resize>())
+	CHECK_TRUE(halo.needs_exchange<Incorporate>())
+
+	// variables of several kernels are exchanged together
+	CHECK_TRUE((halo.prepare_exchange<Resize, Incorporate>()))
+	CHECK_TRUE(halo.is_transferred<Number_Of_External>())
+	CHECK_TRUE(halo.is_transferred<External>())
+	CHECK_TRUE(not halo.is_transferred<Internal>())
+
+	// writes during an exchange are not covered by it
+	halo.written<Remove>(Cell_Set::outer);
+	halo.finish_exchange();
+	CHECK_TRUE(halo.is_out_of_date<Number_Of_External>())
+	CHECK_TRUE(halo.is_out_of_date<External>())
+
+	CHECK_TRUE(halo.prepare_exchange<Incorporate>())
+	CHECK_TRUE(not halo.is_transferred<Number_Of_External>())
+	CHECK_TRUE(halo.is_transferred<External>())
+	halo.finish_exchange();
+	CHECK_TRUE(not halo.is_out_of_date<External>())
+	CHECK_TRUE(halo.is_out_of_date<Number_Of_External>())
+
+	// writes by code without annotations
+	halo.variables_written<External>(Cell_Set::outer);
+	CHECK_TRUE(halo.is_out_of_date<External>())
+
+	// velocity is never read from neighbors so it's never transferred
+	CHECK_TRUE(halo.is_out_of_date<Velocity>())
+	CHECK_TRUE(not (halo.needs_exchange<Solve, Remove>()))
+
+	// transfers of other policies aren't switched
+	using Always_Cell = gensimcell::Cell<
+		gensimcell::Always_Transfer,
+		Number_Of_External,
+		Velocity,
+		External,
+		Internal
+	>;
+	gensimcell::Halo_Tracker<Always_Cell> always_halo;
+	CHECK_TRUE(always_halo.prepare_exchange<Resize>())
+	CHECK_TRUE(always_halo.is_transferred<Number_Of_External>())
+	always_halo.finish_exchange();
+	CHECK_TRUE(not always_halo.needs_exchange<Resize>())
+
+	#ifdef HAVE_MPI
+	MPI_Finalize();
+	#endif
+
+	return EXIT_SUCCESS;
+}
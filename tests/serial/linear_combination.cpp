@@ -0,0 +1,159 @@
+/*
+Tests fused linear combinations of generic cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdlib"
+#include "iostream"
+#include "vector"
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "linear_combination.hpp"
+
+using namespace std;
+
+struct test_variable1 {
+	using data_type = double;
+};
+
+struct test_variable2 {
+	using data_type = std::array<double, 2>;
+};
+
+struct test_variable3 {
+	using data_type = std::vector<std::array<double, 3>>;
+};
+
+using cell1_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	test_variable1,
+	test_variable2
+>;
+
+struct test_variable4 {
+	using data_type = cell1_t;
+};
+
+using cell2_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	test_variable1,
+	test_variable2,
+	test_variable3,
+	test_variable4
+>;
+
+int main(int, char**)
+{
+	const test_variable1 v1{};
+	const test_variable2 v2{};
+	const test_variable3 v3{};
+	const test_variable4 v4{};
+
+	cell2_t y, x, z;
+	y = 1;
+	x = 2;
+	z = 3;
+	y[v3].resize(2, {{1, 1, 1}});
+	x[v3].resize(2, {{2, 2, 2}});
+	z[v3].resize(2, {{3, 3, 3}});
+
+	// only given variables change
+	gensimcell::axpy(y, 0.5, x, v1, v3);
+	CHECK_TRUE(y[v1] == 2)
+	CHECK_TRUE(y[v2][0] == 1)
+	CHECK_TRUE(y[v3][1][2] == 2)
+	CHECK_TRUE(y[v4][v1] == 1)
+
+	gensimcell::axpy(y, 2.0, x, v2, v4);
+	CHECK_TRUE(y[v1] == 2)
+	CHECK_TRUE(y[v2][0] == 5)
+	CHECK_TRUE(y[v2][1] == 5)
+	CHECK_TRUE(y[v4][v1] == 5)
+	CHECK_TRUE(y[v4][v2][1] == 5)
+
+	// y = 2 * x + 0.5 * y
+	gensimcell::axpby(y, 2.0, x, 0.5, v1, v2);
+	CHECK_TRUE(y[v1] == 5)
+	CHECK_TRUE(y[v2][1] == 6.5)
+	CHECK_TRUE(y[v4][v1] == 5)
+
+	// y = x - z, vectors in y are resized like in assignment
+	y[v3].resize(3);
+	gensimcell::lincomb(y, 1.0, x, -1.0, z, v1, v2, v3, v4);
+	CHECK_TRUE(y[v1] == -1)
+	CHECK_TRUE(y[v2][0] == -1)
+	CHECK_TRUE(y[v3].size() == 2)
+	CHECK_TRUE(y[v3][1][1] == -1)
+	CHECK_TRUE(y[v4][v2][0] == -1)
+
+	// output can be one of the inputs
+	gensimcell::lincomb(x, 2.0, x, 1.0, z, v1);
+	CHECK_TRUE(x[v1] == 7)
+
+
+	// ranges of cells
+	std::vector<cell1_t> ys(10), xs(10), zs(10);
+	for (size_t i = 0; i < ys.size(); i++) {
+		ys[i] = double(i);
+		xs[i] = 1;
+		zs[i] = 2;
+	}
+
+	gensimcell::axpy(ys, 3.0, xs, v1);
+	for (size_t i = 0; i < ys.size(); i++) {
+		CHECK_TRUE(ys[i][v1] == double(i) + 3)
+		CHECK_TRUE(ys[i][v2][0] == double(i))
+	}
+
+	gensimcell::axpby(ys, 1.0, xs, 2.0, v2);
+	for (size_t i = 0; i < ys.size(); i++) {
+		CHECK_TRUE(ys[i][v1] == double(i) + 3)
+		CHECK_TRUE(ys[i][v2][1] == 2 * double(i) + 1)
+	}
+
+	gensimcell::lincomb(ys, 1.0, xs, 1.0, zs, v1, v2);
+	for (size_t i = 0; i < ys.size(); i++) {
+		CHECK_TRUE(ys[i][v1] == 3)
+		CHECK_TRUE(ys[i][v2][0] == 3)
+	}
+
+	std::array<cell1_t, 3> ya, xa;
+	ya[0] = ya[1] = ya[2] = 1;
+	xa[0] = xa[1] = xa[2] = 1;
+	gensimcell::axpy(ya, -1.0, xa, v1, v2);
+	for (const auto& cell: ya) {
+		CHECK_TRUE(cell[v1] == 0)
+		CHECK_TRUE(cell[v2][1] == 0)
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+/*
+Counts memory allocations of copying and moving particle cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdlib"
+#include "iostream"
+#include "new"
+#include "string"
+#include "utility"
+#include "vector"
+
+#include "mpi.h"
+
+#include "check_true.hpp"
+#include "particle_variables.hpp"
+
+using namespace std;
+
+
+// number of calls to global operator new
+size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+	allocations++;
+	void* const memory = std::malloc(size > 0 ? size : 1);
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+
+particle::Cell make_cell(const size_t nr_of_particles)
+{
+	particle::Cell cell;
+	cell[particle::Velocity()] = {{1, 2}};
+	cell[particle::Internal_Particles()].resize(nr_of_particles, {{1, 2, 3}});
+	cell[particle::External_Particles()].resize(
+		nr_of_particles,
+		std::make_pair(std::array<double, 3>{{4, 5, 6}}, 7ull)
+	);
+	cell[particle::Number_Of_Internal_Particles()] = nr_of_particles;
+	cell[particle::Number_Of_External_Particles()] = nr_of_particles;
+	return cell;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+
+	constexpr size_t
+		nr_of_cells = 1000,
+		nr_of_particles = 100;
+
+	const particle::Cell reference = make_cell(nr_of_particles);
+
+	// growing a vector of cells moves existing cells
+	std::vector<particle::Cell> cells;
+	size_t before = allocations;
+	for (size_t i = 0; i < nr_of_cells; i++) {
+		cells.push_back(reference);
+	}
+	const size_t push_back_allocations = allocations - before;
+	// two vectors per cell plus reallocations of cells
+	CHECK_TRUE(push_back_allocations < 2 * nr_of_cells + 64)
+
+	// copy assign from an lvalue
+	std::vector<particle::Cell> targets(nr_of_cells);
+	before = allocations;
+	for (size_t i = 0; i < nr_of_cells; i++) {
+		gensimcell::assign(targets[i], cells[i]);
+	}
+	const size_t copy_assign_allocations = allocations - before;
+	CHECK_TRUE(copy_assign_allocations == 2 * nr_of_cells)
+
+	targets.clear();
+	targets.resize(nr_of_cells);
+	before = allocations;
+	for (size_t i = 0; i < nr_of_cells; i++) {
+		gensimcell::assign(targets[i], std::move(cells[i]));
+	}
+	const size_t move_assign_allocations = allocations - before;
+	CHECK_TRUE(move_assign_allocations == 0)
+	CHECK_TRUE(targets[0][particle::Internal_Particles()].size() == nr_of_particles)
+
+	// move assignment of whole cells
+	before = allocations;
+	for (size_t i = 0; i < nr_of_cells; i++) {
+		cells[i] = std::move(targets[i]);
+	}
+	const size_t move_allocations = allocations - before;
+	CHECK_TRUE(move_allocations == 0)
+	CHECK_TRUE(cells[0][particle::External_Particles()][0].second == 7)
+
+	// a + (b + c) copies a and b
+	particle::Cell a = make_cell(nr_of_particles);
+	particle::Cell b = make_cell(nr_of_particles);
+	particle::Cell c = make_cell(nr_of_particles);
+	before = allocations;
+	for (size_t i = 0; i < nr_of_cells; i++) {
+		particle::Cell result = a + (b + c);
+		CHECK_TRUE(result[particle::Velocity()][1] == 6)
+	}
+	const size_t expression_allocations = allocations - before;
+	// temporary right hand side isn't reused because
+	// a + b and b + a differ e.g. for matrix variables
+	CHECK_TRUE(expression_allocations == 4 * nr_of_cells)
+
+	// result doesn't depend on whether operands are temporaries
+	struct Name { using data_type = std::string; };
+	using Name_Cell = gensimcell::Cell<gensimcell::Never_Transfer, Name>;
+	Name_Cell first, second;
+	first[Name()] = "a";
+	second[Name()] = "b";
+	CHECK_TRUE((first + second)[Name()] == "ab")
+	CHECK_TRUE((first + Name_Cell(second))[Name()] == "ab")
+	CHECK_TRUE((Name_Cell(first) + second)[Name()] == "ab")
+
+	cout << "Allocations for " << nr_of_cells
+		<< " cells with " << nr_of_particles << " particles"
+		<< "\n  push_back:        " << push_back_allocations
+		<< "\n  assign copy:      " << copy_assign_allocations
+		<< "\n  assign move:      " << move_assign_allocations
+		<< "\n  move assignment:  " << move_allocations
+		<< "\n  a + (b + c):      " << expression_allocations
+		<< endl;
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
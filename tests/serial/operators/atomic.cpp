@@ -0,0 +1,162 @@
+/*
+Tests atomic operators of generic simulation cell.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdlib"
+#include "iostream"
+#include "thread"
+#include "utility"
+#include "vector"
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+
+using namespace std;
+
+struct test_variable1 {
+	using data_type = double;
+};
+
+struct test_variable2 {
+	using data_type = std::array<int, 2>;
+};
+
+struct test_variable3 {
+	using data_type = std::vector<std::pair<float, unsigned long>>;
+};
+
+using cell1_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	test_variable1,
+	test_variable2,
+	test_variable3
+>;
+
+using cell2_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	test_variable1
+>;
+
+int main(int, char**)
+{
+	const test_variable1 v1{};
+	const test_variable2 v2{};
+	const test_variable3 v3{};
+
+	cell1_t c1_1, c1_2;
+	c1_1[v1] = 1;
+	c1_1[v2] = {{2, 3}};
+	c1_1[v3].resize(2, std::make_pair(4.0f, 5));
+	c1_2[v1] = 4;
+	c1_2[v2] = {{5, 6}};
+	c1_2[v3].resize(2, std::make_pair(1.0f, 2));
+
+	c1_1.atomic_plus_equal(c1_2, v1, v2, v3);
+	CHECK_TRUE(c1_1[v1] == 5)
+	CHECK_TRUE(c1_1[v2][0] == 7)
+	CHECK_TRUE(c1_1[v2][1] == 9)
+	CHECK_TRUE(c1_1[v3][0].first == 5)
+	CHECK_TRUE(c1_1[v3][0].second == 7)
+	CHECK_TRUE(c1_1[v3][1].first == 5)
+	CHECK_TRUE(c1_1[v3][1].second == 7)
+
+	c1_1.atomic_minus_equal(c1_2, v2);
+	CHECK_TRUE(c1_1[v1] == 5)
+	CHECK_TRUE(c1_1[v2][0] == 2)
+	CHECK_TRUE(c1_1[v2][1] == 3)
+
+	c1_1.atomic_mul_equal(c1_2, v1, v2);
+	CHECK_TRUE(c1_1[v1] == 20)
+	CHECK_TRUE(c1_1[v2][0] == 10)
+	CHECK_TRUE(c1_1[v2][1] == 18)
+
+	c1_1.atomic_div_equal(c1_2, v1, v2);
+	CHECK_TRUE(c1_1[v1] == 5)
+	CHECK_TRUE(c1_1[v2][0] == 2)
+	CHECK_TRUE(c1_1[v2][1] == 3)
+
+	// scalar broadcast
+	c1_1.atomic_plus_equal(1, v1, v2, v3);
+	CHECK_TRUE(c1_1[v1] == 6)
+	CHECK_TRUE(c1_1[v2][0] == 3)
+	CHECK_TRUE(c1_1[v3][1].first == 6)
+	CHECK_TRUE(c1_1[v3][1].second == 8)
+	c1_1.atomic_mul_equal(0.5, v1);
+	CHECK_TRUE(c1_1[v1] == 3)
+	c1_1.atomic_minus_equal(1, v2);
+	CHECK_TRUE(c1_1[v2][0] == 2)
+	CHECK_TRUE(c1_1[v2][1] == 3)
+
+	cell2_t c2;
+	c2[v1] = 1;
+	c2.atomic_plus_equal(c2, v1);
+	CHECK_TRUE(c2[v1] == 2)
+	c2.atomic_div_equal(4, v1);
+	CHECK_TRUE(c2[v1] == 0.5)
+
+	// concurrent updates of the same cells
+	const size_t nr_threads = 4, nr_updates = 100000;
+	cell1_t target, contribution;
+	target[v1] = 0;
+	target[v2] = {{0, 0}};
+	target[v3].resize(3, std::make_pair(0.0f, 0));
+	contribution[v1] = 0.5;
+	contribution[v2] = {{1, -1}};
+	contribution[v3].resize(3, std::make_pair(0.25f, 1));
+	cell2_t counter;
+	counter[v1] = 0;
+
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < nr_threads; i++) {
+		threads.emplace_back([&]() {
+			for (size_t j = 0; j < nr_updates; j++) {
+				target.atomic_plus_equal(contribution, v1, v2, v3);
+				counter.atomic_plus_equal(1, v1);
+			}
+		});
+	}
+	for (auto& thread: threads) {
+		thread.join();
+	}
+
+	const size_t total = nr_threads * nr_updates;
+	CHECK_TRUE(target[v1] == 0.5 * total)
+	CHECK_TRUE(target[v2][0] == int(total))
+	CHECK_TRUE(target[v2][1] == -int(total))
+	for (const auto& item: target[v3]) {
+		CHECK_TRUE(item.first == 0.25f * total)
+		CHECK_TRUE(item.second == total)
+	}
+	CHECK_TRUE(counter[v1] == total)
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,226 @@
+/*
+Tests element-wise operators of generic cell.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdlib"
+#include "iostream"
+#include "utility"
+#include "vector"
+
+#ifdef HAVE_EIGEN
+#include "Eigen/Core"
+#endif
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+
+using namespace std;
+
+struct test_variable1 {
+	using data_type = double;
+};
+
+struct test_variable2 {
+	using data_type = std::array<double, 2>;
+};
+
+struct test_variable3 {
+	using data_type = std::vector<std::array<double, 3>>;
+};
+
+struct test_variable4 {
+	using data_type = std::vector<std::pair<std::array<double, 3>, int>>;
+};
+
+using cell1_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	test_variable1,
+	test_variable2
+>;
+
+struct test_variable5 {
+	using data_type = std::array<cell1_t, 2>;
+};
+
+using cell2_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	test_variable1,
+	test_variable2,
+	test_variable3,
+	test_variable4,
+	test_variable5
+>;
+
+#ifdef HAVE_EIGEN
+struct test_variable6 {
+	using data_type = Eigen::Matrix2d;
+};
+
+using cell3_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	test_variable1,
+	test_variable6
+>;
+#endif
+
+int main(int, char**)
+{
+	const test_variable1 v1{};
+	const test_variable2 v2{};
+	const test_variable3 v3{};
+	const test_variable4 v4{};
+	const test_variable5 v5{};
+
+	cell1_t c1_1, c1_2;
+	c1_1[v1] = 1;
+	c1_1[v2] = {{2, 3}};
+	c1_2[v1] = 4;
+	c1_2[v2] = {{5, 6}};
+
+	c1_1 += c1_2;
+	CHECK_TRUE(c1_1[v1] == 5)
+	CHECK_TRUE(c1_1[v2][0] == 7)
+	CHECK_TRUE(c1_1[v2][1] == 9)
+	c1_1 -= c1_2;
+	CHECK_TRUE(c1_1[v1] == 1)
+	CHECK_TRUE(c1_1[v2][0] == 2)
+	CHECK_TRUE(c1_1[v2][1] == 3)
+	c1_1 *= c1_2;
+	CHECK_TRUE(c1_1[v1] == 4)
+	CHECK_TRUE(c1_1[v2][0] == 10)
+	CHECK_TRUE(c1_1[v2][1] == 18)
+	c1_1 /= c1_2;
+	CHECK_TRUE(c1_1[v1] == 1)
+	CHECK_TRUE(c1_1[v2][0] == 2)
+	CHECK_TRUE(c1_1[v2][1] == 3)
+
+	// scalar broadcast
+	c1_1 += 1;
+	CHECK_TRUE(c1_1[v1] == 2)
+	CHECK_TRUE(c1_1[v2][0] == 3)
+	CHECK_TRUE(c1_1[v2][1] == 4)
+	c1_1 *= 2.0;
+	CHECK_TRUE(c1_1[v1] == 4)
+	CHECK_TRUE(c1_1[v2][0] == 6)
+	CHECK_TRUE(c1_1[v2][1] == 8)
+	c1_1 = c1_1 / 2.0 - 1;
+	CHECK_TRUE(c1_1[v1] == 1)
+	CHECK_TRUE(c1_1[v2][0] == 2)
+	CHECK_TRUE(c1_1[v2][1] == 3)
+	c1_1 = 0;
+	CHECK_TRUE(c1_1[v1] == 0)
+	CHECK_TRUE(c1_1[v2][0] == 0)
+	CHECK_TRUE(c1_1[v2][1] == 0)
+
+	// selected variables only
+	c1_1[v1] = 1;
+	c1_1[v2] = {{2, 3}};
+	c1_1.plus_equal(c1_2, v2);
+	CHECK_TRUE(c1_1[v1] == 1)
+	CHECK_TRUE(c1_1[v2][0] == 7)
+	CHECK_TRUE(c1_1[v2][1] == 9)
+	c1_1.mul_equal(2, v2);
+	CHECK_TRUE(c1_1[v1] == 1)
+	CHECK_TRUE(c1_1[v2][0] == 14)
+	CHECK_TRUE(c1_1[v2][1] == 18)
+
+
+	// nested containers and cells
+	cell2_t c2_1, c2_2;
+	c2_1 = 1;
+	CHECK_TRUE(c2_1[v3].size() == 0)
+	CHECK_TRUE(c2_1[v5][1][v2][1] == 1)
+
+	c2_1[v3].resize(2, {{1, 2, 3}});
+	c2_2[v3].resize(2, {{4, 5, 6}});
+	c2_1[v4].resize(1, std::make_pair(std::array<double, 3>{{1, 2, 3}}, 4));
+	c2_2[v4].resize(1, std::make_pair(std::array<double, 3>{{5, 6, 7}}, 8));
+	c2_2 = 2;
+	c2_2[v5][0] += c2_2[v5][1];
+	CHECK_TRUE(c2_2[v5][0][v1] == 4)
+	CHECK_TRUE(c2_2[v5][0][v2][0] == 4)
+
+	c2_1 *= c2_2;
+	CHECK_TRUE(c2_1[v1] == 2)
+	CHECK_TRUE(c2_1[v2][1] == 2)
+	CHECK_TRUE(c2_1[v3].size() == 2)
+	CHECK_TRUE(c2_1[v3][0][0] == 2)
+	CHECK_TRUE(c2_1[v3][1][2] == 6)
+	CHECK_TRUE(c2_1[v4][0].first[1] == 4)
+	CHECK_TRUE(c2_1[v4][0].second == 8)
+	CHECK_TRUE(c2_1[v5][0][v1] == 4)
+	CHECK_TRUE(c2_1[v5][1][v2][0] == 2)
+
+	c2_1 -= c2_2;
+	CHECK_TRUE(c2_1[v3].size() == 2)
+	CHECK_TRUE(c2_1[v3][0][0] == 0)
+	CHECK_TRUE(c2_1[v3][1][2] == 4)
+
+	// whole state update, e.g. one Runge-Kutta stage
+	cell2_t y, k;
+	y = 1;
+	y[v3].resize(3, {{1, 1, 1}});
+	k = y;
+	k *= 2;
+	y += k * 0.5;
+	CHECK_TRUE(y[v1] == 2)
+	CHECK_TRUE(y[v2][0] == 2)
+	CHECK_TRUE(y[v3][2][1] == 2)
+	CHECK_TRUE(y[v5][1][v2][1] == 2)
+
+
+	#ifdef HAVE_EIGEN
+	const test_variable6 v6{};
+
+	cell3_t c3_1, c3_2;
+	c3_1[v6] << 1, 2, 3, 4;
+	c3_2[v6] << 2, 2, 2, 2;
+	c3_1[v1] = 1;
+	c3_2[v1] = 2;
+	c3_1 *= c3_2;
+	CHECK_TRUE(c3_1[v1] == 2)
+	CHECK_TRUE(c3_1[v6](0, 0) == 2)
+	CHECK_TRUE(c3_1[v6](0, 1) == 4)
+	CHECK_TRUE(c3_1[v6](1, 0) == 6)
+	CHECK_TRUE(c3_1[v6](1, 1) == 8)
+	c3_1 /= c3_2;
+	c3_1 += 1;
+	CHECK_TRUE(c3_1[v1] == 2)
+	CHECK_TRUE(c3_1[v6](0, 0) == 2)
+	CHECK_TRUE(c3_1[v6](1, 1) == 5)
+	c3_1 = 3;
+	CHECK_TRUE(c3_1[v1] == 3)
+	CHECK_TRUE(c3_1[v6](1, 0) == 3)
+	#endif
+
+	return EXIT_SUCCESS;
+}
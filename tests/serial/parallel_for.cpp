@@ -0,0 +1,243 @@
+/*
+Tests for the work-stealing thread pool.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "algorithm"
+#include "atomic"
+#include "chrono"
+#include "cstdint"
+#include "cstdlib"
+#include "functional"
+#include "future"
+#include "thread"
+#include "vector"
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "parallel_for.hpp"
+
+using namespace std;
+
+struct value { using data_type = double; };
+struct result { using data_type = double; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	value,
+	result
+>;
+
+//! Grid with [] returning a pointer to cell like dccrg.
+struct grid_t
+{
+	std::vector<cell_t> cells;
+
+	cell_t* operator[](const std::uint64_t cell_id)
+	{
+		return &this->cells[size_t(cell_id)];
+	}
+};
+
+//! Checks that ranges given to parallel_for cover each item once.
+bool covers_once(
+	gensimcell::Thread_Pool& pool,
+	const size_t nr_items,
+	const size_t chunk_size
+) {
+	std::vector<int> counts(nr_items, 0);
+	std::atomic<bool> valid_slots(true);
+	pool.parallel_for(nr_items, chunk_size,
+		[&](const size_t begin, const size_t end, const size_t slot) {
+			if (
+				slot >= pool.size()
+				or begin >= end
+				or (chunk_size > 0 and end - begin > chunk_size)
+			) {
+				valid_slots = false;
+			}
+			for (size_t i = begin; i < end; i++) {
+				counts[i]++;
+			}
+		}
+	);
+	return
+		valid_slots
+		and std::all_of(counts.begin(), counts.end(), [](const int count) {
+			return count == 1;
+		});
+}
+
+int main()
+{
+	gensimcell::Thread_Pool pool(4), serial_pool(1);
+	CHECK_TRUE(pool.size() == 4)
+
+	// size of default pool is set before its first use
+	gensimcell::set_default_nr_threads(3);
+	CHECK_TRUE(gensimcell::get_default_thread_pool().size() == 3)
+	gensimcell::set_default_nr_threads(5);
+	CHECK_TRUE(gensimcell::get_default_thread_pool().size() == 3)
+	CHECK_TRUE(serial_pool.size() == 1)
+
+	for (const size_t nr_items: {0, 1, 2, 3, 5, 100, 12345}) {
+		for (const size_t chunk_size: {
+			size_t(0),
+			size_t(1),
+			size_t(7),
+			size_t(1000),
+			gensimcell::static_schedule
+		}) {
+			CHECK_TRUE(covers_once(pool, nr_items, chunk_size))
+			CHECK_TRUE(covers_once(serial_pool, nr_items, chunk_size))
+		}
+	}
+
+	// uneven work is stolen by other threads
+	std::vector<std::thread::id> thread_ids(64);
+	pool.parallel_for(thread_ids.size(), 1,
+		[&](const size_t begin, const size_t, const size_t) {
+			if (begin < 16) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			}
+			thread_ids[begin] = std::this_thread::get_id();
+		}
+	);
+	std::sort(thread_ids.begin(), thread_ids.end());
+	CHECK_TRUE(std::unique(thread_ids.begin(), thread_ids.end()) - thread_ids.begin() > 1)
+
+	// nested and concurrent calls
+	std::atomic<size_t> total(0);
+	auto nested = [&]() {
+		pool.parallel_for(10, 1, [&](const size_t, const size_t, const size_t) {
+			pool.parallel_for(100, 3, [&](const size_t begin, const size_t end, const size_t) {
+				total += end - begin;
+			});
+		});
+	};
+	auto first = std::async(std::launch::async, nested);
+	auto second = std::async(std::launch::async, nested);
+	nested();
+	first.wait();
+	second.wait();
+	CHECK_TRUE(total == 3000)
+
+	// static schedule gives the same items to the same threads
+	std::vector<std::thread::id> first_ids(1000), second_ids(1000);
+	for (auto* ids: {&first_ids, &second_ids}) {
+		pool.parallel_for(ids->size(), gensimcell::static_schedule,
+			[&](const size_t begin, const size_t end, const size_t slot) {
+				CHECK_TRUE(begin == slot * 1000 / pool.size())
+				CHECK_TRUE(end == (slot + 1) * 1000 / pool.size())
+				for (size_t i = begin; i < end; i++) {
+					(*ids)[i] = std::this_thread::get_id();
+				}
+			}
+		);
+	}
+	CHECK_TRUE(first_ids == second_ids)
+	CHECK_TRUE(first_ids[0] == std::this_thread::get_id())
+	std::sort(first_ids.begin(), first_ids.end());
+	CHECK_TRUE(size_t(std::unique(first_ids.begin(), first_ids.end()) - first_ids.begin()) == pool.size())
+
+	std::vector<std::thread::id> first_threads(pool.size()), second_threads(pool.size());
+	for (auto* threads: {&first_threads, &second_threads}) {
+		pool.for_each_thread([&](const size_t thread) {
+			(*threads)[thread] = std::this_thread::get_id();
+		});
+	}
+	CHECK_TRUE(first_threads == second_threads)
+	CHECK_TRUE(first_threads[0] == std::this_thread::get_id())
+	std::sort(first_threads.begin(), first_threads.end());
+	CHECK_TRUE(std::unique(first_threads.begin(), first_threads.end()) == first_threads.end())
+
+	// workers can't wait for each other so static schedule isn't used
+	total = 0;
+	pool.parallel_for(10, 1, [&](const size_t, const size_t, const size_t) {
+		pool.parallel_for(100, gensimcell::static_schedule,
+			[&](const size_t begin, const size_t end, const size_t) {
+				total += end - begin;
+			}
+		);
+		pool.for_each_thread([&](const size_t) {
+			total++;
+		});
+	});
+	CHECK_TRUE(total == 10 * (100 + pool.size()))
+
+	// kernels over cells
+	grid_t grid;
+	grid.cells.resize(10000);
+	std::vector<std::uint64_t> cell_ids;
+	for (size_t i = 0; i < grid.cells.size(); i++) {
+		grid.cells[i][value()] = double(i);
+		if (i % 2 == 0) {
+			cell_ids.push_back(i);
+		}
+	}
+	std::reverse(cell_ids.begin(), cell_ids.end());
+
+	gensimcell::parallel_for_cells(cell_ids, grid,
+		[](const std::uint64_t cell_id, grid_t& grid) {
+			auto& cell = *grid[cell_id];
+			cell[result()] = 2 * cell[value()];
+		}
+	);
+	for (size_t i = 0; i < grid.cells.size(); i++) {
+		CHECK_TRUE(grid.cells[i][result()] == (i % 2 == 0 ? 2 * double(i) : 0))
+	}
+
+	const auto time_step = [](const std::uint64_t cell_id, grid_t& grid) {
+		return 1 / (1 + (*grid[cell_id])[value()]);
+	};
+	CHECK_TRUE(
+		gensimcell::parallel_min_cells(cell_ids, grid, time_step, 7, pool)
+		== 1.0 / 9999
+	)
+	CHECK_TRUE(
+		gensimcell::parallel_min_cells(std::vector<std::uint64_t>(), grid, time_step)
+		== std::numeric_limits<double>::max()
+	)
+	CHECK_TRUE(
+		gensimcell::parallel_reduce_cells(
+			cell_ids,
+			grid,
+			[](const std::uint64_t cell_id, grid_t&) {
+				return cell_id;
+			},
+			std::uint64_t(0),
+			std::plus<std::uint64_t>(),
+			0,
+			pool
+		) == 5000 * 9998 / 2
+	)
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+/*
+Tests storage of cells first touched by the threads that process them.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "atomic"
+#include "cstdlib"
+#include "limits"
+#include "new"
+#include "thread"
+#include "utility"
+#include "vector"
+
+#include "assign_ranges.hpp"
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "partitioned_cells.hpp"
+
+using namespace std;
+
+std::atomic<int> nr_objects(0);
+
+//! Counts objects alive.
+struct counted
+{
+	int value = 3;
+	counted() { nr_objects++; }
+	counted(const counted& other) : value(other.value) { nr_objects++; }
+	~counted() { nr_objects--; }
+	counted& operator=(const counted&) = default;
+};
+
+struct density { using data_type = double; };
+struct particles { using data_type = std::vector<double>; };
+struct object { using data_type = counted; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	density,
+	particles,
+	object
+>;
+
+using density_cell_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	density
+>;
+
+int main(int, char**)
+{
+	gensimcell::Thread_Pool pool(4);
+
+	{
+		gensimcell::Partitioned_Cells<cell_t> cells(1001, pool);
+		CHECK_TRUE(cells.size() == 1001)
+		CHECK_TRUE(&cells.get_pool() == &pool)
+		CHECK_TRUE(nr_objects == 1001)
+		for (const auto& cell: cells) {
+			CHECK_TRUE(cell[density()] == 0)
+			CHECK_TRUE(cell[particles()].size() == 0)
+			CHECK_TRUE(cell[object()].value == 3)
+		}
+
+		// each thread processes the same cells every time
+		std::vector<std::thread::id> threads(cells.size());
+		cells.for_each_partition([&](const size_t begin, const size_t end, const size_t) {
+			for (size_t i = begin; i < end; i++) {
+				cells[i][density()] = double(i);
+				cells[i][particles()].resize(i % 5, 1);
+				threads[i] = std::this_thread::get_id();
+			}
+		});
+		cells.for_each_partition([&](const size_t begin, const size_t end, const size_t) {
+			for (size_t i = begin; i < end; i++) {
+				CHECK_TRUE(threads[i] == std::this_thread::get_id())
+				CHECK_TRUE(cells[i][particles()].size() == i % 5)
+			}
+		});
+
+		// usable as a range of cells
+		std::vector<density_cell_t> densities(cells.size());
+		gensimcell::assign(densities, cells);
+		for (size_t i = 0; i < densities.size(); i++) {
+			CHECK_TRUE(densities[i][density()] == double(i))
+		}
+
+		auto moved = std::move(cells);
+		CHECK_TRUE(moved.size() == 1001)
+		CHECK_TRUE(cells.size() == 0)
+		CHECK_TRUE(moved.data()[1000][density()] == 1000)
+		CHECK_TRUE(nr_objects == 1001)
+
+		gensimcell::Partitioned_Cells<cell_t> empty(0, pool);
+		CHECK_TRUE(empty.begin() == empty.end())
+		empty = std::move(moved);
+		CHECK_TRUE(empty.size() == 1001)
+	}
+	CHECK_TRUE(nr_objects == 0)
+
+	// size of cells overflows
+	bool threw = false;
+	try {
+		gensimcell::Partitioned_Cells<cell_t> cells(
+			std::numeric_limits<size_t>::max() / 2,
+			pool
+		);
+	} catch (const std::bad_alloc&) {
+		threw = true;
+	}
+	CHECK_TRUE(threw)
+	CHECK_TRUE(nr_objects == 0)
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+/*
+Tests operators of ranges of generic cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdlib"
+#include "iostream"
+#include "vector"
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "range_operators.hpp"
+
+using namespace std;
+
+struct test_variable1 {
+	using data_type = int;
+};
+
+struct test_variable2 {
+	using data_type = std::array<double, 3>;
+};
+
+struct test_variable3 {
+	using data_type = std::vector<float>;
+};
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Optional_Transfer,
+	test_variable1,
+	test_variable2,
+	test_variable3
+>;
+
+int main(int, char**)
+{
+	const test_variable1 v1{};
+	const test_variable2 v2{};
+	const test_variable3 v3{};
+
+	std::vector<cell_t> cells1(5), cells2(5);
+	std::array<cell_t, 5> cells3;
+
+	gensimcell::fill(cells1, 1, v1, v2);
+	gensimcell::fill(cells2, 2, v1, v2);
+	for (size_t i = 0; i < cells1.size(); i++) {
+		cells1[i][v3].resize(i, 1);
+		cells2[i][v3].resize(i, 2);
+		CHECK_TRUE(cells1[i][v1] == 1)
+		CHECK_TRUE(cells1[i][v2][2] == 1)
+		CHECK_TRUE(cells2[i][v1] == 2)
+		CHECK_TRUE(cells2[i][v2][1] == 2)
+	}
+
+	gensimcell::plus_equal(cells1, cells2, v1, v3);
+	for (size_t i = 0; i < cells1.size(); i++) {
+		CHECK_TRUE(cells1[i][v1] == 3)
+		CHECK_TRUE(cells1[i][v2][0] == 1)
+		CHECK_TRUE(cells1[i][v3].size() == i)
+		for (const auto& item: cells1[i][v3]) {
+			CHECK_TRUE(item == 3)
+		}
+	}
+
+	gensimcell::minus_equal(cells1, cells2, v2);
+	gensimcell::mul_equal(cells1, cells2, v1);
+	for (const auto& cell: cells1) {
+		CHECK_TRUE(cell[v1] == 6)
+		CHECK_TRUE(cell[v2][1] == -1)
+	}
+
+	gensimcell::div_equal(cells1, cells2, v1, v2);
+	gensimcell::scale(cells1, 4, v2, v3);
+	for (const auto& cell: cells1) {
+		CHECK_TRUE(cell[v1] == 3)
+		CHECK_TRUE(cell[v2][2] == -2)
+		for (const auto& item: cell[v3]) {
+			CHECK_TRUE(item == 12)
+		}
+	}
+
+	// ranges of different size
+	std::vector<cell_t> cells4(2);
+	gensimcell::fill(cells4, 0, v1);
+	gensimcell::copy(cells1, cells4, v1, v3);
+	CHECK_TRUE(cells1[0][v1] == 0)
+	CHECK_TRUE(cells1[1][v1] == 0)
+	CHECK_TRUE(cells1[1][v3].size() == 0)
+	CHECK_TRUE(cells1[2][v1] == 3)
+	CHECK_TRUE(cells1[2][v3].size() == 2)
+
+	for (auto& cell: cells3) {
+		cell[v1] = 5;
+	}
+	gensimcell::scale(cells3, 2, v1);
+	gensimcell::plus_equal(cells3, cells3, v1);
+	for (const auto& cell: cells3) {
+		CHECK_TRUE(cell[v1] == 20)
+	}
+
+	return EXIT_SUCCESS;
+}
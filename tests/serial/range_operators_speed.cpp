@@ -0,0 +1,128 @@
+/*
+Compares speed of range and per cell operators of generic cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "chrono"
+#include "cstdlib"
+#include "iostream"
+#include "vector"
+
+#include "gensimcell.hpp"
+#include "range_operators.hpp"
+
+using namespace std;
+using namespace std::chrono;
+
+struct density
+{
+	using data_type = double;
+};
+
+struct density_flux
+{
+	using data_type = double;
+};
+
+struct velocity
+{
+	using data_type = std::array<double, 3>;
+};
+
+struct pressure
+{
+	using data_type = double;
+};
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Never_Transfer,
+	density,
+	density_flux,
+	velocity,
+	pressure
+>;
+
+
+int main(int, char**)
+{
+	constexpr size_t
+		number_of_cells = 100000,
+		max_turns = 1000;
+
+	std::vector<cell_t> state1(number_of_cells), state2(number_of_cells);
+	for (size_t i = 0; i < number_of_cells; i++) {
+		state1[i] = 1;
+		state2[i] = double(i % 7) / 7;
+	}
+
+	// per cell loop over variables
+	const auto per_cell_start = high_resolution_clock::now();
+	for (size_t turn = 0; turn < max_turns; turn++) {
+		for (size_t i = 0; i < number_of_cells; i++) {
+			state1[i].plus_equal(state2[i], density(), velocity(), pressure());
+		}
+	}
+	const auto per_cell_end = high_resolution_clock::now();
+
+	const double per_cell_result
+		= state1[number_of_cells - 1][density()]
+		+ state1[number_of_cells - 1][velocity()][2]
+		+ state1[number_of_cells - 1][pressure()];
+
+	for (auto& cell: state1) {
+		cell = 1;
+	}
+
+	// per variable loop over cells
+	const auto range_start = high_resolution_clock::now();
+	for (size_t turn = 0; turn < max_turns; turn++) {
+		gensimcell::plus_equal(state1, state2, density(), velocity(), pressure());
+	}
+	const auto range_end = high_resolution_clock::now();
+
+	const double range_result
+		= state1[number_of_cells - 1][density()]
+		+ state1[number_of_cells - 1][velocity()][2]
+		+ state1[number_of_cells - 1][pressure()];
+
+	if (per_cell_result != range_result) {
+		std::cerr << __FILE__ << ":" << __LINE__ << " FAILED" << std::endl;
+		abort();
+	}
+
+	cout << "Per cell: "
+		<< duration_cast<duration<double>>(per_cell_end - per_cell_start).count()
+		<< " s, range: "
+		<< duration_cast<duration<double>>(range_end - range_start).count()
+		<< " s" << endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+/*
+Tests for bulk reading of saved data of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "algorithm"
+#include "array"
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "fstream"
+#include "iostream"
+#include "string"
+#include "vector"
+
+#include "mpi.h"
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "read_cells.hpp"
+
+using namespace std;
+
+struct density { using data_type = double; };
+struct velocity { using data_type = std::array<float, 3>; };
+struct number { using data_type = std::uint16_t; };
+struct particles { using data_type = std::vector<std::array<double, 3>>; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Optional_Transfer,
+	density,
+	velocity,
+	number,
+	particles
+>;
+
+template<class T> void write_bytes(ofstream& file, const T& value)
+{
+	file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+
+	int rank = 0;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	const std::string file_name(
+		"tests/serial/read_cells.mexe." + std::to_string(rank) + ".dc"
+	);
+
+	/*
+	Write cells in reverse order after a header, data of
+	each cell is packed in the order of cell's variables
+	*/
+	constexpr size_t nr_cells = 100;
+	std::vector<std::uint64_t> file_offsets(nr_cells);
+	{
+		ofstream file(file_name, ios::binary);
+		file.write("header", 6);
+		for (size_t i = nr_cells - 1; i < nr_cells; i--) {
+			file_offsets[i] = std::uint64_t(file.tellp());
+			write_bytes(file, double(i));
+			write_bytes(file, std::array<float, 3>{{float(i), float(i + 1), float(i + 2)}});
+			write_bytes(file, std::uint16_t(i % 7));
+			for (size_t j = 0; j < i % 7; j++) {
+				write_bytes(file, std::array<double, 3>{{double(i), double(j), 0.0}});
+			}
+		}
+	}
+
+	MPI_File file;
+	CHECK_TRUE(
+		MPI_File_open(
+			MPI_COMM_SELF,
+			const_cast<char*>(file_name.c_str()),
+			MPI_MODE_RDONLY,
+			MPI_INFO_NULL,
+			&file
+		) == MPI_SUCCESS
+	)
+
+	// variables of fixed size with few bytes per chunk
+	cell_t::set_transfer_all(true, density(), velocity(), number());
+	cell_t::set_transfer_all(false, particles());
+	CHECK_TRUE(
+		gensimcell::detail::get_packed_blocks(cell_t()).second
+		== sizeof(double) + 3 * sizeof(float) + sizeof(std::uint16_t)
+	)
+	std::vector<cell_t> cells(nr_cells);
+	for (auto& cell: cells) {
+		cell[density()] = -1;
+	}
+	CHECK_TRUE(gensimcell::read_cells(file, file_offsets, cells, 100))
+	for (size_t i = 0; i < nr_cells; i++) {
+		CHECK_TRUE(cells[i][density()] == double(i))
+		CHECK_TRUE(cells[i][velocity()][0] == float(i))
+		CHECK_TRUE(cells[i][velocity()][2] == float(i + 2))
+		CHECK_TRUE(cells[i][number()] == i % 7)
+		CHECK_TRUE(cells[i][particles()].size() == 0)
+	}
+
+	// only some variables, cells are resized
+	cell_t::set_transfer_all(false, density(), velocity());
+	std::vector<cell_t> numbers;
+	auto number_offsets = file_offsets;
+	for (auto& offset: number_offsets) {
+		offset += sizeof(double) + 3 * sizeof(float);
+	}
+	CHECK_TRUE(gensimcell::read_cells(file, number_offsets, numbers))
+	CHECK_TRUE(numbers.size() == nr_cells)
+	for (size_t i = 0; i < nr_cells; i++) {
+		CHECK_TRUE(numbers[i][number()] == i % 7)
+	}
+
+	// variable length data after its length is known
+	cell_t::set_transfer_all(false, number());
+	cell_t::set_transfer_all(true, particles());
+	CHECK_TRUE(gensimcell::detail::get_packed_blocks(cell_t()).second == 0)
+	auto particle_offsets = number_offsets;
+	for (size_t i = 0; i < nr_cells; i++) {
+		particle_offsets[i] += sizeof(std::uint16_t);
+		cells[i][particles()].resize(cells[i][number()]);
+	}
+	CHECK_TRUE(gensimcell::read_cells(file, particle_offsets, cells, 100, 3))
+	for (size_t i = 0; i < nr_cells; i++) {
+		CHECK_TRUE(cells[i][particles()].size() == i % 7)
+		for (size_t j = 0; j < i % 7; j++) {
+			CHECK_TRUE(cells[i][particles()][j][0] == double(i))
+			CHECK_TRUE(cells[i][particles()][j][1] == double(j))
+		}
+	}
+
+	// file can be read normally afterwards
+	char header[7] = {0};
+	MPI_File_read_at(file, 0, header, 6, MPI_BYTE, MPI_STATUS_IGNORE);
+	CHECK_TRUE(std::string(header) == "header")
+
+	MPI_File_close(&file);
+	std::remove(file_name.c_str());
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
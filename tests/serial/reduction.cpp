@@ -0,0 +1,163 @@
+/*
+Tests reductions of cell variables.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdint"
+#include "cstdlib"
+#include "limits"
+#include "tuple"
+#include "vector"
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "partitioned_cells.hpp"
+#include "reduction.hpp"
+
+using namespace std;
+
+struct density { using data_type = double; };
+struct velocity { using data_type = std::array<float, 3>; };
+struct number { using data_type = std::uint64_t; };
+struct level { using data_type = int; };
+struct particles { using data_type = std::vector<double>; };
+
+using cell_t = gensimcell::Cell<
+	gensimcell::Optional_Transfer,
+	density,
+	velocity,
+	number,
+	level,
+	particles
+>;
+
+//! Sets data of cell with given index.
+void set_cell(cell_t& cell, const std::size_t index)
+{
+	cell[density()] = 0.25 * double(index % 97);
+	cell[velocity()] = {{float(index % 13), -float(index % 7), 1}};
+	cell[number()] = index;
+	cell[level()] = int(index % 11) - 5;
+	cell[particles()].resize(index % 3);
+}
+
+//! Checks reductions of given cells against loops over them.
+template<class Range> void check_reductions(
+	const Range& cells,
+	gensimcell::Thread_Pool& pool,
+	const std::size_t chunk_size
+) {
+	double total_density = 0;
+	std::array<float, 3>
+		min_velocity{{
+			std::numeric_limits<float>::max(),
+			std::numeric_limits<float>::max(),
+			std::numeric_limits<float>::max()
+		}},
+		max_velocity{{
+			std::numeric_limits<float>::lowest(),
+			std::numeric_limits<float>::lowest(),
+			std::numeric_limits<float>::lowest()
+		}};
+	std::uint64_t total_number = 0;
+	int max_level = std::numeric_limits<int>::lowest();
+	for (std::size_t i = 0; i < cells.size(); i++) {
+		const auto& cell = cells[i];
+		total_density += cell[density()];
+		for (std::size_t j = 0; j < 3; j++) {
+			min_velocity[j] = std::min(min_velocity[j], cell[velocity()][j]);
+			max_velocity[j] = std::max(max_velocity[j], cell[velocity()][j]);
+		}
+		total_number += cell[number()];
+		max_level = std::max(max_level, cell[level()]);
+	}
+
+	// sums of multiples of 0.25 are exact in any order
+	CHECK_TRUE((gensimcell::reduce<density>(cells, gensimcell::Reduction::sum, chunk_size, pool) == total_density))
+	CHECK_TRUE((gensimcell::reduce<velocity>(cells, gensimcell::Reduction::min, chunk_size, pool) == min_velocity))
+	CHECK_TRUE((gensimcell::reduce<velocity>(cells, gensimcell::Reduction::max, chunk_size, pool) == max_velocity))
+	CHECK_TRUE((gensimcell::reduce<number>(cells, gensimcell::Reduction::sum, chunk_size, pool) == total_number))
+	CHECK_TRUE((gensimcell::reduce<level>(cells, gensimcell::Reduction::max, chunk_size, pool) == max_level))
+
+	const auto reduced = gensimcell::reduce<density, velocity, number, level>(
+		cells,
+		{{
+			gensimcell::Reduction::sum,
+			gensimcell::Reduction::max,
+			gensimcell::Reduction::sum,
+			gensimcell::Reduction::max
+		}},
+		chunk_size,
+		pool
+	);
+	CHECK_TRUE(std::get<0>(reduced) == total_density)
+	CHECK_TRUE(std::get<1>(reduced) == max_velocity)
+	CHECK_TRUE(std::get<2>(reduced) == total_number)
+	CHECK_TRUE(std::get<3>(reduced) == max_level)
+
+	// same variable can be reduced with different operations
+	const auto velocity_range = gensimcell::reduce<velocity, velocity>(
+		cells,
+		{{gensimcell::Reduction::min, gensimcell::Reduction::max}},
+		chunk_size,
+		pool
+	);
+	CHECK_TRUE(std::get<0>(velocity_range) == min_velocity)
+	CHECK_TRUE(std::get<1>(velocity_range) == max_velocity)
+}
+
+int main(int, char**)
+{
+	gensimcell::Thread_Pool pool(4), serial_pool(1);
+
+	for (const std::size_t nr_of_cells: {std::size_t(0), std::size_t(1), std::size_t(255), std::size_t(2000)}) {
+		std::vector<cell_t> cells(nr_of_cells);
+		gensimcell::Partitioned_Cells<cell_t> partitioned(nr_of_cells, pool);
+		for (std::size_t i = 0; i < nr_of_cells; i++) {
+			set_cell(cells[i], i);
+			set_cell(partitioned[i], i);
+		}
+
+		for (const std::size_t chunk_size: {std::size_t(0), std::size_t(1), std::size_t(300), gensimcell::static_schedule}) {
+			check_reductions(cells, pool, chunk_size);
+			check_reductions(cells, serial_pool, chunk_size);
+			check_reductions(partitioned, pool, chunk_size);
+		}
+	}
+
+	// identities are returned for empty ranges
+	const std::vector<cell_t> empty;
+	CHECK_TRUE(gensimcell::reduce<density>(empty, gensimcell::Reduction::sum) == 0)
+	CHECK_TRUE(gensimcell::reduce<density>(empty, gensimcell::Reduction::min) == std::numeric_limits<double>::max())
+	CHECK_TRUE(gensimcell::reduce<level>(empty, gensimcell::Reduction::max) == std::numeric_limits<int>::lowest())
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+/*
+Tests for schema of saved data of generic simulation cells.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdio"
+#include "cstdlib"
+#include "iostream"
+#include "string"
+#include "vector"
+
+#ifdef HAVE_MPI
+#include "mpi.h"
+#endif
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "schema.hpp"
+
+using namespace std;
+
+struct density { using data_type = double; };
+struct velocity { using data_type = std::array<float, 3>; };
+struct particles { using data_type = std::vector<std::array<double, 3>>; };
+struct number { using data_type = unsigned short; };
+
+using cell_t = gensimcell::Cell<
+	#ifdef HAVE_MPI
+	gensimcell::Optional_Transfer,
+	#else
+	gensimcell::Never_Transfer,
+	#endif
+	density,
+	velocity,
+	particles,
+	number
+>;
+
+int main(int argc, char* argv[])
+{
+	#ifdef HAVE_MPI
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	#else
+	(void)argc;
+	(void)argv;
+	#endif
+
+	#ifdef HAVE_MPI
+	cell_t::set_transfer_all(true, density(), number());
+	cell_t::set_transfer_all(false, velocity(), particles());
+	#endif
+
+	cell_t cell;
+	auto schema = gensimcell::Schema::create(cell);
+
+	CHECK_TRUE(schema.variables.size() == 4)
+	CHECK_TRUE(schema.find("density") == 0)
+	CHECK_TRUE(schema.find("number") == 3)
+	CHECK_TRUE(schema.find("pressure") == 4)
+	CHECK_TRUE(schema.variables[1].element_type == gensimcell::Element_Type::floating_point)
+	CHECK_TRUE(schema.variables[1].element_count == 3)
+	CHECK_TRUE(schema.variables[2].variable_length)
+
+	#ifdef HAVE_MPI
+	CHECK_TRUE(schema.variables[0].transferred)
+	CHECK_TRUE(not schema.variables[1].transferred)
+	CHECK_TRUE(not schema.variables[2].transferred)
+	CHECK_TRUE(schema.variables[3].transferred)
+	CHECK_TRUE(schema.variables[0].packed_offset == 0)
+	CHECK_TRUE(schema.variables[3].packed_offset == sizeof(double))
+	CHECK_TRUE(schema.fixed_size == sizeof(double) + sizeof(unsigned short))
+	CHECK_TRUE(schema.variables[0].get_element_datatype() == MPI_DOUBLE)
+	CHECK_TRUE(schema.variables[3].get_element_datatype() == MPI_UINT16_T)
+
+	// data after a variable of variable length has no fixed offset
+	cell_t::set_transfer_all(true, velocity(), particles());
+	schema = gensimcell::Schema::create(cell);
+	CHECK_TRUE(schema.variables[1].packed_offset == sizeof(double))
+	CHECK_TRUE(schema.variables[2].packed_offset == sizeof(double) + 3 * sizeof(float))
+	CHECK_TRUE(schema.variables[3].packed_offset == gensimcell::unknown_packed_offset)
+	CHECK_TRUE(schema.fixed_size == sizeof(double) + 3 * sizeof(float))
+
+	// per cell transfers also have no fixed offset
+	cell_t::set_transfer_all(boost::logic::indeterminate, velocity());
+	cell_t::set_transfer_all(false, particles());
+	cell.set_transfer(true, velocity());
+	schema = gensimcell::Schema::create(cell);
+	CHECK_TRUE(schema.variables[1].transferred)
+	CHECK_TRUE(schema.variables[1].transfer_per_cell)
+	CHECK_TRUE(schema.variables[3].packed_offset == gensimcell::unknown_packed_offset)
+	#else
+	CHECK_TRUE(schema.variables[1].packed_offset == sizeof(double))
+	CHECK_TRUE(schema.variables[3].packed_offset == gensimcell::unknown_packed_offset)
+	#endif
+
+	const auto bytes = schema.to_bytes();
+	gensimcell::Schema decoded;
+	CHECK_TRUE(decoded.from_bytes(bytes))
+	CHECK_TRUE(decoded.to_bytes() == bytes)
+	CHECK_TRUE(decoded.fixed_size == schema.fixed_size)
+	CHECK_TRUE(decoded.variables.size() == schema.variables.size())
+	for (size_t i = 0; i < schema.variables.size(); i++) {
+		CHECK_TRUE(decoded.variables[i].name == schema.variables[i].name)
+		CHECK_TRUE(decoded.variables[i].element_type == schema.variables[i].element_type)
+		CHECK_TRUE(decoded.variables[i].element_count == schema.variables[i].element_count)
+		CHECK_TRUE(decoded.variables[i].transferred == schema.variables[i].transferred)
+		CHECK_TRUE(decoded.variables[i].packed_offset == schema.variables[i].packed_offset)
+	}
+
+	// invalid data is rejected without modifying the schema
+	CHECK_TRUE(not decoded.from_bytes(""))
+	CHECK_TRUE(not decoded.from_bytes(bytes.substr(0, bytes.size() - 1)))
+	CHECK_TRUE(not decoded.from_bytes(bytes + "x"))
+	auto corrupted = bytes;
+	corrupted[0] = 'X';
+	CHECK_TRUE(not decoded.from_bytes(corrupted))
+	CHECK_TRUE(decoded.variables.size() == schema.variables.size())
+
+	#ifdef HAVE_MPI
+	int rank = 0;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	const std::string file_name(
+		"tests/serial/schema.mexe." + std::to_string(rank) + ".schema"
+	);
+	#else
+	const std::string file_name("tests/serial/schema.exe.schema");
+	#endif
+	CHECK_TRUE(schema.write(file_name))
+	gensimcell::Schema from_file;
+	CHECK_TRUE(from_file.read(file_name))
+	CHECK_TRUE(from_file.to_bytes() == bytes)
+	std::remove(file_name.c_str());
+	CHECK_TRUE(not from_file.read(file_name))
+
+	#ifdef HAVE_MPI
+	MPI_Finalize();
+	#endif
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+/*
+Tests for the task graph of time step kernels.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "algorithm"
+#include "atomic"
+#include "chrono"
+#include "cstdlib"
+#include "thread"
+#include "vector"
+
+#include "check_true.hpp"
+#include "task_graph.hpp"
+
+using namespace std;
+
+struct density { using data_type = double; };
+struct flux { using data_type = double; };
+struct is_alive { using data_type = bool; };
+
+using gensimcell::Cell_Set;
+using gensimcell::reads;
+using gensimcell::writes;
+
+int main()
+{
+	gensimcell::Task_Graph graph;
+	std::vector<int> order;
+	std::atomic<int> counter(0);
+	std::vector<int> finished_at(20, -1);
+	const auto main_thread = std::this_thread::get_id();
+	std::atomic<bool> main_tasks_on_main_thread(true);
+
+	auto record = [&](const size_t index) {
+		return [&, index]() {
+			finished_at[index] = counter++;
+		};
+	};
+
+	// outer cells of density are written, then sent
+	const auto outer_solve = graph.add_task(
+		reads<density>(Cell_Set::outer) + writes<flux, density>(Cell_Set::outer),
+		record(0)
+	);
+	const auto exchange = graph.add_exchange(
+		reads<density>(Cell_Set::outer),
+		[&]() {
+			if (std::this_thread::get_id() != main_thread) {
+				main_tasks_on_main_thread = false;
+			}
+			finished_at[1] = counter++;
+		},
+		[&]() {
+			if (std::this_thread::get_id() != main_thread) {
+				main_tasks_on_main_thread = false;
+			}
+			finished_at[2] = counter++;
+		}
+	);
+	// independent of the exchange
+	const auto inner_solve = graph.add_task(
+		reads<density>(Cell_Set::local) + writes<flux>(Cell_Set::inner),
+		record(3)
+	);
+	const auto other_physics = graph.add_task(
+		writes<is_alive>(Cell_Set::all),
+		record(4)
+	);
+	// needs remote copies
+	const auto remote_solve = graph.add_task(
+		reads<density>(Cell_Set::all) + writes<flux>(Cell_Set::outer),
+		record(5)
+	);
+	// overwrites data read by inner solve
+	const auto inner_apply = graph.add_task(
+		reads<flux>(Cell_Set::inner) + writes<density>(Cell_Set::inner),
+		record(6)
+	);
+	// overwrites data being sent
+	const auto outer_apply = graph.add_task(
+		reads<flux>(Cell_Set::outer) + writes<density>(Cell_Set::outer),
+		record(7)
+	);
+	const auto reduction = graph.add_main_thread_task(
+		reads<flux>(Cell_Set::local),
+		[&]() {
+			if (std::this_thread::get_id() != main_thread) {
+				main_tasks_on_main_thread = false;
+			}
+			finished_at[8] = counter++;
+		}
+	);
+
+	CHECK_TRUE(graph.size() == 9)
+	CHECK_TRUE(exchange == 2)
+	CHECK_TRUE(graph.get_dependencies(outer_solve).size() == 0)
+	CHECK_TRUE(graph.get_dependencies(1) == std::vector<size_t>{outer_solve})
+	CHECK_TRUE(graph.get_dependencies(exchange) == std::vector<size_t>{1})
+	CHECK_TRUE(graph.get_dependencies(inner_solve) == std::vector<size_t>{outer_solve})
+	CHECK_TRUE(graph.get_dependencies(other_physics).size() == 0)
+	CHECK_TRUE(
+		graph.get_dependencies(remote_solve)
+		== (std::vector<size_t>{outer_solve, exchange})
+	)
+	CHECK_TRUE(
+		graph.get_dependencies(inner_apply)
+		== (std::vector<size_t>{inner_solve, remote_solve})
+	)
+	CHECK_TRUE(
+		graph.get_dependencies(outer_apply)
+		== (std::vector<size_t>{outer_solve, exchange, inner_solve, remote_solve})
+	)
+	CHECK_TRUE(
+		graph.get_dependencies(reduction)
+		== (std::vector<size_t>{exchange, inner_solve, remote_solve})
+	)
+
+	gensimcell::Thread_Pool pool(4), serial_pool(1);
+	for (auto* used_pool: {&pool, &serial_pool, &pool}) {
+		counter = 0;
+		std::fill(finished_at.begin(), finished_at.end(), -1);
+		graph.run(*used_pool);
+
+		CHECK_TRUE(counter == 9)
+		CHECK_TRUE(main_tasks_on_main_thread)
+		for (size_t task = 0; task < graph.size(); task++) {
+			for (const auto dependency: graph.get_dependencies(task)) {
+				CHECK_TRUE(finished_at[dependency] < finished_at[task])
+			}
+		}
+	}
+
+	// independent tasks run concurrently
+	gensimcell::Task_Graph concurrent;
+	std::atomic<int> started(0);
+	std::atomic<bool> overlapped(true);
+	for (int i = 0; i < 2; i++) {
+		concurrent.add_task(
+			i == 0 ? writes<density>(Cell_Set::all) : writes<flux>(Cell_Set::all),
+			[&]() {
+				started++;
+				const auto start = std::chrono::steady_clock::now();
+				while (started < 2) {
+					if (std::chrono::steady_clock::now() - start > std::chrono::seconds(10)) {
+						overlapped = false;
+						break;
+					}
+					std::this_thread::yield();
+				}
+			}
+		);
+	}
+	concurrent.run(pool);
+	CHECK_TRUE(overlapped)
+
+	// empty graph
+	gensimcell::Task_Graph().run(pool);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,159 @@
+/*
+Tests run time table of variables of generic simulation cell.
+
+Copyright 2016 Ilja Honkonen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the name of copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdlib"
+#include "cstring"
+#include "iostream"
+#include "vector"
+
+#ifdef HAVE_MPI
+#include "mpi.h"
+#endif
+
+#include "check_true.hpp"
+#include "gensimcell.hpp"
+#include "variable_table.hpp"
+
+using namespace std;
+
+namespace test {
+	struct density { using data_type = double; };
+}
+struct velocity { using data_type = std::array<float, 3>; };
+struct particles { using data_type = std::vector<std::array<double, 3>>; };
+struct number { using data_type = unsigned short; };
+struct alive { using data_type = bool; };
+
+using cell_t = gensimcell::Cell<
+	#ifdef HAVE_MPI
+	gensimcell::Optional_Transfer,
+	#else
+	gensimcell::Never_Transfer,
+	#endif
+	test::density,
+	velocity,
+	particles,
+	number,
+	alive
+>;
+
+int main(int argc, char* argv[])
+{
+	#ifdef HAVE_MPI
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	#else
+	(void)argc;
+	(void)argv;
+	#endif
+
+	using table_t = gensimcell::Variable_Table<cell_t>;
+
+	CHECK_TRUE(table_t::size() == 5)
+	CHECK_TRUE(table_t::get_table().size() == 5)
+
+	CHECK_TRUE(table_t::info(0).name == "test::density")
+	CHECK_TRUE(table_t::info(1).name == "velocity")
+	CHECK_TRUE(table_t::find("test::density") == 0)
+	CHECK_TRUE(table_t::find("density") == 0)
+	CHECK_TRUE(table_t::find("velocity") == 1)
+	CHECK_TRUE(table_t::find("alive") == 4)
+	CHECK_TRUE(table_t::find("ocity") == table_t::size())
+	CHECK_TRUE(table_t::find("pressure") == table_t::size())
+
+	CHECK_TRUE(table_t::info(0).size == sizeof(double))
+	CHECK_TRUE(table_t::info(0).trivially_copyable)
+	CHECK_TRUE(table_t::info(0).element_type == gensimcell::Element_Type::floating_point)
+	CHECK_TRUE(table_t::info(0).element_size == sizeof(double))
+	CHECK_TRUE(table_t::info(0).element_count == 1)
+
+	CHECK_TRUE(table_t::info(1).element_type == gensimcell::Element_Type::floating_point)
+	CHECK_TRUE(table_t::info(1).element_size == sizeof(float))
+	CHECK_TRUE(table_t::info(1).element_count == 3)
+
+	CHECK_TRUE(not table_t::info(0).variable_length)
+	CHECK_TRUE(not table_t::info(2).trivially_copyable)
+	CHECK_TRUE(table_t::info(2).variable_length)
+	CHECK_TRUE(table_t::info(2).element_type == gensimcell::Element_Type::floating_point)
+	CHECK_TRUE(table_t::info(2).element_count == 3)
+
+	CHECK_TRUE(table_t::info(3).element_type == gensimcell::Element_Type::unsigned_integer)
+	CHECK_TRUE(table_t::info(4).element_type == gensimcell::Element_Type::boolean)
+
+	cell_t cell;
+	cell[test::density()] = 3;
+	cell[velocity()] = {{1, 2, 3}};
+	cell[particles()].resize(2);
+	CHECK_TRUE(table_t::get(cell, 0) == &cell[test::density()])
+	CHECK_TRUE(table_t::get(cell, 1) == &cell[velocity()])
+	CHECK_TRUE(table_t::get(cell, 2) == &cell[particles()])
+	CHECK_TRUE(table_t::get(cell, 3) == &cell[number()])
+	CHECK_TRUE(table_t::get(cell, 4) == &cell[alive()])
+
+	// vector variable looked up by name
+	const auto particles_index = table_t::find("particles");
+	CHECK_TRUE(particles_index == 2)
+	CHECK_TRUE(table_t::info(particles_index).variable_length)
+	CHECK_TRUE(table_t::info(particles_index).size == sizeof(std::vector<std::array<double, 3>>))
+	auto* const particles_data = static_cast<std::vector<std::array<double, 3>>*>(
+		table_t::get(cell, particles_index)
+	);
+	CHECK_TRUE(particles_data->size() == 2)
+	(*particles_data)[1][2] = 4;
+	CHECK_TRUE(cell[particles()][1][2] == 4)
+
+	// copy bytes between cells without knowing variable types
+	cell_t other;
+	const cell_t& const_cell = cell;
+	for (size_t i = 0; i < table_t::size(); i++) {
+		const auto& info = table_t::info(i);
+		if (info.trivially_copyable) {
+			std::memcpy(table_t::get(other, i), table_t::get(const_cell, i), info.size);
+		}
+	}
+	CHECK_TRUE(other[test::density()] == 3)
+	CHECK_TRUE(other[velocity()][2] == 3)
+	CHECK_TRUE(other[particles()].size() == 0)
+
+	#ifdef HAVE_MPI
+	CHECK_TRUE(table_t::info(0).element_datatype == MPI_DOUBLE)
+	CHECK_TRUE(table_t::info(1).element_datatype == MPI_FLOAT)
+	CHECK_TRUE(table_t::info(2).element_datatype == MPI_DOUBLE)
+	CHECK_TRUE(table_t::info(3).element_datatype == MPI_UNSIGNED_SHORT)
+	MPI_Finalize();
+	#endif
+
+	return EXIT_SUCCESS;
+}